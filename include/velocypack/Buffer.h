@@ -27,11 +27,13 @@
 #ifndef VELOCYPACK_BUFFER_H
 #define VELOCYPACK_BUFFER_H 1
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Exception.h"
+#include "velocypack/Instrumentation.h"
 
 namespace arangodb {
 namespace velocypack {
@@ -235,6 +237,8 @@ class Buffer {
 #endif
     // copy old data
     memcpy(p, _buffer, checkOverflow(_pos));
+    VELOCYPACK_COUNT(BufferReallocations, 1);
+    VELOCYPACK_COUNT(BufferBytesCopied, _pos);
     if (_buffer != _local) {
       delete[] _buffer;
     }
@@ -242,6 +246,22 @@ class Buffer {
     _alloc = newLen;
   }
 
+  // hands the storage over to the caller, who must delete[] it. contents
+  // held in the local storage are copied to the heap first. afterwards
+  // the Buffer is empty
+  T* steal() {
+    T* result = _buffer;
+    if (_buffer == _local) {
+      result = new T[checkOverflow((std::max)(_pos, ValueLength(1)))];
+      memcpy(result, _buffer, checkOverflow(_pos));
+    }
+    _buffer = _local;
+    _alloc = sizeof(_local);
+    _pos = 0;
+    initWithNone();
+    return result;
+  }
+
   // reserve and zero fill
   void prealloc(ValueLength len) {
     reserve(len);
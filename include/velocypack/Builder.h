@@ -73,6 +73,17 @@ class Builder {
   bool _keyWritten;  // indicates that in the current object the key
                      // has been written but the value not yet
 
+  // State for Options::dedupeStrings. _stringTable is a small lossy
+  // hash table mapping the hash of a String value to its position + 1
+  // (0 = empty slot). _stringLog contains the positions and table slots
+  // of all Strings entered into the table, and _stringRefs the positions
+  // of all String references written, both in ascending order. They are
+  // needed to fix up positions and reference distances when close()
+  // moves down the members of a compound value
+  std::vector<ValueLength> _stringTable;
+  std::vector<std::pair<ValueLength, uint32_t>> _stringLog;
+  std::vector<ValueLength> _stringRefs;
+
   // Here are the mechanics of how this building process works:
   // The whole VPack being built starts at where _start points to
   // and uses at most _size bytes. The variable _pos keeps the
@@ -132,6 +143,10 @@ class Builder {
   static void sortObjectIndexLong(uint8_t* objBase,
                                   std::vector<ValueLength>& offsets);
 
+  // Check if the indices are already sorted by attribute name:
+  static bool isObjectIndexSorted(uint8_t const* objBase,
+                                  std::vector<ValueLength> const& offsets);
+
   static void sortObjectIndex(uint8_t* objBase,
                               std::vector<ValueLength>& offsets);
 
@@ -195,6 +210,9 @@ class Builder {
         _stack(that._stack),
         _index(that._index),
         _keyWritten(that._keyWritten),
+        _stringTable(that._stringTable),
+        _stringLog(that._stringLog),
+        _stringRefs(that._stringRefs),
         options(that.options) {
     if (options == nullptr) {
       throw Exception(Exception::InternalError, "Options cannot be a nullptr");
@@ -212,6 +230,9 @@ class Builder {
     _stack = that._stack;
     _index = that._index;
     _keyWritten = that._keyWritten;
+    _stringTable = that._stringTable;
+    _stringLog = that._stringLog;
+    _stringRefs = that._stringRefs;
     options = that.options;
     return *this;
   }
@@ -233,6 +254,12 @@ class Builder {
     _index.clear();
     _index.swap(that._index);
     _keyWritten = that._keyWritten;
+    _stringTable.clear();
+    _stringTable.swap(that._stringTable);
+    _stringLog.clear();
+    _stringLog.swap(that._stringLog);
+    _stringRefs.clear();
+    _stringRefs.swap(that._stringRefs);
     options = that.options;
     that._start = that._buffer->data();
     that._size = 0;
@@ -257,6 +284,12 @@ class Builder {
     _index.clear();
     _index.swap(that._index);
     _keyWritten = that._keyWritten;
+    _stringTable.clear();
+    _stringTable.swap(that._stringTable);
+    _stringLog.clear();
+    _stringLog.swap(that._stringLog);
+    _stringRefs.clear();
+    _stringRefs.swap(that._stringRefs);
     options = that.options;
     that._start = that._buffer->data();
     that._size = 0;
@@ -300,6 +333,7 @@ class Builder {
     _pos = 0;
     _stack.clear();
     _keyWritten = false;
+    resetStringDedupe();
   }
 
   // Return a pointer to the start of the result:
@@ -405,6 +439,17 @@ class Builder {
   // Add a slice to an array
   uint8_t* add(Slice const& sub);
 
+  // Add a packed Array of n numbers of the same type to an array, or as
+  // the value of an attribute whose name was added before
+  uint8_t* addPacked(int32_t const* values, ValueLength n);
+  uint8_t* addPacked(int64_t const* values, ValueLength n);
+  uint8_t* addPacked(uint64_t const* values, ValueLength n);
+  uint8_t* addPacked(double const* values, ValueLength n);
+
+  // Add a delta-encoded Array of n integers to an array, or as the value
+  // of an attribute whose name was added before
+  uint8_t* addDelta(int64_t const* values, ValueLength n);
+
   // Add a subvalue into an array from a ValuePair:
   uint8_t* add(ValuePair const& sub);
 
@@ -476,6 +521,18 @@ class Builder {
   bool closeCompactArrayOrObject(ValueLength tos, bool isArray,
                                  std::vector<ValueLength> const& index);
 
+  // close for the shaped array case:
+  bool closeShapedArray(ValueLength tos, std::vector<ValueLength> const& index);
+
+  // close for the packed array case:
+  bool closePackedArray(ValueLength tos, std::vector<ValueLength> const& index);
+
+  // close for the delta-encoded array case:
+  bool closeDeltaArray(ValueLength tos, std::vector<ValueLength> const& index);
+
+  template<typename T>
+  uint8_t* addPackedInternal(T const* values, ValueLength n);
+
   // close for the array case:
   Builder& closeArray(ValueLength tos, std::vector<ValueLength>& index);
 
@@ -701,6 +758,11 @@ class Builder {
 
   void addCompoundValue(uint8_t type) {
     reserveSpace(9);
+    if (_stack.empty()) {
+      // a new document starts. Strings must not be referenced across
+      // documents
+      resetStringDedupe();
+    }
     // an Array or Object is started:
     _stack.push_back(_pos);
     while (_stack.size() > _index.size()) {
@@ -743,6 +805,34 @@ class Builder {
 
   uint8_t* set(Slice const& item);
 
+  // copies an Array or Object member by member, resolving String
+  // references and turning rows of shaped Arrays into regular Objects
+  uint8_t* setMembers(Slice const& item);
+
+  // replaces the String value that was just written at pos with a
+  // reference to an earlier identical String value of the document,
+  // if there is one (only used with Options::dedupeStrings)
+  inline void dedupeString(ValueLength pos) {
+    if (options->dedupeStrings && !_stack.empty() && !_keyWritten) {
+      replaceWithStringReference(pos);
+    }
+  }
+
+  void replaceWithStringReference(ValueLength pos);
+
+  // adjusts the deduplication state before close() moves the members
+  // of the compound value at tos down by diff bytes
+  void shiftStringDedupe(ValueLength tos, ValueLength diff);
+
+  // forgets all Strings and references at or behind pos
+  void truncateStringDedupe(ValueLength pos);
+
+  void resetStringDedupe() {
+    if (!_stringLog.empty() || !_stringRefs.empty()) {
+      truncateStringDedupe(0);
+    }
+  }
+
   void cleanupAdd() {
     size_t depth = _stack.size() - 1;
     _index[depth].pop_back();
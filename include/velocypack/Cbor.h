@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_CBOR_H
+#define VELOCYPACK_CBOR_H 1
+
+#include <memory>
+#include <string>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Exception.h"
+#include "velocypack/Options.h"
+#include "velocypack/Sink.h"
+#include "velocypack/Slice.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// CBOR values with tag 1 (epoch-based date/time) are mapped to and from
+// ValueType::UTCDate. bignums (tags 2 and 3) are converted into integers
+// if they fit into 64 bits. all other tags are ignored, and only their
+// tagged data item is converted. the simple value "undefined" and
+// unassigned simple values are converted into null
+
+// This class converts CBOR data into VPack in a single pass.
+// It builds the result using the Builder.
+class CborParser {
+  std::shared_ptr<Builder> _b;
+  uint8_t const* _start;
+  size_t _size;
+  size_t _pos;
+  char const* _key;
+  size_t _keyLength;
+  std::string _keyBuffer;
+
+ public:
+  Options const* options;
+
+  CborParser(CborParser const&) = delete;
+  CborParser& operator=(CborParser const&) = delete;
+  ~CborParser() = default;
+
+  explicit CborParser(Options const* options = &Options::Defaults);
+
+  // This method produces a parser that does not own the builder
+  explicit CborParser(Builder& builder,
+                      Options const* options = &Options::Defaults);
+
+  Builder const& builder() const { return *_b; }
+
+  static std::shared_ptr<Builder> fromCbor(
+      uint8_t const* start, size_t size,
+      Options const* options = &Options::Defaults) {
+    CborParser parser(options);
+    parser.parse(start, size);
+    return parser.steal();
+  }
+
+  static std::shared_ptr<Builder> fromCbor(
+      std::string const& data, Options const* options = &Options::Defaults) {
+    CborParser parser(options);
+    parser.parse(data);
+    return parser.steal();
+  }
+
+  ValueLength parse(std::string const& data, bool multi = false) {
+    return parse(reinterpret_cast<uint8_t const*>(data.data()), data.size(),
+                 multi);
+  }
+
+  ValueLength parse(char const* start, size_t size, bool multi = false) {
+    return parse(reinterpret_cast<uint8_t const*>(start), size, multi);
+  }
+
+  // parses one value, or a sequence of values if multi is true. returns
+  // the number of values parsed
+  ValueLength parse(uint8_t const* start, size_t size, bool multi = false);
+
+  std::shared_ptr<Builder> steal() {
+    // Parser object is broken after a steal()
+    std::shared_ptr<Builder> res(_b);
+    _b.reset();
+    return res;
+  }
+
+  // Beware, only valid as long as you do not parse more, use steal
+  // to move the data out!
+  uint8_t const* start() { return _b->start(); }
+
+  // Returns the position at the time when the just reported error
+  // occurred, only use when handling an exception.
+  size_t errorPos() const { return _pos; }
+
+  void clear() { _b->clear(); }
+
+ private:
+  void parseValue();
+  void parseKey();
+  void parseArray(uint8_t info);
+  void parseObject(uint8_t info);
+  void parseString(uint8_t info, ValueType type);
+  void parseTag(uint64_t tag);
+  void parseSimple(uint8_t info);
+
+  uint8_t const* consume(uint64_t length);
+  uint64_t readArgument(uint8_t info);
+  double readFloat(uint8_t info);
+  bool checkBreak();
+  void readString(uint8_t info, uint8_t major, std::string& result,
+                  char const*& p, uint64_t& length);
+
+  template <typename T>
+  uint8_t* addValue(T const& value) {
+    if (_key != nullptr) {
+      char const* key = _key;
+      _key = nullptr;
+      return _b->add(key, _keyLength, value);
+    }
+    return _b->add(value);
+  }
+};
+
+// Dumps VPack into CBOR
+class CborDumper {
+ public:
+  Options const* options;
+
+  CborDumper(CborDumper const&) = delete;
+  CborDumper& operator=(CborDumper const&) = delete;
+
+  explicit CborDumper(Sink* sink, Options const* options = &Options::Defaults);
+
+  ~CborDumper() {}
+
+  Sink* sink() const { return _sink; }
+
+  void dump(Slice const& slice) {
+    _sink->reserve(slice.byteSize());
+    dumpValue(slice);
+  }
+
+  void dump(Slice const* slice) { dump(*slice); }
+
+  static void dump(Slice const& slice, Sink* sink,
+                   Options const* options = &Options::Defaults) {
+    CborDumper dumper(sink, options);
+    dumper.dump(slice);
+  }
+
+  // returns the CBOR data for the slice in a (binary) string
+  static std::string toString(Slice const& slice,
+                              Options const* options = &Options::Defaults) {
+    std::string buffer;
+    StringSink sink(&buffer);
+    dump(slice, &sink, options);
+    return buffer;
+  }
+
+ private:
+  void dumpValue(Slice const& slice);
+  void dumpInt(int64_t v);
+  void dumpDouble(double v);
+  void dumpUTCDate(int64_t v);
+  void appendHead(uint8_t major, uint64_t value);
+  void handleUnsupportedType(Slice const& slice);
+
+ private:
+  Sink* _sink;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
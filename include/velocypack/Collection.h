@@ -27,29 +27,183 @@
 #ifndef VELOCYPACK_COLLECTION_H
 #define VELOCYPACK_COLLECTION_H 1
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <functional>
+#include <initializer_list>
 #include <set>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Builder.h"
+#include "velocypack/Executor.h"
 #include "velocypack/Iterator.h"
 #include "velocypack/Slice.h"
+#include "velocypack/StringRef.h"
 
 namespace arangodb {
 namespace velocypack {
 
+// a set of attribute names for Collection::keep() and Collection::remove(),
+// sorted once so that it can be merge-joined with the sorted index tables
+// of Objects. the set only references the names, so they must stay valid
+// while the set is in use
+class SortedKeySet {
+ public:
+  SortedKeySet() {}
+
+  explicit SortedKeySet(std::vector<std::string> const& keys) {
+    _keys.reserve(keys.size());
+    for (auto const& it : keys) {
+      _keys.emplace_back(it);
+    }
+    prepare();
+  }
+
+  explicit SortedKeySet(std::vector<StringRef> keys) : _keys(std::move(keys)) {
+    prepare();
+  }
+
+  explicit SortedKeySet(std::initializer_list<char const*> keys) {
+    _keys.reserve(keys.size());
+    for (auto const& it : keys) {
+      _keys.emplace_back(it);
+    }
+    prepare();
+  }
+
+  // compares two attribute names in the order used for sorted index tables
+  static int compare(char const* lhs, size_t lhsLength, char const* rhs,
+                     size_t rhsLength) {
+    int res = memcmp(lhs, rhs, (std::min)(lhsLength, rhsLength));
+    if (res != 0) {
+      return res;
+    }
+    return (lhsLength < rhsLength) ? -1 : ((lhsLength > rhsLength) ? 1 : 0);
+  }
+
+  bool contains(char const* key, size_t length) const {
+    auto it = std::lower_bound(_keys.begin(), _keys.end(), StringRef(key, length), less);
+    return (it != _keys.end() &&
+            compare((*it).data(), (*it).size(), key, length) == 0);
+  }
+
+  bool contains(StringRef const& key) const {
+    return contains(key.data(), key.size());
+  }
+
+  // the attribute names, sorted and without duplicates
+  std::vector<StringRef> const& keys() const noexcept { return _keys; }
+
+  size_t size() const noexcept { return _keys.size(); }
+
+  bool empty() const noexcept { return _keys.empty(); }
+
+ private:
+  static bool less(StringRef const& lhs, StringRef const& rhs) {
+    return compare(lhs.data(), lhs.size(), rhs.data(), rhs.size()) < 0;
+  }
+
+  void prepare() {
+    std::sort(_keys.begin(), _keys.end(), less);
+    _keys.erase(std::unique(_keys.begin(), _keys.end(),
+                            [](StringRef const& lhs, StringRef const& rhs) {
+                              return compare(lhs.data(), lhs.size(), rhs.data(),
+                                             rhs.size()) == 0;
+                            }),
+                _keys.end());
+  }
+
+  std::vector<StringRef> _keys;
+};
+
+// execution policy for the parallel Collection algorithms. the members
+// of an Array are split into contiguous chunks of at least minChunkSize
+// members, which are processed concurrently on the executor. Arrays too
+// small for two chunks are processed sequentially by the calling thread
+struct ParallelPolicy {
+  ParallelPolicy() : executor(nullptr), minChunkSize(16384) {}
+  explicit ParallelPolicy(Executor* executor, ValueLength minChunkSize = 16384)
+      : executor(executor), minChunkSize(minChunkSize) {}
+
+  // executor to run the chunks on. nullptr means ThreadPool::instance()
+  Executor* executor;
+  ValueLength minChunkSize;
+};
+
+// the position of a value visited by Collection::visit(): one step per
+// enclosing Array or Object, from the outermost to the innermost. the
+// steps are updated in place while the visitor moves on, so a path is
+// only valid during the callback it was passed to
+class VisitPath {
+  friend class Collection;
+
+ public:
+  struct Step {
+    // the attribute name for Object members, None for Array members
+    Slice key;
+    // the position within the enclosing Array or Object
+    ValueLength index;
+
+    bool isArrayMember() const noexcept { return key.isNone(); }
+  };
+
+  VisitPath() = default;
+  VisitPath(VisitPath const&) = delete;
+  VisitPath& operator=(VisitPath const&) = delete;
+
+  // the nesting depth of the current value. the root value has depth 0
+  size_t size() const noexcept { return _steps.size(); }
+
+  bool empty() const noexcept { return _steps.empty(); }
+
+  Step const& operator[](size_t depth) const noexcept { return _steps[depth]; }
+
+  // the step leading to the current value. must not be called for the root
+  Step const& back() const noexcept { return _steps.back(); }
+
+  // returns the path in the form a.b[3].c
+  std::string toString() const;
+
+ private:
+  std::vector<Step> _steps;
+};
+
+// members of packed Arrays (see Options::buildPackedArrays) have no VPack
+// representation of their own. functions that only look at members one
+// at a time work for them, but functions that return or collect member
+// slices (find(), sort(), sortBy(), distinct(), groupBy(), the set
+// operations and the parallel variants) throw for packed Arrays
 class Collection {
  public:
   enum VisitationOrder { PreOrder = 1, PostOrder = 2 };
 
+  // return values for the callbacks of visit()
+  enum VisitDecision { Continue = 0, SkipChildren = 1, Stop = 2 };
+
+  // operations of the patches created by diff() (see there)
+  enum PatchOperation {
+    PatchRemove = 0,
+    PatchReplace = 1,
+    PatchObject = 2,
+    PatchArray = 3
+  };
+
   // indicator for "element not found" in indexOf() method
   static ValueLength const NotFound;
 
   typedef std::function<bool(Slice const&, ValueLength)> Predicate;
 
+  // used to restrict the template overloads below to callables with the
+  // signature of a Predicate
+  template<typename F>
+  using IfPredicate = decltype(std::declval<F&>()(
+      std::declval<Slice const&>(), std::declval<ValueLength>()));
+
   Collection() = delete;
   Collection(Collection const&) = delete;
   Collection& operator=(Collection const&) = delete;
@@ -102,6 +256,244 @@ class Collection {
     return any(*slice, predicate);
   }
 
+  // overloads of the above for any callable with the signature of a
+  // Predicate. the callable is invoked directly and can be inlined,
+  // whereas a Predicate needs an indirect call per member
+  template<typename F, typename = IfPredicate<F>>
+  static void forEach(Slice const& slice, F&& predicate) {
+    ArrayIterator it(slice);
+    ValueLength index = 0;
+
+    while (it.valid()) {
+      if (!predicate(it.value(), index)) {
+        // abort
+        return;
+      }
+      it.next();
+      ++index;
+    }
+  }
+
+  // the resulting Array is built with the given options, so it is built
+  // without index table if options->buildUnindexedArrays is set. the
+  // options must stay valid as long as the returned Builder is used
+  template<typename F, typename = IfPredicate<F>>
+  static Builder filter(Slice const& slice, F&& predicate,
+                        Options const* options = &Options::Defaults) {
+    // construct a new Array
+    Builder b(options);
+    b.add(Value(ValueType::Array));
+
+    ArrayIterator it(slice);
+    ValueLength index = 0;
+
+    while (it.valid()) {
+      Slice s = it.value();
+      if (predicate(s, index)) {
+        b.add(s);
+      }
+      it.next();
+      ++index;
+    }
+    b.close();
+    return b;
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static Slice find(Slice const& slice, F&& predicate) {
+    if (slice.isPackedArray()) {
+      throw Exception(Exception::InvalidValueType,
+                      "Members of packed Arrays have no VPack representation");
+    }
+    ArrayIterator it(slice);
+    ValueLength index = 0;
+
+    while (it.valid()) {
+      Slice s = it.value();
+      if (predicate(s, index)) {
+        return s;
+      }
+      it.next();
+      ++index;
+    }
+
+    return Slice();
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool contains(Slice const& slice, F&& predicate) {
+    return any(slice, std::forward<F>(predicate));
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool all(Slice const& slice, F&& predicate) {
+    ArrayIterator it(slice);
+    ValueLength index = 0;
+
+    while (it.valid()) {
+      if (!predicate(it.value(), index)) {
+        return false;
+      }
+      it.next();
+      ++index;
+    }
+
+    return true;
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool any(Slice const& slice, F&& predicate) {
+    ArrayIterator it(slice);
+    ValueLength index = 0;
+
+    while (it.valid()) {
+      if (predicate(it.value(), index)) {
+        return true;
+      }
+      it.next();
+      ++index;
+    }
+
+    return false;
+  }
+
+  // parallel overloads of the above for Arrays. the callable is invoked
+  // concurrently for members of different chunks, with their positions in
+  // the Array, and must be safe to call that way. once a callable aborted
+  // forEach or decided all or any, the remaining chunks stop early, but
+  // members of other chunks may still be visited before that
+  template<typename F, typename = IfPredicate<F>>
+  static void forEach(ParallelPolicy const& policy, Slice const& slice,
+                      F&& predicate) {
+    std::atomic<bool> abort(false);
+    forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+      Slice s(chunk.start);
+      for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+        if (abort.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (!predicate(s, i)) {
+          abort.store(true);
+          return;
+        }
+        s = Slice(s.start() + s.byteSize());
+      }
+    });
+  }
+
+  // the matching members of all chunks are concatenated in Array order
+  template<typename F, typename = IfPredicate<F>>
+  static Builder filter(ParallelPolicy const& policy, Slice const& slice,
+                        F&& predicate,
+                        Options const* options = &Options::Defaults) {
+    std::vector<std::vector<Slice>> results;
+    forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+      std::vector<Slice>& result = results[chunk.index];
+      Slice s(chunk.start);
+      for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+        if (predicate(s, i)) {
+          result.push_back(s);
+        }
+        s = Slice(s.start() + s.byteSize());
+      }
+    }, &results);
+
+    std::vector<Slice> members;
+    if (results.size() == 1) {
+      members.swap(results[0]);
+    } else {
+      size_t total = 0;
+      for (auto const& it : results) {
+        total += it.size();
+      }
+      members.reserve(total);
+      for (auto const& it : results) {
+        members.insert(members.end(), it.begin(), it.end());
+      }
+    }
+    return buildArray(members, options);
+  }
+
+  // returns the first matching member in Array order, as the sequential
+  // find() does. chunks stop once an earlier member has matched
+  template<typename F, typename = IfPredicate<F>>
+  static Slice find(ParallelPolicy const& policy, Slice const& slice,
+                    F&& predicate) {
+    std::atomic<ValueLength> first(NotFound);
+    std::vector<std::vector<Slice>> results;
+    forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+      Slice s(chunk.start);
+      for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+        if (first.load(std::memory_order_relaxed) < i) {
+          return;
+        }
+        if (predicate(s, i)) {
+          results[chunk.index].push_back(s);
+          ValueLength current = first.load();
+          while (i < current && !first.compare_exchange_weak(current, i)) {
+          }
+          return;
+        }
+        s = Slice(s.start() + s.byteSize());
+      }
+    }, &results);
+
+    // chunks are in Array order, so the first chunk with a match has the
+    // first matching member
+    for (auto const& it : results) {
+      if (!it.empty()) {
+        return it[0];
+      }
+    }
+    return Slice();
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool contains(ParallelPolicy const& policy, Slice const& slice,
+                       F&& predicate) {
+    return any(policy, slice, std::forward<F>(predicate));
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool all(ParallelPolicy const& policy, Slice const& slice,
+                  F&& predicate) {
+    std::atomic<bool> failed(false);
+    forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+      Slice s(chunk.start);
+      for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+        if (failed.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (!predicate(s, i)) {
+          failed.store(true);
+          return;
+        }
+        s = Slice(s.start() + s.byteSize());
+      }
+    });
+    return !failed.load();
+  }
+
+  template<typename F, typename = IfPredicate<F>>
+  static bool any(ParallelPolicy const& policy, Slice const& slice,
+                  F&& predicate) {
+    std::atomic<bool> found(false);
+    forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+      Slice s(chunk.start);
+      for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+        if (found.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (predicate(s, i)) {
+          found.store(true);
+          return;
+        }
+        s = Slice(s.start() + s.byteSize());
+      }
+    });
+    return found.load();
+  }
+
   static std::vector<std::string> keys(Slice const& slice);
 
   static std::vector<std::string> keys(Slice const* slice) {
@@ -193,6 +585,18 @@ class Collection {
     return remove(*slice, keys);
   }
 
+  // keep() and remove() for a precompiled set of attribute names. Objects
+  // with sorted index table are merge-joined with the set, and no
+  // attribute name is copied
+  static Builder keep(Slice const& slice, SortedKeySet const& keys);
+  static Builder remove(Slice const& slice, SortedKeySet const& keys);
+
+  // same as above, but write the resulting Object into builder
+  static Builder& keep(Builder& builder, Slice const& slice,
+                       SortedKeySet const& keys);
+  static Builder& remove(Builder& builder, Slice const& slice,
+                         SortedKeySet const& keys);
+
   static Builder merge(Slice const& left, Slice const& right, bool mergeValues, bool nullMeansRemove = false);
 
   static Builder merge(Slice const* left, Slice const* right,
@@ -201,6 +605,40 @@ class Collection {
   }
   static Builder& merge(Builder& builder, Slice const& left, Slice const& right, bool mergeValues, bool nullMeansRemove = false);
 
+  // returns a patch that turns oldValue into newValue when passed to
+  // apply(). a patch is an Array holding one operation:
+  //   []                     the values are equal
+  //   [PatchRemove]          remove the attribute (only inside PatchObject)
+  //   [PatchReplace, value]  replace the value, or add the attribute
+  //   [PatchObject, {name: patch, ...}]
+  //                          patch the attributes of an Object. attributes
+  //                          not mentioned are kept as they are
+  //   [PatchArray, length, index, patch, index, patch, ...]
+  //                          patch the members of an Array at the given
+  //                          ascending positions, and cut it to or extend
+  //                          it to length members
+  // Objects are compared by merge-joining their attribute names, Arrays
+  // position by position. values with equal bytes are not descended into,
+  // and nested patches that would be larger than the new value itself are
+  // replaced by it. the patch is built with the given options, which must
+  // stay valid as long as the returned Builder is used. if the values may
+  // contain String references, options->dedupeStrings must be set, so
+  // that subvalues are compared and copied by value instead of by bytes
+  static Builder diff(Slice const& oldValue, Slice const& newValue,
+                      Options const* options = &Options::Defaults);
+
+  // applies a patch created by diff() to value. throws InvalidValueType
+  // if the patch is invalid or does not match the value. the result is
+  // built with the given options, which must stay valid as long as the
+  // returned Builder is used. as for diff(), options->dedupeStrings must
+  // be set if value or patch may contain String references
+  static Builder apply(Slice const& value, Slice const& patch,
+                       Options const* options = &Options::Defaults);
+
+  // same as above, but write the resulting value into builder
+  static Builder& apply(Builder& builder, Slice const& value,
+                        Slice const& patch);
+
   static void visitRecursive(
       Slice const& slice, VisitationOrder order,
       std::function<bool(Slice const&, Slice const&)> const& func);
@@ -211,9 +649,274 @@ class Collection {
     visitRecursive(*slice, order, func);
   }
 
-  static Builder sort(
-      Slice const& array,
-      std::function<bool (Slice const&, Slice const&)> lessthan);
+  // visits the root value and all values nested in it in document order,
+  // parents before their members. func is called with the VisitPath to
+  // and the value itself, and decides whether to descend into the value,
+  // to skip its members or to stop the visitation altogether. keys of
+  // Objects are visited as part of the path only. nesting is tracked on
+  // the heap, so the depth of a document is not limited by the stack
+  template<typename F>
+  static void visit(Slice const& slice, F&& func) {
+    VisitPath path;
+    visit(slice, std::forward<F>(func), path);
+  }
+
+  // as above, reusing the memory of path for repeated visits
+  template<typename F>
+  static void visit(Slice const& slice, F&& func, VisitPath& path) {
+    VisitPath const& current = path;
+    path._steps.clear();
+    if (static_cast<VisitDecision>(func(current, slice)) != Continue) {
+      return;
+    }
+
+    std::vector<VisitFrame> frames;
+    enterFrame(slice, frames, path);
+    while (!frames.empty()) {
+      VisitFrame& frame = frames.back();
+      if (frame.index == frame.size) {
+        frames.pop_back();
+        path._steps.pop_back();
+        continue;
+      }
+
+      VisitPath::Step& step = path._steps.back();
+      step.index = frame.index++;
+      Slice value;
+      if (frame.isObject) {
+        Slice key(frame.currentKey != nullptr ? frame.currentKey
+                                              : frame.current);
+        step.key = key.makeKey();
+        if (frame.currentKey != nullptr) {
+          value = Slice(frame.current);
+          frame.currentKey += key.byteSize();
+        } else {
+          value = Slice(frame.current + key.byteSize());
+        }
+        frame.current = value.start() + value.byteSize();
+      } else if (frame.isPacked) {
+        value = Slice(frame.current).packedAt(step.index, frame.buffer);
+      } else {
+        value = Slice(frame.current);
+        frame.current = value.start() + value.byteSize();
+      }
+
+      VisitDecision decision =
+          static_cast<VisitDecision>(func(current, value));
+      if (decision == Stop) {
+        return;
+      }
+      if (decision == Continue) {
+        // may invalidate frame and step
+        enterFrame(value, frames, path);
+      }
+    }
+  }
+
+  // visits the members of a top-level Array concurrently, each chunk of
+  // members in order. func must be safe to call concurrently. returning
+  // false from func stops the visitation of all chunks. slices that are
+  // no Arrays are visited sequentially
+  static void visitRecursive(
+      ParallelPolicy const& policy, Slice const& slice, VisitationOrder order,
+      std::function<bool(Slice const&, Slice const&)> const& func);
+
+  // compares two VPack values by a total order over all types:
+  // MinKey < None < Illegal < Null < Bool < numbers < UTCDate < String <
+  // Binary < Array < Object < Custom < MaxKey. numbers of different
+  // types are compared by value, Strings and Binary byte-wise, Arrays
+  // element-wise and Objects by their sorted key/value pairs. Externals
+  // are compared by the values they point to.
+  // returns a negative value, 0 or a positive value
+  static int compare(Slice const& lhs, Slice const& rhs);
+
+  // sorts the members of an Array using the given comparator. with
+  // numThreads other than 1, Arrays with at least ParallelSortThreshold
+  // members are sorted in parallel by up to numThreads threads (0 means
+  // one per hardware thread). the comparator must then be safe to call
+  // concurrently
+  template<typename LessThan>
+  static Builder sort(Slice const& array, LessThan lessthan,
+                      size_t numThreads = 1) {
+    std::vector<Slice> members;
+    arrayMembers(array, members);
+    sortValues(members, lessthan, numThreads);
+    return buildArray(members);
+  }
+
+  // sorts the members of an Array by the total order of compare()
+  static Builder sort(Slice const& array);
+
+  // sorts the members of an Array by the value of the attribute at the
+  // given path, using the total order of compare(). members that are no
+  // Objects or lack the attribute sort as None. the attribute values are
+  // looked up once per member, and members with equal values keep their
+  // relative order
+  static Builder sortBy(Slice const& array,
+                        std::vector<std::string> const& path,
+                        bool ascending = true, size_t numThreads = 1);
+
+  static Builder sortBy(Slice const& array, std::string const& attribute,
+                        bool ascending = true, size_t numThreads = 1) {
+    return sortBy(array, std::vector<std::string>{attribute}, ascending,
+                  numThreads);
+  }
+
+  // returns the distinct members of an Array, in order of their first
+  // occurrence. values are considered equal if they are binary equal,
+  // as for contains() and indexOf(), except that String references are
+  // compared by the Strings they refer to and rows of shaped Arrays by
+  // their attributes. all set operations below use a hash table of the
+  // members and run in linear time
+  static Builder distinct(Slice const& array);
+
+  // returns the distinct members of lhs that are also contained in rhs
+  static Builder intersect(Slice const& lhs, Slice const& rhs);
+
+  // returns the distinct members of lhs and rhs, first those of lhs.
+  // (named unionOf because union is a reserved word)
+  static Builder unionOf(Slice const& lhs, Slice const& rhs);
+
+  // returns the distinct members of lhs that are not contained in rhs
+  static Builder difference(Slice const& lhs, Slice const& rhs);
+
+  // groups the members of an Array by the value of the attribute at the
+  // given path. returns an Array with one [value, [members...]] pair per
+  // distinct attribute value, in order of first occurrence. members that
+  // are no Objects or lack the attribute are grouped under null
+  static Builder groupBy(Slice const& array,
+                         std::vector<std::string> const& path);
+
+  static Builder groupBy(Slice const& array, std::string const& attribute) {
+    return groupBy(array, std::vector<std::string>{attribute});
+  }
+
+  // minimum number of Array members for sorting in parallel
+  static constexpr size_t ParallelSortThreshold = 65536;
+
+ private:
+  // collects the members of an Array, throws if slice is no Array or a
+  // packed Array
+  static void arrayMembers(Slice const& array, std::vector<Slice>& members);
+
+  // builds an Array from the given members in a single pre-sized pass
+  static Builder buildArray(std::vector<Slice> const& members,
+                            Options const* options = &Options::Defaults);
+
+  // an Array or Object entered by visit()
+  struct VisitFrame {
+    uint8_t const* current;  // the next member, or its key for Objects.
+                             // the Array itself for packed Arrays
+    uint8_t const* currentKey;  // the next key in the shape, only used
+                                // for rows of shaped Arrays
+    ValueLength index;
+    ValueLength size;
+    bool isObject;
+    bool isPacked;
+    uint8_t buffer[9];  // the current member of a packed Array
+  };
+
+  // pushes a frame for value if it is a non-empty Array or Object
+  static void enterFrame(Slice const& value, std::vector<VisitFrame>& frames,
+                         VisitPath& path);
+
+  // a contiguous range of Array members, processed by one task
+  struct ArrayChunk {
+    size_t index;
+    ValueLength from;
+    ValueLength to;
+    uint8_t const* start;  // the member at position from
+  };
+
+  // splits the members of an Array into chunks according to the policy.
+  // throws if slice is no Array or a packed Array
+  static void arrayChunks(ParallelPolicy const& policy, Slice const& array,
+                          std::vector<ArrayChunk>& chunks);
+
+  // runs body for each chunk of the Array, concurrently if there is more
+  // than one chunk. results is resized to the number of chunks first
+  template<typename Body, typename Result = int>
+  static void forEachChunk(ParallelPolicy const& policy, Slice const& array,
+                           Body&& body,
+                           std::vector<Result>* results = nullptr) {
+    std::vector<ArrayChunk> chunks;
+    arrayChunks(policy, array, chunks);
+    if (results != nullptr) {
+      results->resize(chunks.size());
+    }
+    if (chunks.size() == 1) {
+      body(chunks[0]);
+      return;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(chunks.size());
+    for (auto const& chunk : chunks) {
+      tasks.emplace_back([&body, &chunk]() { body(chunk); });
+    }
+    executorFor(policy).run(tasks);
+  }
+
+  static Executor& executorFor(ParallelPolicy const& policy) {
+    if (policy.executor != nullptr) {
+      return *policy.executor;
+    }
+    return ThreadPool::instance();
+  }
+
+  // determines the number of threads to sort n values with
+  static size_t sortThreads(size_t n, size_t numThreads);
+
+  // runs the given tasks on the built-in thread pool, and rethrows the
+  // first exception thrown by any of them after all have finished
+  static void runParallel(std::vector<std::function<void()>> const& tasks);
+
+  // sorts the values in chunks, one per thread, and merges the sorted
+  // chunks pairwise
+  template<typename T, typename LessThan>
+  static void sortValues(std::vector<T>& values, LessThan const& lessthan,
+                         size_t numThreads) {
+    size_t const n = values.size();
+    numThreads = sortThreads(n, numThreads);
+    if (numThreads <= 1) {
+      std::sort(values.begin(), values.end(), lessthan);
+      return;
+    }
+
+    std::vector<size_t> bounds;
+    for (size_t i = 0; i <= numThreads; ++i) {
+      bounds.push_back(n * i / numThreads);
+    }
+
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < numThreads; ++i) {
+      tasks.emplace_back([&values, &lessthan, &bounds, i]() {
+        std::sort(values.begin() + bounds[i], values.begin() + bounds[i + 1],
+                  lessthan);
+      });
+    }
+    runParallel(tasks);
+
+    for (size_t width = 1; width < numThreads; width *= 2) {
+      tasks.clear();
+      for (size_t i = 0; i + width < numThreads; i += 2 * width) {
+        size_t const last = (std::min)(i + 2 * width, numThreads);
+        tasks.emplace_back([&values, &lessthan, &bounds, i, width, last]() {
+          std::inplace_merge(values.begin() + bounds[i],
+                             values.begin() + bounds[i + width],
+                             values.begin() + bounds[last], lessthan);
+        });
+      }
+      runParallel(tasks);
+    }
+  }
+};
+
+// comparator for sorting by the total order of Collection::compare()
+struct NormalizedLess {
+  bool operator()(Slice const& lhs, Slice const& rhs) const {
+    return Collection::compare(lhs, rhs) < 0;
+  }
 };
 
 struct IsEqualPredicate {
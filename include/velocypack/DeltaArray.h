@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_DELTAARRAY_H
+#define VELOCYPACK_DELTAARRAY_H 1
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Exception.h"
+#include "velocypack/PackedArray.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// zig-zag encoding maps integers of small magnitude to small unsigned
+// integers, so that they can be stored as short varints
+static inline uint64_t zigZagEncode(int64_t value) noexcept {
+  return (static_cast<uint64_t>(value) << 1) ^
+         (value < 0 ? ~static_cast<uint64_t>(0) : 0);
+}
+
+static inline int64_t zigZagDecode(uint64_t value) noexcept {
+  return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+// encodes n integers as a delta-encoded Array, including its type byte,
+// and appends it to out
+void encodeDeltaArray(int64_t const* values, ValueLength n,
+                      std::vector<uint8_t>& out);
+
+// writes value into buffer as a regular VPack Int, encoded as a Builder
+// would encode it. buffer must have room for 9 bytes
+static inline void storeDeltaMember(uint8_t* buffer, int64_t value) noexcept {
+  storePackedInt(buffer, value);
+}
+
+// read-only view on the members of a delta-encoded Array, as returned by
+// Slice::getDelta(). Members are stored in blocks of blockSize, each
+// with its first member and the smallest difference between two
+// consecutive members. All other differences are stored relative to
+// that with 0, 1, 2, 4 or 8 bytes each, so decoding a member takes at
+// most blockSize - 1 additions
+class DeltaSpan {
+ public:
+  static constexpr ValueLength blockSize = 64;
+
+  // decodes the members one after the other
+  class iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef int64_t value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef int64_t const* pointer;
+    typedef int64_t reference;
+
+    iterator() noexcept
+        : _p(nullptr), _value(0), _step(0), _index(0), _size(0), _left(0),
+          _width(0) {}
+
+    iterator(uint8_t const* block, ValueLength index, ValueLength size) noexcept
+        : _p(block), _value(0), _step(0), _index(index), _size(size),
+          _left(0), _width(0) {
+      if (_index < _size) {
+        readBlock();
+      }
+    }
+
+    int64_t operator*() const noexcept { return static_cast<int64_t>(_value); }
+
+    iterator& operator++() noexcept {
+      if (++_index < _size) {
+        if (_left > 0) {
+          _value += _step + readDelta(_p, _width);
+          _p += _width;
+          --_left;
+        } else {
+          // the next block follows the current one
+          readBlock();
+        }
+      }
+      return *this;
+    }
+
+    iterator operator++(int) noexcept {
+      iterator result(*this);
+      ++(*this);
+      return result;
+    }
+
+    bool operator==(iterator const& other) const noexcept {
+      return _index == other._index;
+    }
+
+    bool operator!=(iterator const& other) const noexcept {
+      return _index != other._index;
+    }
+
+    ValueLength index() const noexcept { return _index; }
+
+   private:
+    void readBlock() noexcept {
+      ValueLength const members = (std::min)(blockSize, _size - _index);
+      _p = readBlockHeader(_p, members, _value, _step, _width);
+      _left = members - 1;
+    }
+
+    uint8_t const* _p;
+    uint64_t _value;
+    uint64_t _step;
+    ValueLength _index;
+    ValueLength _size;
+    ValueLength _left;
+    uint8_t _width;
+  };
+
+  // start must point to the type byte of a delta-encoded Array
+  explicit DeltaSpan(uint8_t const* start) noexcept;
+
+  ValueLength size() const noexcept { return _size; }
+
+  bool empty() const noexcept { return _size == 0; }
+
+  int64_t operator[](ValueLength index) const noexcept {
+    return *iteratorAt(index);
+  }
+
+  int64_t at(ValueLength index) const {
+    if (index >= _size) {
+      throw Exception(Exception::IndexOutOfBounds);
+    }
+    return operator[](index);
+  }
+
+  iterator begin() const noexcept { return iterator(_blocks, 0, _size); }
+
+  iterator end() const noexcept { return iterator(nullptr, _size, _size); }
+
+  // returns an iterator positioned at the specified member
+  iterator iteratorAt(ValueLength index) const noexcept;
+
+  // decodes all members into out, which must have room for size() values.
+  // uses the vectorized decoder if available
+  void copyTo(int64_t* out) const;
+
+  // reads the header of a block with the specified number of members and
+  // returns the start of its differences
+  static uint8_t const* readBlockHeader(uint8_t const* p, ValueLength members,
+                                        uint64_t& base, uint64_t& step,
+                                        uint8_t& width) noexcept {
+    base = static_cast<uint64_t>(
+        zigZagDecode(readVariableValueLength<false>(p)));
+    p += getVariableValueLengthSize(p);
+    step = 0;
+    width = 0;
+    if (members > 1) {
+      step = static_cast<uint64_t>(
+          zigZagDecode(readVariableValueLength<false>(p)));
+      p += getVariableValueLengthSize(p);
+      width = *p++;
+    }
+    return p;
+  }
+
+  // reads a single difference with the specified byte width
+  static uint64_t readDelta(uint8_t const* p, uint8_t width) noexcept {
+    switch (width) {
+      case 0:
+        return 0;
+      case 1:
+        return *p;
+      case 2:
+        return readIntegerFixed<uint64_t, 2>(p);
+      case 4:
+        return readIntegerFixed<uint64_t, 4>(p);
+      default:
+        return readIntegerFixed<uint64_t, 8>(p);
+    }
+  }
+
+ private:
+  uint8_t const* blockStart(ValueLength block) const noexcept;
+
+  uint8_t const* _start;
+  // the first block
+  uint8_t const* _blocks;
+  // offsets of all blocks but the first, 4 bytes each
+  uint8_t const* _offsets;
+  ValueLength _size;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
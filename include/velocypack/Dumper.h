@@ -41,6 +41,9 @@ namespace velocypack {
 // Dumps VPack into a JSON output string
 class Dumper {
  public:
+  // default number of VPack bytes per range in dumpParallel()
+  static constexpr ValueLength DefaultParallelChunkSize = 4 * 1024 * 1024;
+
   Options const* options;
 
   Dumper(Dumper const&) = delete;
@@ -68,6 +71,17 @@ class Dumper {
 
   void dump(Slice const* slice) { dump(*slice); }
 
+  // dumps the slice like dump(), but converts the members of a top-level
+  // Array or Object concurrently. the members are split into ranges of
+  // roughly chunkSize bytes of VPack each, which are dumped into per-thread
+  // buffers by up to numThreads worker threads (0 means one per hardware
+  // thread). the buffers are written to the sink in order, so the output is
+  // identical to that of dump(). values that are too small to be split fall
+  // back to dump(). if a customTypeHandler is set in the options, it will
+  // be called from the worker threads
+  void dumpParallel(Slice const& slice, size_t numThreads = 0,
+                    ValueLength chunkSize = DefaultParallelChunkSize);
+
   static void dump(Slice const& slice, Sink* sink,
                    Options const* options = &Options::Defaults) {
     Dumper dumper(sink, options);
@@ -79,6 +93,13 @@ class Dumper {
     dump(*slice, sink, options);
   }
 
+  static void dumpParallel(Slice const& slice, Sink* sink,
+                           Options const* options = &Options::Defaults,
+                           size_t numThreads = 0) {
+    Dumper dumper(sink, options);
+    dumper.dumpParallel(slice, numThreads);
+  }
+
   static std::string toString(Slice const& slice,
                               Options const* options = &Options::Defaults) {
     std::string buffer;
@@ -127,6 +148,12 @@ class Dumper {
 
   void dumpValue(Slice const*, Slice const* = nullptr);
 
+  // dump the members [from, to) of an Array or Object, including their
+  // separators and indentation, but without the enclosing brackets
+  void dumpArrayRange(Slice const*, ValueLength from, ValueLength to);
+
+  void dumpObjectRange(Slice const*, ValueLength from, ValueLength to);
+
   void indent() {
     size_t n = _indentation;
     _sink->reserve(2 * n);
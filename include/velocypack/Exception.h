@@ -70,6 +70,12 @@ struct Exception : std::exception {
 
     ValidatorInvalidLength = 50,
     ValidatorInvalidType = 51,
+    ValidatorNestingTooDeep = 52,
+    ValidatorInvalidKeyOrder = 53,
+
+    FileError = 60,
+    FileInvalidFormat = 61,
+    FileChecksumMismatch = 62,
 
     UnknownError = 999
   };
@@ -147,6 +153,17 @@ struct Exception : std::exception {
         return "Invalid type found in binary data";
       case ValidatorInvalidLength:
         return "Invalid length found in binary data";
+      case ValidatorNestingTooDeep:
+        return "Nesting of compound values exceeds the allowed depth";
+      case ValidatorInvalidKeyOrder:
+        return "Attribute names of sorted Object are not in order";
+
+      case FileError:
+        return "Cannot access file";
+      case FileInvalidFormat:
+        return "Invalid file format";
+      case FileChecksumMismatch:
+        return "Checksum mismatch";
 
       case UnknownError:
       default:
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+
+#ifndef VELOCYPACK_EXECUTOR_H
+#define VELOCYPACK_EXECUTOR_H 1
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// interface for running the tasks of the parallel Collection algorithms.
+// implement this to run them on an application's own threads
+class Executor {
+ public:
+  virtual ~Executor() {}
+
+  // number of tasks that can run at the same time
+  virtual size_t concurrency() const = 0;
+
+  // runs all tasks and returns when all of them have finished. if tasks
+  // throw, the first exception is rethrown after all tasks have finished
+  virtual void run(std::vector<std::function<void()>> const& tasks) = 0;
+};
+
+// small work-stealing thread pool. the tasks of a run() call are spread
+// over the workers' queues, and idle workers steal from the other queues.
+// the thread calling run() helps executing tasks while it waits
+class ThreadPool final : public Executor {
+ public:
+  // creates a pool with the given concurrency, including the calling
+  // thread. 0 means one per hardware thread
+  explicit ThreadPool(size_t concurrency = 0);
+  ~ThreadPool();
+
+  ThreadPool(ThreadPool const&) = delete;
+  ThreadPool& operator=(ThreadPool const&) = delete;
+
+  size_t concurrency() const override { return _queues.size(); }
+
+  void run(std::vector<std::function<void()>> const& tasks) override;
+
+  // the pool used by default, created on first use
+  static ThreadPool& instance();
+
+ private:
+  struct Batch;
+
+  struct Task {
+    Batch* batch;
+    size_t index;
+  };
+
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  // takes a task from the given queue, or steals one from another queue
+  bool take(size_t queue, Task& task);
+  void execute(Task const& task);
+  void work(size_t queue);
+
+  // one queue per worker, plus one for the threads calling run()
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+  std::atomic<size_t> _next;
+
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
+  size_t _pending;
+  bool _stop;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
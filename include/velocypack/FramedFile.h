@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_FRAMEDFILE_H
+#define VELOCYPACK_FRAMEDFILE_H 1
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Collection.h"
+#include "velocypack/Exception.h"
+#include "velocypack/Slice.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// Framed files store many VPack documents in one file: a header, the
+// documents with their lengths and optional checksums, and an index with
+// the offsets of all documents at the end (see VelocyPack.md)
+
+// writes documents into a framed file. documents are appended one after
+// the other, and finish() writes the index. a writer that is destroyed
+// without finish() being called finishes the file itself
+class FramedFileWriter {
+ public:
+  // creates the file, or truncates it if it exists. with checksums, the
+  // XXH64 hash of every document is stored after it
+  explicit FramedFileWriter(std::string const& path, bool checksums = true);
+  ~FramedFileWriter();
+
+  FramedFileWriter(FramedFileWriter const&) = delete;
+  FramedFileWriter& operator=(FramedFileWriter const&) = delete;
+
+  // appends a document, which must be a complete VPack value
+  void append(Slice const& document);
+
+  // number of documents appended so far
+  ValueLength size() const noexcept { return _offsets.size(); }
+
+  // writes the index and closes the file. no documents can be appended
+  // afterwards
+  void finish();
+
+ private:
+  void write(uint8_t const* data, ValueLength size);
+
+  std::string _path;
+  std::ofstream _out;
+  std::vector<ValueLength> _offsets;
+  ValueLength _position;
+  bool _checksums;
+  bool _finished;
+};
+
+// gives access to the documents of a framed file. the file is mapped into
+// memory, and documents are located through the index in O(1). the
+// Slices returned point into the mapping and stay valid as long as the
+// reader exists
+class FramedFileReader {
+ public:
+  // iterates over the documents of a range
+  class iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef Slice value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Slice const* pointer;
+    typedef Slice reference;
+
+    iterator(FramedFileReader const* reader, ValueLength index) noexcept
+        : _reader(reader), _index(index) {}
+
+    Slice operator*() const { return _reader->document(_index); }
+
+    iterator& operator++() noexcept {
+      ++_index;
+      return *this;
+    }
+
+    iterator operator++(int) noexcept {
+      iterator result(*this);
+      ++_index;
+      return result;
+    }
+
+    bool operator==(iterator const& other) const noexcept {
+      return _index == other._index;
+    }
+
+    bool operator!=(iterator const& other) const noexcept {
+      return _index != other._index;
+    }
+
+    ValueLength index() const noexcept { return _index; }
+
+   private:
+    FramedFileReader const* _reader;
+    ValueLength _index;
+  };
+
+  // a contiguous range of documents [from, to), e.g. for scanning a file
+  // with several threads
+  struct Range {
+    FramedFileReader const* reader;
+    ValueLength from;
+    ValueLength to;
+
+    iterator begin() const noexcept { return iterator(reader, from); }
+    iterator end() const noexcept { return iterator(reader, to); }
+    ValueLength size() const noexcept { return to - from; }
+  };
+
+  // maps the file into memory and checks its header and index. throws
+  // FileError if the file cannot be read and FileInvalidFormat if it is
+  // no complete framed file
+  explicit FramedFileReader(std::string const& path);
+
+  // reads a framed file from memory, which must stay valid as long as
+  // the reader exists
+  FramedFileReader(uint8_t const* data, ValueLength size);
+
+  ~FramedFileReader();
+
+  FramedFileReader(FramedFileReader const&) = delete;
+  FramedFileReader& operator=(FramedFileReader const&) = delete;
+
+  // number of documents
+  ValueLength size() const noexcept { return _size; }
+
+  bool empty() const noexcept { return _size == 0; }
+
+  bool hasChecksums() const noexcept { return _checksums; }
+
+  // returns the document at the specified index. the frame of the
+  // document is checked against the index, but the document itself is
+  // not validated (see verify())
+  Slice document(ValueLength index) const;
+
+  Slice operator[](ValueLength index) const { return document(index); }
+
+  // checks the checksum of the document at the specified index, if the
+  // file has checksums, and validates the document. throws
+  // FileChecksumMismatch or the Validator's exceptions
+  void verify(ValueLength index, Options const* options = &Options::Defaults) const;
+
+  iterator begin() const noexcept { return iterator(this, 0); }
+
+  iterator end() const noexcept { return iterator(this, _size); }
+
+  // splits the documents into at most count ranges of about equal size
+  std::vector<Range> split(ValueLength count) const;
+
+  // invokes the callable with every document and its index. documents of
+  // different ranges are processed concurrently on the policy's executor,
+  // so the callable must be safe to call that way. once it returns false,
+  // the remaining ranges stop early
+  template<typename F>
+  void forEach(ParallelPolicy const& policy, F&& callable) const {
+    if (_size == 0) {
+      return;
+    }
+    ValueLength const minChunkSize =
+        (std::max)(policy.minChunkSize, ValueLength(1));
+    Executor& executor = policy.executor != nullptr ? *policy.executor
+                                                    : ThreadPool::instance();
+    std::vector<Range> ranges =
+        split((std::min)(_size / minChunkSize,
+                         ValueLength(executor.concurrency() * 4)));
+
+    std::atomic<bool> abort(false);
+    auto scan = [&](Range const& range) {
+      for (ValueLength i = range.from; i < range.to; ++i) {
+        if (abort.load(std::memory_order_relaxed)) {
+          return;
+        }
+        if (!callable(document(i), i)) {
+          abort.store(true);
+          return;
+        }
+      }
+    };
+    if (ranges.size() == 1) {
+      scan(ranges[0]);
+      return;
+    }
+
+    std::vector<std::function<void()>> tasks;
+    tasks.reserve(ranges.size());
+    for (auto const& range : ranges) {
+      tasks.emplace_back([&scan, &range]() { scan(range); });
+    }
+    executor.run(tasks);
+  }
+
+ private:
+  void init();
+
+  // returns the start and the length of the document at the specified
+  // index, after checking its frame against the index
+  uint8_t const* locate(ValueLength index, ValueLength& length) const;
+
+  uint8_t const* _data;
+  ValueLength _fileSize;
+  uint8_t const* _index;
+  ValueLength _indexOffset;
+  ValueLength _size;
+  // mapping or buffer owned by the reader, if any
+  void* _mapping;
+  std::vector<uint8_t> _buffer;
+  bool _checksums;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_INSTRUMENTATION_H
+#define VELOCYPACK_INSTRUMENTATION_H 1
+
+#include <cstdint>
+
+#include "velocypack/velocypack-common.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// counters for what the library does internally, to tune Options for a
+// workload. the counters are only maintained if the library is built with
+// the CMake option EnableInstrumentation, which defines
+// VELOCYPACK_INSTRUMENTATION. otherwise the hooks in the library compile
+// to nothing and all counters stay 0.
+// every thread counts into its own counters, so counting needs no
+// synchronization. the counters of finished threads are kept in a global
+// total
+struct Instrumentation {
+  enum Counter : uint32_t {
+    BufferReallocations = 0,   // Buffer grown to a new allocation
+    BufferBytesCopied,         // bytes copied into grown Buffers
+    BuilderCloseMemmoves,      // members moved down when closing a value
+    BuilderCloseBytesMoved,    // bytes moved by these
+    ObjectIndexSorts,          // Object indexes sorted by Builder::close()
+    ObjectIndexSortedMembers,  // members of these Objects
+    CompactArrays,             // Arrays closed in compact format
+    IndexedArrays,             // Arrays closed with index or equal sizes
+    CompactObjects,            // Objects closed in compact format
+    IndexedObjects,            // Objects closed with sorted index
+    BinaryKeySearches,         // Slice::get() with binary search
+    LinearKeySearches,         // Slice::get() with linear search
+    ParserSimdCalls,           // SSE4.2 string copy / whitespace skip calls
+    ParserScalarCalls,         // portable string copy / whitespace skip calls
+    StringReferences,          // String values replaced by references
+    ShapedArrays,              // Arrays closed in shaped format
+    PackedArrays,              // Arrays closed in packed format
+    PackedSimdCalls,           // SSE4.2 aggregations of packed Arrays
+    PackedScalarCalls,         // portable aggregations of packed Arrays
+    DeltaArrays,               // Arrays closed in delta-encoded format
+    DeltaSimdCalls,            // SSE4.2 decodings of delta-encoded blocks
+    DeltaScalarCalls,          // portable decodings of delta-encoded blocks
+    NumCounters
+  };
+
+  struct Snapshot {
+    uint64_t values[NumCounters];
+
+    uint64_t operator[](Counter counter) const noexcept {
+      return values[counter];
+    }
+
+    // counter differences, e.g. between snapshots before and after an
+    // operation
+    Snapshot operator-(Snapshot const& other) const noexcept;
+  };
+
+  // called for every counted event, with the counter and the amount added
+  typedef void (*TraceHook)(Counter counter, uint64_t amount);
+
+  Instrumentation() = delete;
+
+  static constexpr bool enabled() noexcept {
+#ifdef VELOCYPACK_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  static char const* counterName(Counter counter) noexcept;
+
+  // the counters of the calling thread
+  static Snapshot threadSnapshot();
+
+  // the sum of the counters of all threads, including finished ones.
+  // counters of other threads may lag behind slightly
+  static Snapshot globalSnapshot();
+
+  // sets the counters of the calling thread to 0
+  static void resetThread();
+
+  // sets the counters of all threads to 0. events counted by other
+  // threads at the same time may get lost
+  static void reset();
+
+  // installs a hook called for every counted event, nullptr removes it.
+  // the hook is called on the thread counting the event
+  static void setTraceHook(TraceHook hook) noexcept;
+
+  static void count(Counter counter, uint64_t amount) noexcept;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#ifdef VELOCYPACK_INSTRUMENTATION
+#define VELOCYPACK_COUNT(counter, amount)                         \
+  ::arangodb::velocypack::Instrumentation::count(                 \
+      ::arangodb::velocypack::Instrumentation::counter, (amount))
+#else
+#define VELOCYPACK_COUNT(counter, amount) \
+  do {                                    \
+  } while (false)
+#endif
+
+#endif
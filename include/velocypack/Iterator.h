@@ -27,8 +27,12 @@
 #ifndef VELOCYPACK_ITERATOR_H
 #define VELOCYPACK_ITERATOR_H 1
 
+#include <algorithm>
+#include <cstring>
 #include <iosfwd>
 #include <functional>
+#include <utility>
+#include <vector>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Exception.h"
@@ -54,7 +58,8 @@ class ArrayIterator {
       : _slice(other._slice),
         _size(other._size),
         _position(other._position),
-        _current(other._current) {}
+        _current(other._current),
+        _delta(other._delta) {}
 
   ArrayIterator& operator=(ArrayIterator const& other) = delete;
   ArrayIterator& operator=(ArrayIterator&& other) = default;
@@ -66,6 +71,9 @@ class ArrayIterator {
       _current += Slice(_current).byteSize();
     } else {
       _current = nullptr;
+      if (_position < _size && _slice.isDeltaArray()) {
+        ++_delta;
+      }
     }
     return *this;
   }
@@ -81,10 +89,19 @@ class ArrayIterator {
     return _position != other._position;
   }
 
+  // for packed Arrays, the returned Slice points into the iterator and is
+  // only valid until the iterator is advanced
   Slice operator*() const {
     if (_current != nullptr) {
       return Slice(_current);
     }
+    if (_slice.isDeltaArray()) {
+      storeDeltaMember(_buffer, *_delta);
+      return Slice(_buffer);
+    }
+    if (_slice.isPackedArray()) {
+      return _slice.packedAt(_position, _buffer);
+    }
     return _slice.at(_position);
   }
 
@@ -140,11 +157,16 @@ class ArrayIterator {
       _position = _size;
     } else {
       auto h = _slice.head();
-      if (h == 0x13) {
+      if (h == 0x13 || h == 0x15) {
         while (count-- > 0) {
           _current += Slice(_current).byteSize();
           ++_position;
         }
+      } else if (_slice.isDeltaArray()) {
+        _position += count;
+        _delta = _slice.getDelta().iteratorAt(_position);
+      } else if (_slice.isPackedArray()) {
+        _position += count;
       } else {
         _position += count;
         _current = _slice.at(_position).start();
@@ -157,9 +179,11 @@ class ArrayIterator {
     _current = nullptr;
     if (_size > 0) {
       auto h = _slice.head();
-      if (h == 0x13) {
+      if (h == 0x13 || h == 0x15) {
         _current = _slice.at(0).start();
-      } else {
+      } else if (h == 0xe4) {
+        _delta = _slice.getDelta().begin();
+      } else if (!_slice.isPackedArray()) {
         _current = _slice.begin() + _slice.findDataOffset(h);
       }
     }
@@ -170,6 +194,10 @@ class ArrayIterator {
   ValueLength _size;
   ValueLength _position;
   uint8_t const* _current;
+  // decoding state for delta-encoded Arrays
+  DeltaSpan::iterator _delta;
+  // the current member of a packed Array, converted into a VPack number
+  mutable uint8_t _buffer[9];
 };
 
 class ObjectIterator {
@@ -187,7 +215,7 @@ class ObjectIterator {
   // index. The default `false` is to use the index if it is there.
   explicit ObjectIterator(Slice const& slice, bool useSequentialIteration = false)
       : _slice(slice), _size(_slice.length()), _position(0), _current(nullptr),
-        _useSequentialIteration(useSequentialIteration) {
+        _currentKey(nullptr), _useSequentialIteration(useSequentialIteration) {
     if (!slice.isObject()) {
       throw Exception(Exception::InvalidValueType, "Expecting Object slice");
     }
@@ -196,6 +224,11 @@ class ObjectIterator {
       auto h = slice.head();
       if (h == 0x14) {
         _current = slice.keyAt(0, false).start();
+      } else if (h == 0x16) {
+        // rows of shaped Arrays only contain the values, the attribute
+        // names are iterated in the shape alongside
+        _current = slice.getNthValue(0).start();
+        _currentKey = slice.keyAt(0, false).start();
       } else if (useSequentialIteration) {
         _current = slice.begin() + slice.findDataOffset(h);
       }
@@ -207,6 +240,7 @@ class ObjectIterator {
         _size(other._size),
         _position(other._position),
         _current(other._current),
+        _currentKey(other._currentKey),
         _useSequentialIteration(other._useSequentialIteration) {}
 
   ObjectIterator& operator=(ObjectIterator const& other) = delete;
@@ -216,8 +250,12 @@ class ObjectIterator {
   ObjectIterator& operator++() {
     ++_position;
     if (_position < _size && _current != nullptr) {
-      // skip over key
-      _current += Slice(_current).byteSize();
+      if (_currentKey != nullptr) {
+        _currentKey += Slice(_currentKey).byteSize();
+      } else {
+        // skip over key
+        _current += Slice(_current).byteSize();
+      }
       // skip over value
       _current += Slice(_current).byteSize();
     } else {
@@ -239,6 +277,9 @@ class ObjectIterator {
 
   ObjectPair operator*() const {
     if (_current != nullptr) {
+      if (_currentKey != nullptr) {
+        return ObjectPair(Slice(_currentKey), Slice(_current));
+      }
       Slice key = Slice(_current);
       return ObjectPair(key.makeKey(), Slice(_current + key.byteSize()));
     }
@@ -276,7 +317,7 @@ class ObjectIterator {
       throw Exception(Exception::IndexOutOfBounds);
     }
     if (_current != nullptr) {
-      Slice s(_current);
+      Slice s(_currentKey != nullptr ? _currentKey : _current);
       return translate ? s.makeKey() : s;
     }
     return _slice.getNthKey(_position, translate);
@@ -287,6 +328,9 @@ class ObjectIterator {
       throw Exception(Exception::IndexOutOfBounds);
     }
     if (_current != nullptr) {
+      if (_currentKey != nullptr) {
+        return Slice(_current);
+      }
       Slice key = Slice(_current);
       return Slice(_current + key.byteSize());
     }
@@ -305,14 +349,94 @@ class ObjectIterator {
 
   inline bool isLast() const noexcept { return (_position + 1 >= _size); }
 
+  inline void forward(ValueLength count) {
+    if (_position + count >= _size) {
+      // beyond end of data
+      _current = nullptr;
+      _position = _size;
+    } else if (_current != nullptr) {
+      while (count-- > 0) {
+        operator++();
+      }
+    } else {
+      _position += count;
+    }
+  }
+
  private:
   Slice _slice;
   ValueLength _size;
   ValueLength _position;
   uint8_t const* _current;
+  uint8_t const* _currentKey;  // only used for rows of shaped Arrays
   bool _useSequentialIteration;
 };
 
+// iterates over the members of an Object in the order of their attribute
+// names, as used by sorted index tables. Objects with sorted index table
+// are iterated via the index, the members of all other Objects are
+// collected and sorted first. keys are translated
+class KeyOrderedIterator {
+ public:
+  explicit KeyOrderedIterator(Slice const& slice)
+      : _it(slice), _position(0), _useIndex(true) {
+    uint8_t const head = slice.head();
+    // rows of shaped Arrays are stored in attribute name order as well
+    if ((head < 0x0b || head > 0x0e) && head != 0x16) {
+      _useIndex = false;
+      _members.reserve(checkOverflow(_it.size()));
+      ObjectIterator it(slice, true);
+      while (it.valid()) {
+        _members.emplace_back(it.key(true), it.value());
+        it.next();
+      }
+      std::stable_sort(_members.begin(), _members.end(),
+                       [](std::pair<Slice, Slice> const& lhs,
+                          std::pair<Slice, Slice> const& rhs) {
+                         return compareKeys(lhs.first, rhs.first) < 0;
+                       });
+    }
+  }
+
+  bool valid() const noexcept {
+    return _useIndex ? _it.valid() : (_position < _members.size());
+  }
+
+  Slice key() const {
+    return _useIndex ? _it.key(true) : _members[_position].first;
+  }
+
+  Slice value() const {
+    return _useIndex ? _it.value() : _members[_position].second;
+  }
+
+  void next() {
+    if (_useIndex) {
+      _it.next();
+    } else {
+      ++_position;
+    }
+  }
+
+  // compares two attribute names in the order used for sorted index tables
+  static int compareKeys(Slice const& lhs, Slice const& rhs) {
+    ValueLength l, r;
+    char const* p = lhs.getString(l);
+    char const* q = rhs.getString(r);
+    int res = memcmp(p, q, checkOverflow((std::min)(l, r)));
+    if (res != 0) {
+      return res;
+    }
+    return (l < r) ? -1 : ((l > r) ? 1 : 0);
+  }
+
+ private:
+  ObjectIterator _it;
+  std::vector<std::pair<Slice, Slice>> _members;
+  size_t _position;
+  bool _useIndex;
+};
+
 }  // namespace arangodb::velocypack
 }  // namespace arangodb
 
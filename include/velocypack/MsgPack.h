@@ -0,0 +1,198 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_MSGPACK_H
+#define VELOCYPACK_MSGPACK_H 1
+
+#include <memory>
+#include <string>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Exception.h"
+#include "velocypack/Options.h"
+#include "velocypack/Sink.h"
+#include "velocypack/Slice.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// MessagePack extension values are stored in VPack as Custom values with
+// a variable-length payload (type bytes 0xf4, 0xf7, 0xfa or 0xfd). the
+// first payload byte is the extension type, the remaining payload bytes
+// are the extension data. Custom values with these type bytes are turned
+// back into MessagePack extensions by the MsgPackDumper. the timestamp
+// extension (type -1) is mapped to and from ValueType::UTCDate
+
+// This class converts MessagePack data into VPack in a single pass.
+// It builds the result using the Builder.
+class MsgPackParser {
+  std::shared_ptr<Builder> _b;
+  uint8_t const* _start;
+  size_t _size;
+  size_t _pos;
+  char const* _key;
+  size_t _keyLength;
+  std::string _keyBuffer;
+
+ public:
+  Options const* options;
+
+  MsgPackParser(MsgPackParser const&) = delete;
+  MsgPackParser& operator=(MsgPackParser const&) = delete;
+  ~MsgPackParser() = default;
+
+  explicit MsgPackParser(Options const* options = &Options::Defaults);
+
+  // This method produces a parser that does not own the builder
+  explicit MsgPackParser(Builder& builder,
+                         Options const* options = &Options::Defaults);
+
+  Builder const& builder() const { return *_b; }
+
+  static std::shared_ptr<Builder> fromMsgPack(
+      uint8_t const* start, size_t size,
+      Options const* options = &Options::Defaults) {
+    MsgPackParser parser(options);
+    parser.parse(start, size);
+    return parser.steal();
+  }
+
+  static std::shared_ptr<Builder> fromMsgPack(
+      std::string const& data, Options const* options = &Options::Defaults) {
+    MsgPackParser parser(options);
+    parser.parse(data);
+    return parser.steal();
+  }
+
+  ValueLength parse(std::string const& data, bool multi = false) {
+    return parse(reinterpret_cast<uint8_t const*>(data.data()), data.size(),
+                 multi);
+  }
+
+  ValueLength parse(char const* start, size_t size, bool multi = false) {
+    return parse(reinterpret_cast<uint8_t const*>(start), size, multi);
+  }
+
+  // parses one value, or a sequence of values if multi is true. returns
+  // the number of values parsed
+  ValueLength parse(uint8_t const* start, size_t size, bool multi = false);
+
+  std::shared_ptr<Builder> steal() {
+    // Parser object is broken after a steal()
+    std::shared_ptr<Builder> res(_b);
+    _b.reset();
+    return res;
+  }
+
+  // Beware, only valid as long as you do not parse more, use steal
+  // to move the data out!
+  uint8_t const* start() { return _b->start(); }
+
+  // Returns the position at the time when the just reported error
+  // occurred, only use when handling an exception.
+  size_t errorPos() const { return _pos; }
+
+  void clear() { _b->clear(); }
+
+ private:
+  void parseValue();
+  void parseKey();
+  void parseArray(uint64_t length);
+  void parseObject(uint64_t length);
+  void parseString(uint64_t length);
+  void parseBinary(uint64_t length);
+  void parseExtension(int8_t type, uint64_t length);
+
+  uint8_t const* consume(uint64_t length);
+  uint64_t readUInt(size_t length);
+
+  template <typename T>
+  uint8_t* addValue(T const& value) {
+    if (_key != nullptr) {
+      char const* key = _key;
+      _key = nullptr;
+      return _b->add(key, _keyLength, value);
+    }
+    return _b->add(value);
+  }
+};
+
+// Dumps VPack into MessagePack
+class MsgPackDumper {
+ public:
+  Options const* options;
+
+  MsgPackDumper(MsgPackDumper const&) = delete;
+  MsgPackDumper& operator=(MsgPackDumper const&) = delete;
+
+  explicit MsgPackDumper(Sink* sink,
+                         Options const* options = &Options::Defaults);
+
+  ~MsgPackDumper() {}
+
+  Sink* sink() const { return _sink; }
+
+  void dump(Slice const& slice) {
+    _sink->reserve(slice.byteSize());
+    dumpValue(slice);
+  }
+
+  void dump(Slice const* slice) { dump(*slice); }
+
+  static void dump(Slice const& slice, Sink* sink,
+                   Options const* options = &Options::Defaults) {
+    MsgPackDumper dumper(sink, options);
+    dumper.dump(slice);
+  }
+
+  // returns the MessagePack data for the slice in a (binary) string
+  static std::string toString(Slice const& slice,
+                              Options const* options = &Options::Defaults) {
+    std::string buffer;
+    StringSink sink(&buffer);
+    dump(slice, &sink, options);
+    return buffer;
+  }
+
+ private:
+  void dumpValue(Slice const& slice);
+  void dumpInt(int64_t v);
+  void dumpUInt(uint64_t v);
+  void dumpUTCDate(int64_t v);
+  void dumpExtension(Slice const& slice);
+  void appendHead(uint8_t head, uint64_t value, size_t length);
+  void appendBigEndian(uint64_t value, size_t length);
+  void handleUnsupportedType(Slice const& slice);
+
+ private:
+  Sink* _sink;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
@@ -86,6 +86,26 @@ struct Options {
   // allow building Objects without index table?
   bool buildUnindexedObjects = false;
 
+  // store Arrays whose members are all Objects with the same attribute
+  // names as shaped Arrays when closing them in a Builder: the sorted
+  // attribute names are stored once, followed by the values of each
+  // member. Only used if the result is smaller than the members alone
+  bool buildShapedArrays = false;
+
+  // store Arrays whose members are all Doubles or all integers as packed
+  // Arrays when closing them in a Builder: the numbers are stored as one
+  // payload of int32_t, int64_t, uint64_t or double values without type
+  // bytes. Only used if the result is smaller than any other Array
+  // format could be
+  bool buildPackedArrays = false;
+
+  // store Arrays whose members are all integers as delta-encoded Arrays
+  // when closing them in a Builder: each member is stored as its
+  // difference to the previous one, in blocks that start with a full
+  // value. Only used if the result is smaller than any other Array
+  // format could be, including a packed Array if buildPackedArrays is set
+  bool buildDeltaArrays = false;
+
   // pretty-print JSON output when dumping with Dumper
   bool prettyPrint = false;
 
@@ -100,9 +120,14 @@ struct Options {
 
   // validate that attribute names in Object values are actually
   // unique when creating objects via Builder. This also includes
-  // creation of Object values via a Parser
+  // creation of Object values via a Parser, and checking of Object
+  // values via a Validator
   bool checkAttributeUniqueness = false;
 
+  // make the Validator check that the index tables of sorted Objects
+  // are actually sorted by attribute name
+  bool validatorCheckKeyOrder = false;
+
   // escape forward slashes when serializing VPack values into
   // JSON with a Dumper
   bool escapeForwardSlashes = false;
@@ -115,6 +140,18 @@ struct Options {
   // values as a security precaution)
   bool disallowExternals = false;
 
+  // replace String values that occur more than once inside the same
+  // document with references to their first occurrence when building
+  // with a Builder or Parser. Attribute names are never replaced
+  bool dedupeStrings = false;
+
+  // maximum nesting depth of compound values accepted by the Validator
+  // (0 = unlimited)
+  uint32_t validatorMaxDepth = 0;
+
+  // maximum byte size of a value accepted by the Validator (0 = unlimited)
+  ValueLength validatorMaxSize = 0;
+
   // default options with the above settings
   static Options Defaults;
 };
@@ -0,0 +1,163 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_OVERLAY_SLICE_H
+#define VELOCYPACK_OVERLAY_SLICE_H 1
+
+#include <string>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Iterator.h"
+#include "velocypack/Options.h"
+#include "velocypack/Sink.h"
+#include "velocypack/Slice.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// a read-only view of an Object patch merged onto an Object base, with
+// the same result as Collection::merge(base, patch, mergeValues,
+// nullMeansRemove), but without building it. attribute lookups and
+// iteration work on the two Objects directly, so reading a few values
+// of a large merged document is cheap.
+// the view of an attribute is an OverlaySlice again. it is an overlay if
+// both sides have an Object for it and mergeValues is set, and a plain
+// value otherwise, see isOverlay() and slice(). missing attributes are
+// plain None values. base and patch must stay valid while the view is used
+class OverlayIterator;
+
+class OverlaySlice {
+ public:
+  OverlaySlice(Slice const& base, Slice const& patch, bool mergeValues = true,
+               bool nullMeansRemove = false);
+
+  // a plain value
+  explicit OverlaySlice(Slice const& value)
+      : _base(value), _patch(), _mergeValues(false), _nullMeansRemove(false) {}
+
+  bool isOverlay() const noexcept { return !_patch.isNone(); }
+
+  // the value of a plain OverlaySlice. throws for overlays
+  Slice slice() const {
+    if (isOverlay()) {
+      throw Exception(Exception::InvalidValueType,
+                      "OverlaySlice is no plain value");
+    }
+    return _base;
+  }
+
+  Slice base() const noexcept { return _base; }
+  Slice patch() const noexcept { return _patch; }
+
+  bool isNone() const noexcept { return !isOverlay() && _base.isNone(); }
+  bool isObject() const noexcept { return isOverlay() || _base.isObject(); }
+
+  ValueType type() const noexcept {
+    return isOverlay() ? ValueType::Object : _base.type();
+  }
+
+  // looks up an attribute of the merged Object. returns a None value if
+  // it does not exist or was removed by the patch
+  OverlaySlice get(std::string const& attribute) const;
+
+  OverlaySlice get(std::vector<std::string> const& path) const;
+
+  bool hasKey(std::string const& attribute) const {
+    return !get(attribute).isNone();
+  }
+
+  // number of attributes of the merged Object, or the length of a plain
+  // value. the attributes of an overlay are counted by iterating
+  ValueLength length() const;
+
+  // adds the merged value to the builder, like Builder::add(Slice)
+  void materialize(Builder& builder) const;
+
+  Builder materialize(Options const* options = &Options::Defaults) const {
+    Builder b(options);
+    materialize(b);
+    return b;
+  }
+
+  // dumps the merged value as JSON, in the same way as the Dumper would
+  // dump the materialized value. with options->prettyPrint, the value is
+  // materialized first
+  void dump(Sink* sink, Options const* options = &Options::Defaults) const;
+
+  std::string toJson(Options const* options = &Options::Defaults) const;
+
+ private:
+  friend class OverlayIterator;
+
+  Slice _base;
+  Slice _patch;
+  bool _mergeValues;
+  bool _nullMeansRemove;
+};
+
+// iterates over the attributes of an OverlaySlice that is an Object, in
+// the order of their names. removed attributes are skipped
+class OverlayIterator {
+ public:
+  explicit OverlayIterator(OverlaySlice const& overlay);
+
+  bool valid() const noexcept { return _valid; }
+
+  Slice key() const {
+    if (!_valid) {
+      throw Exception(Exception::IndexOutOfBounds);
+    }
+    return _key;
+  }
+
+  OverlaySlice const& value() const {
+    if (!_valid) {
+      throw Exception(Exception::IndexOutOfBounds);
+    }
+    return _value;
+  }
+
+  void next();
+
+ private:
+  // advances to the next attribute that is not removed
+  void advance();
+
+  KeyOrderedIterator _base;
+  KeyOrderedIterator _patch;
+  bool _mergeValues;
+  bool _nullMeansRemove;
+  bool _valid;
+  Slice _key;
+  OverlaySlice _value;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
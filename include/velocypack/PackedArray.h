@@ -0,0 +1,250 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_PACKEDARRAY_H
+#define VELOCYPACK_PACKEDARRAY_H 1
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Exception.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// writes value into buffer as a VPack Int in the encoding a Builder uses
+// for it, i.e. as a SmallInt or with as few bytes as possible, so that
+// members of packed Arrays are binary equal to regularly built numbers.
+// buffer must have room for 9 bytes
+static inline void storePackedInt(uint8_t* buffer, int64_t value) noexcept {
+  if (value >= -6 && value <= 9) {
+    buffer[0] = static_cast<uint8_t>(value >= 0 ? 0x30 + value : 0x40 + value);
+    return;
+  }
+  uint64_t const x = value >= 0 ? static_cast<uint64_t>(value)
+                                : static_cast<uint64_t>(-(value + 1));
+  unsigned int size = 1;
+  while (size < 8 && (x >> (8 * size - 1)) != 0) {
+    ++size;
+  }
+  buffer[0] = static_cast<uint8_t>(0x1f + size);
+  uint64_t v = static_cast<uint64_t>(value);
+  for (unsigned int i = 1; i <= size; ++i) {
+    buffer[i] = static_cast<uint8_t>(v & 0xff);
+    v >>= 8;
+  }
+}
+
+// same for a VPack UInt
+static inline void storePackedUInt(uint8_t* buffer, uint64_t value) noexcept {
+  if (value <= 9) {
+    buffer[0] = static_cast<uint8_t>(0x30 + value);
+    return;
+  }
+  unsigned int size = 0;
+  do {
+    buffer[++size] = static_cast<uint8_t>(value & 0xff);
+    value >>= 8;
+  } while (value != 0);
+  buffer[0] = static_cast<uint8_t>(0x27 + size);
+}
+
+// member types of packed Arrays. A packed Array stores numbers of one
+// type as a plain little endian payload, without a type byte per member
+template<typename T>
+struct PackedTraits;
+
+template<>
+struct PackedTraits<int32_t> {
+  typedef int64_t SumType;
+  static constexpr uint8_t head = 0xe0;
+
+  static int32_t load(uint8_t const* p) noexcept {
+    return static_cast<int32_t>(readIntegerFixed<uint32_t, 4>(p));
+  }
+};
+
+template<>
+struct PackedTraits<int64_t> {
+  typedef int64_t SumType;
+  static constexpr uint8_t head = 0xe1;
+
+  static int64_t load(uint8_t const* p) noexcept {
+    return toInt64(readIntegerFixed<uint64_t, 8>(p));
+  }
+};
+
+template<>
+struct PackedTraits<uint64_t> {
+  typedef uint64_t SumType;
+  static constexpr uint8_t head = 0xe2;
+
+  static uint64_t load(uint8_t const* p) noexcept {
+    return readIntegerFixed<uint64_t, 8>(p);
+  }
+};
+
+template<>
+struct PackedTraits<double> {
+  typedef double SumType;
+  static constexpr uint8_t head = 0xe3;
+
+  static double load(uint8_t const* p) noexcept {
+    union {
+      uint64_t dv;
+      double d;
+    } v;
+    v.dv = readIntegerFixed<uint64_t, 8>(p);
+    return v.d;
+  }
+};
+
+// result of aggregating the members of a packed Array in one pass.
+// NaN values are ignored by all aggregates, so count is the number of
+// members minus the NaN values. Integer sums wrap around on overflow,
+// except for int32_t members, which are summed as int64_t. min and max
+// are 0 if count is 0
+template<typename T>
+struct PackedAggregate {
+  ValueLength count = 0;
+  typename PackedTraits<T>::SumType sum = 0;
+  T min = 0;
+  T max = 0;
+};
+
+// vectorized aggregation kernels, used by PackedSpan::aggregate()
+void aggregatePacked(uint8_t const* data, ValueLength n,
+                     PackedAggregate<int32_t>& result);
+void aggregatePacked(uint8_t const* data, ValueLength n,
+                     PackedAggregate<int64_t>& result);
+void aggregatePacked(uint8_t const* data, ValueLength n,
+                     PackedAggregate<uint64_t>& result);
+void aggregatePacked(uint8_t const* data, ValueLength n,
+                     PackedAggregate<double>& result);
+
+// read-only view on the members of a packed Array, as returned by
+// Slice::getPacked<T>(). The payload is not aligned, so members are
+// returned by value
+template<typename T>
+class PackedSpan {
+ public:
+  class iterator {
+   public:
+    typedef std::input_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T const* pointer;
+    typedef T reference;
+
+    explicit iterator(uint8_t const* p) noexcept : _p(p) {}
+
+    T operator*() const noexcept { return PackedTraits<T>::load(_p); }
+
+    iterator& operator++() noexcept {
+      _p += sizeof(T);
+      return *this;
+    }
+
+    iterator operator++(int) noexcept {
+      iterator result(*this);
+      _p += sizeof(T);
+      return result;
+    }
+
+    bool operator==(iterator const& other) const noexcept {
+      return _p == other._p;
+    }
+
+    bool operator!=(iterator const& other) const noexcept {
+      return _p != other._p;
+    }
+
+   private:
+    uint8_t const* _p;
+  };
+
+  PackedSpan(uint8_t const* data, ValueLength size) noexcept
+      : _data(data), _size(size) {}
+
+  // the raw little endian payload
+  uint8_t const* data() const noexcept { return _data; }
+
+  ValueLength size() const noexcept { return _size; }
+
+  bool empty() const noexcept { return _size == 0; }
+
+  T operator[](ValueLength index) const noexcept {
+    return PackedTraits<T>::load(_data + index * sizeof(T));
+  }
+
+  T at(ValueLength index) const {
+    if (index >= _size) {
+      throw Exception(Exception::IndexOutOfBounds);
+    }
+    return operator[](index);
+  }
+
+  iterator begin() const noexcept { return iterator(_data); }
+
+  iterator end() const noexcept { return iterator(_data + _size * sizeof(T)); }
+
+  // decodes all members into out, which must have room for size() values
+  void copyTo(T* out) const {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(out, _data, checkOverflow(_size * sizeof(T)));
+#else
+    for (ValueLength i = 0; i < _size; ++i) {
+      out[i] = operator[](i);
+    }
+#endif
+  }
+
+  PackedAggregate<T> aggregate() const {
+    PackedAggregate<T> result;
+    aggregatePacked(_data, _size, result);
+    return result;
+  }
+
+  typename PackedTraits<T>::SumType sum() const { return aggregate().sum; }
+
+  T min() const { return aggregate().min; }
+
+  T max() const { return aggregate().max; }
+
+  ValueLength count() const { return aggregate().count; }
+
+ private:
+  uint8_t const* _data;
+  ValueLength _size;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
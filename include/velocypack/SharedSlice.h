@@ -0,0 +1,275 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_SHARED_SLICE_H
+#define VELOCYPACK_SHARED_SLICE_H 1
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <utility>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Buffer.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Exception.h"
+#include "velocypack/Slice.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// reference count policy for SharedSlices used by several threads
+class AtomicRefCount {
+ public:
+  AtomicRefCount() noexcept : _value(1) {}
+
+  void increment() noexcept { _value.fetch_add(1, std::memory_order_relaxed); }
+
+  // returns true if the last reference was released
+  bool decrement() noexcept {
+    return _value.fetch_sub(1, std::memory_order_acq_rel) == 1;
+  }
+
+  size_t load() const noexcept {
+    return _value.load(std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<size_t> _value;
+};
+
+// reference count policy for SharedSlices that never leave their thread
+class LocalRefCount {
+ public:
+  LocalRefCount() noexcept : _value(1) {}
+
+  void increment() noexcept { ++_value; }
+
+  // returns true if the last reference was released
+  bool decrement() noexcept { return --_value == 0; }
+
+  size_t load() const noexcept { return _value; }
+
+ private:
+  size_t _value;
+};
+
+// memory management for BasicSharedSlice. kept out of line, as the
+// memory is released only rarely compared to copying SharedSlices
+struct SharedSliceMemory {
+  // allocates memory for a control block of the given size, followed by
+  // length bytes
+  static void* allocate(size_t controlSize, ValueLength length);
+
+  // releases memory obtained from allocate(), and the separately
+  // allocated bytes external unless they are nullptr
+  static void release(void* memory, uint8_t* external) noexcept;
+};
+
+// an immutable, reference-counted VPack value. copies share the same
+// memory, which holds the reference count followed by the VPack bytes
+// in a single allocation. the bytes of a Builder are adopted without
+// copying them, in which case the reference count is allocated on its
+// own. sub-slices such as get() or at() keep the whole value alive
+template<typename RefCount>
+class BasicSharedSlice {
+ public:
+  // a SharedSlice pointing to a None value
+  BasicSharedSlice() noexcept : _control(nullptr), _start(Slice().start()) {}
+
+  // copies the VPack value into a new allocation. values that are not
+  // self-contained are copied member by member
+  explicit BasicSharedSlice(Slice const& slice)
+      : _control(nullptr), _start(Slice().start()) {
+    if (slice.isSelfContained()) {
+      *this = BasicSharedSlice(slice.start(), slice.byteSize());
+    } else {
+      Builder b;
+      b.add(slice);
+      *this = BasicSharedSlice(b.start(), b.size());
+    }
+  }
+
+  BasicSharedSlice(uint8_t const* data, ValueLength length)
+      : _control(nullptr), _start(Slice().start()) {
+    VELOCYPACK_ASSERT(data != nullptr);
+    if (length == 0) {
+      return;
+    }
+    void* memory = SharedSliceMemory::allocate(sizeof(Control), length);
+    _control = new (memory) Control(nullptr);
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(_control + 1);
+    memcpy(bytes, data, checkOverflow(length));
+    _start = bytes;
+  }
+
+  // takes over the bytes of a closed Builder. the Builder is unusable
+  // afterwards. the bytes are copied only if the Builder shares its
+  // Buffer with others or does not own it
+  explicit BasicSharedSlice(Builder&& builder)
+      : _control(nullptr), _start(Slice().start()) {
+    if (!builder.isClosed()) {
+      throw Exception(Exception::BuilderNotSealed);
+    }
+    if (builder.isEmpty()) {
+      return;
+    }
+    std::shared_ptr<Buffer<uint8_t>> buffer = builder.steal();
+    if (buffer.use_count() != 1 ||
+        std::get_deleter<BufferNonDeleter<uint8_t>>(buffer) != nullptr) {
+      *this = BasicSharedSlice(Slice(buffer->data()));
+      return;
+    }
+    uint8_t* bytes = buffer->steal();
+    void* memory;
+    try {
+      memory = SharedSliceMemory::allocate(sizeof(Control), 0);
+    } catch (...) {
+      delete[] bytes;
+      throw;
+    }
+    _control = new (memory) Control(bytes);
+    _start = bytes;
+  }
+
+  BasicSharedSlice(BasicSharedSlice const& other) noexcept
+      : _control(other._control), _start(other._start) {
+    if (_control != nullptr) {
+      _control->refCount.increment();
+    }
+  }
+
+  BasicSharedSlice(BasicSharedSlice&& other) noexcept
+      : _control(other._control), _start(other._start) {
+    other._control = nullptr;
+    other._start = Slice().start();
+  }
+
+  BasicSharedSlice& operator=(BasicSharedSlice const& other) noexcept {
+    BasicSharedSlice copy(other);
+    swap(copy);
+    return *this;
+  }
+
+  BasicSharedSlice& operator=(BasicSharedSlice&& other) noexcept {
+    BasicSharedSlice moved(std::move(other));
+    swap(moved);
+    return *this;
+  }
+
+  ~BasicSharedSlice() { release(); }
+
+  void swap(BasicSharedSlice& other) noexcept {
+    std::swap(_control, other._control);
+    std::swap(_start, other._start);
+  }
+
+  Slice slice() const noexcept { return Slice(_start); }
+
+  uint8_t const* begin() const noexcept { return _start; }
+  uint8_t const* start() const noexcept { return _start; }
+
+  ValueLength byteSize() const { return slice().byteSize(); }
+
+  bool isNone() const noexcept { return slice().isNone(); }
+
+  // number of SharedSlices referencing the underlying memory, 0 for a
+  // default-constructed one
+  size_t useCount() const noexcept {
+    return _control == nullptr ? 0 : _control->refCount.load();
+  }
+
+  // a SharedSlice for a value within this one, sharing its memory. value
+  // must be part of this SharedSlice, or be a Slice to a static value
+  // such as the ones returned by Slice::get() for missing attributes
+  BasicSharedSlice sub(Slice const& value) const noexcept {
+    return BasicSharedSlice(_control, value.start());
+  }
+
+  BasicSharedSlice get(std::string const& attribute) const {
+    return sub(slice().get(attribute));
+  }
+
+  BasicSharedSlice get(char const* attribute) const {
+    return sub(slice().get(attribute));
+  }
+
+  BasicSharedSlice at(ValueLength index) const {
+    return sub(slice().at(index));
+  }
+
+  BasicSharedSlice keyAt(ValueLength index) const {
+    return sub(slice().keyAt(index, false));
+  }
+
+  BasicSharedSlice valueAt(ValueLength index) const {
+    return sub(slice().valueAt(index));
+  }
+
+ private:
+  struct Control {
+    explicit Control(uint8_t* external) noexcept : external(external) {}
+
+    RefCount refCount;
+    // bytes allocated separately with new[], or nullptr if the bytes
+    // follow the Control in the same allocation
+    uint8_t* external;
+  };
+
+  BasicSharedSlice(Control* control, uint8_t const* start) noexcept
+      : _control(control), _start(start) {
+    if (_control != nullptr) {
+      _control->refCount.increment();
+    }
+  }
+
+  void release() noexcept {
+    if (_control == nullptr || !_control->refCount.decrement()) {
+      return;
+    }
+    uint8_t* external = _control->external;
+    _control->~Control();
+    SharedSliceMemory::release(_control, external);
+  }
+
+  Control* _control;
+  uint8_t const* _start;
+};
+
+// SharedSlice can be copied and released by several threads concurrently
+typedef BasicSharedSlice<AtomicRefCount> SharedSlice;
+typedef BasicSharedSlice<LocalRefCount> LocalSharedSlice;
+
+// class should not be different to two raw pointers size-wise
+static_assert(sizeof(SharedSlice) == 2 * sizeof(void*),
+              "invalid size for SharedSlice");
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
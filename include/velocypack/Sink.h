@@ -27,12 +27,15 @@
 #ifndef VELOCYPACK_SINK_H
 #define VELOCYPACK_SINK_H 1
 
+#include <cstring>
 #include <string>
 #include <fstream>
+#include <memory>
 #include <sstream>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Buffer.h"
+#include "velocypack/Exception.h"
 
 namespace arangodb {
 namespace velocypack {
@@ -48,6 +51,17 @@ struct Sink {
   virtual void append(char const* p) = 0;
   virtual void append(char const* p, ValueLength len) = 0;
   virtual void reserve(ValueLength len) = 0;
+
+  // overwrites len bytes of the data appended so far, starting offset
+  // bytes before its end. used by the StreamingBuilder to fill in byte
+  // lengths once they are known. not all sinks support this
+  virtual void overwrite(ValueLength offset, char const* p, ValueLength len) {
+    (void) offset;
+    (void) p;
+    (void) len;
+    throw Exception(Exception::NotImplemented,
+                    "Sink does not support overwriting data");
+  }
 };
 
 template <typename T>
@@ -68,6 +82,12 @@ struct ByteBufferSinkImpl final : public Sink {
 
   void reserve(ValueLength len) override final { buffer->reserve(len); }
 
+  void overwrite(ValueLength offset, char const* p,
+                 ValueLength len) override final {
+    VELOCYPACK_ASSERT(offset <= buffer->size() && len <= offset);
+    memcpy(buffer->data() + (buffer->size() - offset), p, checkOverflow(len));
+  }
+
   Buffer<T>* buffer;
 };
 
@@ -95,6 +115,13 @@ struct StringSinkImpl final : public Sink {
     buffer->reserve(checkOverflow(length));
   }
 
+  void overwrite(ValueLength offset, char const* p,
+                 ValueLength len) override final {
+    VELOCYPACK_ASSERT(offset <= buffer->size() && len <= offset);
+    buffer->replace(buffer->size() - checkOverflow(offset), checkOverflow(len),
+                    p, checkOverflow(len));
+  }
+
   T* buffer;
 };
 
@@ -104,9 +131,11 @@ template <typename T>
 struct StreamSinkImpl final : public Sink {
   explicit StreamSinkImpl(T* stream) : stream(stream) {}
 
-  void push_back(char c) override final { *stream << c; }
+  void push_back(char c) override final { stream->put(c); }
 
-  void append(std::string const& p) override final { *stream << p; }
+  void append(std::string const& p) override final {
+    stream->write(p.c_str(), static_cast<std::streamsize>(p.size()));
+  }
 
   void append(char const* p) override final {
     stream->write(p, static_cast<std::streamsize>(strlen(p)));
@@ -118,12 +147,92 @@ struct StreamSinkImpl final : public Sink {
 
   void reserve(ValueLength) override final {}
 
+  void overwrite(ValueLength offset, char const* p,
+                 ValueLength len) override final {
+    auto end = stream->tellp();
+    stream->seekp(end - static_cast<std::streamoff>(offset));
+    stream->write(p, static_cast<std::streamsize>(len));
+    stream->seekp(end);
+    if (!stream->good()) {
+      throw Exception(Exception::InternalError,
+                      "cannot overwrite data in stream");
+    }
+  }
+
   T* stream;
 };
 
 typedef StreamSinkImpl<std::ostringstream> StringStreamSink;
 typedef StreamSinkImpl<std::ofstream> OutputFileStreamSink;
 
+#ifndef _WIN32
+// a Sink that writes into a POSIX file descriptor (file, pipe or socket).
+// data is collected in a write-behind buffer and only handed to the kernel
+// once the buffer has reached the flush threshold. appends that do not fit
+// into the buffer are written together with the buffered data using a single
+// writev() call, so they are never copied. partial writes and EINTR are
+// handled, and non-blocking descriptors are waited on until writable.
+// the sink does not take ownership of the file descriptor. any data still
+// buffered is written out when the sink is destroyed, but errors can only be
+// detected by calling flush() explicitly before that.
+struct FdSink final : public Sink {
+  static constexpr ValueLength DefaultFlushThreshold = 64 * 1024;
+
+  explicit FdSink(int fd, ValueLength flushThreshold = DefaultFlushThreshold);
+  ~FdSink();
+
+  void push_back(char c) override final {
+    if (_size == _flushThreshold) {
+      flush();
+    }
+    _buffer[_size++] = c;
+  }
+
+  void append(std::string const& p) override final {
+    append(p.c_str(), p.size());
+  }
+
+  void append(char const* p) override final { append(p, strlen(p)); }
+
+  void append(char const* p, ValueLength len) override final {
+    if (len <= _flushThreshold - _size) {
+      memcpy(_buffer.get() + _size, p, checkOverflow(len));
+      _size += len;
+      return;
+    }
+    appendLarge(p, len);
+  }
+
+  // the buffer size is fixed, so there is nothing to reserve
+  void reserve(ValueLength) override final {}
+
+  // overwrites data in the buffer, or with pwrite() if it was written
+  // to the file descriptor already, which must then refer to a regular
+  // file
+  void overwrite(ValueLength offset, char const* p,
+                 ValueLength len) override final;
+
+  // write all buffered data to the file descriptor. throws on error
+  void flush();
+
+  int fd() const { return _fd; }
+
+  // number of bytes appended so far, including still-buffered bytes
+  ValueLength bytesWritten() const { return _flushed + _size; }
+
+ private:
+  void appendLarge(char const* p, ValueLength len);
+  void writeAll(char const* p, ValueLength len);
+
+ private:
+  int const _fd;
+  ValueLength const _flushThreshold;
+  ValueLength _size;
+  ValueLength _flushed;
+  std::unique_ptr<char[]> _buffer;
+};
+#endif
+
 }  // namespace arangodb::velocypack
 }  // namespace arangodb
 
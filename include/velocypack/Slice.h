@@ -39,6 +39,8 @@
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Exception.h"
 #include "velocypack/Options.h"
+#include "velocypack/DeltaArray.h"
+#include "velocypack/PackedArray.h"
 #include "velocypack/Value.h"
 #include "velocypack/ValueType.h"
 
@@ -218,6 +220,18 @@ class Slice {
   // check if slice is an Object object
   bool isObject() const noexcept { return isType(ValueType::Object); }
 
+  // check if slice is a packed Array, which stores numbers of one type
+  // without type bytes (see Options::buildPackedArrays). Delta-encoded
+  // Arrays are packed Arrays, too
+  bool isPackedArray() const noexcept {
+    uint8_t const h = head();
+    return (h >= 0xe0 && h <= 0xe4);
+  }
+
+  // check if slice is a delta-encoded Array, which stores integers as
+  // differences to their predecessors (see Options::buildDeltaArrays)
+  bool isDeltaArray() const noexcept { return head() == 0xe4; }
+
   // check if slice is a Double object
   bool isDouble() const noexcept { return isType(ValueType::Double); }
 
@@ -245,6 +259,31 @@ class Slice {
   // check if slice is a String object
   bool isString() const noexcept { return isType(ValueType::String); }
 
+  // check if slice is a reference to an earlier String value of the
+  // same document (see Options::dedupeStrings)
+  bool isStringReference() const noexcept {
+    uint8_t const h = head();
+    return (h >= 0xd8 && h <= 0xdb);
+  }
+
+  // return the String value a String reference points to. returns the
+  // slice itself if it is not a String reference
+  Slice resolveStringReference() const {
+    uint8_t const h = head();
+    if (h < 0xd8 || h > 0xdb) {
+      return *this;
+    }
+    ValueLength const distance =
+        readIntegerNonEmpty<ValueLength>(_start + 1, 1 << (h - 0xd8));
+    return Slice(_start - distance);
+  }
+
+  // check if the bytes of the slice form a valid value on their own,
+  // i.e. it is no row of a shaped Array and contains no String references
+  // to Strings in front of it. values that are not self-contained must
+  // be copied member by member
+  bool isSelfContained() const;
+
   // check if slice is a Binary object
   bool isBinary() const noexcept { return isType(ValueType::Binary); }
 
@@ -367,12 +406,28 @@ class Slice {
       return 0;
     }
 
-    if (h == 0x13 || h == 0x14) {
-      // compact Array or Object
+    if (h == 0x13 || h == 0x14 || h == 0x15) {
+      // compact Array or Object, or shaped Array
       ValueLength end = readVariableValueLength<false>(_start + 1);
       return readVariableValueLength<true>(_start + end - 1);
     }
 
+    if (h == 0x16) {
+      // row of a shaped Array, has one member per attribute name
+      return getShape().length();
+    }
+
+    if (h == 0xe4) {
+      // delta-encoded Array, the number of members follows the byte length
+      return readVariableValueLength<false>(
+          _start + 1 + getVariableValueLengthSize(_start + 1));
+    }
+
+    if (h >= 0xe0) {
+      // packed Array
+      return readVariableValueLength<false>(_start + 1);
+    }
+
     ValueLength const offsetSize = indexEntrySize(h);
     VELOCYPACK_ASSERT(offsetSize > 0);
     ValueLength end = readIntegerNonEmpty<ValueLength>(_start + 1, offsetSize);
@@ -424,16 +479,68 @@ class Slice {
       throw Exception(Exception::InvalidValueType, "Expecting type Object");
     }
 
-    Slice key = getNthKey(index, false);
-    return Slice(key.start() + key.byteSize());
+    return getNthValue(index);
   }
   
   // extract the nth value from an Object
   Slice getNthValue(ValueLength index) const {
+    if (head() == 0x16) {
+      return getNthValueFromRow(index);
+    }
     Slice key = getNthKey(index, false);
     return Slice(key.start() + key.byteSize());
   }
 
+  // return the sorted Array of attribute names shared by all rows of a
+  // shaped Array (see Options::buildShapedArrays), for the shaped Array
+  // itself or for one of its rows. The position of an attribute name in
+  // the shape is the index of its value in every row, so the values of
+  // one attribute can be scanned with valueAt() on each row
+  Slice getShape() const {
+    auto const h = head();
+    if (h == 0x15) {
+      return Slice(_start + 1 + getVariableValueLengthSize(_start + 1));
+    }
+    if (h == 0x16) {
+      uint8_t const* p = _start + 1 + getVariableValueLengthSize(_start + 1);
+      return Slice(_start - readVariableValueLength<false>(p));
+    }
+    throw Exception(Exception::InvalidValueType,
+                    "Expecting shaped Array or row of a shaped Array");
+  }
+
+  // return a view on the members of a packed Array of type T, which is
+  // one of int32_t, int64_t, uint64_t or double. Members of packed Arrays
+  // are plain numbers without a VPack representation of their own, so
+  // they cannot be accessed with at()
+  template<typename T>
+  PackedSpan<T> getPacked() const {
+    if (head() != PackedTraits<T>::head) {
+      throw Exception(Exception::InvalidValueType,
+                      "Expecting packed Array of matching type");
+    }
+    uint8_t const* p = _start + 1;
+    ValueLength const n = readVariableValueLength<false>(p);
+    return PackedSpan<T>(p + getVariableValueLength(n), n);
+  }
+
+  // return a view on the members of a delta-encoded Array. Members are
+  // decoded on access, and can be decoded all at once with copyTo()
+  DeltaSpan getDelta() const {
+    if (!isDeltaArray()) {
+      throw Exception(Exception::InvalidValueType,
+                      "Expecting delta-encoded Array");
+    }
+    return DeltaSpan(_start);
+  }
+
+  // convert the member at the specified index of a packed Array into a
+  // regular VPack number, encoded as a Builder would encode it, which is
+  // written to buffer. buffer must have room for 9 bytes, the returned
+  // Slice points into it. Members of
+  // delta-encoded Arrays take up to DeltaSpan::blockSize steps to decode
+  Slice packedAt(ValueLength index, uint8_t* buffer) const;
+
   // look for the specified attribute path inside an Object
   // returns a Slice(ValueType::None) if not found
   Slice get(std::vector<std::string> const& attributes, 
@@ -643,6 +750,11 @@ class Slice {
       return reinterpret_cast<char const*>(_start + 1 + 8);
     }
 
+    if (h >= 0xd8 && h <= 0xdb) {
+      // reference to an earlier String
+      return resolveStringReference().getString(length);
+    }
+
     throw Exception(Exception::InvalidValueType, "Expecting type String");
   }
 
@@ -660,6 +772,11 @@ class Slice {
       return readIntegerFixed<ValueLength, 8>(_start + 1);
     }
 
+    if (h >= 0xd8 && h <= 0xdb) {
+      // reference to an earlier String
+      return resolveStringReference().getStringLength();
+    }
+
     throw Exception(Exception::InvalidValueType, "Expecting type String");
   }
 
@@ -679,6 +796,11 @@ class Slice {
                          checkOverflow(length));
     }
 
+    if (h >= 0xd8 && h <= 0xdb) {
+      // reference to an earlier String
+      return resolveStringReference().copyString();
+    }
+
     throw Exception(Exception::InvalidValueType, "Expecting type String");
   }
 
@@ -740,11 +862,22 @@ class Slice {
     switch (type(h)) {
       case ValueType::Array:
       case ValueType::Object: {
-        if (h == 0x13 || h == 0x14) {
-          // compact Array or Object
+        if (h >= 0x13 && h <= 0x16) {
+          // compact Array or Object, shaped Array or row
+          return readVariableValueLength<false>(_start + 1);
+        }
+
+        if (h == 0xe4) {
+          // delta-encoded Array
           return readVariableValueLength<false>(_start + 1);
         }
 
+        if (h >= 0xe0) {
+          // packed Array: number of members and the payload
+          ValueLength const n = readVariableValueLength<false>(_start + 1);
+          return 1 + getVariableValueLength(n) + n * (h == 0xe0 ? 4 : 8);
+        }
+
         if (h == 0x01 || h == 0x0a) {
           // we cannot get here, because the FixedTypeLengths lookup
           // above will have kicked in already. however, the compiler
@@ -929,6 +1062,11 @@ class Slice {
 
   Slice getFromCompactObject(std::string const& attribute) const;
 
+  Slice getFromRow(std::string const& attribute) const;
+
+  // extract the nth value from a row of a shaped Array
+  Slice getNthValueFromRow(ValueLength index) const;
+
   // extract the nth member from an Array
   Slice getNth(ValueLength index) const;
 
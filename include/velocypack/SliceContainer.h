@@ -31,6 +31,7 @@
 #include <string>
 
 #include "velocypack/velocypack-common.h"
+#include "velocypack/Builder.h"
 #include "velocypack/Options.h"
 #include "velocypack/Slice.h"
 
@@ -55,8 +56,15 @@ class SliceContainer {
     : SliceContainer(reinterpret_cast<uint8_t const*>(data), length) {
   }
 
-  SliceContainer(Slice const& slice)
-    : SliceContainer(slice.begin(), slice.byteSize()) {
+  SliceContainer(Slice const& slice) : _data(nullptr) {
+    if (slice.isSelfContained()) {
+      *this = SliceContainer(slice.begin(), slice.byteSize());
+    } else {
+      // resolve the references to data in front of the value
+      Builder b;
+      b.add(slice);
+      *this = SliceContainer(b.start(), b.size());
+    }
   }
 
   SliceContainer(Slice const* slice)
@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_SLICE_PATCHER_H
+#define VELOCYPACK_SLICE_PATCHER_H 1
+
+#include <string>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Slice.h"
+#include "velocypack/Value.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// replaces values inside a mutable VPack buffer without rebuilding it.
+// a value can only be replaced by one with an encoding of exactly the same
+// byte size, so that all byte lengths, offsets and index tables stay
+// valid. integers are encoded in whatever width fits the old value, so an
+// integer can replace any integer or double of the same byte size if its
+// value fits. other values such as doubles, bools, null and strings of
+// equal length fit if their regular encoding has the same size.
+// the patch methods return false if the new value does not fit, in which
+// case the data is left unchanged and the caller has to rebuild the value.
+// only values may be patched, not attribute names. Strings that String
+// references point to (see Options::dedupeStrings) cannot be patched
+// either, as that would change the referencing values as well
+class SlicePatcher {
+ public:
+  SlicePatcher(uint8_t* data, ValueLength size);
+
+  // patches the value held by a closed Builder
+  explicit SlicePatcher(Builder& builder);
+
+  SlicePatcher(SlicePatcher const&) = delete;
+  SlicePatcher& operator=(SlicePatcher const&) = delete;
+
+  Slice slice() const noexcept { return Slice(_data); }
+
+  // replaces target, which must point into the patched data
+  bool patch(Slice const& target, Value const& value);
+  bool patch(Slice const& target, Slice const& value);
+
+  // replaces the value of the attribute at the given path. returns false
+  // if there is no such attribute
+  bool patch(std::vector<std::string> const& path, Value const& value);
+
+  bool patch(std::string const& attribute, Value const& value) {
+    return patch(std::vector<std::string>{attribute}, value);
+  }
+
+ private:
+  uint8_t* mutableStart(Slice const& target) const;
+
+  // overwrites the size bytes at p with value, if it fits
+  bool replace(uint8_t* p, ValueLength size, Slice const& value);
+
+  // check if a String reference outside of target points into it
+  bool isReferenced(Slice const& target);
+
+  static bool patchSigned(uint8_t* p, ValueLength size, int64_t value);
+  static bool patchUnsigned(uint8_t* p, ValueLength size, uint64_t value);
+
+  uint8_t* _data;
+  ValueLength _size;
+  Builder _scratch;  // encodes values other than integers
+  int _references;   // whether the data contains String references
+                     // (-1 = not yet known)
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
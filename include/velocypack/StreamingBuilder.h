@@ -0,0 +1,157 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#ifndef VELOCYPACK_STREAMING_BUILDER_H
+#define VELOCYPACK_STREAMING_BUILDER_H 1
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Buffer.h"
+#include "velocypack/Builder.h"
+#include "velocypack/Options.h"
+#include "velocypack/Sink.h"
+#include "velocypack/Slice.h"
+#include "velocypack/Value.h"
+
+namespace arangodb {
+namespace velocypack {
+
+// builds a single VPack value directly into a Sink, using memory that
+// does not depend on the size of the value. Arrays and Objects are
+// written in the compact formats 0x13 and 0x14 without index tables, and
+// Object attributes are written in the order they are added, without
+// checking for duplicates.
+// output is collected in a chunk of about chunkSize bytes and appended to
+// the sink whenever the chunk is full. compact values store their byte
+// length in front of their members, so Arrays and Objects that are closed
+// while their start is still in the chunk get the shortest encoding.
+// those written out already get a fixed 8 byte length that is filled in
+// via Sink::overwrite() when they are closed, which the sink must support
+// if such values are built. the value is complete once the outermost
+// Array or Object is closed; call flush() to append the rest to the sink
+class StreamingBuilder {
+ public:
+  static constexpr ValueLength DefaultChunkSize = 64 * 1024;
+
+  explicit StreamingBuilder(Sink* sink,
+                            Options const* options = &Options::Defaults,
+                            ValueLength chunkSize = DefaultChunkSize);
+
+  StreamingBuilder(StreamingBuilder const&) = delete;
+  StreamingBuilder& operator=(StreamingBuilder const&) = delete;
+
+  StreamingBuilder& openArray() { return openCompound(true); }
+  StreamingBuilder& openObject() { return openCompound(false); }
+
+  StreamingBuilder& openArray(std::string const& key) {
+    addKey(key.data(), key.size());
+    return openCompound(true);
+  }
+
+  StreamingBuilder& openObject(std::string const& key) {
+    addKey(key.data(), key.size());
+    return openCompound(false);
+  }
+
+  // adds an Array member, or the top-level value. a Value of type Array
+  // or Object opens a compound value, like in Builder
+  StreamingBuilder& add(Value const& value);
+  StreamingBuilder& add(Slice const& value);
+
+  // adds an Object attribute
+  StreamingBuilder& add(std::string const& key, Value const& value) {
+    addKey(key.data(), key.size());
+    return add(value);
+  }
+
+  StreamingBuilder& add(char const* key, Value const& value) {
+    addKey(key, strlen(key));
+    return add(value);
+  }
+
+  StreamingBuilder& add(std::string const& key, Slice const& value) {
+    addKey(key.data(), key.size());
+    return add(value);
+  }
+
+  StreamingBuilder& add(char const* key, Slice const& value) {
+    addKey(key, strlen(key));
+    return add(value);
+  }
+
+  StreamingBuilder& close();
+
+  // appends all data collected in the chunk to the sink
+  void flush();
+
+  // whether the outermost value has been completed
+  bool isClosed() const noexcept { return _done; }
+
+  // number of bytes produced so far, including those in the chunk
+  ValueLength size() const noexcept { return _flushed + _chunk.size(); }
+
+ private:
+  struct Level {
+    ValueLength start;  // offset of the head byte, once written
+    ValueLength count;
+    bool isArray;
+    bool headerWritten;
+    bool keyWritten;
+  };
+
+  StreamingBuilder& openCompound(bool isArray);
+  void addKey(char const* key, size_t length);
+
+  // writes the head bytes of all opened Arrays and Objects that have not
+  // been written yet, as a member is about to be added
+  void writeHeaders();
+
+  // prepares for adding a member to the innermost Array or Object
+  void beforeMember();
+  // counts the member just added, and flushes a full chunk
+  void afterMember();
+
+  void append(uint8_t const* p, ValueLength len);
+
+  // overwrites previously produced bytes at the given offset
+  void patch(ValueLength offset, uint8_t const* p, ValueLength len);
+
+  Sink* _sink;
+  ValueLength const _chunkSize;
+  Buffer<uint8_t> _chunk;
+  ValueLength _flushed;  // bytes appended to the sink so far
+  std::vector<Level> _stack;
+  Builder _scratch;  // encodes scalar values
+  bool _done;
+};
+
+}  // namespace arangodb::velocypack
+}  // namespace arangodb
+
+#endif
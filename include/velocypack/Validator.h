@@ -35,7 +35,14 @@ namespace velocypack {
 class Slice;
 
 class Validator {
-  // This class can validate a binary VelocyPack value.
+  // This class can validate a binary VelocyPack value. Validation is done
+  // in a single pass over the data, using an explicit stack for compound
+  // values, so that arbitrarily deep input cannot exhaust the call stack.
+  // The following Options are honored: validateUtf8Strings,
+  // checkAttributeUniqueness, disallowExternals, validatorCheckKeyOrder,
+  // validatorMaxDepth and validatorMaxSize.
+  // String references must point to a complete String located in front
+  // of them inside the validated data, and must not be used as keys.
 
  public:
   explicit Validator(Options const* options = &Options::Defaults)
@@ -58,18 +65,6 @@ class Validator {
   // throws if the data is invalid
   bool validate(uint8_t const* ptr, size_t length, bool isSubPart = false) const;
 
- private:
-  void validateArray(uint8_t const* ptr, size_t length) const;
-  void validateCompactArray(uint8_t const* ptr, size_t length) const;
-  void validateUnindexedArray(uint8_t const* ptr, size_t length) const;
-  void validateIndexedArray(uint8_t const* ptr, size_t length) const;
-  void validateObject(uint8_t const* ptr, size_t length) const;
-  void validateCompactObject(uint8_t const* ptr, size_t length) const;
-  void validateIndexedObject(uint8_t const* ptr, size_t length) const;
-  void validateBufferLength(size_t expected, size_t actual, bool isSubPart) const;
-  void validateSliceLength(uint8_t const* ptr, size_t length, bool isSubPart) const;
-  ValueLength readByteSize(uint8_t const*& ptr, uint8_t const* end) const;
-
  public:
   Options const* options;
 };
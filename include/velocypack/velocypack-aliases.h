@@ -75,6 +75,9 @@ using VPackSink = arangodb::velocypack::Sink;
 using VPackCharBufferSink = arangodb::velocypack::CharBufferSink;
 using VPackStringSink = arangodb::velocypack::StringSink;
 using VPackStringStreamSink = arangodb::velocypack::StringStreamSink;
+#ifndef _WIN32
+using VPackFdSink = arangodb::velocypack::FdSink;
+#endif
 #endif
 #endif
 
@@ -82,6 +85,8 @@ using VPackStringStreamSink = arangodb::velocypack::StringStreamSink;
 #ifndef VELOCYPACK_ALIAS_COLLECTION
 #define VELOCYPACK_ALIAS_COLLECTION
 using VPackCollection = arangodb::velocypack::Collection;
+using VPackParallelPolicy = arangodb::velocypack::ParallelPolicy;
+using VPackVisitPath = arangodb::velocypack::VisitPath;
 #endif
 #endif
 
@@ -99,6 +104,21 @@ using VPackTopLevelAttributeExcludeHandler = arangodb::velocypack::TopLevelAttri
 #endif
 #endif
 
+#ifdef VELOCYPACK_CBOR_H
+#ifndef VELOCYPACK_ALIAS_CBOR
+#define VELOCYPACK_ALIAS_CBOR
+using VPackCborParser = arangodb::velocypack::CborParser;
+using VPackCborDumper = arangodb::velocypack::CborDumper;
+#endif
+#endif
+
+#ifdef VELOCYPACK_DELTAARRAY_H
+#ifndef VELOCYPACK_ALIAS_DELTAARRAY
+#define VELOCYPACK_ALIAS_DELTAARRAY
+using VPackDeltaSpan = arangodb::velocypack::DeltaSpan;
+#endif
+#endif
+
 #ifdef VELOCYPACK_DUMPER_H
 #ifndef VELOCYPACK_ALIAS_DUMPER
 #define VELOCYPACK_ALIAS_DUMPER
@@ -113,6 +133,22 @@ using VPackException = arangodb::velocypack::Exception;
 #endif
 #endif
 
+#ifdef VELOCYPACK_EXECUTOR_H
+#ifndef VELOCYPACK_ALIAS_EXECUTOR
+#define VELOCYPACK_ALIAS_EXECUTOR
+using VPackExecutor = arangodb::velocypack::Executor;
+using VPackThreadPool = arangodb::velocypack::ThreadPool;
+#endif
+#endif
+
+#ifdef VELOCYPACK_FRAMEDFILE_H
+#ifndef VELOCYPACK_ALIAS_FRAMEDFILE
+#define VELOCYPACK_ALIAS_FRAMEDFILE
+using VPackFramedFileWriter = arangodb::velocypack::FramedFileWriter;
+using VPackFramedFileReader = arangodb::velocypack::FramedFileReader;
+#endif
+#endif
+
 #ifdef VELOCYPACK_HEXDUMP_H
 #ifndef VELOCYPACK_ALIAS_HEXDUMP
 #define VELOCYPACK_ALIAS_HEXDUMP
@@ -120,6 +156,21 @@ using VPackHexDump = arangodb::velocypack::HexDump;
 #endif
 #endif
 
+#ifdef VELOCYPACK_INSTRUMENTATION_H
+#ifndef VELOCYPACK_ALIAS_INSTRUMENTATION
+#define VELOCYPACK_ALIAS_INSTRUMENTATION
+using VPackInstrumentation = arangodb::velocypack::Instrumentation;
+#endif
+#endif
+
+#ifdef VELOCYPACK_MSGPACK_H
+#ifndef VELOCYPACK_ALIAS_MSGPACK
+#define VELOCYPACK_ALIAS_MSGPACK
+using VPackMsgPackParser = arangodb::velocypack::MsgPackParser;
+using VPackMsgPackDumper = arangodb::velocypack::MsgPackDumper;
+#endif
+#endif
+
 #ifdef VELOCYPACK_OPTIONS_H
 #ifndef VELOCYPACK_ALIAS_OPTIONS
 #define VELOCYPACK_ALIAS_OPTIONS
@@ -130,6 +181,24 @@ using VPackCustomTypeHandler = arangodb::velocypack::CustomTypeHandler;
 #endif
 #endif
 
+#ifdef VELOCYPACK_OVERLAY_SLICE_H
+#ifndef VELOCYPACK_ALIAS_OVERLAY_SLICE
+#define VELOCYPACK_ALIAS_OVERLAY_SLICE
+using VPackOverlaySlice = arangodb::velocypack::OverlaySlice;
+using VPackOverlayIterator = arangodb::velocypack::OverlayIterator;
+#endif
+#endif
+
+#ifdef VELOCYPACK_PACKEDARRAY_H
+#ifndef VELOCYPACK_ALIAS_PACKEDARRAY
+#define VELOCYPACK_ALIAS_PACKEDARRAY
+template<typename T>
+using VPackPackedSpan = arangodb::velocypack::PackedSpan<T>;
+template<typename T>
+using VPackPackedAggregate = arangodb::velocypack::PackedAggregate<T>;
+#endif
+#endif
+
 #ifdef VELOCYPACK_PARSER_H
 #ifndef VELOCYPACK_ALIAS_PARSER
 #define VELOCYPACK_ALIAS_PARSER
@@ -144,6 +213,28 @@ using VPackSlice = arangodb::velocypack::Slice;
 #endif
 #endif
 
+#ifdef VELOCYPACK_SHARED_SLICE_H
+#ifndef VELOCYPACK_ALIAS_SHARED_SLICE
+#define VELOCYPACK_ALIAS_SHARED_SLICE
+using VPackSharedSlice = arangodb::velocypack::SharedSlice;
+using VPackLocalSharedSlice = arangodb::velocypack::LocalSharedSlice;
+#endif
+#endif
+
+#ifdef VELOCYPACK_SLICE_PATCHER_H
+#ifndef VELOCYPACK_ALIAS_SLICE_PATCHER
+#define VELOCYPACK_ALIAS_SLICE_PATCHER
+using VPackSlicePatcher = arangodb::velocypack::SlicePatcher;
+#endif
+#endif
+
+#ifdef VELOCYPACK_STREAMING_BUILDER_H
+#ifndef VELOCYPACK_ALIAS_STREAMING_BUILDER
+#define VELOCYPACK_ALIAS_STREAMING_BUILDER
+using VPackStreamingBuilder = arangodb::velocypack::StreamingBuilder;
+#endif
+#endif
+
 #ifdef VELOCYPACK_SLICE_CONTAINER_H
 #ifndef VELOCYPACK_ALIAS_SLICE_CONTAINER
 #define VELOCYPACK_ALIAS_SLICE_CONTAINER
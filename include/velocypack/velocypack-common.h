@@ -97,6 +97,16 @@ static inline ValueLength getVariableValueLength(ValueLength value) noexcept {
   return len;
 }
 
+// returns the number of bytes of the variable length integer at source
+static inline ValueLength getVariableValueLengthSize(
+    uint8_t const* source) noexcept {
+  ValueLength len = 1;
+  while (*source++ & 0x80U) {
+    ++len;
+  }
+  return len;
+}
+
 // read a variable length integer in unsigned LEB128 format
 template <bool reverse>
 static inline ValueLength readVariableValueLength(uint8_t const* source) {
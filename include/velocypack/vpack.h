@@ -31,16 +31,27 @@
 #include "velocypack/AttributeTranslator.h"
 #include "velocypack/Buffer.h"
 #include "velocypack/Builder.h"
+#include "velocypack/Cbor.h"
 #include "velocypack/Collection.h"
+#include "velocypack/DeltaArray.h"
 #include "velocypack/Dumper.h"
 #include "velocypack/Exception.h"
+#include "velocypack/Executor.h"
+#include "velocypack/FramedFile.h"
 #include "velocypack/HexDump.h"
+#include "velocypack/Instrumentation.h"
 #include "velocypack/Iterator.h"
+#include "velocypack/MsgPack.h"
 #include "velocypack/Options.h"
+#include "velocypack/OverlaySlice.h"
+#include "velocypack/PackedArray.h"
 #include "velocypack/Parser.h"
+#include "velocypack/SharedSlice.h"
 #include "velocypack/Sink.h"
 #include "velocypack/Slice.h"
 #include "velocypack/SliceContainer.h"
+#include "velocypack/SlicePatcher.h"
+#include "velocypack/StreamingBuilder.h"
 #include "velocypack/StringRef.h"
 #include "velocypack/Utf8Helper.h"
 #include "velocypack/Validator.h"
@@ -29,11 +29,20 @@
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Builder.h"
 #include "velocypack/Dumper.h"
+#include "velocypack/Instrumentation.h"
 #include "velocypack/Iterator.h"
 #include "velocypack/Sink.h"
 #include "velocypack/StringRef.h"
 
 using namespace arangodb::velocypack;
+
+// stores value in little endian byte order using width bytes
+static inline void StoreInteger(uint8_t* p, ValueLength value, unsigned int width) {
+  for (unsigned int i = 0; i < width; ++i) {
+    p[i] = static_cast<uint8_t>(value & 0xff);
+    value >>= 8;
+  }
+}
   
 std::string Builder::toString() const {
   Options options;
@@ -143,8 +152,33 @@ void Builder::sortObjectIndexLong(uint8_t* objBase,
   }
 }
 
+bool Builder::isObjectIndexSorted(uint8_t const* objBase,
+                                  std::vector<ValueLength> const& offsets) {
+  size_t const n = offsets.size();
+  uint64_t lenPrev;
+  uint8_t const* prev = findAttrName(objBase + offsets[0], lenPrev);
+  for (size_t i = 1; i < n; i++) {
+    uint64_t len;
+    uint8_t const* current = findAttrName(objBase + offsets[i], len);
+    uint64_t m = (std::min)(lenPrev, len);
+    int c = memcmp(prev, current, checkOverflow(m));
+    if (c > 0 || (c == 0 && lenPrev > len)) {
+      return false;
+    }
+    prev = current;
+    lenPrev = len;
+  }
+  return true;
+}
+
 void Builder::sortObjectIndex(uint8_t* objBase,
                               std::vector<ValueLength>& offsets) {
+  // attributes added in order of their names need no sorting
+  if (isObjectIndexSorted(objBase, offsets)) {
+    return;
+  }
+  VELOCYPACK_COUNT(ObjectIndexSorts, 1);
+  VELOCYPACK_COUNT(ObjectIndexSortedMembers, offsets.size());
   if (offsets.size() > 32) {
     sortObjectIndexLong(objBase, offsets);
   } else {
@@ -163,6 +197,7 @@ void Builder::removeLast() {
   }
   _pos = tos + index.back();
   index.pop_back();
+  truncateStringDedupe(_pos);
 }
 
 Builder& Builder::closeEmptyArrayOrObject(ValueLength tos, bool isArray) {
@@ -199,7 +234,10 @@ bool Builder::closeCompactArrayOrObject(ValueLength tos, bool isArray,
 
     if (_pos > (tos + 9)) {
       ValueLength len = _pos - (tos + 9);
+      shiftStringDedupe(tos, 9 - targetPos);
       memmove(_start + tos + targetPos, _start + tos + 9, checkOverflow(len));
+      VELOCYPACK_COUNT(BuilderCloseMemmoves, 1);
+      VELOCYPACK_COUNT(BuilderCloseBytesMoved, len);
     }
 
     // store byte length
@@ -216,17 +254,173 @@ bool Builder::closeCompactArrayOrObject(ValueLength tos, bool isArray,
     _pos -= 8;
     _pos += nLen + bLen;
 
+    if (isArray) {
+      VELOCYPACK_COUNT(CompactArrays, 1);
+    } else {
+      VELOCYPACK_COUNT(CompactObjects, 1);
+    }
     _stack.pop_back();
     return true;
   }
   return false;
 }
 
+bool Builder::closeShapedArray(ValueLength tos,
+                               std::vector<ValueLength> const& index) {
+  if (!_stringRefs.empty() && _stringRefs.back() > tos) {
+    // the members contain String references, which would become invalid
+    // when the members are rewritten
+    return false;
+  }
+
+  ValueLength const n = index.size();
+  std::vector<Slice> keys;
+  std::vector<std::pair<Slice, Slice>> members;
+  // values of all members in attribute name order, and their byte sizes
+  std::vector<Slice> values;
+  std::vector<ValueLength> valueSizes;
+  valueSizes.reserve(checkOverflow(n));
+
+  for (ValueLength i = 0; i < n; ++i) {
+    Slice const obj(_start + tos + index[i]);
+    uint8_t const h = obj.head();
+    if (!obj.isObject() || h == 0x0a || h == 0x16) {
+      return false;
+    }
+
+    // Objects with sorted index table are iterated in attribute name
+    // order, all others need to be sorted
+    bool const sorted = (h >= 0x0b && h <= 0x0e);
+    members.clear();
+    ObjectIterator it(obj, !sorted);
+    while (it.valid()) {
+      Slice const key = it.key(false);
+      if (!key.isString()) {
+        // translated attribute names are not supported
+        return false;
+      }
+      members.emplace_back(key, it.value());
+      it.next();
+    }
+    if (!sorted) {
+      std::sort(members.begin(), members.end(),
+                [](std::pair<Slice, Slice> const& lhs,
+                   std::pair<Slice, Slice> const& rhs) {
+                  return KeyOrderedIterator::compareKeys(lhs.first, rhs.first) < 0;
+                });
+    }
+
+    if (i == 0) {
+      for (size_t j = 0; j < members.size(); ++j) {
+        if (j > 0 && KeyOrderedIterator::compareKeys(members[j - 1].first,
+                                                     members[j].first) == 0) {
+          // duplicate attribute name
+          return false;
+        }
+        keys.push_back(members[j].first);
+      }
+      values.reserve(checkOverflow(n * keys.size()));
+    } else {
+      if (members.size() != keys.size()) {
+        return false;
+      }
+      for (size_t j = 0; j < members.size(); ++j) {
+        ValueLength const l = keys[j].byteSize();
+        if (members[j].first.byteSize() != l ||
+            memcmp(members[j].first.start(), keys[j].start(), checkOverflow(l)) != 0) {
+          return false;
+        }
+      }
+    }
+
+    ValueLength size = 0;
+    for (auto const& member : members) {
+      values.push_back(member.second);
+      size += member.second.byteSize();
+    }
+    valueSizes.push_back(size);
+  }
+
+  // the shape: an Array with the sorted attribute names
+  static Options const shapeOptions;
+  Builder shape(&shapeOptions);
+  shape.openArray();
+  for (auto const& key : keys) {
+    shape.add(key);
+  }
+  shape.close();
+  ValueLength const shapeSize = shape.size();
+
+  // compute the byte sizes of all rows. a row consists of its byte
+  // length, the distance back to the shape and the values
+  ValueLength rowsSize = 0;
+  for (auto& size : valueSizes) {
+    ValueLength const distance = shapeSize + rowsSize;
+    ValueLength rowSize = 1 + getVariableValueLength(distance) + size;
+    ValueLength const bLen = getVariableValueLength(rowSize);
+    rowSize += bLen;
+    if (getVariableValueLength(rowSize) != bLen) {
+      rowSize += 1;
+    }
+    size = rowSize;
+    rowsSize += rowSize;
+  }
+
+  ValueLength const nLen = getVariableValueLength(n);
+  ValueLength byteSize = 1 + shapeSize + rowsSize + nLen;
+  ValueLength const bLen = getVariableValueLength(byteSize);
+  byteSize += bLen;
+  if (getVariableValueLength(byteSize) != bLen) {
+    byteSize += 1;
+  }
+
+  if (byteSize >= _pos - (tos + 9)) {
+    // not smaller than the members alone
+    return false;
+  }
+
+  std::vector<uint8_t> out(checkOverflow(byteSize));
+  uint8_t* p = out.data();
+  *p = 0x15;
+  storeVariableValueLength<false>(p + 1, byteSize);
+  p += 1 + getVariableValueLength(byteSize);
+  uint8_t const* shapeStart = p;
+  memcpy(p, shape.start(), checkOverflow(shapeSize));
+  p += shapeSize;
+
+  size_t v = 0;
+  for (ValueLength i = 0; i < n; ++i) {
+    ValueLength const rowSize = valueSizes[i];
+    ValueLength const distance = static_cast<ValueLength>(p - shapeStart);
+    *p = 0x16;
+    storeVariableValueLength<false>(p + 1, rowSize);
+    p += 1 + getVariableValueLength(rowSize);
+    storeVariableValueLength<false>(p, distance);
+    p += getVariableValueLength(distance);
+    for (size_t j = 0; j < keys.size(); ++j, ++v) {
+      ValueLength const l = values[v].byteSize();
+      memcpy(p, values[v].start(), checkOverflow(l));
+      p += l;
+    }
+  }
+  storeVariableValueLength<true>(out.data() + byteSize - 1, n);
+
+  // Strings inside the members have moved
+  truncateStringDedupe(tos);
+
+  memcpy(_start + tos, out.data(), checkOverflow(byteSize));
+  _pos = tos + byteSize;
+  VELOCYPACK_COUNT(ShapedArrays, 1);
+  _stack.pop_back();
+  return true;
+}
+
 Builder& Builder::closeArray(ValueLength tos, std::vector<ValueLength>& index) {
   VELOCYPACK_ASSERT(!index.empty());
 
   // fix head byte in case a compact Array was originally requested:
   _start[tos] = 0x06;
+  VELOCYPACK_COUNT(IndexedArrays, 1);
 
   bool needIndexTable = true;
   bool needNrSubs = true;
@@ -298,7 +492,10 @@ Builder& Builder::closeArray(ValueLength tos, std::vector<ValueLength>& index) {
       }
       if (_pos > (tos + 9)) {
         ValueLength len = _pos - (tos + 9);
+        shiftStringDedupe(tos, 9 - targetPos);
         memmove(_start + tos + targetPos, _start + tos + 9, checkOverflow(len));
+        VELOCYPACK_COUNT(BuilderCloseMemmoves, 1);
+        VELOCYPACK_COUNT(BuilderCloseBytesMoved, len);
       }
       ValueLength const diff = 9 - targetPos;
       _pos -= diff;
@@ -366,6 +563,212 @@ Builder& Builder::closeArray(ValueLength tos, std::vector<ValueLength>& index) {
   return *this;
 }
 
+bool Builder::closePackedArray(ValueLength tos,
+                               std::vector<ValueLength> const& index) {
+  // either all members are Doubles, or all are integers. integers are
+  // stored as int32_t if possible, otherwise as int64_t or uint64_t
+  ValueLength const n = index.size();
+  bool const doubles = Slice(_start + tos + index[0]).isDouble();
+  bool negative = false;
+  bool wide = false;
+  bool unsignedWide = false;
+  for (ValueLength i = 0; i < n; ++i) {
+    Slice const s(_start + tos + index[i]);
+    if (doubles) {
+      if (!s.isDouble()) {
+        return false;
+      }
+    } else if (s.isUInt()) {
+      uint64_t const v = s.getUInt();
+      if (v > static_cast<uint64_t>(INT64_MAX)) {
+        unsignedWide = true;
+      } else if (v > static_cast<uint64_t>(INT32_MAX)) {
+        wide = true;
+      }
+    } else if (s.isInt() || s.isSmallInt()) {
+      int64_t const v = s.getInt();
+      if (v < 0) {
+        negative = true;
+      }
+      if (v < INT32_MIN || v > INT32_MAX) {
+        wide = true;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (negative && unsignedWide) {
+    return false;
+  }
+
+  uint8_t const head =
+      doubles ? 0xe3 : (unsignedWide ? 0xe2 : (wide ? 0xe1 : 0xe0));
+  ValueLength const width = (head == 0xe0 ? 4 : 8);
+  ValueLength const nLen = getVariableValueLength(n);
+  ValueLength const byteSize = 1 + nLen + n * width;
+  if (byteSize >= _pos - (tos + 9) + 2) {
+    // not smaller than the members plus the smallest Array header
+    return false;
+  }
+
+  // the payload can be larger than a member, so it cannot be written
+  // over the members in place
+  std::vector<uint8_t> out(checkOverflow(byteSize));
+  out[0] = head;
+  storeVariableValueLength<false>(out.data() + 1, n);
+  uint8_t* p = out.data() + 1 + nLen;
+  for (ValueLength i = 0; i < n; ++i) {
+    Slice const s(_start + tos + index[i]);
+    if (doubles) {
+      // Doubles are stored little endian already
+      memcpy(p, s.start() + 1, 8);
+    } else if (s.isUInt()) {
+      StoreInteger(p, s.getUInt(), static_cast<unsigned int>(width));
+    } else {
+      StoreInteger(p, static_cast<uint64_t>(s.getInt()),
+                   static_cast<unsigned int>(width));
+    }
+    p += width;
+  }
+
+  memcpy(_start + tos, out.data(), checkOverflow(byteSize));
+  _pos = tos + byteSize;
+  VELOCYPACK_COUNT(PackedArrays, 1);
+  _stack.pop_back();
+  return true;
+}
+
+bool Builder::closeDeltaArray(ValueLength tos,
+                              std::vector<ValueLength> const& index) {
+  ValueLength const n = index.size();
+  if (n > 0xffffffffULL / 9) {
+    // block offsets have 4 bytes, and a member can take up to 9 bytes
+    return false;
+  }
+  // all members must be integers that fit into an int64_t
+  std::vector<int64_t> values;
+  values.reserve(checkOverflow(n));
+  bool wide = false;
+  for (ValueLength i = 0; i < n; ++i) {
+    Slice const s(_start + tos + index[i]);
+    int64_t v;
+    if (s.isUInt()) {
+      uint64_t const u = s.getUInt();
+      if (u > static_cast<uint64_t>(INT64_MAX)) {
+        return false;
+      }
+      v = static_cast<int64_t>(u);
+    } else if (s.isInt() || s.isSmallInt()) {
+      v = s.getInt();
+    } else {
+      return false;
+    }
+    if (v < INT32_MIN || v > INT32_MAX) {
+      wide = true;
+    }
+    values.push_back(v);
+  }
+
+  std::vector<uint8_t> out;
+  encodeDeltaArray(values.data(), n, out);
+  ValueLength const byteSize = out.size();
+  if (byteSize >= _pos - (tos + 9) + 2) {
+    // not smaller than the members plus the smallest Array header
+    return false;
+  }
+  if (options->buildPackedArrays &&
+      byteSize >= 1 + getVariableValueLength(n) + n * (wide ? 8 : 4)) {
+    // not smaller than the packed Array
+    return false;
+  }
+
+  memcpy(_start + tos, out.data(), checkOverflow(byteSize));
+  _pos = tos + byteSize;
+  VELOCYPACK_COUNT(DeltaArrays, 1);
+  _stack.pop_back();
+  return true;
+}
+
+template<typename T>
+uint8_t* Builder::addPackedInternal(T const* values, ValueLength n) {
+  bool haveReported = false;
+  if (!_stack.empty() && !_keyWritten) {
+    reportAdd();
+    haveReported = true;
+  }
+  try {
+    checkKeyIsString(false);
+    ValueLength const oldPos = _pos;
+    ValueLength const nLen = getVariableValueLength(n);
+    ValueLength const byteSize = 1 + nLen + n * sizeof(T);
+    reserveSpace(byteSize);
+    _start[_pos] = PackedTraits<T>::head;
+    if (n == 0) {
+      _start[_pos + 1] = 0x00;
+    } else {
+      storeVariableValueLength<false>(_start + _pos + 1, n);
+    }
+    uint8_t* p = _start + _pos + 1 + nLen;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(p, values, checkOverflow(n * sizeof(T)));
+#else
+    for (ValueLength i = 0; i < n; ++i) {
+      uint64_t v = 0;
+      memcpy(&v, values + i, sizeof(T));
+      StoreInteger(p + i * sizeof(T), v, sizeof(T));
+    }
+#endif
+    _pos += byteSize;
+    return _start + oldPos;
+  } catch (...) {
+    // clean up in case of an exception
+    if (haveReported) {
+      cleanupAdd();
+    }
+    throw;
+  }
+}
+
+uint8_t* Builder::addPacked(int32_t const* values, ValueLength n) {
+  return addPackedInternal(values, n);
+}
+
+uint8_t* Builder::addPacked(int64_t const* values, ValueLength n) {
+  return addPackedInternal(values, n);
+}
+
+uint8_t* Builder::addPacked(uint64_t const* values, ValueLength n) {
+  return addPackedInternal(values, n);
+}
+
+uint8_t* Builder::addPacked(double const* values, ValueLength n) {
+  return addPackedInternal(values, n);
+}
+
+uint8_t* Builder::addDelta(int64_t const* values, ValueLength n) {
+  bool haveReported = false;
+  if (!_stack.empty() && !_keyWritten) {
+    reportAdd();
+    haveReported = true;
+  }
+  try {
+    checkKeyIsString(false);
+    std::vector<uint8_t> out;
+    encodeDeltaArray(values, n, out);
+    ValueLength const oldPos = _pos;
+    reserveSpace(out.size());
+    memcpy(_start + _pos, out.data(), out.size());
+    _pos += out.size();
+    return _start + oldPos;
+  } catch (...) {
+    // clean up in case of an exception
+    if (haveReported) {
+      cleanupAdd();
+    }
+    throw;
+  }
+}
+
 Builder& Builder::close() {
   if (isClosed()) {
     throw Exception(Exception::BuilderNeedOpenCompound);
@@ -387,6 +790,19 @@ Builder& Builder::close() {
   // From now on index.size() > 0
   VELOCYPACK_ASSERT(index.size() > 0);
 
+  if (isArray && index.size() >= 2 && options->buildShapedArrays &&
+      closeShapedArray(tos, index)) {
+    return *this;
+  }
+
+  if (isArray && options->buildDeltaArrays && closeDeltaArray(tos, index)) {
+    return *this;
+  }
+
+  if (isArray && options->buildPackedArrays && closePackedArray(tos, index)) {
+    return *this;
+  }
+
   // check if we can use the compact Array / Object format
   if (head == 0x13 || head == 0x14 ||
       (head == 0x06 && options->buildUnindexedArrays) ||
@@ -404,6 +820,7 @@ Builder& Builder::close() {
 
   // fix head byte in case a compact Array / Object was originally requested
   _start[tos] = 0x0b;
+  VELOCYPACK_COUNT(IndexedObjects, 1);
 
   // First determine byte length and its format:
   unsigned int offsetSize = 8;
@@ -420,7 +837,10 @@ Builder& Builder::close() {
     ValueLength targetPos = 3;
     if (_pos > (tos + 9)) {
       ValueLength len = _pos - (tos + 9);
+      shiftStringDedupe(tos, 9 - targetPos);
       memmove(_start + tos + targetPos, _start + tos + 9, checkOverflow(len));
+      VELOCYPACK_COUNT(BuilderCloseMemmoves, 1);
+      VELOCYPACK_COUNT(BuilderCloseBytesMoved, len);
     }
     ValueLength const diff = 9 - targetPos;
     _pos -= diff;
@@ -745,6 +1165,7 @@ uint8_t* Builder::set(Value const& item) {
             Exception::BuilderUnexpectedValue,
             "Must give a string or char const* for ValueType::String");
       }
+      dedupeString(oldPos);
       break;
     }
     case ValueType::Array: {
@@ -804,13 +1225,57 @@ uint8_t* Builder::set(Value const& item) {
 uint8_t* Builder::set(Slice const& item) {
   checkKeyIsString(item.isString());
 
-  ValueLength const l = item.byteSize();
+  if ((item.isArray() || item.isObject()) && !item.isSelfContained()) {
+    // a row of a shaped Array refers to the shape in front of it, and
+    // String references may point in front of the value, so copy it
+    // member by member
+    return setMembers(item);
+  }
+
+  // a String reference is only valid inside its own document, so
+  // copy the String it refers to instead
+  Slice const source = item.resolveStringReference();
+  ValueLength const l = source.byteSize();
   reserveSpace(l);
-  memcpy(_start + _pos, item.start(), checkOverflow(l));
+  memcpy(_start + _pos, source.start(), checkOverflow(l));
   _pos += l;
+  if (source.isString()) {
+    dedupeString(_pos - l);
+  }
   return _start + _pos - l;
 }
 
+uint8_t* Builder::setMembers(Slice const& item) {
+  ValueLength const pos = _pos;
+  if (item.isObject()) {
+    addObject();
+    ObjectIterator it(item, true);
+    while (it.valid()) {
+      reportAdd();
+      // attribute names are never String references, and must not
+      // become ones. translated attribute names are kept as they are
+      checkKeyIsString(true);
+      Slice const key = it.key(false);
+      ValueLength const l = key.byteSize();
+      reserveSpace(l);
+      memcpy(_start + _pos, key.start(), checkOverflow(l));
+      _pos += l;
+      set(it.value());
+      it.next();
+    }
+  } else {
+    addArray();
+    ArrayIterator it(item);
+    while (it.valid()) {
+      reportAdd();
+      set(it.value());
+      it.next();
+    }
+  }
+  close();
+  return _start + pos;
+}
+
 uint8_t* Builder::set(ValuePair const& pair) {
   // This method builds a single further VPack item at the current
   // append position. This is the case for ValueType::String,
@@ -844,6 +1309,7 @@ uint8_t* Builder::set(ValuePair const& pair) {
       memcpy(_start + _pos, pair.getStart(), checkOverflow(size));
       _pos += size;
     }
+    dedupeString(oldPos);
     return _start + oldPos;
   } else if (pair.valueType() == ValueType::Custom) {
     // We only reserve space here, the caller has to fill in the custom type
@@ -861,6 +1327,94 @@ uint8_t* Builder::set(ValuePair const& pair) {
                   "ValueType::Custom are valid for ValuePair argument");
 }
 
+void Builder::replaceWithStringReference(ValueLength pos) {
+  static constexpr uint32_t tableSize = 1024;
+
+  uint8_t* s = _start + pos;
+  ValueLength const size = _pos - pos;
+  if (size <= 2) {
+    // cannot be replaced by anything shorter
+    return;
+  }
+
+  if (_stringTable.empty()) {
+    _stringTable.resize(tableSize, 0);
+  }
+  uint32_t const slot = static_cast<uint32_t>(
+      VELOCYPACK_HASH(s, checkOverflow(size), 0xdeadbeef) & (tableSize - 1));
+
+  ValueLength const entry = _stringTable[slot];
+  if (entry != 0) {
+    // the entry may be outdated, so always compare the actual bytes
+    ValueLength const target = entry - 1;
+    if (target + size <= pos && memcmp(_start + target, s, checkOverflow(size)) == 0) {
+      ValueLength const distance = pos - target;
+      uint8_t head;
+      unsigned int width;
+      if (distance <= 0xff) {
+        head = 0xd8;
+        width = 1;
+      } else if (distance <= 0xffff) {
+        head = 0xd9;
+        width = 2;
+      } else if (distance <= 0xffffffffu) {
+        head = 0xda;
+        width = 4;
+      } else {
+        head = 0xdb;
+        width = 8;
+      }
+      if (1 + width < size) {
+        s[0] = head;
+        StoreInteger(s + 1, distance, width);
+        _pos = pos + 1 + width;
+        _stringRefs.push_back(pos);
+        VELOCYPACK_COUNT(StringReferences, 1);
+        return;
+      }
+    }
+  }
+
+  // remember the String. on a collision, the more recent String wins,
+  // which keeps the distances of later references small
+  _stringTable[slot] = pos + 1;
+  _stringLog.emplace_back(pos, slot);
+}
+
+void Builder::shiftStringDedupe(ValueLength tos, ValueLength diff) {
+  // references inside the compound value pointing to Strings in front
+  // of it get shorter distances. references to Strings inside the
+  // compound value stay the same, as both ends are moved
+  for (auto it = _stringRefs.rbegin(); it != _stringRefs.rend() && *it > tos; ++it) {
+    uint8_t* p = _start + *it;
+    unsigned int const width = 1U << (*p - 0xd8);
+    ValueLength const distance = readIntegerNonEmpty<ValueLength>(p + 1, width);
+    if (*it - distance < tos) {
+      StoreInteger(p + 1, distance - diff, width);
+    }
+    *it -= diff;
+  }
+  for (auto it = _stringLog.rbegin(); it != _stringLog.rend() && it->first > tos; ++it) {
+    if (_stringTable[it->second] == it->first + 1) {
+      _stringTable[it->second] -= diff;
+    }
+    it->first -= diff;
+  }
+}
+
+void Builder::truncateStringDedupe(ValueLength pos) {
+  while (!_stringRefs.empty() && _stringRefs.back() >= pos) {
+    _stringRefs.pop_back();
+  }
+  while (!_stringLog.empty() && _stringLog.back().first >= pos) {
+    auto const& last = _stringLog.back();
+    if (_stringTable[last.second] == last.first + 1) {
+      _stringTable[last.second] = 0;
+    }
+    _stringLog.pop_back();
+  }
+}
+
 void Builder::checkAttributeUniqueness(Slice const& obj) const {
   VELOCYPACK_ASSERT(options->checkAttributeUniqueness == true);
 
@@ -0,0 +1,587 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Cbor.h"
+#include "velocypack/Iterator.h"
+#include "velocypack/Utf8Helper.h"
+#include "velocypack/Value.h"
+#include "velocypack/ValueType.h"
+
+using namespace arangodb::velocypack;
+
+namespace {
+
+// CBOR major types
+uint8_t const MajorUnsigned = 0;
+uint8_t const MajorNegative = 1;
+uint8_t const MajorBytes = 2;
+uint8_t const MajorText = 3;
+uint8_t const MajorArray = 4;
+uint8_t const MajorMap = 5;
+uint8_t const MajorTag = 6;
+uint8_t const MajorSimple = 7;
+
+// additional information value for indefinite-length items
+uint8_t const Indefinite = 31;
+
+// CBOR tags with special treatment
+uint64_t const TagEpochDateTime = 1;
+uint64_t const TagPositiveBignum = 2;
+uint64_t const TagNegativeBignum = 3;
+
+inline uint64_t readBigEndian(uint8_t const* p, size_t length) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < length; ++i) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+inline double decodeHalf(uint16_t half) {
+  int const exponent = (half >> 10) & 0x1f;
+  int const mantissa = half & 0x3ff;
+  double value;
+  if (exponent == 0) {
+    value = std::ldexp(mantissa, -24);
+  } else if (exponent != 31) {
+    value = std::ldexp(mantissa + 1024, exponent - 25);
+  } else {
+    value = (mantissa == 0) ? INFINITY : NAN;
+  }
+  return (half & 0x8000) ? -value : value;
+}
+
+}  // namespace
+
+CborParser::CborParser(Options const* options)
+    : _start(nullptr),
+      _size(0),
+      _pos(0),
+      _key(nullptr),
+      _keyLength(0),
+      options(options) {
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+  _b.reset(new Builder());
+  _b->options = options;
+}
+
+CborParser::CborParser(Builder& builder, Options const* options)
+    : _start(nullptr),
+      _size(0),
+      _pos(0),
+      _key(nullptr),
+      _keyLength(0),
+      options(options) {
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+  _b.reset(&builder, BuilderNonDeleter());
+}
+
+ValueLength CborParser::parse(uint8_t const* start, size_t size, bool multi) {
+  _start = start;
+  _size = size;
+  _pos = 0;
+  _key = nullptr;
+  if (options->clearBuilderBeforeParse) {
+    _b->clear();
+  }
+
+  ValueLength nr = 0;
+  do {
+    parseValue();
+    ++nr;
+    if (!multi && _pos != _size) {
+      throw Exception(Exception::ParseError, "Expecting EOF");
+    }
+  } while (multi && _pos < _size);
+  return nr;
+}
+
+uint8_t const* CborParser::consume(uint64_t length) {
+  if (length > _size - _pos) {
+    throw Exception(Exception::ParseError, "Unexpected end of input");
+  }
+  uint8_t const* p = _start + _pos;
+  _pos += static_cast<size_t>(length);
+  return p;
+}
+
+uint64_t CborParser::readArgument(uint8_t info) {
+  if (info < 24) {
+    return info;
+  }
+  if (info <= 27) {
+    size_t const length = size_t(1) << (info - 24);
+    return readBigEndian(consume(length), length);
+  }
+  throw Exception(Exception::ParseError, "Invalid CBOR additional information");
+}
+
+double CborParser::readFloat(uint8_t info) {
+  switch (info) {
+    case 25:
+      return decodeHalf(static_cast<uint16_t>(readBigEndian(consume(2), 2)));
+    case 26: {
+      uint32_t bits = static_cast<uint32_t>(readBigEndian(consume(4), 4));
+      float f;
+      memcpy(&f, &bits, sizeof(f));
+      return f;
+    }
+    case 27: {
+      uint64_t bits = readBigEndian(consume(8), 8);
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      return d;
+    }
+    default:
+      throw Exception(Exception::ParseError, "Expecting CBOR float");
+  }
+}
+
+// returns true and skips the break byte if it is next in the input
+bool CborParser::checkBreak() {
+  if (_pos >= _size) {
+    throw Exception(Exception::ParseError, "Unexpected end of input");
+  }
+  if (_start[_pos] == 0xff) {
+    ++_pos;
+    return true;
+  }
+  return false;
+}
+
+// reads a byte or text string. indefinite-length strings are assembled
+// in result, definite-length strings are referenced in the input
+void CborParser::readString(uint8_t info, uint8_t major, std::string& result,
+                            char const*& p, uint64_t& length) {
+  if (info != Indefinite) {
+    length = readArgument(info);
+    p = reinterpret_cast<char const*>(consume(length));
+    return;
+  }
+
+  result.clear();
+  while (!checkBreak()) {
+    uint8_t const head = *consume(1);
+    if ((head >> 5) != major || (head & 0x1f) == Indefinite) {
+      throw Exception(Exception::ParseError,
+                      "Invalid chunk in indefinite-length string");
+    }
+    uint64_t const chunkLength = readArgument(head & 0x1f);
+    result.append(reinterpret_cast<char const*>(consume(chunkLength)),
+                  checkOverflow(chunkLength));
+  }
+  p = result.data();
+  length = result.size();
+}
+
+void CborParser::parseValue() {
+  uint8_t const head = *consume(1);
+  uint8_t const major = head >> 5;
+  uint8_t const info = head & 0x1f;
+
+  switch (major) {
+    case MajorUnsigned:
+      addValue(Value(readArgument(info)));
+      break;
+    case MajorNegative: {
+      uint64_t const n = readArgument(info);
+      if (n > static_cast<uint64_t>(INT64_MAX)) {
+        throw Exception(Exception::NumberOutOfRange);
+      }
+      addValue(Value(-1 - static_cast<int64_t>(n)));
+      break;
+    }
+    case MajorBytes:
+      parseString(info, ValueType::Binary);
+      break;
+    case MajorText:
+      parseString(info, ValueType::String);
+      break;
+    case MajorArray:
+      parseArray(info);
+      break;
+    case MajorMap:
+      parseObject(info);
+      break;
+    case MajorTag:
+      parseTag(readArgument(info));
+      break;
+    default:
+      parseSimple(info);
+      break;
+  }
+}
+
+void CborParser::parseKey() {
+  uint8_t head = *consume(1);
+  // tags on attribute names are ignored
+  while ((head >> 5) == MajorTag) {
+    readArgument(head & 0x1f);
+    head = *consume(1);
+  }
+
+  uint8_t const major = head >> 5;
+  uint8_t const info = head & 0x1f;
+
+  if (major == MajorText) {
+    char const* p;
+    uint64_t length;
+    readString(info, MajorText, _keyBuffer, p, length);
+    if (options->validateUtf8Strings &&
+        !Utf8Helper::isValidUtf8(reinterpret_cast<uint8_t const*>(p),
+                                 length)) {
+      throw Exception(Exception::InvalidUtf8Sequence);
+    }
+    _key = p;
+    _keyLength = checkOverflow(length);
+    return;
+  }
+
+  // integer keys are converted into their string representation
+  if (major == MajorUnsigned) {
+    _keyBuffer = std::to_string(readArgument(info));
+  } else if (major == MajorNegative) {
+    uint64_t const n = readArgument(info);
+    if (n > static_cast<uint64_t>(INT64_MAX)) {
+      throw Exception(Exception::NumberOutOfRange);
+    }
+    _keyBuffer = std::to_string(-1 - static_cast<int64_t>(n));
+  } else {
+    throw Exception(Exception::ParseError,
+                    "Expecting string or integer attribute name");
+  }
+  _key = _keyBuffer.data();
+  _keyLength = _keyBuffer.size();
+}
+
+void CborParser::parseArray(uint8_t info) {
+  addValue(Value(ValueType::Array));
+  if (info == Indefinite) {
+    while (!checkBreak()) {
+      parseValue();
+    }
+  } else {
+    uint64_t const length = readArgument(info);
+    for (uint64_t i = 0; i < length; ++i) {
+      parseValue();
+    }
+  }
+  _b->close();
+}
+
+void CborParser::parseObject(uint8_t info) {
+  addValue(Value(ValueType::Object));
+  if (info == Indefinite) {
+    while (!checkBreak()) {
+      parseKey();
+      parseValue();
+    }
+  } else {
+    uint64_t const length = readArgument(info);
+    for (uint64_t i = 0; i < length; ++i) {
+      parseKey();
+      parseValue();
+    }
+  }
+  _b->close();
+}
+
+void CborParser::parseString(uint8_t info, ValueType type) {
+  std::string buffer;
+  char const* p;
+  uint64_t length;
+  readString(info, type == ValueType::String ? MajorText : MajorBytes, buffer,
+             p, length);
+  if (type == ValueType::String && options->validateUtf8Strings &&
+      !Utf8Helper::isValidUtf8(reinterpret_cast<uint8_t const*>(p), length)) {
+    throw Exception(Exception::InvalidUtf8Sequence);
+  }
+  addValue(ValuePair(p, length, type));
+}
+
+void CborParser::parseTag(uint64_t tag) {
+  if (tag == TagEpochDateTime) {
+    uint8_t const head = *consume(1);
+    uint8_t const major = head >> 5;
+    uint8_t const info = head & 0x1f;
+    int64_t value;
+    if (major == MajorUnsigned || major == MajorNegative) {
+      uint64_t const n = readArgument(info);
+      if (n > static_cast<uint64_t>(INT64_MAX / 1000)) {
+        throw Exception(Exception::NumberOutOfRange);
+      }
+      int64_t const seconds = (major == MajorUnsigned)
+                                  ? static_cast<int64_t>(n)
+                                  : -1 - static_cast<int64_t>(n);
+      value = seconds * 1000;
+    } else if (major == MajorSimple && info >= 25 && info <= 27) {
+      double const seconds = readFloat(info);
+      double const ms = std::round(seconds * 1000.0);
+      if (std::isnan(ms) || ms >= 9223372036854775807.0 ||
+          ms <= -9223372036854775808.0) {
+        throw Exception(Exception::NumberOutOfRange);
+      }
+      value = static_cast<int64_t>(ms);
+    } else {
+      throw Exception(Exception::ParseError,
+                      "Expecting number for epoch-based date/time");
+    }
+    addValue(Value(value, ValueType::UTCDate));
+    return;
+  }
+
+  if (tag == TagPositiveBignum || tag == TagNegativeBignum) {
+    uint8_t const head = *consume(1);
+    if ((head >> 5) != MajorBytes) {
+      throw Exception(Exception::ParseError, "Expecting byte string for bignum");
+    }
+    std::string buffer;
+    char const* p;
+    uint64_t length;
+    readString(head & 0x1f, MajorBytes, buffer, p, length);
+    // skip leading zeros
+    while (length > 0 && *p == '\0') {
+      ++p;
+      --length;
+    }
+    if (length > 8) {
+      throw Exception(Exception::NumberOutOfRange);
+    }
+    uint64_t const n =
+        readBigEndian(reinterpret_cast<uint8_t const*>(p), length);
+    if (tag == TagPositiveBignum) {
+      addValue(Value(n));
+    } else {
+      if (n > static_cast<uint64_t>(INT64_MAX)) {
+        throw Exception(Exception::NumberOutOfRange);
+      }
+      addValue(Value(-1 - static_cast<int64_t>(n)));
+    }
+    return;
+  }
+
+  // all other tags are ignored
+  parseValue();
+}
+
+void CborParser::parseSimple(uint8_t info) {
+  switch (info) {
+    case 20:
+      addValue(Value(false));
+      break;
+    case 21:
+      addValue(Value(true));
+      break;
+    case 24:
+      // one-byte simple value
+      consume(1);
+      addValue(Value(ValueType::Null));
+      break;
+    case 25:
+    case 26:
+    case 27:
+      addValue(Value(readFloat(info)));
+      break;
+    case 28:
+    case 29:
+    case 30:
+      throw Exception(Exception::ParseError,
+                      "Invalid CBOR additional information");
+    case Indefinite:
+      throw Exception(Exception::ParseError, "Unexpected CBOR break");
+    default:
+      // null, undefined and unassigned simple values
+      addValue(Value(ValueType::Null));
+      break;
+  }
+}
+
+CborDumper::CborDumper(Sink* sink, Options const* options)
+    : options(options), _sink(sink) {
+  if (sink == nullptr) {
+    throw Exception(Exception::InternalError, "Sink cannot be a nullptr");
+  }
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+}
+
+// appends the initial byte for the major type with the smallest possible
+// encoding of the argument value
+void CborDumper::appendHead(uint8_t major, uint64_t value) {
+  char buffer[9];
+  size_t length;
+  uint8_t info;
+  if (value < 24) {
+    info = static_cast<uint8_t>(value);
+    length = 0;
+  } else if (value <= 0xff) {
+    info = 24;
+    length = 1;
+  } else if (value <= 0xffff) {
+    info = 25;
+    length = 2;
+  } else if (value <= 0xffffffffULL) {
+    info = 26;
+    length = 4;
+  } else {
+    info = 27;
+    length = 8;
+  }
+  buffer[0] = static_cast<char>((major << 5) | info);
+  for (size_t i = 0; i < length; ++i) {
+    buffer[length - i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  _sink->append(&buffer[0], 1 + length);
+}
+
+void CborDumper::dumpInt(int64_t v) {
+  if (v >= 0) {
+    appendHead(MajorUnsigned, static_cast<uint64_t>(v));
+  } else {
+    appendHead(MajorNegative, static_cast<uint64_t>(-1 - v));
+  }
+}
+
+void CborDumper::dumpDouble(double v) {
+  uint64_t bits;
+  memcpy(&bits, &v, sizeof(bits));
+  char buffer[9];
+  buffer[0] = static_cast<char>(0xfb);
+  for (size_t i = 0; i < 8; ++i) {
+    buffer[8 - i] = static_cast<char>((bits >> (8 * i)) & 0xff);
+  }
+  _sink->append(&buffer[0], 9);
+}
+
+// dumps a UTCDate value (milliseconds since the epoch) as an epoch-based
+// date/time, using an integer if there is no fractional second
+void CborDumper::dumpUTCDate(int64_t v) {
+  appendHead(MajorTag, TagEpochDateTime);
+  if (v % 1000 == 0) {
+    dumpInt(v / 1000);
+  } else {
+    dumpDouble(static_cast<double>(v) / 1000.0);
+  }
+}
+
+void CborDumper::handleUnsupportedType(Slice const& slice) {
+  if (options->unsupportedTypeBehavior == Options::NullifyUnsupportedType) {
+    _sink->push_back(static_cast<char>(0xf6));
+    return;
+  } else if (options->unsupportedTypeBehavior ==
+             Options::ConvertUnsupportedType) {
+    std::string value =
+        std::string("(non-representable type ") + slice.typeName() + ")";
+    appendHead(MajorText, value.size());
+    _sink->append(value);
+    return;
+  }
+
+  throw Exception(Exception::NoJsonEquivalent,
+                  "Type has no equivalent in CBOR");
+}
+
+void CborDumper::dumpValue(Slice const& slice) {
+  switch (slice.type()) {
+    case ValueType::Null:
+      _sink->push_back(static_cast<char>(0xf6));
+      break;
+
+    case ValueType::Bool:
+      _sink->push_back(static_cast<char>(slice.getBool() ? 0xf5 : 0xf4));
+      break;
+
+    case ValueType::Double:
+      dumpDouble(slice.getDouble());
+      break;
+
+    case ValueType::UTCDate:
+      dumpUTCDate(slice.getUTCDate());
+      break;
+
+    case ValueType::External:
+      dumpValue(Slice(slice.getExternal()));
+      break;
+
+    case ValueType::Int:
+    case ValueType::SmallInt:
+      dumpInt(slice.getInt());
+      break;
+
+    case ValueType::UInt:
+      appendHead(MajorUnsigned, slice.getUInt());
+      break;
+
+    case ValueType::String: {
+      ValueLength len;
+      char const* p = slice.getString(len);
+      appendHead(MajorText, len);
+      _sink->append(p, len);
+      break;
+    }
+
+    case ValueType::Binary: {
+      ValueLength len;
+      uint8_t const* p = slice.getBinary(len);
+      appendHead(MajorBytes, len);
+      _sink->append(reinterpret_cast<char const*>(p), len);
+      break;
+    }
+
+    case ValueType::Array: {
+      appendHead(MajorArray, slice.length());
+      ArrayIterator it(slice);
+      while (it.valid()) {
+        dumpValue(it.value());
+        it.next();
+      }
+      break;
+    }
+
+    case ValueType::Object: {
+      appendHead(MajorMap, slice.length());
+      ObjectIterator it(slice);
+      while (it.valid()) {
+        dumpValue(it.key(true));
+        dumpValue(it.value());
+        it.next();
+      }
+      break;
+    }
+
+    default:
+      handleUnsupportedType(slice);
+      break;
+  }
+}
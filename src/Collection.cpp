@@ -24,7 +24,11 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <unordered_map>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <thread>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Collection.h"
@@ -37,6 +41,8 @@ using namespace arangodb::velocypack;
 
 // indicator for "element not found" in indexOf() method
 ValueLength const Collection::NotFound = UINT64_MAX;
+
+constexpr size_t Collection::ParallelSortThreshold;
   
 // fully append an array to the builder
 static void appendArray(Builder& builder, Slice const& slice) {
@@ -48,16 +54,6 @@ static void appendArray(Builder& builder, Slice const& slice) {
   }
 }
 
-// convert a vector of strings into an unordered_set of strings
-static inline std::unordered_set<std::string> makeSet(
-    std::vector<std::string> const& keys) {
-  std::unordered_set<std::string> s;
-  for (auto const& it : keys) {
-    s.emplace(it);
-  }
-  return s;
-}
-
 void Collection::forEach(Slice const& slice, Predicate const& predicate) {
   ArrayIterator it(slice);
   ValueLength index = 0;
@@ -93,6 +89,10 @@ Builder Collection::filter(Slice const& slice, Predicate const& predicate) {
 }
 
 Slice Collection::find(Slice const& slice, Predicate const& predicate) {
+  if (slice.isPackedArray()) {
+    throw Exception(Exception::InvalidValueType,
+                    "Members of packed Arrays have no VPack representation");
+  }
   ArrayIterator it(slice);
   ValueLength index = 0;
 
@@ -250,10 +250,10 @@ Builder Collection::values(Slice const& slice) {
 
 Builder Collection::keep(Slice const& slice,
                          std::vector<std::string> const& keys) {
-  // check if there are so many keys that we want to use the hash-based version
+  // check if there are so many keys that we want to use the sorted version
   // cut-off values are arbitrary...
   if (keys.size() >= 4 && slice.length() > 10) {
-    return keep(slice, makeSet(keys));
+    return keep(slice, SortedKeySet(keys));
   }
 
   Builder b;
@@ -262,9 +262,13 @@ Builder Collection::keep(Slice const& slice,
   ObjectIterator it(slice);
 
   while (it.valid()) {
-    auto key = it.key(true).copyString();
-    if (std::find(keys.begin(), keys.end(), key) != keys.end()) {
-      b.add(key, it.value());
+    ValueLength length;
+    char const* key = it.key(true).getString(length);
+    for (auto const& k : keys) {
+      if (k.size() == length && memcmp(k.data(), key, checkOverflow(length)) == 0) {
+        b.add(key, checkOverflow(length), it.value());
+        break;
+      }
     }
     it.next();
   }
@@ -279,9 +283,12 @@ Builder Collection::keep(Slice const& slice,
   b.add(Value(ValueType::Object));
 
   ObjectIterator it(slice);
+  std::string key;
 
   while (it.valid()) {
-    auto key = it.key(true).copyString();
+    ValueLength length;
+    char const* p = it.key(true).getString(length);
+    key.assign(p, checkOverflow(length));
     if (keys.find(key) != keys.end()) {
       b.add(key, it.value());
     }
@@ -294,10 +301,10 @@ Builder Collection::keep(Slice const& slice,
 
 Builder Collection::remove(Slice const& slice,
                            std::vector<std::string> const& keys) {
-  // check if there are so many keys that we want to use the hash-based version
+  // check if there are so many keys that we want to use the sorted version
   // cut-off values are arbitrary...
   if (keys.size() >= 4 && slice.length() > 10) {
-    return remove(slice, makeSet(keys));
+    return remove(slice, SortedKeySet(keys));
   }
 
   Builder b;
@@ -306,9 +313,17 @@ Builder Collection::remove(Slice const& slice,
   ObjectIterator it(slice);
 
   while (it.valid()) {
-    auto key = it.key(true).copyString();
-    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
-      b.add(key, it.value());
+    ValueLength length;
+    char const* key = it.key(true).getString(length);
+    bool found = false;
+    for (auto const& k : keys) {
+      if (k.size() == length && memcmp(k.data(), key, checkOverflow(length)) == 0) {
+        found = true;
+        break;
+      }
+    }
+    if (!found) {
+      b.add(key, checkOverflow(length), it.value());
     }
     it.next();
   }
@@ -323,9 +338,12 @@ Builder Collection::remove(Slice const& slice,
   b.add(Value(ValueType::Object));
 
   ObjectIterator it(slice);
+  std::string key;
 
   while (it.valid()) {
-    auto key = it.key(true).copyString();
+    ValueLength length;
+    char const* p = it.key(true).getString(length);
+    key.assign(p, checkOverflow(length));
     if (keys.find(key) == keys.end()) {
       b.add(key, it.value());
     }
@@ -336,70 +354,140 @@ Builder Collection::remove(Slice const& slice,
   return b;
 }
 
-Builder Collection::merge(Slice const& left, Slice const& right,
-                          bool mergeValues, bool nullMeansRemove) {
-  if (!left.isObject() || !right.isObject()) {
-    throw Exception(Exception::InvalidValueType, "Expecting type Object");
-  }
-
-  Builder b;
-  b.add(Value(ValueType::Object));
+// adds the members of an Object whose names are (keep = true) or are not
+// (keep = false) contained in keys to the open Object in builder
+static void filterMembers(Builder& builder, Slice const& slice,
+                          SortedKeySet const& keys, bool keep) {
+  uint8_t const head = slice.head();
+  ObjectIterator it(slice);
 
-  std::unordered_map<std::string, Slice> rightValues;
-  {
-    ObjectIterator it(right);
+  if (head >= 0x0b && head <= 0x0e) {
+    // sorted index table: merge-join the attribute names with the key set
+    std::vector<StringRef> const& sorted = keys.keys();
+    size_t position = 0;
     while (it.valid()) {
-      rightValues.emplace(it.key(true).copyString(), it.value());
+      ValueLength length;
+      char const* key = it.key(true).getString(length);
+      int res = 1;
+      while (position < sorted.size() &&
+             (res = SortedKeySet::compare(sorted[position].data(),
+                                          sorted[position].size(), key,
+                                          checkOverflow(length))) < 0) {
+        ++position;
+      }
+      bool const found = (position < sorted.size() && res == 0);
+      if (found == keep) {
+        builder.add(key, checkOverflow(length), it.value());
+      } else if (keep && position == sorted.size()) {
+        // no more attributes to keep
+        break;
+      }
       it.next();
     }
+    return;
   }
 
-  {
-    ObjectIterator it(left);
-
-    while (it.valid()) {
-      auto key = it.key(true).copyString();
-      auto found = rightValues.find(key);
-
-      if (found == rightValues.end()) {
-        // use left value
-        b.add(key, it.value());
-      } else if (mergeValues && it.value().isObject() &&
-                 (*found).second.isObject()) {
-        // merge both values
-        auto& value = (*found).second;
-        if (!nullMeansRemove || (!value.isNone() && !value.isNull())) {
-          Builder sub = Collection::merge(it.value(), value, true, nullMeansRemove);
-          b.add(key, sub.slice());
-        }
-        // clear the value in the map so its not added again
-        (*found).second = Slice();
-      } else {
-        // use right value
-        auto& value = (*found).second;
-        if (!nullMeansRemove || (!value.isNone() && !value.isNull())) {
-          b.add(key, value);
-        }
-        // clear the value in the map so its not added again
-        (*found).second = Slice();
-      }
-      it.next();
+  // no sorted index table: look up each attribute name
+  while (it.valid()) {
+    ValueLength length;
+    char const* key = it.key(true).getString(length);
+    if (keys.contains(key, checkOverflow(length)) == keep) {
+      builder.add(key, checkOverflow(length), it.value());
     }
+    it.next();
   }
+}
 
-  // add remaining values that were only in right
-  for (auto& it : rightValues) {
-    auto& s = it.second;
-    if (s.isNone()) {
-      continue;
+Builder Collection::keep(Slice const& slice, SortedKeySet const& keys) {
+  Builder b;
+  keep(b, slice, keys);
+  return b;
+}
+
+Builder Collection::remove(Slice const& slice, SortedKeySet const& keys) {
+  Builder b;
+  remove(b, slice, keys);
+  return b;
+}
+
+Builder& Collection::keep(Builder& builder, Slice const& slice,
+                          SortedKeySet const& keys) {
+  if (!slice.isObject()) {
+    throw Exception(Exception::InvalidValueType, "Expecting type Object");
+  }
+  builder.add(Value(ValueType::Object));
+  filterMembers(builder, slice, keys, true);
+  builder.close();
+  return builder;
+}
+
+Builder& Collection::remove(Builder& builder, Slice const& slice,
+                            SortedKeySet const& keys) {
+  if (!slice.isObject()) {
+    throw Exception(Exception::InvalidValueType, "Expecting type Object");
+  }
+  builder.add(Value(ValueType::Object));
+  filterMembers(builder, slice, keys, false);
+  builder.close();
+  return builder;
+}
+
+// merges the members of two Objects into the open Object in builder, by
+// a merge-join over both sequences of attribute names. the attributes
+// are added in sorted order, so closing the Object does not need to sort
+static void mergeMembers(Builder& builder, Slice const& left,
+                         Slice const& right, bool mergeValues,
+                         bool nullMeansRemove) {
+  KeyOrderedIterator l(left);
+  KeyOrderedIterator r(right);
+
+  while (l.valid() || r.valid()) {
+    int res;
+    if (!r.valid()) {
+      res = -1;
+    } else if (!l.valid()) {
+      res = 1;
+    } else {
+      res = KeyOrderedIterator::compareKeys(l.key(), r.key());
     }
-    if (nullMeansRemove && s.isNull()) {
+
+    if (res < 0) {
+      // use left value
+      ValueLength length;
+      char const* key = l.key().getString(length);
+      builder.add(key, checkOverflow(length), l.value());
+      l.next();
       continue;
     }
-    b.add(std::move(it.first), s);
+
+    Slice const rightKey = r.key();
+    Slice const value = r.value();
+    ValueLength length;
+    char const* key = rightKey.getString(length);
+    if (res == 0 && mergeValues && value.isObject() && l.value().isObject()) {
+      // merge both values
+      builder.add(key, checkOverflow(length), Value(ValueType::Object));
+      mergeMembers(builder, l.value(), value, true, nullMeansRemove);
+      builder.close();
+    } else if (!value.isNone() && (!nullMeansRemove || !value.isNull())) {
+      // use right value
+      builder.add(key, checkOverflow(length), value);
+    }
+    // the right value replaces all left values with the same name, and
+    // only the first of several right values with the same name is used
+    while (l.valid() && KeyOrderedIterator::compareKeys(l.key(), rightKey) == 0) {
+      l.next();
+    }
+    do {
+      r.next();
+    } while (r.valid() && KeyOrderedIterator::compareKeys(r.key(), rightKey) == 0);
   }
+}
 
-  b.close();
+Builder Collection::merge(Slice const& left, Slice const& right,
+                          bool mergeValues, bool nullMeansRemove) {
+  Builder b;
+  merge(b, left, right, mergeValues, nullMeansRemove);
   return b;
 }
 
@@ -410,61 +498,354 @@ Builder& Collection::merge(Builder& builder, Slice const& left, Slice const& rig
   }
 
   builder.add(Value(ValueType::Object));
+  mergeMembers(builder, left, right, mergeValues, nullMeansRemove);
+  builder.close();
+  return builder;
+}
+
+// adds a value to builder, as a member of the open Object if key is set
+template<typename T>
+static inline void addMember(Builder& builder, char const* key,
+                             ValueLength keyLength, T const& value) {
+  if (key == nullptr) {
+    builder.add(value);
+  } else {
+    builder.add(key, checkOverflow(keyLength), value);
+  }
+}
+
+// copies a value into builder. with String references, Arrays and Objects
+// are copied member by member, because their bytes may refer to Strings
+// in front of them
+static void copyValue(Builder& builder, char const* key, ValueLength keyLength,
+                      Slice const& value, bool references) {
+  if (!references || (!value.isArray() && !value.isObject())) {
+    addMember(builder, key, keyLength, value);
+    return;
+  }
 
-  std::unordered_map<std::string, Slice> rightValues;
-  {
-    ObjectIterator it(right);
+  if (value.isArray()) {
+    addMember(builder, key, keyLength, Value(ValueType::Array));
+    for (auto const& it : ArrayIterator(value)) {
+      copyValue(builder, nullptr, 0, it, true);
+    }
+  } else {
+    addMember(builder, key, keyLength, Value(ValueType::Object));
+    ObjectIterator it(value, true);
     while (it.valid()) {
-      rightValues.emplace(it.key(true).copyString(), it.value());
+      ValueLength length;
+      char const* name = it.key(true).getString(length);
+      copyValue(builder, name, length, it.value(), true);
       it.next();
     }
   }
+  builder.close();
+}
 
-  {
-    ObjectIterator it(left);
+namespace {
+
+struct DiffContext {
+  Options const* options;
+  // values may contain String references, so equal bytes do not mean
+  // equal values for Arrays and Objects
+  bool references;
+};
+
+}  // namespace
+
+static bool diffValues(DiffContext const& context, Slice const& oldValue,
+                       Slice const& newValue, Builder& patch);
+
+// adds the attribute patches of a PatchObject operation to the open
+// Object in patch, merge-joining the attribute names of both Objects.
+// returns whether there are any
+static bool diffObjects(DiffContext const& context, Slice const& oldValue,
+                        Slice const& newValue, Builder& patch) {
+  KeyOrderedIterator l(oldValue);
+  KeyOrderedIterator r(newValue);
+  Builder member(context.options);
+  bool changed = false;
+
+  while (l.valid() || r.valid()) {
+    int res;
+    if (!r.valid()) {
+      res = -1;
+    } else if (!l.valid()) {
+      res = 1;
+    } else {
+      res = KeyOrderedIterator::compareKeys(l.key(), r.key());
+    }
 
-    while (it.valid()) {
-      auto key = it.key(true).copyString();
-      auto found = rightValues.find(key);
-
-      if (found == rightValues.end()) {
-        // use left value
-        builder.add(key, it.value());
-      } else if (mergeValues && it.value().isObject() &&
-                 (*found).second.isObject()) {
-        // merge both values
-        auto& value = (*found).second;
-        if (!nullMeansRemove || (!value.isNone() && !value.isNull())) {
-          Collection::merge(builder, it.value(), value, true, nullMeansRemove);
-        }
-        // clear the value in the map so its not added again
-        (*found).second = Slice();
+    ValueLength length;
+    if (res < 0) {
+      // attribute removed
+      char const* key = l.key().getString(length);
+      patch.add(key, checkOverflow(length), Value(ValueType::Array));
+      patch.add(Value(Collection::PatchRemove));
+      patch.close();
+      l.next();
+    } else if (res > 0) {
+      // attribute added
+      char const* key = r.key().getString(length);
+      patch.add(key, checkOverflow(length), Value(ValueType::Array));
+      patch.add(Value(Collection::PatchReplace));
+      copyValue(patch, nullptr, 0, r.value(), context.references);
+      patch.close();
+      r.next();
+    } else {
+      member.clear();
+      bool const differs = diffValues(context, l.value(), r.value(), member);
+      if (differs) {
+        char const* key = r.key().getString(length);
+        patch.add(key, checkOverflow(length), member.slice());
+      }
+      l.next();
+      r.next();
+      if (!differs) {
+        continue;
+      }
+    }
+    changed = true;
+  }
+  return changed;
+}
+
+// adds the length and the member patches of a PatchArray operation to the
+// open Array in patch, comparing the members position by position.
+// returns whether the Arrays differ
+static bool diffArrays(DiffContext const& context, Slice const& oldValue,
+                       Slice const& newValue, Builder& patch) {
+  ArrayIterator l(oldValue);
+  ArrayIterator r(newValue);
+  Builder member(context.options);
+  bool changed = (l.size() != r.size());
+
+  patch.add(Value(r.size()));
+  for (ValueLength index = 0; r.valid(); ++index) {
+    if (l.valid()) {
+      member.clear();
+      if (diffValues(context, l.value(), r.value(), member)) {
+        patch.add(Value(index));
+        patch.add(member.slice());
+        changed = true;
+      }
+      l.next();
+    } else {
+      // member appended
+      patch.add(Value(index));
+      patch.add(Value(ValueType::Array));
+      patch.add(Value(Collection::PatchReplace));
+      copyValue(patch, nullptr, 0, r.value(), context.references);
+      patch.close();
+    }
+    r.next();
+  }
+  return changed;
+}
+
+// builds the operation turning oldValue into newValue into the empty
+// Builder patch. returns false and builds nothing if the values are equal
+static bool diffValues(DiffContext const& context, Slice const& oldValue,
+                       Slice const& newValue, Builder& patch) {
+  if (oldValue.isString() && newValue.isString()) {
+    // compare by value, as either may be a String reference
+    ValueLength l, r;
+    char const* p = oldValue.getString(l);
+    char const* q = newValue.getString(r);
+    if (l == r && memcmp(p, q, checkOverflow(l)) == 0) {
+      return false;
+    }
+  } else {
+    ValueLength const size = newValue.byteSize();
+    bool const compound = (newValue.isArray() || newValue.isObject());
+    if ((!context.references || !compound) && oldValue.byteSize() == size &&
+        memcmp(oldValue.start(), newValue.start(), checkOverflow(size)) == 0) {
+      // equal bytes, no need to look inside
+      return false;
+    }
+
+    bool const objects = (oldValue.isObject() && newValue.isObject());
+    if (objects || (oldValue.isArray() && newValue.isArray())) {
+      patch.add(Value(ValueType::Array));
+      bool changed;
+      if (objects) {
+        patch.add(Value(Collection::PatchObject));
+        patch.add(Value(ValueType::Object));
+        changed = diffObjects(context, oldValue, newValue, patch);
+        patch.close();
       } else {
-        // use right value
-        auto& value = (*found).second;
-        if (!nullMeansRemove || (!value.isNone() && !value.isNull())) {
-          builder.add(key, value);
-        }
-        // clear the value in the map so its not added again
-        (*found).second = Slice();
+        patch.add(Value(Collection::PatchArray));
+        changed = diffArrays(context, oldValue, newValue, patch);
       }
-      it.next();
+      patch.close();
+      if (!changed) {
+        patch.clear();
+        return false;
+      }
+      if (patch.size() < size) {
+        return true;
+      }
+      // replacing the value is shorter
+      patch.clear();
+    } else if (!compound && oldValue.type() == newValue.type() &&
+               Collection::compare(oldValue, newValue) == 0) {
+      // the same value in a different encoding, e.g. a number
+      return false;
     }
   }
 
-  // add remaining values that were only in right
-  for (auto& it : rightValues) {
-    auto& s = it.second;
-    if (s.isNone()) {
-      continue;
+  patch.add(Value(ValueType::Array));
+  patch.add(Value(Collection::PatchReplace));
+  copyValue(patch, nullptr, 0, newValue, context.references);
+  patch.close();
+  return true;
+}
+
+Builder Collection::diff(Slice const& oldValue, Slice const& newValue,
+                         Options const* options) {
+  DiffContext const context{options, options->dedupeStrings};
+  Builder patch(options);
+  if (!diffValues(context, oldValue, newValue, patch)) {
+    patch.add(Value(ValueType::Array));
+    patch.close();
+  }
+  return patch;
+}
+
+// reads a non-negative integer from a patch
+static ValueLength patchNumber(Slice const& slice) {
+  if (!slice.isInteger() || (!slice.isUInt() && slice.getInt() < 0)) {
+    throw Exception(Exception::InvalidValueType, "Invalid patch");
+  }
+  return slice.getUInt();
+}
+
+// returns the operation of a patch, or -1 for the empty patch
+static int patchOperation(Slice const& patch) {
+  if (!patch.isArray()) {
+    throw Exception(Exception::InvalidValueType, "Invalid patch");
+  }
+  if (patch.isEmptyArray()) {
+    return -1;
+  }
+  ValueLength const op = patchNumber(patch.at(0));
+  if (op > Collection::PatchArray) {
+    throw Exception(Exception::InvalidValueType, "Invalid patch");
+  }
+  return static_cast<int>(op);
+}
+
+// adds the result of applying patch to value to builder, as a member of
+// the open Object if key is set
+static void applyPatch(Builder& builder, char const* key,
+                       ValueLength keyLength, Slice const& value,
+                       Slice const& patch, bool references) {
+  int const op = patchOperation(patch);
+  ValueLength const n = patch.length();
+
+  if (op == -1) {
+    copyValue(builder, key, keyLength, value, references);
+  } else if (op == Collection::PatchReplace && n == 2) {
+    copyValue(builder, key, keyLength, patch.at(1), references);
+  } else if (op == Collection::PatchObject && n == 2 && value.isObject() &&
+             patch.at(1).isObject()) {
+    addMember(builder, key, keyLength, Value(ValueType::Object));
+    KeyOrderedIterator l(value);
+    KeyOrderedIterator r(patch.at(1));
+    while (l.valid() || r.valid()) {
+      int res;
+      if (!r.valid()) {
+        res = -1;
+      } else if (!l.valid()) {
+        res = 1;
+      } else {
+        res = KeyOrderedIterator::compareKeys(l.key(), r.key());
+      }
+
+      ValueLength length;
+      if (res < 0) {
+        // attribute not patched
+        char const* name = l.key().getString(length);
+        copyValue(builder, name, length, l.value(), references);
+        l.next();
+        continue;
+      }
+
+      char const* name = r.key().getString(length);
+      Slice const memberPatch = r.value();
+      int const memberOp = patchOperation(memberPatch);
+      if (res == 0) {
+        if (memberOp != Collection::PatchRemove) {
+          applyPatch(builder, name, length, l.value(), memberPatch, references);
+        } else if (memberPatch.length() != 1) {
+          throw Exception(Exception::InvalidValueType, "Invalid patch");
+        }
+        l.next();
+      } else if (memberOp == Collection::PatchReplace) {
+        // attribute added
+        applyPatch(builder, name, length, Slice::noneSlice(), memberPatch,
+                   references);
+      } else {
+        throw Exception(Exception::InvalidValueType,
+                        "Patch does not match value");
+      }
+      r.next();
     }
-    if (nullMeansRemove && s.isNull()) {
-      continue;
+    builder.close();
+  } else if (op == Collection::PatchArray && n >= 2 && n % 2 == 0 &&
+             value.isArray()) {
+    ValueLength const length = patchNumber(patch.at(1));
+    addMember(builder, key, keyLength, Value(ValueType::Array));
+    ArrayIterator members(value);
+    ArrayIterator ops(patch);
+    ops.next();
+    ops.next();
+    for (ValueLength index = 0; index < length; ++index) {
+      Slice const member =
+          members.valid() ? members.value() : Slice::noneSlice();
+      if (ops.valid() && patchNumber(ops.value()) == index) {
+        ops.next();
+        Slice const memberPatch = ops.value();
+        if (!members.valid() &&
+            patchOperation(memberPatch) != Collection::PatchReplace) {
+          throw Exception(Exception::InvalidValueType,
+                          "Patch does not match value");
+        }
+        applyPatch(builder, nullptr, 0, member, memberPatch, references);
+        ops.next();
+      } else if (members.valid()) {
+        copyValue(builder, nullptr, 0, member, references);
+      } else {
+        throw Exception(Exception::InvalidValueType,
+                        "Patch does not match value");
+      }
+      if (members.valid()) {
+        members.next();
+      }
+    }
+    if (ops.valid()) {
+      // positions out of order or behind the end
+      throw Exception(Exception::InvalidValueType, "Invalid patch");
     }
-    builder.add(std::move(it.first), s);
+    builder.close();
+  } else if (op == Collection::PatchObject || op == Collection::PatchArray) {
+    throw Exception(Exception::InvalidValueType, "Patch does not match value");
+  } else {
+    throw Exception(Exception::InvalidValueType, "Invalid patch");
   }
+}
 
-  builder.close();
+Builder Collection::apply(Slice const& value, Slice const& patch,
+                          Options const* options) {
+  Builder b(options);
+  apply(b, value, patch);
+  return b;
+}
+
+Builder& Collection::apply(Builder& builder, Slice const& value,
+                           Slice const& patch) {
+  applyPatch(builder, nullptr, 0, value, patch,
+             builder.options->dedupeStrings);
   return builder;
 }
 
@@ -506,32 +887,40 @@ static bool visitObject(
 }
 
 template <Collection::VisitationOrder order>
-static bool visitArray(
-    Slice const& value,
+static bool visitArrayMember(
+    Slice const& v,
     std::function<bool(Slice const& key, Slice const& value)> const& func) {
-  ArrayIterator it(value);
-
-  while (it.valid()) {
-    // sub-object?
-    Slice v = it.value();
-    bool const isCompound = (v.isObject() || v.isArray());
+  // sub-object?
+  bool const isCompound = (v.isObject() || v.isArray());
 
-    if (isCompound && order == Collection::PreOrder) {
-      if (!doVisit<order>(v, func)) {
-        return false;
-      }
+  if (isCompound && order == Collection::PreOrder) {
+    if (!doVisit<order>(v, func)) {
+      return false;
     }
+  }
 
-    if (!func(Slice(), v)) {
+  if (!func(Slice(), v)) {
+    return false;
+  }
+
+  if (isCompound && order == Collection::PostOrder) {
+    if (!doVisit<order>(v, func)) {
       return false;
     }
+  }
+  return true;
+}
 
-    if (isCompound && order == Collection::PostOrder) {
-      if (!doVisit<order>(v, func)) {
-        return false;
-      }
-    }
+template <Collection::VisitationOrder order>
+static bool visitArray(
+    Slice const& value,
+    std::function<bool(Slice const& key, Slice const& value)> const& func) {
+  ArrayIterator it(value);
 
+  while (it.valid()) {
+    if (!visitArrayMember<order>(it.value(), func)) {
+      return false;
+    }
     it.next();
   }
 
@@ -563,25 +952,763 @@ void Collection::visitRecursive(
   }
 }
 
-Builder Collection::sort(
-      Slice const& array,
-      std::function<bool (Slice const&, Slice const&)> lessthan) {
+void Collection::visitRecursive(
+    ParallelPolicy const& policy, Slice const& slice,
+    Collection::VisitationOrder order,
+    std::function<bool(Slice const&, Slice const&)> const& func) {
+  if (!slice.isArray()) {
+    visitRecursive(slice, order, func);
+    return;
+  }
+
+  std::atomic<bool> abort(false);
+  forEachChunk(policy, slice, [&](ArrayChunk const& chunk) {
+    Slice v(chunk.start);
+    for (ValueLength i = chunk.from; i < chunk.to; ++i) {
+      if (abort.load(std::memory_order_relaxed)) {
+        return;
+      }
+      bool const goOn = (order == Collection::PreOrder)
+                            ? visitArrayMember<Collection::PreOrder>(v, func)
+                            : visitArrayMember<Collection::PostOrder>(v, func);
+      if (!goOn) {
+        abort.store(true);
+        return;
+      }
+      v = Slice(v.start() + v.byteSize());
+    }
+  });
+}
+
+std::string VisitPath::toString() const {
+  std::string result;
+  for (auto const& it : _steps) {
+    if (it.isArrayMember()) {
+      result.push_back('[');
+      result.append(std::to_string(it.index));
+      result.push_back(']');
+    } else {
+      if (!result.empty()) {
+        result.push_back('.');
+      }
+      if (it.key.isString()) {
+        ValueLength len;
+        char const* p = it.key.getString(len);
+        result.append(p, static_cast<size_t>(len));
+      } else {
+        result.append(it.key.toString());
+      }
+    }
+  }
+  return result;
+}
+
+void Collection::enterFrame(Slice const& value,
+                            std::vector<VisitFrame>& frames, VisitPath& path) {
+  bool const isObject = value.isObject();
+  if (!isObject && !value.isArray()) {
+    return;
+  }
+  ValueLength const size = value.length();
+  if (size == 0) {
+    return;
+  }
+  bool const isPacked = value.isPackedArray();
+  uint8_t const* first;
+  uint8_t const* firstKey = nullptr;
+  if (value.head() == 0x16) {
+    // rows of shaped Arrays only contain the values, the attribute names
+    // are walked in the shape alongside
+    first = value.getNthValue(0).start();
+    firstKey = value.keyAt(0, false).start();
+  } else if (isObject) {
+    // walk the members in storage order, which does not need the index
+    first = ObjectIterator(value, true).key(false).start();
+  } else if (isPacked) {
+    // members are converted one at a time
+    first = value.start();
+  } else {
+    first = value.at(0).start();
+  }
+  frames.push_back(
+      VisitFrame{first, firstKey, 0, size, isObject, isPacked, {}});
+  path._steps.push_back(VisitPath::Step{Slice(), 0});
+}
+
+void Collection::arrayChunks(ParallelPolicy const& policy, Slice const& array,
+                             std::vector<ArrayChunk>& chunks) {
   if (!array.isArray()) {
-    throw Exception(Exception::InvalidValueType, "Expecting type Array");
+    throw Exception(Exception::InvalidValueType, "Expecting Array slice");
+  }
+  if (array.isPackedArray()) {
+    throw Exception(Exception::InvalidValueType,
+                    "Members of packed Arrays have no VPack representation");
+  }
+  ValueLength const n = array.length();
+  if (n == 0) {
+    return;
+  }
+
+  // a few chunks per thread, so that idle threads can steal work
+  ValueLength const minChunkSize =
+      (std::max)(policy.minChunkSize, ValueLength(1));
+  ValueLength const maxChunks = executorFor(policy).concurrency() * 4;
+  ValueLength count = (std::min)(n / minChunkSize, maxChunks);
+  if (count == 0) {
+    count = 1;
+  }
+  chunks.reserve(count);
+
+  bool const compact = (array.head() == 0x13 || array.head() == 0x15);
+  uint8_t const* p = nullptr;
+  ValueLength position = 0;
+  for (ValueLength i = 0; i < count; ++i) {
+    ValueLength const from = n * i / count;
+    ValueLength const to = n * (i + 1) / count;
+    if (compact) {
+      // compact and shaped Arrays have no index table, so walk over the
+      // members once
+      if (p == nullptr) {
+        p = array.at(0).start();
+      }
+      while (position < from) {
+        p += Slice(p).byteSize();
+        ++position;
+      }
+    } else {
+      p = array.at(from).start();
+    }
+    chunks.push_back(ArrayChunk{static_cast<size_t>(i), from, to, p});
+  }
+}
+
+static int CompareTypes(Slice const& slice) {
+  switch (slice.type()) {
+    case ValueType::MinKey:
+      return 0;
+    case ValueType::None:
+      return 1;
+    case ValueType::Illegal:
+      return 2;
+    case ValueType::Null:
+      return 3;
+    case ValueType::Bool:
+      return 4;
+    case ValueType::Double:
+    case ValueType::Int:
+    case ValueType::UInt:
+    case ValueType::SmallInt:
+      return 5;
+    case ValueType::UTCDate:
+      return 6;
+    case ValueType::String:
+      return 7;
+    case ValueType::Binary:
+      return 8;
+    case ValueType::Array:
+      return 9;
+    case ValueType::Object:
+      return 10;
+    case ValueType::Custom:
+      return 11;
+    case ValueType::MaxKey:
+      return 12;
+    case ValueType::BCD:
+    case ValueType::External:
+      break;
+  }
+  throw Exception(Exception::NotImplemented, "Type not supported in comparison");
+}
+
+template<typename T>
+static inline int CompareValues(T lhs, T rhs) {
+  return (lhs < rhs) ? -1 : ((rhs < lhs) ? 1 : 0);
+}
+
+static inline int CompareBytes(uint8_t const* lhs, ValueLength lhsLength,
+                               uint8_t const* rhs, ValueLength rhsLength) {
+  int res = memcmp(lhs, rhs, checkOverflow((std::min)(lhsLength, rhsLength)));
+  if (res != 0) {
+    return (res < 0) ? -1 : 1;
+  }
+  return CompareValues(lhsLength, rhsLength);
+}
+
+// compares a double with an integer given by its sign and magnitude
+static int CompareDoubleInteger(double d, bool negative, int64_t i, uint64_t u) {
+  if (std::isnan(d)) {
+    // NaN sorts before all other numbers
+    return -1;
+  }
+  if (negative) {
+    if (d >= 0.0) {
+      return 1;
+    }
+    if (d < -9223372036854775808.0) {
+      return -1;
+    }
+    double const t = std::trunc(d);
+    int res = CompareValues(static_cast<int64_t>(t), i);
+    if (res != 0) {
+      return res;
+    }
+    return (d < t) ? -1 : 0;
+  }
+  if (d < 0.0) {
+    return -1;
+  }
+  if (d >= 18446744073709551616.0) {
+    return 1;
+  }
+  double const t = std::trunc(d);
+  int res = CompareValues(static_cast<uint64_t>(t), u);
+  if (res != 0) {
+    return res;
+  }
+  return (d > t) ? 1 : 0;
+}
+
+static int CompareNumbers(Slice const& lhs, Slice const& rhs) {
+  if (lhs.isDouble() && rhs.isDouble()) {
+    double const l = lhs.getDouble();
+    double const r = rhs.getDouble();
+    if (std::isnan(l) || std::isnan(r)) {
+      return CompareValues(!std::isnan(l), !std::isnan(r));
+    }
+    return CompareValues(l, r);
+  }
+
+  // integers by sign and magnitude
+  bool lneg = false, rneg = false;
+  int64_t li = 0, ri = 0;
+  uint64_t lu = 0, ru = 0;
+  if (lhs.isUInt()) {
+    lu = lhs.getUInt();
+  } else if (!lhs.isDouble()) {
+    li = lhs.getInt();
+    lneg = (li < 0);
+    lu = static_cast<uint64_t>(li);
   }
-  std::vector<Slice> subValues;
-  ValueLength len = array.length();
-  subValues.reserve(checkOverflow(len));
-  for (ValueLength i = 0; i < len; i++) {
-    subValues.push_back(array[i]);
+  if (rhs.isUInt()) {
+    ru = rhs.getUInt();
+  } else if (!rhs.isDouble()) {
+    ri = rhs.getInt();
+    rneg = (ri < 0);
+    ru = static_cast<uint64_t>(ri);
   }
-  std::sort(subValues.begin(), subValues.end(), lessthan);
+
+  if (lhs.isDouble()) {
+    return CompareDoubleInteger(lhs.getDouble(), rneg, ri, ru);
+  }
+  if (rhs.isDouble()) {
+    return -CompareDoubleInteger(rhs.getDouble(), lneg, li, lu);
+  }
+  if (lneg != rneg) {
+    return lneg ? -1 : 1;
+  }
+  if (lneg) {
+    return CompareValues(li, ri);
+  }
+  return CompareValues(lu, ru);
+}
+
+// collects the key/value pairs of an Object, sorted by key
+static void SortedPairs(Slice const& slice,
+                        std::vector<std::pair<Slice, Slice>>& pairs) {
+  pairs.reserve(checkOverflow(slice.length()));
+  ObjectIterator it(slice, true);
+  while (it.valid()) {
+    pairs.emplace_back(it.key(true), it.value());
+    it.next();
+  }
+  std::sort(pairs.begin(), pairs.end(),
+            [](std::pair<Slice, Slice> const& lhs,
+               std::pair<Slice, Slice> const& rhs) {
+              ValueLength l, r;
+              char const* p = lhs.first.getString(l);
+              char const* q = rhs.first.getString(r);
+              return CompareBytes(reinterpret_cast<uint8_t const*>(p), l,
+                                  reinterpret_cast<uint8_t const*>(q), r) < 0;
+            });
+}
+
+int Collection::compare(Slice const& left, Slice const& right) {
+  Slice const lhs = left.resolveExternals();
+  Slice const rhs = right.resolveExternals();
+
+  int res = CompareValues(CompareTypes(lhs), CompareTypes(rhs));
+  if (res != 0) {
+    return res;
+  }
+
+  switch (lhs.type()) {
+    case ValueType::Bool:
+      return CompareValues(lhs.getBool(), rhs.getBool());
+    case ValueType::Double:
+    case ValueType::Int:
+    case ValueType::UInt:
+    case ValueType::SmallInt:
+      return CompareNumbers(lhs, rhs);
+    case ValueType::UTCDate:
+      return CompareValues(lhs.getUTCDate(), rhs.getUTCDate());
+    case ValueType::String: {
+      ValueLength l, r;
+      char const* p = lhs.getString(l);
+      char const* q = rhs.getString(r);
+      return CompareBytes(reinterpret_cast<uint8_t const*>(p), l,
+                          reinterpret_cast<uint8_t const*>(q), r);
+    }
+    case ValueType::Binary: {
+      ValueLength l, r;
+      uint8_t const* p = lhs.getBinary(l);
+      uint8_t const* q = rhs.getBinary(r);
+      return CompareBytes(p, l, q, r);
+    }
+    case ValueType::Array: {
+      ArrayIterator it1(lhs);
+      ArrayIterator it2(rhs);
+      while (it1.valid() && it2.valid()) {
+        res = compare(it1.value(), it2.value());
+        if (res != 0) {
+          return res;
+        }
+        it1.next();
+        it2.next();
+      }
+      return CompareValues(it1.valid(), it2.valid());
+    }
+    case ValueType::Object: {
+      std::vector<std::pair<Slice, Slice>> l, r;
+      SortedPairs(lhs, l);
+      SortedPairs(rhs, r);
+      size_t const n = (std::min)(l.size(), r.size());
+      for (size_t i = 0; i < n; ++i) {
+        res = compare(l[i].first, r[i].first);
+        if (res == 0) {
+          res = compare(l[i].second, r[i].second);
+        }
+        if (res != 0) {
+          return res;
+        }
+      }
+      return CompareValues(l.size(), r.size());
+    }
+    case ValueType::Custom:
+      return CompareBytes(lhs.start(), lhs.byteSize(), rhs.start(),
+                          rhs.byteSize());
+    default:
+      // all values of the remaining types are equal
+      return 0;
+  }
+}
+
+Builder Collection::sort(Slice const& array) {
+  return sort(array, NormalizedLess());
+}
+
+Builder Collection::sortBy(Slice const& array,
+                           std::vector<std::string> const& path,
+                           bool ascending, size_t numThreads) {
+  if (path.empty()) {
+    throw Exception(Exception::InvalidAttributePath);
+  }
+  std::vector<Slice> members;
+  arrayMembers(array, members);
+
+  // look up the sort keys only once
+  struct SortEntry {
+    Slice key;
+    size_t position;
+  };
+  std::vector<SortEntry> entries;
+  entries.reserve(members.size());
+  for (size_t i = 0; i < members.size(); ++i) {
+    Slice const& member = members[i];
+    entries.push_back(SortEntry{member.isObject() ? member.get(path, true) : Slice(), i});
+  }
+
+  sortValues(entries, [ascending](SortEntry const& lhs, SortEntry const& rhs) {
+    int res = compare(lhs.key, rhs.key);
+    if (res != 0) {
+      return ascending ? (res < 0) : (res > 0);
+    }
+    return lhs.position < rhs.position;
+  }, numThreads);
+
+  std::vector<Slice> sorted;
+  sorted.reserve(entries.size());
+  for (auto const& it : entries) {
+    sorted.push_back(members[it.position]);
+  }
+  return buildArray(sorted);
+}
+
+// check if value is or contains a String reference or a row of a shaped
+// Array, which make binary equality meaningless
+static bool HasIndirection(Slice const& value) {
+  if (value.isStringReference() || value.head() == 0x16) {
+    return true;
+  }
+  if (value.isObject()) {
+    ObjectIterator it(value, true);
+    while (it.valid()) {
+      if (HasIndirection(it.value())) {
+        return true;
+      }
+      it.next();
+    }
+  } else if (value.isArray() && !value.isPackedArray()) {
+    ArrayIterator it(value);
+    while (it.valid()) {
+      if (HasIndirection(it.value())) {
+        return true;
+      }
+      it.next();
+    }
+  }
+  return false;
+}
+
+// binary equality of the values String references, rows of shaped Arrays
+// and compound values containing them stand for. rows are compared as
+// Objects holding their attributes in the order of the shape
+static bool IndirectEquals(Slice const& lhs, Slice const& rhs) {
+  if (lhs.isString() && rhs.isString()) {
+    ValueLength l, r;
+    char const* p = lhs.getString(l);
+    char const* q = rhs.getString(r);
+    return l == r && memcmp(p, q, checkOverflow(l)) == 0;
+  }
+  if (lhs.isArray() && rhs.isArray() && !lhs.isPackedArray() &&
+      !rhs.isPackedArray()) {
+    ArrayIterator l(lhs);
+    ArrayIterator r(rhs);
+    if (l.size() != r.size()) {
+      return false;
+    }
+    while (l.valid()) {
+      if (!IndirectEquals(l.value(), r.value())) {
+        return false;
+      }
+      l.next();
+      r.next();
+    }
+    return true;
+  }
+  if (lhs.isObject() && rhs.isObject()) {
+    ObjectIterator l(lhs, true);
+    ObjectIterator r(rhs, true);
+    if (l.size() != r.size()) {
+      return false;
+    }
+    while (l.valid()) {
+      if (!l.key(false).equals(r.key(false)) ||
+          !IndirectEquals(l.value(), r.value())) {
+        return false;
+      }
+      l.next();
+      r.next();
+    }
+    return true;
+  }
+  return lhs.equals(rhs);
+}
+
+namespace {
+
+// open-addressing hash table of Slices, keyed by their normalized hash and
+// compared by binary equality. String references are compared by the
+// Strings they refer to, and rows of shaped Arrays by their attributes.
+// only pointers to the values are stored, each with an associated number
+class SliceTable {
+ public:
+  static constexpr size_t NotFound = SIZE_MAX;
+
+  explicit SliceTable(size_t expected) : _size(0) {
+    size_t capacity = 16;
+    while (capacity < expected * 2) {
+      capacity *= 2;
+    }
+    _slots.resize(capacity);
+  }
+
+  // returns the number stored for the value, or NotFound
+  size_t find(Slice const& value, uint64_t hash) const {
+    size_t const mask = _slots.size() - 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (_slots[i].start != nullptr) {
+      if (_slots[i].hash == hash && equals(value, Slice(_slots[i].start))) {
+        return _slots[i].number;
+      }
+      i = (i + 1) & mask;
+    }
+    return NotFound;
+  }
+
+  size_t find(Slice const& value) const {
+    return find(value, value.normalizedHash());
+  }
+
+  // inserts the value with the given number, if it is not yet contained.
+  // returns the number stored for the value
+  size_t insert(Slice const& value, uint64_t hash, size_t number) {
+    if ((_size + 1) * 2 > _slots.size()) {
+      grow();
+    }
+    size_t const mask = _slots.size() - 1;
+    size_t i = static_cast<size_t>(hash) & mask;
+    while (_slots[i].start != nullptr) {
+      if (_slots[i].hash == hash && equals(value, Slice(_slots[i].start))) {
+        return _slots[i].number;
+      }
+      i = (i + 1) & mask;
+    }
+    _slots[i].start = value.start();
+    _slots[i].hash = hash;
+    _slots[i].number = number;
+    ++_size;
+    return number;
+  }
+
+  // returns true if the value was not yet contained
+  bool insert(Slice const& value) {
+    size_t const size = _size;
+    insert(value, value.normalizedHash(), size);
+    return _size != size;
+  }
+
+ private:
+  static bool equals(Slice const& lhs, Slice const& rhs) {
+    if (lhs.equals(rhs) && lhs.isSelfContained()) {
+      return true;
+    }
+    return (HasIndirection(lhs) || HasIndirection(rhs)) &&
+           IndirectEquals(lhs, rhs);
+  }
+
+  struct Slot {
+    Slot() : start(nullptr), hash(0), number(0) {}
+    uint8_t const* start;
+    uint64_t hash;
+    size_t number;
+  };
+
+  void grow() {
+    std::vector<Slot> old(_slots.size() * 2);
+    old.swap(_slots);
+    size_t const mask = _slots.size() - 1;
+    for (auto const& it : old) {
+      if (it.start != nullptr) {
+        size_t i = static_cast<size_t>(it.hash) & mask;
+        while (_slots[i].start != nullptr) {
+          i = (i + 1) & mask;
+        }
+        _slots[i] = it;
+      }
+    }
+  }
+
+  std::vector<Slot> _slots;
+  size_t _size;
+};
+
+constexpr size_t SliceTable::NotFound;
+
+}  // namespace
+
+Builder Collection::distinct(Slice const& array) {
+  std::vector<Slice> members;
+  arrayMembers(array, members);
+
+  SliceTable table(members.size());
+  std::vector<Slice> result;
+  result.reserve(members.size());
+  for (auto const& it : members) {
+    if (table.insert(it)) {
+      result.push_back(it);
+    }
+  }
+  return buildArray(result);
+}
+
+Builder Collection::intersect(Slice const& lhs, Slice const& rhs) {
+  std::vector<Slice> left, right;
+  arrayMembers(lhs, left);
+  arrayMembers(rhs, right);
+
+  SliceTable other(right.size());
+  for (auto const& it : right) {
+    other.insert(it);
+  }
+  SliceTable seen(left.size());
+  std::vector<Slice> result;
+  for (auto const& it : left) {
+    uint64_t const hash = it.normalizedHash();
+    if (other.find(it, hash) != SliceTable::NotFound &&
+        seen.find(it, hash) == SliceTable::NotFound) {
+      seen.insert(it, hash, 0);
+      result.push_back(it);
+    }
+  }
+  return buildArray(result);
+}
+
+Builder Collection::unionOf(Slice const& lhs, Slice const& rhs) {
+  std::vector<Slice> left, right;
+  arrayMembers(lhs, left);
+  arrayMembers(rhs, right);
+
+  SliceTable table(left.size() + right.size());
+  std::vector<Slice> result;
+  result.reserve(left.size() + right.size());
+  for (auto const* members : {&left, &right}) {
+    for (auto const& it : *members) {
+      if (table.insert(it)) {
+        result.push_back(it);
+      }
+    }
+  }
+  return buildArray(result);
+}
+
+Builder Collection::difference(Slice const& lhs, Slice const& rhs) {
+  std::vector<Slice> left, right;
+  arrayMembers(lhs, left);
+  arrayMembers(rhs, right);
+
+  // values of rhs are marked as seen already, so they are skipped
+  SliceTable table(left.size() + right.size());
+  for (auto const& it : right) {
+    table.insert(it);
+  }
+  std::vector<Slice> result;
+  for (auto const& it : left) {
+    if (table.insert(it)) {
+      result.push_back(it);
+    }
+  }
+  return buildArray(result);
+}
+
+Builder Collection::groupBy(Slice const& array,
+                            std::vector<std::string> const& path) {
+  if (path.empty()) {
+    throw Exception(Exception::InvalidAttributePath);
+  }
+  std::vector<Slice> members;
+  arrayMembers(array, members);
+
+  // assign a group number to each member
+  SliceTable table(members.size());
+  std::vector<Slice> groupKeys;
+  std::vector<size_t> groupOf;
+  groupOf.reserve(members.size());
+  for (auto const& it : members) {
+    Slice key = it.isObject() ? it.get(path, true) : Slice();
+    if (key.isNone()) {
+      key = Slice::nullSlice();
+    }
+    size_t const group = table.insert(key, key.normalizedHash(), groupKeys.size());
+    if (group == groupKeys.size()) {
+      groupKeys.push_back(key);
+    }
+    groupOf.push_back(group);
+  }
+
+  // order the members by group, keeping their relative order
+  std::vector<size_t> starts(groupKeys.size() + 1, 0);
+  for (size_t group : groupOf) {
+    ++starts[group + 1];
+  }
+  for (size_t i = 1; i < starts.size(); ++i) {
+    starts[i] += starts[i - 1];
+  }
+  std::vector<Slice> grouped(members.size());
+  std::vector<size_t> next(starts.begin(), starts.end() - 1);
+  for (size_t i = 0; i < members.size(); ++i) {
+    grouped[next[groupOf[i]]++] = members[i];
+  }
+
+  // reserve room for the members, the group keys and the headers and
+  // index tables of the group Arrays
+  ValueLength size = array.byteSize();
+  for (auto const& it : groupKeys) {
+    size += it.byteSize() + 32;
+  }
+
   Builder b;
+  b.reserve(size);
   b.openArray();
-  for (auto const&s : subValues) {
-    b.add(s);
+  for (size_t group = 0; group < groupKeys.size(); ++group) {
+    b.openArray();
+    b.add(groupKeys[group]);
+    b.openArray();
+    for (size_t i = starts[group]; i < starts[group + 1]; ++i) {
+      b.add(grouped[i]);
+    }
+    b.close();
+    b.close();
   }
   b.close();
   return b;
 }
 
+void Collection::arrayMembers(Slice const& array, std::vector<Slice>& members) {
+  if (!array.isArray()) {
+    throw Exception(Exception::InvalidValueType, "Expecting type Array");
+  }
+  if (array.isPackedArray()) {
+    throw Exception(Exception::InvalidValueType,
+                    "Members of packed Arrays have no VPack representation");
+  }
+  ArrayIterator it(array);
+  members.reserve(checkOverflow(it.size()));
+  while (it.valid()) {
+    members.push_back(it.value());
+    it.next();
+  }
+}
+
+Builder Collection::buildArray(std::vector<Slice> const& members,
+                               Options const* options) {
+  ValueLength const n = members.size();
+  ValueLength total = 0;
+  for (auto const& it : members) {
+    total += it.byteSize();
+  }
+
+  // reserve room for the header, the members and the index table, so the
+  // Builder does not need to grow its buffer
+  ValueLength width = 8;
+  if (9 + total + n <= 0xff) {
+    width = 1;
+  } else if (9 + total + 2 * n <= 0xffff) {
+    width = 2;
+  } else if (9 + total + 4 * n <= 0xffffffffULL) {
+    width = 4;
+  }
+
+  Builder b(options);
+  b.reserve(9 + total + width * n + 8);
+  b.openArray();
+  for (auto const& it : members) {
+    b.add(it);
+  }
+  b.close();
+  return b;
+}
+
+size_t Collection::sortThreads(size_t n, size_t numThreads) {
+  if (numThreads == 0) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+  if (numThreads <= 1 || n < ParallelSortThreshold) {
+    return 1;
+  }
+  // give each thread a reasonable amount of work
+  return (std::min)(numThreads, n / (ParallelSortThreshold / 4));
+}
+
+void Collection::runParallel(std::vector<std::function<void()>> const& tasks) {
+  ThreadPool::instance().run(tasks);
+}
@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <limits>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/DeltaArray.h"
+
+#include "asm-functions.h"
+
+using namespace arangodb::velocypack;
+
+constexpr ValueLength DeltaSpan::blockSize;
+
+// appends an unsigned LEB128 varint, which may be 0
+static void appendVariableValueLength(std::vector<uint8_t>& out,
+                                      uint64_t value) {
+  while (value >= 0x80U) {
+    out.push_back(static_cast<uint8_t>(value | 0x80U));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+static void appendInteger(std::vector<uint8_t>& out, uint64_t value,
+                          uint8_t width) {
+  for (uint8_t i = 0; i < width; ++i) {
+    out.push_back(static_cast<uint8_t>(value & 0xff));
+    value >>= 8;
+  }
+}
+
+void arangodb::velocypack::encodeDeltaArray(int64_t const* values,
+                                            ValueLength n,
+                                            std::vector<uint8_t>& out) {
+  ValueLength const blockSize = DeltaSpan::blockSize;
+  ValueLength const nrBlocks = (n + blockSize - 1) / blockSize;
+
+  // the blocks are encoded first, as the header contains the total length
+  std::vector<uint8_t> blocks;
+  std::vector<ValueLength> offsets;
+  offsets.reserve(checkOverflow(nrBlocks));
+  for (ValueLength first = 0; first < n; first += blockSize) {
+    offsets.push_back(blocks.size());
+    ValueLength const members = (std::min)(blockSize, n - first);
+    appendVariableValueLength(blocks, zigZagEncode(values[first]));
+    if (members == 1) {
+      continue;
+    }
+
+    // differences are computed in unsigned arithmetic, so that they wrap
+    // around instead of overflowing. relative to the smallest difference
+    // of the block, all of them fit into 64 bits
+    int64_t step = (std::numeric_limits<int64_t>::max)();
+    for (ValueLength i = first + 1; i < first + members; ++i) {
+      int64_t const diff = static_cast<int64_t>(
+          static_cast<uint64_t>(values[i]) -
+          static_cast<uint64_t>(values[i - 1]));
+      step = (std::min)(step, diff);
+    }
+    uint64_t range = 0;
+    for (ValueLength i = first + 1; i < first + members; ++i) {
+      uint64_t const delta = static_cast<uint64_t>(values[i]) -
+                             static_cast<uint64_t>(values[i - 1]) -
+                             static_cast<uint64_t>(step);
+      range = (std::max)(range, delta);
+    }
+    uint8_t width = 8;
+    if (range == 0) {
+      width = 0;
+    } else if (range <= 0xffULL) {
+      width = 1;
+    } else if (range <= 0xffffULL) {
+      width = 2;
+    } else if (range <= 0xffffffffULL) {
+      width = 4;
+    }
+
+    appendVariableValueLength(blocks, zigZagEncode(step));
+    blocks.push_back(width);
+    for (ValueLength i = first + 1; i < first + members; ++i) {
+      appendInteger(blocks,
+                    static_cast<uint64_t>(values[i]) -
+                        static_cast<uint64_t>(values[i - 1]) -
+                        static_cast<uint64_t>(step),
+                    width);
+    }
+  }
+
+  ValueLength const tableSize = (nrBlocks > 1 ? (nrBlocks - 1) * 4 : 0);
+  ValueLength const nLen = getVariableValueLength(n);
+  // the byte length includes its own varint
+  ValueLength lengthSize = 1;
+  ValueLength byteSize;
+  while (true) {
+    byteSize = 1 + lengthSize + nLen + blocks.size() + tableSize;
+    ValueLength const needed = getVariableValueLength(byteSize);
+    if (needed == lengthSize) {
+      break;
+    }
+    lengthSize = needed;
+  }
+  if (byteSize > 0xffffffffULL) {
+    // block offsets are stored with 4 bytes
+    throw Exception(Exception::NumberOutOfRange,
+                    "Delta-encoded Array is too large");
+  }
+
+  ValueLength const headerSize = 1 + lengthSize + nLen;
+  out.reserve(out.size() + checkOverflow(byteSize));
+  out.push_back(0xe4);
+  appendVariableValueLength(out, byteSize);
+  appendVariableValueLength(out, n);
+  out.insert(out.end(), blocks.begin(), blocks.end());
+  for (ValueLength b = 1; b < nrBlocks; ++b) {
+    appendInteger(out, headerSize + offsets[checkOverflow(b)], 4);
+  }
+}
+
+DeltaSpan::DeltaSpan(uint8_t const* start) noexcept : _start(start) {
+  uint8_t const* p = start + 1;
+  ValueLength const byteSize = readVariableValueLength<false>(p);
+  p += getVariableValueLengthSize(p);
+  _size = readVariableValueLength<false>(p);
+  p += getVariableValueLengthSize(p);
+  _blocks = p;
+  ValueLength const nrBlocks = (_size + blockSize - 1) / blockSize;
+  _offsets = start + byteSize - (nrBlocks > 1 ? (nrBlocks - 1) * 4 : 0);
+}
+
+uint8_t const* DeltaSpan::blockStart(ValueLength block) const noexcept {
+  if (block == 0) {
+    return _blocks;
+  }
+  return _start + readIntegerFixed<ValueLength, 4>(_offsets + (block - 1) * 4);
+}
+
+DeltaSpan::iterator DeltaSpan::iteratorAt(ValueLength index) const noexcept {
+  if (index >= _size) {
+    return end();
+  }
+  ValueLength const block = index / blockSize;
+  iterator it(blockStart(block), block * blockSize, _size);
+  while (it.index() < index) {
+    ++it;
+  }
+  return it;
+}
+
+void DeltaSpan::copyTo(int64_t* out) const {
+  uint64_t* dst = reinterpret_cast<uint64_t*>(out);
+  uint8_t const* p = _blocks;
+  for (ValueLength first = 0; first < _size; first += blockSize) {
+    ValueLength const members = (std::min)(blockSize, _size - first);
+    uint64_t base;
+    uint64_t step;
+    uint8_t width;
+    p = readBlockHeader(p, members, base, step, width);
+    DeltaDecodeBlock(p, checkOverflow(members), width, base, step,
+                     dst + first);
+    p += (members - 1) * width;
+  }
+}
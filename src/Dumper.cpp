@@ -24,7 +24,13 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Dumper.h"
@@ -33,6 +39,8 @@
 
 using namespace arangodb::velocypack;
 
+constexpr ValueLength Dumper::DefaultParallelChunkSize;
+
 // forward for fpconv function declared elsewhere
 namespace arangodb {
 namespace velocypack {
@@ -324,6 +332,60 @@ void Dumper::dumpString(char const* src, ValueLength len) {
   }
 }
 
+void Dumper::dumpArrayRange(Slice const* slice, ValueLength from,
+                            ValueLength to) {
+  ArrayIterator it(*slice);
+  it.forward(from);
+  if (options->prettyPrint) {
+    while (it.index() < to) {
+      indent();
+      dumpValue(it.value(), slice);
+      if (!it.isLast()) {
+        _sink->push_back(',');
+      }
+      _sink->push_back('\n');
+      it.next();
+    }
+  } else {
+    while (it.index() < to) {
+      if (!it.isFirst()) {
+        _sink->push_back(',');
+      }
+      dumpValue(it.value(), slice);
+      it.next();
+    }
+  }
+}
+
+void Dumper::dumpObjectRange(Slice const* slice, ValueLength from,
+                             ValueLength to) {
+  ObjectIterator it(*slice);
+  it.forward(from);
+  if (options->prettyPrint) {
+    while (it.index() < to) {
+      indent();
+      dumpValue(it.key(true), slice);
+      _sink->append(" : ", 3);
+      dumpValue(it.value(), slice);
+      if (!it.isLast()) {
+        _sink->push_back(',');
+      }
+      _sink->push_back('\n');
+      it.next();
+    }
+  } else {
+    while (it.index() < to) {
+      if (!it.isFirst()) {
+        _sink->push_back(',');
+      }
+      dumpValue(it.key(true), slice);
+      _sink->push_back(':');
+      dumpValue(it.value(), slice);
+      it.next();
+    }
+  }
+}
+
 void Dumper::dumpValue(Slice const* slice, Slice const* base) {
   if (base == nullptr) {
     base = slice;
@@ -346,64 +408,30 @@ void Dumper::dumpValue(Slice const* slice, Slice const* base) {
     }
 
     case ValueType::Array: {
-      ArrayIterator it(*slice);
       _sink->push_back('[');
       if (options->prettyPrint) {
         _sink->push_back('\n');
         ++_indentation;
-        while (it.valid()) {
-          indent();
-          dumpValue(it.value(), slice);
-          if (!it.isLast()) {
-            _sink->push_back(',');
-          }
-          _sink->push_back('\n');
-          it.next();
-        }
+        dumpArrayRange(slice, 0, slice->length());
         --_indentation;
         indent();
       } else {
-        while (it.valid()) {
-          if (!it.isFirst()) {
-            _sink->push_back(',');
-          }
-          dumpValue(it.value(), slice);
-          it.next();
-        }
+        dumpArrayRange(slice, 0, slice->length());
       }
       _sink->push_back(']');
       break;
     }
 
     case ValueType::Object: {
-      ObjectIterator it(*slice);
       _sink->push_back('{');
       if (options->prettyPrint) {
         _sink->push_back('\n');
         ++_indentation;
-        while (it.valid()) {
-          indent();
-          dumpValue(it.key(true), slice);
-          _sink->append(" : ", 3);
-          dumpValue(it.value(), slice);
-          if (!it.isLast()) {
-            _sink->push_back(',');
-          }
-          _sink->push_back('\n');
-          it.next();
-        }
+        dumpObjectRange(slice, 0, slice->length());
         --_indentation;
         indent();
       } else {
-        while (it.valid()) {
-          if (!it.isFirst()) {
-            _sink->push_back(',');
-          }
-          dumpValue(it.key(true), slice);
-          _sink->push_back(':');
-          dumpValue(it.value(), slice);
-          it.next();
-        }
+        dumpObjectRange(slice, 0, slice->length());
       }
       _sink->push_back('}');
       break;
@@ -467,3 +495,144 @@ void Dumper::dumpValue(Slice const* slice, Slice const* base) {
     }
   }
 }
+
+void Dumper::dumpParallel(Slice const& slice, size_t numThreads,
+                          ValueLength chunkSize) {
+  _indentation = 0;
+
+  if (numThreads == 0) {
+    numThreads = std::thread::hardware_concurrency();
+  }
+
+  ValueType const type = slice.type();
+  if (type != ValueType::Array && type != ValueType::Object) {
+    dump(slice);
+    return;
+  }
+
+  ValueLength const n = slice.length();
+  ValueLength numChunks = (chunkSize > 0) ? slice.byteSize() / chunkSize : n;
+  if (numChunks > n) {
+    numChunks = n;
+  }
+  if (numThreads <= 1 || numChunks <= 1) {
+    dump(slice);
+    return;
+  }
+  if (numThreads > numChunks) {
+    numThreads = static_cast<size_t>(numChunks);
+  }
+
+  struct Chunk {
+    ValueLength from;
+    ValueLength to;
+    Buffer<char> output;
+    std::exception_ptr error;
+    bool done = false;
+  };
+
+  std::vector<Chunk> chunks(checkOverflow(numChunks));
+  for (ValueLength i = 0; i < numChunks; ++i) {
+    chunks[i].from = (n * i) / numChunks;
+    chunks[i].to = (n * (i + 1)) / numChunks;
+  }
+
+  // workers may not run further ahead of the writer than this, so the
+  // amount of buffered output stays bounded
+  size_t const window = 2 * numThreads;
+  size_t nextChunk = 0;
+  size_t written = 0;
+  bool abort = false;
+  std::mutex mutex;
+  std::condition_variable workerCondition;
+  std::condition_variable writerCondition;
+  ValueLength const expectedSize = slice.byteSize() / numChunks;
+
+  auto worker = [&]() {
+    while (true) {
+      Chunk* chunk;
+      {
+        std::unique_lock<std::mutex> guard(mutex);
+        workerCondition.wait(guard, [&]() {
+          return abort || nextChunk >= chunks.size() ||
+                 nextChunk < written + window;
+        });
+        if (abort || nextChunk >= chunks.size()) {
+          return;
+        }
+        chunk = &chunks[nextChunk++];
+      }
+
+      try {
+        CharBufferSink sink(&chunk->output);
+        sink.reserve(expectedSize);
+        Dumper dumper(&sink, options);
+        dumper._indentation = 1;
+        if (type == ValueType::Array) {
+          dumper.dumpArrayRange(&slice, chunk->from, chunk->to);
+        } else {
+          dumper.dumpObjectRange(&slice, chunk->from, chunk->to);
+        }
+      } catch (...) {
+        chunk->error = std::current_exception();
+      }
+
+      std::lock_guard<std::mutex> guard(mutex);
+      chunk->done = true;
+      writerCondition.notify_one();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads);
+
+  auto joinAll = [&]() {
+    {
+      std::lock_guard<std::mutex> guard(mutex);
+      abort = true;
+    }
+    workerCondition.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  };
+
+  try {
+    for (size_t i = 0; i < numThreads; ++i) {
+      threads.emplace_back(worker);
+    }
+
+    bool const pretty = options->prettyPrint;
+    _sink->push_back(type == ValueType::Array ? '[' : '{');
+    if (pretty) {
+      _sink->push_back('\n');
+    }
+
+    for (auto& chunk : chunks) {
+      {
+        std::unique_lock<std::mutex> guard(mutex);
+        writerCondition.wait(guard, [&chunk]() { return chunk.done; });
+      }
+      if (chunk.error) {
+        std::rethrow_exception(chunk.error);
+      }
+      _sink->append(chunk.output.data(), chunk.output.size());
+      chunk.output.clear();
+      {
+        std::lock_guard<std::mutex> guard(mutex);
+        ++written;
+      }
+      workerCondition.notify_all();
+    }
+
+    if (pretty) {
+      indent();
+    }
+    _sink->push_back(type == ValueType::Array ? ']' : '}');
+  } catch (...) {
+    joinAll();
+    throw;
+  }
+
+  joinAll();
+}
@@ -0,0 +1,180 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+
+#include <exception>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Executor.h"
+
+using namespace arangodb::velocypack;
+
+// the tasks of one run() call
+struct ThreadPool::Batch {
+  explicit Batch(std::vector<std::function<void()>> const& tasks)
+      : tasks(tasks), remaining(tasks.size()), errors(tasks.size()) {}
+
+  std::vector<std::function<void()>> const& tasks;
+  size_t remaining;
+  std::vector<std::exception_ptr> errors;
+  std::mutex mutex;
+  std::condition_variable done;
+};
+
+ThreadPool::ThreadPool(size_t concurrency)
+    : _next(0), _pending(0), _stop(false) {
+  if (concurrency == 0) {
+    concurrency = std::thread::hardware_concurrency();
+  }
+  if (concurrency == 0) {
+    concurrency = 1;
+  }
+  for (size_t i = 0; i < concurrency; ++i) {
+    _queues.emplace_back(new Queue());
+  }
+  // queue 0 is served by the threads calling run()
+  try {
+    for (size_t i = 1; i < concurrency; ++i) {
+      _workers.emplace_back([this, i]() { work(i); });
+    }
+  } catch (...) {
+    {
+      std::lock_guard<std::mutex> guard(_wakeMutex);
+      _stop = true;
+    }
+    _wake.notify_all();
+    for (auto& it : _workers) {
+      it.join();
+    }
+    throw;
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(_wakeMutex);
+    _stop = true;
+  }
+  _wake.notify_all();
+  for (auto& it : _workers) {
+    it.join();
+  }
+}
+
+ThreadPool& ThreadPool::instance() {
+  static ThreadPool pool;
+  return pool;
+}
+
+void ThreadPool::run(std::vector<std::function<void()>> const& tasks) {
+  if (tasks.empty()) {
+    return;
+  }
+
+  Batch batch(tasks);
+  // spread the tasks over all queues, starting at a different queue
+  // for each batch
+  size_t const n = _queues.size();
+  size_t const first = _next.fetch_add(1) % n;
+  for (size_t i = 0; i < tasks.size(); ++i) {
+    Queue& queue = *_queues[(first + i) % n];
+    std::lock_guard<std::mutex> guard(queue.mutex);
+    queue.tasks.push_back(Task{&batch, i});
+  }
+  {
+    std::lock_guard<std::mutex> guard(_wakeMutex);
+    _pending += tasks.size();
+  }
+  _wake.notify_all();
+
+  // help executing tasks until no more are queued
+  Task task;
+  while (take(0, task)) {
+    execute(task);
+  }
+
+  {
+    std::unique_lock<std::mutex> guard(batch.mutex);
+    batch.done.wait(guard, [&batch]() { return batch.remaining == 0; });
+  }
+
+  for (auto const& it : batch.errors) {
+    if (it) {
+      std::rethrow_exception(it);
+    }
+  }
+}
+
+bool ThreadPool::take(size_t queue, Task& task) {
+  size_t const n = _queues.size();
+  for (size_t i = 0; i < n; ++i) {
+    Queue& q = *_queues[(queue + i) % n];
+    std::lock_guard<std::mutex> guard(q.mutex);
+    if (q.tasks.empty()) {
+      continue;
+    }
+    if (i == 0) {
+      // own queue: take from the front
+      task = q.tasks.front();
+      q.tasks.pop_front();
+    } else {
+      // steal from the back of another queue
+      task = q.tasks.back();
+      q.tasks.pop_back();
+    }
+    std::lock_guard<std::mutex> wakeGuard(_wakeMutex);
+    --_pending;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::execute(Task const& task) {
+  Batch* batch = task.batch;
+  try {
+    batch->tasks[task.index]();
+  } catch (...) {
+    batch->errors[task.index] = std::current_exception();
+  }
+  // the batch may be gone as soon as the mutex is released
+  std::lock_guard<std::mutex> guard(batch->mutex);
+  if (--batch->remaining == 0) {
+    batch->done.notify_all();
+  }
+}
+
+void ThreadPool::work(size_t queue) {
+  while (true) {
+    Task task;
+    if (take(queue, task)) {
+      execute(task);
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(_wakeMutex);
+    _wake.wait(guard, [this]() { return _pending > 0 || _stop; });
+    if (_stop) {
+      return;
+    }
+  }
+}
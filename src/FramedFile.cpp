@@ -0,0 +1,318 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <iterator>
+#endif
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/FramedFile.h"
+#include "velocypack/Validator.h"
+
+#include "xxhash.h"
+
+using namespace arangodb::velocypack;
+
+namespace {
+
+uint8_t const Magic[] = {'V', 'P', 'K', 'F'};
+uint8_t const Version = 1;
+uint8_t const FlagChecksums = 0x01;
+
+// magic, version, flags and two unused bytes
+ValueLength const HeaderSize = 8;
+// index offset, number of documents and magic
+ValueLength const FooterSize = 20;
+
+unsigned long long const ChecksumSeed = 0;
+
+void unmap(void* mapping, ValueLength size) noexcept {
+#ifndef _WIN32
+  if (mapping != nullptr) {
+    ::munmap(mapping, checkOverflow(size));
+  }
+#else
+  (void)mapping;
+  (void)size;
+#endif
+}
+
+}  // namespace
+
+FramedFileWriter::FramedFileWriter(std::string const& path, bool checksums)
+    : _path(path),
+      _out(path, std::ofstream::out | std::ofstream::binary |
+                     std::ofstream::trunc),
+      _position(0),
+      _checksums(checksums),
+      _finished(false) {
+  if (!_out.is_open()) {
+    throw Exception(Exception::FileError,
+                    "Cannot open file '" + path + "' for writing");
+  }
+  uint8_t const header[HeaderSize] = {
+      Magic[0], Magic[1], Magic[2], Magic[3],
+      Version,  static_cast<uint8_t>(checksums ? FlagChecksums : 0),
+      0,        0};
+  write(header, HeaderSize);
+}
+
+FramedFileWriter::~FramedFileWriter() {
+  if (!_finished) {
+    try {
+      finish();
+    } catch (...) {
+      // destructors must not throw
+    }
+  }
+}
+
+void FramedFileWriter::append(Slice const& document) {
+  if (_finished) {
+    throw Exception(Exception::FileError,
+                    "Cannot append to finished file '" + _path + "'");
+  }
+  ValueLength const offset = _position;
+  ValueLength const length = document.byteSize();
+  uint8_t buffer[8];
+  storeUInt64(buffer, length);
+  write(buffer, sizeof(buffer));
+  write(document.start(), length);
+  if (_checksums) {
+    storeUInt64(buffer, XXH64(document.start(), checkOverflow(length),
+                              ChecksumSeed));
+    write(buffer, sizeof(buffer));
+  }
+  _offsets.push_back(offset);
+}
+
+void FramedFileWriter::finish() {
+  if (_finished) {
+    return;
+  }
+  _finished = true;
+
+  ValueLength const indexOffset = _position;
+  uint8_t buffer[8];
+  for (ValueLength offset : _offsets) {
+    storeUInt64(buffer, offset);
+    write(buffer, sizeof(buffer));
+  }
+  storeUInt64(buffer, indexOffset);
+  write(buffer, sizeof(buffer));
+  storeUInt64(buffer, _offsets.size());
+  write(buffer, sizeof(buffer));
+  write(Magic, sizeof(Magic));
+
+  _out.close();
+  if (_out.fail()) {
+    throw Exception(Exception::FileError,
+                    "Cannot write to file '" + _path + "'");
+  }
+}
+
+void FramedFileWriter::write(uint8_t const* data, ValueLength size) {
+  _out.write(reinterpret_cast<char const*>(data), checkOverflow(size));
+  if (!_out) {
+    throw Exception(Exception::FileError,
+                    "Cannot write to file '" + _path + "'");
+  }
+  _position += size;
+}
+
+FramedFileReader::FramedFileReader(std::string const& path)
+    : _data(nullptr),
+      _fileSize(0),
+      _index(nullptr),
+      _indexOffset(0),
+      _size(0),
+      _mapping(nullptr),
+      _checksums(false) {
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    throw Exception(Exception::FileError,
+                    "Cannot open file '" + path + "' for reading");
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    ::close(fd);
+    throw Exception(Exception::FileError,
+                    "Cannot determine size of file '" + path + "'");
+  }
+  _fileSize = static_cast<ValueLength>(st.st_size);
+  if (_fileSize > 0) {
+    void* p = ::mmap(nullptr, checkOverflow(_fileSize), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      ::close(fd);
+      throw Exception(Exception::FileError,
+                      "Cannot map file '" + path + "' into memory");
+    }
+    _mapping = p;
+    _data = static_cast<uint8_t const*>(p);
+  }
+  ::close(fd);
+#else
+  // no memory mapping here, the file is read into a buffer instead
+  std::ifstream in(path, std::ifstream::in | std::ifstream::binary);
+  if (!in.is_open()) {
+    throw Exception(Exception::FileError,
+                    "Cannot open file '" + path + "' for reading");
+  }
+  _buffer.assign(std::istreambuf_iterator<char>(in),
+                 std::istreambuf_iterator<char>());
+  _data = _buffer.data();
+  _fileSize = _buffer.size();
+#endif
+
+  try {
+    init();
+  } catch (...) {
+    unmap(_mapping, _fileSize);
+    throw;
+  }
+}
+
+FramedFileReader::FramedFileReader(uint8_t const* data, ValueLength size)
+    : _data(data),
+      _fileSize(size),
+      _index(nullptr),
+      _indexOffset(0),
+      _size(0),
+      _mapping(nullptr),
+      _checksums(false) {
+  init();
+}
+
+FramedFileReader::~FramedFileReader() { unmap(_mapping, _fileSize); }
+
+void FramedFileReader::init() {
+  if (_data == nullptr || _fileSize < HeaderSize + FooterSize ||
+      memcmp(_data, Magic, sizeof(Magic)) != 0) {
+    throw Exception(Exception::FileInvalidFormat, "Not a framed VPack file");
+  }
+  if (_data[4] != Version) {
+    throw Exception(Exception::FileInvalidFormat,
+                    "Unsupported version of framed VPack file");
+  }
+  _checksums = ((_data[5] & FlagChecksums) != 0);
+
+  uint8_t const* footer = _data + _fileSize - FooterSize;
+  if (memcmp(footer + 16, Magic, sizeof(Magic)) != 0) {
+    // the writer did not finish the file
+    throw Exception(Exception::FileInvalidFormat,
+                    "Framed VPack file is incomplete");
+  }
+  _indexOffset = readUInt64(footer);
+  _size = readUInt64(footer + 8);
+  ValueLength const indexEnd = _fileSize - FooterSize;
+  if (_indexOffset < HeaderSize || _indexOffset > indexEnd ||
+      (indexEnd - _indexOffset) / 8 != _size ||
+      (indexEnd - _indexOffset) % 8 != 0) {
+    throw Exception(Exception::FileInvalidFormat,
+                    "Invalid index in framed VPack file");
+  }
+  _index = _data + _indexOffset;
+
+  // frames follow each other without gaps, in the order of the index.
+  // each frame holds the length, a non-empty document and the checksum
+  ValueLength const minFrameSize = 8 + 1 + (_checksums ? 8 : 0);
+  ValueLength expected = HeaderSize;
+  for (ValueLength i = 0; i < _size; ++i) {
+    ValueLength const offset = readUInt64(_index + i * 8);
+    if ((i == 0 && offset != HeaderSize) || offset < expected ||
+        offset > _indexOffset) {
+      throw Exception(Exception::FileInvalidFormat,
+                      "Invalid index in framed VPack file");
+    }
+    expected = offset + minFrameSize;
+  }
+  if (expected > _indexOffset) {
+    throw Exception(Exception::FileInvalidFormat,
+                    "Invalid index in framed VPack file");
+  }
+}
+
+uint8_t const* FramedFileReader::locate(ValueLength index,
+                                        ValueLength& length) const {
+  if (index >= _size) {
+    throw Exception(Exception::IndexOutOfBounds);
+  }
+  ValueLength const offset = readUInt64(_index + index * 8);
+  ValueLength const next =
+      (index + 1 < _size ? readUInt64(_index + (index + 1) * 8)
+                         : _indexOffset);
+  length = readUInt64(_data + offset);
+  if (length != next - offset - 8 - (_checksums ? 8 : 0)) {
+    throw Exception(Exception::FileInvalidFormat,
+                    "Document length does not match index of framed VPack file");
+  }
+  return _data + offset + 8;
+}
+
+Slice FramedFileReader::document(ValueLength index) const {
+  ValueLength length;
+  uint8_t const* p = locate(index, length);
+  Slice const result(p);
+  if (result.byteSize() != length) {
+    throw Exception(Exception::FileInvalidFormat,
+                    "Document length does not match frame in framed VPack file");
+  }
+  return result;
+}
+
+void FramedFileReader::verify(ValueLength index, Options const* options) const {
+  ValueLength length;
+  uint8_t const* p = locate(index, length);
+  if (_checksums &&
+      XXH64(p, checkOverflow(length), ChecksumSeed) != readUInt64(p + length)) {
+    throw Exception(Exception::FileChecksumMismatch);
+  }
+  Validator validator(options);
+  validator.validate(p, checkOverflow(length));
+}
+
+std::vector<FramedFileReader::Range> FramedFileReader::split(
+    ValueLength count) const {
+  std::vector<Range> result;
+  if (_size == 0) {
+    return result;
+  }
+  count = (std::max)(ValueLength(1), (std::min)(count, _size));
+  result.reserve(checkOverflow(count));
+  for (ValueLength i = 0; i < count; ++i) {
+    result.push_back(Range{this, _size * i / count, _size * (i + 1) / count});
+  }
+  return result;
+}
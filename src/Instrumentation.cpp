@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Instrumentation.h"
+
+using namespace arangodb::velocypack;
+
+namespace {
+
+struct ThreadCounters;
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<ThreadCounters*> threads;
+  uint64_t finished[Instrumentation::NumCounters] = {};
+};
+
+// never destroyed, as threads may finish during static destruction
+Registry& registry() {
+  static Registry* instance = new Registry;
+  return *instance;
+}
+
+std::atomic<Instrumentation::TraceHook> traceHook(nullptr);
+
+struct ThreadCounters {
+  // only written by the owning thread. atomic so that other threads can
+  // take snapshots
+  std::atomic<uint64_t> values[Instrumentation::NumCounters];
+
+  ThreadCounters() {
+    for (auto& it : values) {
+      it.store(0, std::memory_order_relaxed);
+    }
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    r.threads.push_back(this);
+  }
+
+  ~ThreadCounters() {
+    Registry& r = registry();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+      r.finished[i] += values[i].load(std::memory_order_relaxed);
+    }
+    r.threads.erase(std::find(r.threads.begin(), r.threads.end(), this));
+  }
+
+  void snapshot(Instrumentation::Snapshot& result) const {
+    for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+      result.values[i] += values[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  void reset() {
+    for (auto& it : values) {
+      it.store(0, std::memory_order_relaxed);
+    }
+  }
+};
+
+ThreadCounters& local() {
+  thread_local ThreadCounters counters;
+  return counters;
+}
+
+Instrumentation::Snapshot emptySnapshot() {
+  Instrumentation::Snapshot result;
+  std::fill(std::begin(result.values), std::end(result.values), 0);
+  return result;
+}
+
+}  // namespace
+
+Instrumentation::Snapshot Instrumentation::Snapshot::operator-(
+    Snapshot const& other) const noexcept {
+  Snapshot result;
+  for (uint32_t i = 0; i < NumCounters; ++i) {
+    result.values[i] = values[i] - other.values[i];
+  }
+  return result;
+}
+
+char const* Instrumentation::counterName(Counter counter) noexcept {
+  switch (counter) {
+    case BufferReallocations:
+      return "bufferReallocations";
+    case BufferBytesCopied:
+      return "bufferBytesCopied";
+    case BuilderCloseMemmoves:
+      return "builderCloseMemmoves";
+    case BuilderCloseBytesMoved:
+      return "builderCloseBytesMoved";
+    case ObjectIndexSorts:
+      return "objectIndexSorts";
+    case ObjectIndexSortedMembers:
+      return "objectIndexSortedMembers";
+    case CompactArrays:
+      return "compactArrays";
+    case IndexedArrays:
+      return "indexedArrays";
+    case CompactObjects:
+      return "compactObjects";
+    case IndexedObjects:
+      return "indexedObjects";
+    case BinaryKeySearches:
+      return "binaryKeySearches";
+    case LinearKeySearches:
+      return "linearKeySearches";
+    case ParserSimdCalls:
+      return "parserSimdCalls";
+    case ParserScalarCalls:
+      return "parserScalarCalls";
+    case StringReferences:
+      return "stringReferences";
+    case ShapedArrays:
+      return "shapedArrays";
+    case PackedArrays:
+      return "packedArrays";
+    case PackedSimdCalls:
+      return "packedSimdCalls";
+    case PackedScalarCalls:
+      return "packedScalarCalls";
+    case DeltaArrays:
+      return "deltaArrays";
+    case DeltaSimdCalls:
+      return "deltaSimdCalls";
+    case DeltaScalarCalls:
+      return "deltaScalarCalls";
+    case NumCounters:
+      break;
+  }
+  return "unknown";
+}
+
+Instrumentation::Snapshot Instrumentation::threadSnapshot() {
+  Snapshot result = emptySnapshot();
+  local().snapshot(result);
+  return result;
+}
+
+Instrumentation::Snapshot Instrumentation::globalSnapshot() {
+  Snapshot result = emptySnapshot();
+  Registry& r = registry();
+  std::lock_guard<std::mutex> guard(r.mutex);
+  for (uint32_t i = 0; i < NumCounters; ++i) {
+    result.values[i] = r.finished[i];
+  }
+  for (auto const* it : r.threads) {
+    it->snapshot(result);
+  }
+  return result;
+}
+
+void Instrumentation::resetThread() { local().reset(); }
+
+void Instrumentation::reset() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> guard(r.mutex);
+  std::fill(std::begin(r.finished), std::end(r.finished), 0);
+  for (auto* it : r.threads) {
+    it->reset();
+  }
+}
+
+void Instrumentation::setTraceHook(TraceHook hook) noexcept {
+  traceHook.store(hook, std::memory_order_release);
+}
+
+void Instrumentation::count(Counter counter, uint64_t amount) noexcept {
+  std::atomic<uint64_t>& value = local().values[counter];
+  value.store(value.load(std::memory_order_relaxed) + amount,
+              std::memory_order_relaxed);
+
+  TraceHook hook = traceHook.load(std::memory_order_acquire);
+  if (hook != nullptr) {
+    hook(counter, amount);
+  }
+}
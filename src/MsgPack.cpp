@@ -0,0 +1,630 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cmath>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/MsgPack.h"
+#include "velocypack/Iterator.h"
+#include "velocypack/Utf8Helper.h"
+#include "velocypack/Value.h"
+#include "velocypack/ValueType.h"
+
+using namespace arangodb::velocypack;
+
+namespace {
+
+// MessagePack extension type of the predefined timestamp extension
+int8_t const TimestampType = -1;
+
+inline uint64_t readBigEndian(uint8_t const* p, size_t length) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < length; ++i) {
+    value = (value << 8) | p[i];
+  }
+  return value;
+}
+
+inline int64_t floorDiv(int64_t a, int64_t b) {
+  int64_t q = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) {
+    --q;
+  }
+  return q;
+}
+
+}  // namespace
+
+MsgPackParser::MsgPackParser(Options const* options)
+    : _start(nullptr),
+      _size(0),
+      _pos(0),
+      _key(nullptr),
+      _keyLength(0),
+      options(options) {
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+  _b.reset(new Builder());
+  _b->options = options;
+}
+
+MsgPackParser::MsgPackParser(Builder& builder, Options const* options)
+    : _start(nullptr),
+      _size(0),
+      _pos(0),
+      _key(nullptr),
+      _keyLength(0),
+      options(options) {
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+  _b.reset(&builder, BuilderNonDeleter());
+}
+
+ValueLength MsgPackParser::parse(uint8_t const* start, size_t size,
+                                 bool multi) {
+  _start = start;
+  _size = size;
+  _pos = 0;
+  _key = nullptr;
+  if (options->clearBuilderBeforeParse) {
+    _b->clear();
+  }
+
+  ValueLength nr = 0;
+  do {
+    parseValue();
+    ++nr;
+    if (!multi && _pos != _size) {
+      throw Exception(Exception::ParseError, "Expecting EOF");
+    }
+  } while (multi && _pos < _size);
+  return nr;
+}
+
+uint8_t const* MsgPackParser::consume(uint64_t length) {
+  if (length > _size - _pos) {
+    throw Exception(Exception::ParseError, "Unexpected end of input");
+  }
+  uint8_t const* p = _start + _pos;
+  _pos += static_cast<size_t>(length);
+  return p;
+}
+
+uint64_t MsgPackParser::readUInt(size_t length) {
+  return readBigEndian(consume(length), length);
+}
+
+void MsgPackParser::parseValue() {
+  uint8_t const head = *consume(1);
+
+  if (head <= 0x7f) {
+    // positive fixint
+    addValue(Value(static_cast<uint64_t>(head)));
+    return;
+  }
+  if (head >= 0xe0) {
+    // negative fixint
+    addValue(Value(static_cast<int64_t>(static_cast<int8_t>(head))));
+    return;
+  }
+  if (head <= 0x8f) {
+    parseObject(head & 0x0f);
+    return;
+  }
+  if (head <= 0x9f) {
+    parseArray(head & 0x0f);
+    return;
+  }
+  if (head <= 0xbf) {
+    parseString(head & 0x1f);
+    return;
+  }
+
+  switch (head) {
+    case 0xc0:
+      addValue(Value(ValueType::Null));
+      break;
+    case 0xc2:
+      addValue(Value(false));
+      break;
+    case 0xc3:
+      addValue(Value(true));
+      break;
+    case 0xc4:
+    case 0xc5:
+    case 0xc6:
+      parseBinary(readUInt(size_t(1) << (head - 0xc4)));
+      break;
+    case 0xc7:
+    case 0xc8:
+    case 0xc9: {
+      uint64_t length = readUInt(size_t(1) << (head - 0xc7));
+      int8_t type = static_cast<int8_t>(readUInt(1));
+      parseExtension(type, length);
+      break;
+    }
+    case 0xca: {
+      uint32_t bits = static_cast<uint32_t>(readUInt(4));
+      float f;
+      memcpy(&f, &bits, sizeof(f));
+      addValue(Value(static_cast<double>(f)));
+      break;
+    }
+    case 0xcb: {
+      uint64_t bits = readUInt(8);
+      double d;
+      memcpy(&d, &bits, sizeof(d));
+      addValue(Value(d));
+      break;
+    }
+    case 0xcc:
+    case 0xcd:
+    case 0xce:
+    case 0xcf:
+      addValue(Value(readUInt(size_t(1) << (head - 0xcc))));
+      break;
+    case 0xd0:
+      addValue(Value(static_cast<int64_t>(static_cast<int8_t>(readUInt(1)))));
+      break;
+    case 0xd1:
+      addValue(Value(static_cast<int64_t>(static_cast<int16_t>(readUInt(2)))));
+      break;
+    case 0xd2:
+      addValue(Value(static_cast<int64_t>(static_cast<int32_t>(readUInt(4)))));
+      break;
+    case 0xd3:
+      addValue(Value(static_cast<int64_t>(readUInt(8))));
+      break;
+    case 0xd4:
+    case 0xd5:
+    case 0xd6:
+    case 0xd7:
+    case 0xd8: {
+      int8_t type = static_cast<int8_t>(readUInt(1));
+      parseExtension(type, uint64_t(1) << (head - 0xd4));
+      break;
+    }
+    case 0xd9:
+    case 0xda:
+    case 0xdb:
+      parseString(readUInt(size_t(1) << (head - 0xd9)));
+      break;
+    case 0xdc:
+    case 0xdd:
+      parseArray(readUInt(head == 0xdc ? 2 : 4));
+      break;
+    case 0xde:
+    case 0xdf:
+      parseObject(readUInt(head == 0xde ? 2 : 4));
+      break;
+    default:
+      throw Exception(Exception::ParseError, "Invalid MessagePack type byte");
+  }
+}
+
+void MsgPackParser::parseKey() {
+  uint8_t const head = *consume(1);
+  uint64_t length;
+
+  if (head >= 0xa0 && head <= 0xbf) {
+    length = head & 0x1f;
+  } else if (head >= 0xd9 && head <= 0xdb) {
+    length = readUInt(size_t(1) << (head - 0xd9));
+  } else {
+    // integer keys are converted into their string representation
+    if (head <= 0x7f) {
+      _keyBuffer = std::to_string(head);
+    } else if (head >= 0xe0) {
+      _keyBuffer = std::to_string(static_cast<int8_t>(head));
+    } else if (head >= 0xcc && head <= 0xcf) {
+      _keyBuffer = std::to_string(readUInt(size_t(1) << (head - 0xcc)));
+    } else if (head >= 0xd0 && head <= 0xd3) {
+      size_t n = size_t(1) << (head - 0xd0);
+      uint64_t v = readUInt(n);
+      if (n < 8) {
+        // sign-extend
+        uint64_t const sign = uint64_t(1) << (8 * n - 1);
+        v = (v ^ sign) - sign;
+      }
+      _keyBuffer = std::to_string(static_cast<int64_t>(v));
+    } else {
+      throw Exception(Exception::ParseError,
+                      "Expecting string or integer attribute name");
+    }
+    _key = _keyBuffer.data();
+    _keyLength = _keyBuffer.size();
+    return;
+  }
+
+  char const* p = reinterpret_cast<char const*>(consume(length));
+  if (options->validateUtf8Strings &&
+      !Utf8Helper::isValidUtf8(reinterpret_cast<uint8_t const*>(p), length)) {
+    throw Exception(Exception::InvalidUtf8Sequence);
+  }
+  _key = p;
+  _keyLength = static_cast<size_t>(length);
+}
+
+void MsgPackParser::parseArray(uint64_t length) {
+  addValue(Value(ValueType::Array));
+  for (uint64_t i = 0; i < length; ++i) {
+    parseValue();
+  }
+  _b->close();
+}
+
+void MsgPackParser::parseObject(uint64_t length) {
+  addValue(Value(ValueType::Object));
+  for (uint64_t i = 0; i < length; ++i) {
+    parseKey();
+    parseValue();
+  }
+  _b->close();
+}
+
+void MsgPackParser::parseString(uint64_t length) {
+  uint8_t const* p = consume(length);
+  if (options->validateUtf8Strings && !Utf8Helper::isValidUtf8(p, length)) {
+    throw Exception(Exception::InvalidUtf8Sequence);
+  }
+  addValue(ValuePair(p, length, ValueType::String));
+}
+
+void MsgPackParser::parseBinary(uint64_t length) {
+  addValue(ValuePair(consume(length), length, ValueType::Binary));
+}
+
+void MsgPackParser::parseExtension(int8_t type, uint64_t length) {
+  uint8_t const* p = consume(length);
+
+  if (type == TimestampType &&
+      (length == 4 || length == 8 || length == 12)) {
+    int64_t seconds;
+    uint64_t nanoseconds;
+    if (length == 4) {
+      seconds = static_cast<int64_t>(readBigEndian(p, 4));
+      nanoseconds = 0;
+    } else if (length == 8) {
+      uint64_t v = readBigEndian(p, 8);
+      seconds = static_cast<int64_t>(v & 0x3ffffffffULL);
+      nanoseconds = v >> 34;
+    } else {
+      nanoseconds = readBigEndian(p, 4);
+      seconds = static_cast<int64_t>(readBigEndian(p + 4, 8));
+    }
+    if (nanoseconds >= 1000000000ULL || seconds > INT64_MAX / 1000 ||
+        seconds < INT64_MIN / 1000) {
+      throw Exception(Exception::NumberOutOfRange);
+    }
+    addValue(Value(seconds * 1000 + static_cast<int64_t>(nanoseconds / 1000000),
+                   ValueType::UTCDate));
+    return;
+  }
+
+  // store as Custom type with the extension type as the first payload byte
+  uint64_t const payload = length + 1;
+  uint8_t head;
+  size_t lengthSize;
+  if (payload <= 0xff) {
+    head = 0xf4;
+    lengthSize = 1;
+  } else if (payload <= 0xffff) {
+    head = 0xf7;
+    lengthSize = 2;
+  } else if (payload <= 0xffffffffULL) {
+    head = 0xfa;
+    lengthSize = 4;
+  } else {
+    head = 0xfd;
+    lengthSize = 8;
+  }
+
+  uint8_t* out = addValue(ValuePair(1 + lengthSize + payload, ValueType::Custom));
+  *out++ = head;
+  for (size_t i = 0; i < lengthSize; ++i) {
+    *out++ = static_cast<uint8_t>((payload >> (8 * i)) & 0xff);
+  }
+  *out++ = static_cast<uint8_t>(type);
+  memcpy(out, p, checkOverflow(length));
+}
+
+MsgPackDumper::MsgPackDumper(Sink* sink, Options const* options)
+    : options(options), _sink(sink) {
+  if (sink == nullptr) {
+    throw Exception(Exception::InternalError, "Sink cannot be a nullptr");
+  }
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+}
+
+// appends a type byte, followed by value as big endian integer of
+// the given byte length
+void MsgPackDumper::appendHead(uint8_t head, uint64_t value, size_t length) {
+  char buffer[9];
+  buffer[0] = static_cast<char>(head);
+  for (size_t i = 0; i < length; ++i) {
+    buffer[length - i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  _sink->append(&buffer[0], 1 + length);
+}
+
+void MsgPackDumper::appendBigEndian(uint64_t value, size_t length) {
+  char buffer[8];
+  for (size_t i = 0; i < length; ++i) {
+    buffer[length - 1 - i] = static_cast<char>((value >> (8 * i)) & 0xff);
+  }
+  _sink->append(&buffer[0], length);
+}
+
+void MsgPackDumper::dumpUInt(uint64_t v) {
+  if (v <= 0x7f) {
+    _sink->push_back(static_cast<char>(v));
+  } else if (v <= 0xff) {
+    appendHead(0xcc, v, 1);
+  } else if (v <= 0xffff) {
+    appendHead(0xcd, v, 2);
+  } else if (v <= 0xffffffffULL) {
+    appendHead(0xce, v, 4);
+  } else {
+    appendHead(0xcf, v, 8);
+  }
+}
+
+void MsgPackDumper::dumpInt(int64_t v) {
+  if (v >= 0) {
+    dumpUInt(static_cast<uint64_t>(v));
+  } else if (v >= -32) {
+    _sink->push_back(static_cast<char>(v));
+  } else if (v >= INT8_MIN) {
+    appendHead(0xd0, static_cast<uint64_t>(v), 1);
+  } else if (v >= INT16_MIN) {
+    appendHead(0xd1, static_cast<uint64_t>(v), 2);
+  } else if (v >= INT32_MIN) {
+    appendHead(0xd2, static_cast<uint64_t>(v), 4);
+  } else {
+    appendHead(0xd3, static_cast<uint64_t>(v), 8);
+  }
+}
+
+// dumps a UTCDate value (milliseconds since the epoch) using the
+// smallest possible encoding of the timestamp extension
+void MsgPackDumper::dumpUTCDate(int64_t v) {
+  int64_t const seconds = floorDiv(v, 1000);
+  uint64_t const nanoseconds =
+      static_cast<uint64_t>(v - seconds * 1000) * 1000000ULL;
+
+  uint8_t const type = static_cast<uint8_t>(TimestampType);
+  if (nanoseconds == 0 && seconds >= 0 && seconds <= 0xffffffffLL) {
+    // timestamp 32
+    appendHead(0xd6, type, 1);
+    appendBigEndian(static_cast<uint64_t>(seconds), 4);
+  } else if (seconds >= 0 && seconds <= 0x3ffffffffLL) {
+    // timestamp 64
+    appendHead(0xd7, type, 1);
+    appendBigEndian((nanoseconds << 34) | static_cast<uint64_t>(seconds), 8);
+  } else {
+    // timestamp 96
+    appendHead(0xc7, 12, 1);
+    _sink->push_back(static_cast<char>(type));
+    appendBigEndian(nanoseconds, 4);
+    appendBigEndian(static_cast<uint64_t>(seconds), 8);
+  }
+}
+
+// dumps a Custom value created by the MsgPackParser as an extension
+void MsgPackDumper::dumpExtension(Slice const& slice) {
+  uint8_t const* p = slice.start();
+  ValueLength const size = slice.byteSize();
+  size_t const lengthSize = size_t(1) << ((slice.head() - 0xf4) / 3);
+  uint8_t const* payload = p + 1 + lengthSize;
+  ValueLength const payloadSize = size - 1 - lengthSize;
+
+  if (payloadSize == 0) {
+    handleUnsupportedType(slice);
+    return;
+  }
+
+  uint8_t const type = payload[0];
+  ValueLength const length = payloadSize - 1;
+  switch (length) {
+    case 1:
+      appendHead(0xd4, type, 1);
+      break;
+    case 2:
+      appendHead(0xd5, type, 1);
+      break;
+    case 4:
+      appendHead(0xd6, type, 1);
+      break;
+    case 8:
+      appendHead(0xd7, type, 1);
+      break;
+    case 16:
+      appendHead(0xd8, type, 1);
+      break;
+    default:
+      if (length <= 0xff) {
+        appendHead(0xc7, length, 1);
+      } else if (length <= 0xffff) {
+        appendHead(0xc8, length, 2);
+      } else if (length <= 0xffffffffULL) {
+        appendHead(0xc9, length, 4);
+      } else {
+        throw Exception(Exception::NumberOutOfRange,
+                        "Custom value too long for MessagePack");
+      }
+      _sink->push_back(static_cast<char>(type));
+  }
+  _sink->append(reinterpret_cast<char const*>(payload + 1), length);
+}
+
+void MsgPackDumper::handleUnsupportedType(Slice const& slice) {
+  if (options->unsupportedTypeBehavior == Options::NullifyUnsupportedType) {
+    _sink->push_back(static_cast<char>(0xc0));
+    return;
+  } else if (options->unsupportedTypeBehavior ==
+             Options::ConvertUnsupportedType) {
+    std::string value =
+        std::string("(non-representable type ") + slice.typeName() + ")";
+    appendHead(0xd9, value.size(), 1);
+    _sink->append(value);
+    return;
+  }
+
+  throw Exception(Exception::NoJsonEquivalent,
+                  "Type has no equivalent in MessagePack");
+}
+
+void MsgPackDumper::dumpValue(Slice const& slice) {
+  switch (slice.type()) {
+    case ValueType::Null:
+      _sink->push_back(static_cast<char>(0xc0));
+      break;
+
+    case ValueType::Bool:
+      _sink->push_back(static_cast<char>(slice.getBool() ? 0xc3 : 0xc2));
+      break;
+
+    case ValueType::Double: {
+      double const d = slice.getDouble();
+      uint64_t bits;
+      memcpy(&bits, &d, sizeof(bits));
+      appendHead(0xcb, bits, 8);
+      break;
+    }
+
+    case ValueType::UTCDate:
+      dumpUTCDate(slice.getUTCDate());
+      break;
+
+    case ValueType::External:
+      dumpValue(Slice(slice.getExternal()));
+      break;
+
+    case ValueType::Int:
+    case ValueType::SmallInt:
+      dumpInt(slice.getInt());
+      break;
+
+    case ValueType::UInt:
+      dumpUInt(slice.getUInt());
+      break;
+
+    case ValueType::String: {
+      ValueLength len;
+      char const* p = slice.getString(len);
+      if (len <= 31) {
+        _sink->push_back(static_cast<char>(0xa0 + len));
+      } else if (len <= 0xff) {
+        appendHead(0xd9, len, 1);
+      } else if (len <= 0xffff) {
+        appendHead(0xda, len, 2);
+      } else if (len <= 0xffffffffULL) {
+        appendHead(0xdb, len, 4);
+      } else {
+        throw Exception(Exception::NumberOutOfRange,
+                        "String too long for MessagePack");
+      }
+      _sink->append(p, len);
+      break;
+    }
+
+    case ValueType::Binary: {
+      ValueLength len;
+      uint8_t const* p = slice.getBinary(len);
+      if (len <= 0xff) {
+        appendHead(0xc4, len, 1);
+      } else if (len <= 0xffff) {
+        appendHead(0xc5, len, 2);
+      } else if (len <= 0xffffffffULL) {
+        appendHead(0xc6, len, 4);
+      } else {
+        throw Exception(Exception::NumberOutOfRange,
+                        "Binary value too long for MessagePack");
+      }
+      _sink->append(reinterpret_cast<char const*>(p), len);
+      break;
+    }
+
+    case ValueType::Array: {
+      ValueLength const n = slice.length();
+      if (n <= 15) {
+        _sink->push_back(static_cast<char>(0x90 + n));
+      } else if (n <= 0xffff) {
+        appendHead(0xdc, n, 2);
+      } else if (n <= 0xffffffffULL) {
+        appendHead(0xdd, n, 4);
+      } else {
+        throw Exception(Exception::NumberOutOfRange,
+                        "Too many members for MessagePack");
+      }
+      ArrayIterator it(slice);
+      while (it.valid()) {
+        dumpValue(it.value());
+        it.next();
+      }
+      break;
+    }
+
+    case ValueType::Object: {
+      ValueLength const n = slice.length();
+      if (n <= 15) {
+        _sink->push_back(static_cast<char>(0x80 + n));
+      } else if (n <= 0xffff) {
+        appendHead(0xde, n, 2);
+      } else if (n <= 0xffffffffULL) {
+        appendHead(0xdf, n, 4);
+      } else {
+        throw Exception(Exception::NumberOutOfRange,
+                        "Too many members for MessagePack");
+      }
+      ObjectIterator it(slice);
+      while (it.valid()) {
+        dumpValue(it.key(true));
+        dumpValue(it.value());
+        it.next();
+      }
+      break;
+    }
+
+    case ValueType::Custom: {
+      uint8_t const h = slice.head();
+      if (h == 0xf4 || h == 0xf7 || h == 0xfa || h == 0xfd) {
+        dumpExtension(slice);
+      } else {
+        handleUnsupportedType(slice);
+      }
+      break;
+    }
+
+    default:
+      handleUnsupportedType(slice);
+      break;
+  }
+}
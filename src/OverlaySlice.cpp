@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/OverlaySlice.h"
+#include "velocypack/Dumper.h"
+#include "velocypack/Exception.h"
+
+using namespace arangodb::velocypack;
+
+OverlaySlice::OverlaySlice(Slice const& base, Slice const& patch,
+                           bool mergeValues, bool nullMeansRemove)
+    : _base(base),
+      _patch(patch),
+      _mergeValues(mergeValues),
+      _nullMeansRemove(nullMeansRemove) {
+  if (!base.isObject() || !patch.isObject()) {
+    throw Exception(Exception::InvalidValueType, "Expecting type Object");
+  }
+}
+
+OverlaySlice OverlaySlice::get(std::string const& attribute) const {
+  if (!isOverlay()) {
+    return OverlaySlice(_base.get(attribute));
+  }
+
+  Slice const value = _patch.get(attribute);
+  if (value.isNone()) {
+    return OverlaySlice(_base.get(attribute));
+  }
+  if (_nullMeansRemove && value.isNull()) {
+    return OverlaySlice(Slice());
+  }
+  if (_mergeValues && value.isObject()) {
+    Slice const original = _base.get(attribute);
+    if (original.isObject()) {
+      return OverlaySlice(original, value, true, _nullMeansRemove);
+    }
+  }
+  return OverlaySlice(value);
+}
+
+OverlaySlice OverlaySlice::get(std::vector<std::string> const& path) const {
+  if (path.empty()) {
+    throw Exception(Exception::InvalidAttributePath);
+  }
+  OverlaySlice current(*this);
+  for (auto const& it : path) {
+    if (!current.isObject()) {
+      return OverlaySlice(Slice());
+    }
+    current = current.get(it);
+    if (current.isNone()) {
+      break;
+    }
+  }
+  return current;
+}
+
+ValueLength OverlaySlice::length() const {
+  if (!isOverlay()) {
+    return _base.length();
+  }
+  ValueLength count = 0;
+  for (OverlayIterator it(*this); it.valid(); it.next()) {
+    ++count;
+  }
+  return count;
+}
+
+void OverlaySlice::materialize(Builder& builder) const {
+  if (!isOverlay()) {
+    builder.add(_base);
+    return;
+  }
+  builder.add(Value(ValueType::Object));
+  for (OverlayIterator it(*this); it.valid(); it.next()) {
+    builder.add(it.key());
+    it.value().materialize(builder);
+  }
+  builder.close();
+}
+
+void OverlaySlice::dump(Sink* sink, Options const* options) const {
+  if (!isOverlay()) {
+    Dumper::dump(_base, sink, options);
+    return;
+  }
+  if (options->prettyPrint) {
+    Builder b(options);
+    materialize(b);
+    Dumper::dump(b.slice(), sink, options);
+    return;
+  }
+
+  Dumper dumper(sink, options);
+  sink->push_back('{');
+  bool first = true;
+  for (OverlayIterator it(*this); it.valid(); it.next()) {
+    if (!first) {
+      sink->push_back(',');
+    }
+    first = false;
+    dumper.append(it.key());
+    sink->push_back(':');
+    OverlaySlice const& value = it.value();
+    if (value.isOverlay()) {
+      value.dump(sink, options);
+    } else {
+      dumper.append(value._base);
+    }
+  }
+  sink->push_back('}');
+}
+
+std::string OverlaySlice::toJson(Options const* options) const {
+  std::string buffer;
+  StringSink sink(&buffer);
+  dump(&sink, options);
+  return buffer;
+}
+
+OverlayIterator::OverlayIterator(OverlaySlice const& overlay)
+    : _base(overlay.isOverlay() ? overlay._base : overlay.slice()),
+      _patch(overlay.isOverlay() ? overlay._patch : Slice::emptyObjectSlice()),
+      _mergeValues(overlay._mergeValues),
+      _nullMeansRemove(overlay._nullMeansRemove),
+      _valid(false),
+      _value(Slice()) {
+  advance();
+}
+
+void OverlayIterator::next() {
+  if (!_valid) {
+    throw Exception(Exception::IndexOutOfBounds);
+  }
+  advance();
+}
+
+// same merge-join as the one used by Collection::merge
+void OverlayIterator::advance() {
+  while (_base.valid() || _patch.valid()) {
+    int res;
+    if (!_patch.valid()) {
+      res = -1;
+    } else if (!_base.valid()) {
+      res = 1;
+    } else {
+      res = KeyOrderedIterator::compareKeys(_base.key(), _patch.key());
+    }
+
+    if (res < 0) {
+      // attribute only in base
+      _key = _base.key();
+      _value = OverlaySlice(_base.value());
+      _base.next();
+      _valid = true;
+      return;
+    }
+
+    Slice const key = _patch.key();
+    Slice const value = _patch.value();
+    bool found = true;
+    if (res == 0 && _mergeValues && value.isObject() &&
+        _base.value().isObject()) {
+      _value = OverlaySlice(_base.value(), value, true, _nullMeansRemove);
+    } else if (!value.isNone() && (!_nullMeansRemove || !value.isNull())) {
+      _value = OverlaySlice(value);
+    } else {
+      found = false;
+    }
+    // the patch value replaces all base values with the same name, and
+    // only the first of several patch values with the same name is used
+    while (_base.valid() &&
+           KeyOrderedIterator::compareKeys(_base.key(), key) == 0) {
+      _base.next();
+    }
+    do {
+      _patch.next();
+    } while (_patch.valid() &&
+             KeyOrderedIterator::compareKeys(_patch.key(), key) == 0);
+
+    if (found) {
+      _key = key;
+      _valid = true;
+      return;
+    }
+  }
+  _valid = false;
+}
@@ -0,0 +1,75 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/PackedArray.h"
+
+#include "asm-functions.h"
+
+using namespace arangodb::velocypack;
+
+void arangodb::velocypack::aggregatePacked(uint8_t const* data, ValueLength n,
+                                           PackedAggregate<int32_t>& result) {
+  if (n > 0) {
+    result.count = n;
+    PackedAggregateInt32(data, checkOverflow(n), &result.sum, &result.min,
+                         &result.max);
+  }
+}
+
+void arangodb::velocypack::aggregatePacked(uint8_t const* data, ValueLength n,
+                                           PackedAggregate<int64_t>& result) {
+  if (n > 0) {
+    result.count = n;
+    PackedAggregateInt64(data, checkOverflow(n), &result.sum, &result.min,
+                         &result.max);
+  }
+}
+
+void arangodb::velocypack::aggregatePacked(uint8_t const* data, ValueLength n,
+                                           PackedAggregate<uint64_t>& result) {
+  if (n > 0) {
+    result.count = n;
+    PackedAggregateUInt64(data, checkOverflow(n), &result.sum, &result.min,
+                          &result.max);
+  }
+}
+
+void arangodb::velocypack::aggregatePacked(uint8_t const* data, ValueLength n,
+                                           PackedAggregate<double>& result) {
+  if (n > 0) {
+    size_t count;
+    PackedAggregateDouble(data, checkOverflow(n), &count, &result.sum,
+                          &result.min, &result.max);
+    result.count = count;
+  }
+  if (result.count == 0) {
+    // no values, or only NaN
+    result.sum = 0.0;
+    result.min = 0.0;
+    result.max = 0.0;
+  }
+}
@@ -600,9 +600,12 @@ void Parser::parseJson() {
     case 'n':
       parseNull();  // this consumes "ull" or throws
       break;
-    case '"':
+    case '"': {
+      ValueLength const pos = _b->_pos;
       parseString();
+      _b->dedupeString(pos);
       break;
+    }
     default: {
       // everything else must be a number or is invalid...
       // this includes '-' and '0' to '9'. scanNumber() will
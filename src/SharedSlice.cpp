@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <new>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/SharedSlice.h"
+
+using namespace arangodb::velocypack;
+
+void* SharedSliceMemory::allocate(size_t controlSize, ValueLength length) {
+  return ::operator new(controlSize + checkOverflow(length));
+}
+
+void SharedSliceMemory::release(void* memory, uint8_t* external) noexcept {
+  delete[] external;
+  ::operator delete(memory);
+}
@@ -0,0 +1,184 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/Sink.h"
+
+#ifndef _WIN32
+
+#include <algorithm>
+#include <cerrno>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "velocypack/Exception.h"
+
+using namespace arangodb::velocypack;
+
+constexpr ValueLength FdSink::DefaultFlushThreshold;
+
+namespace {
+
+// write all iovecs to the file descriptor, retrying after partial writes
+// and interrupted system calls. waits for writability if the descriptor is
+// in non-blocking mode
+void writeVectored(int fd, struct iovec* iov, int count) {
+  while (count > 0) {
+    ssize_t written = ::writev(fd, iov, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLOUT;
+        pfd.revents = 0;
+        if (::poll(&pfd, 1, -1) >= 0 || errno == EINTR) {
+          continue;
+        }
+      }
+      throw Exception(Exception::InternalError,
+                      std::string("cannot write to file descriptor: ") +
+                          strerror(errno));
+    }
+
+    // skip all fully written iovecs and advance into a partially written one
+    size_t remain = static_cast<size_t>(written);
+    while (count > 0 && remain >= iov->iov_len) {
+      remain -= iov->iov_len;
+      ++iov;
+      --count;
+    }
+    if (count > 0) {
+      iov->iov_base = static_cast<char*>(iov->iov_base) + remain;
+      iov->iov_len -= remain;
+    }
+  }
+}
+
+}  // namespace
+
+FdSink::FdSink(int fd, ValueLength flushThreshold)
+    : _fd(fd),
+      _flushThreshold(flushThreshold > 0 ? flushThreshold : 1),
+      _size(0),
+      _flushed(0),
+      _buffer(new char[checkOverflow(_flushThreshold)]) {}
+
+FdSink::~FdSink() {
+  try {
+    flush();
+  } catch (...) {
+    // destructors must not throw
+  }
+}
+
+void FdSink::flush() {
+  if (_size == 0) {
+    return;
+  }
+  writeAll(nullptr, 0);
+}
+
+void FdSink::overwrite(ValueLength offset, char const* p, ValueLength len) {
+  VELOCYPACK_ASSERT(offset <= bytesWritten() && len <= offset);
+  if (offset <= _size) {
+    // still buffered
+    memcpy(_buffer.get() + (_size - offset), p, checkOverflow(len));
+    return;
+  }
+
+  // the part before the buffer has been handed to the kernel already.
+  // the file position is right after the flushed data
+  off_t const position = ::lseek(_fd, 0, SEEK_CUR);
+  if (position == static_cast<off_t>(-1)) {
+    throw Exception(Exception::InternalError,
+                    std::string("cannot overwrite data in file descriptor: ") +
+                        strerror(errno));
+  }
+  ValueLength const fromFile = (std::min)(len, offset - _size);
+  off_t target = position - static_cast<off_t>(offset - _size);
+  char const* q = p;
+  ValueLength remain = fromFile;
+  while (remain > 0) {
+    ssize_t written = ::pwrite(_fd, q, checkOverflow(remain), target);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw Exception(Exception::InternalError,
+                      std::string("cannot overwrite data in file descriptor: ") +
+                          strerror(errno));
+    }
+    q += written;
+    target += written;
+    remain -= static_cast<ValueLength>(written);
+  }
+  if (fromFile < len) {
+    memcpy(_buffer.get(), p + fromFile, checkOverflow(len - fromFile));
+  }
+}
+
+// called when the data does not fit into the remaining buffer space.
+// data smaller than the buffer is copied after flushing the buffer, so
+// it can be batched with subsequent appends. bigger chunks are handed
+// to the kernel directly together with the buffered data
+void FdSink::appendLarge(char const* p, ValueLength len) {
+  if (len < _flushThreshold) {
+    flush();
+    memcpy(_buffer.get(), p, checkOverflow(len));
+    _size = len;
+    return;
+  }
+  writeAll(p, len);
+}
+
+// write the buffered data plus the optional extra chunk in one go
+void FdSink::writeAll(char const* p, ValueLength len) {
+  struct iovec iov[2];
+  int count = 0;
+  if (_size > 0) {
+    iov[count].iov_base = _buffer.get();
+    iov[count].iov_len = checkOverflow(_size);
+    ++count;
+  }
+  if (len > 0) {
+    iov[count].iov_base = const_cast<char*>(p);
+    iov[count].iov_len = checkOverflow(len);
+    ++count;
+  }
+
+  ValueLength total = _size + len;
+  // reset the buffer first, so a failed write does not get retried
+  // from the destructor
+  _size = 0;
+  writeVectored(_fd, &iov[0], count);
+  _flushed += total;
+}
+
+#endif
@@ -31,6 +31,7 @@
 #include "velocypack/Builder.h"
 #include "velocypack/Dumper.h"
 #include "velocypack/HexDump.h"
+#include "velocypack/Instrumentation.h"
 #include "velocypack/Iterator.h"
 #include "velocypack/Parser.h"
 #include "velocypack/Slice.h"
@@ -148,8 +149,8 @@ ValueLength const SliceStaticData::FixedTypeLengths[256] = {
     /* 0xd2 */ 0,                    /* 0xd3 */ 0,        
     /* 0xd4 */ 0,                    /* 0xd5 */ 0,        
     /* 0xd6 */ 0,                    /* 0xd7 */ 0,        
-    /* 0xd8 */ 0,                    /* 0xd9 */ 0,       
-    /* 0xda */ 0,                    /* 0xdb */ 0,       
+    /* 0xd8 */ 2,                    /* 0xd9 */ 3,
+    /* 0xda */ 5,                    /* 0xdb */ 9,
     /* 0xdc */ 0,                    /* 0xdd */ 0,       
     /* 0xde */ 0,                    /* 0xdf */ 0,       
     /* 0xe0 */ 0,                    /* 0xe1 */ 0,       
@@ -180,8 +181,8 @@ VT const SliceStaticData::TypeMap[256] = {
     /* 0x0e */ VT::Object,   /* 0x0f */ VT::Object,
     /* 0x10 */ VT::Object,   /* 0x11 */ VT::Object,
     /* 0x12 */ VT::Object,   /* 0x13 */ VT::Array,
-    /* 0x14 */ VT::Object,   /* 0x15 */ VT::None,
-    /* 0x16 */ VT::None,     /* 0x17 */ VT::Illegal,
+    /* 0x14 */ VT::Object,   /* 0x15 */ VT::Array,
+    /* 0x16 */ VT::Object,   /* 0x17 */ VT::Illegal,
     /* 0x18 */ VT::Null,     /* 0x19 */ VT::Bool,
     /* 0x1a */ VT::Bool,     /* 0x1b */ VT::Double,
     /* 0x1c */ VT::UTCDate,  /* 0x1d */ VT::External,
@@ -278,13 +279,13 @@ VT const SliceStaticData::TypeMap[256] = {
     /* 0xd2 */ VT::BCD,      /* 0xd3 */ VT::BCD,
     /* 0xd4 */ VT::BCD,      /* 0xd5 */ VT::BCD,
     /* 0xd6 */ VT::BCD,      /* 0xd7 */ VT::BCD,
-    /* 0xd8 */ VT::None,     /* 0xd9 */ VT::None,
-    /* 0xda */ VT::None,     /* 0xdb */ VT::None,
+    /* 0xd8 */ VT::String,   /* 0xd9 */ VT::String,
+    /* 0xda */ VT::String,   /* 0xdb */ VT::String,
     /* 0xdc */ VT::None,     /* 0xdd */ VT::None,
     /* 0xde */ VT::None,     /* 0xdf */ VT::None,
-    /* 0xe0 */ VT::None,     /* 0xe1 */ VT::None,
-    /* 0xe2 */ VT::None,     /* 0xe3 */ VT::None,
-    /* 0xe4 */ VT::None,     /* 0xe5 */ VT::None,
+    /* 0xe0 */ VT::Array,    /* 0xe1 */ VT::Array,
+    /* 0xe2 */ VT::Array,    /* 0xe3 */ VT::Array,
+    /* 0xe4 */ VT::Array,    /* 0xe5 */ VT::None,
     /* 0xe6 */ VT::None,     /* 0xe7 */ VT::None,
     /* 0xe8 */ VT::None,     /* 0xe9 */ VT::None,
     /* 0xea */ VT::None,     /* 0xeb */ VT::None,
@@ -415,7 +416,36 @@ std::string Slice::toString(Options const* options) const {
 }
 
 std::string Slice::hexType() const { return HexDump::toHex(head()); }
-  
+
+// check if value contains a String reference to a String in front of base
+static bool HasReferenceBefore(Slice const& value, uint8_t const* base) {
+  if (value.isStringReference()) {
+    return value.resolveStringReference().start() < base;
+  }
+  if (value.isObject()) {
+    // attribute names are never references
+    ObjectIterator it(value, true);
+    while (it.valid()) {
+      if (HasReferenceBefore(it.value(), base)) {
+        return true;
+      }
+      it.next();
+    }
+  } else if (value.isArray() && !value.isPackedArray()) {
+    for (auto const& it : ArrayIterator(value)) {
+      if (HasReferenceBefore(it, base)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+bool Slice::isSelfContained() const {
+  // a row of a shaped Array refers to the shape in front of it
+  return head() != 0x16 && !HasReferenceBefore(*this, _start);
+}
+
 uint64_t Slice::normalizedHash(uint64_t seed) const {
   uint64_t value;
 
@@ -442,6 +472,10 @@ uint64_t Slice::normalizedHash(uint64_t seed) const {
       value ^= seed3;
       value ^= it.value.normalizedHash(seed3);
     }
+  } else if (isStringReference()) {
+    // hash the referenced String, so that both representations of
+    // a String produce the same hash value
+    value = resolveStringReference().hash(seed);
   } else {
     // fall back to regular hash function
     value = hash(seed);
@@ -468,6 +502,11 @@ Slice Slice::get(std::string const& attribute) const {
     return getFromCompactObject(attribute);
   }
 
+  if (h == 0x16) {
+    // row of a shaped Array
+    return getFromRow(attribute);
+  }
+
   ValueLength const offsetSize = indexEntrySize(h);
   VELOCYPACK_ASSERT(offsetSize > 0);
   ValueLength end = readIntegerNonEmpty<ValueLength>(_start + 1, offsetSize);
@@ -485,6 +524,7 @@ Slice Slice::get(std::string const& attribute) const {
 
   if (n == 1) {
     // Just one attribute, there is no index table!
+    VELOCYPACK_COUNT(LinearKeySearches, 1);
     Slice key = Slice(_start + findDataOffset(h));
 
     if (key.isString()) {
@@ -668,6 +708,7 @@ bool Slice::isEqualString(std::string const& attribute) const {
 }
 
 Slice Slice::getFromCompactObject(std::string const& attribute) const {
+  VELOCYPACK_COUNT(LinearKeySearches, 1);
   ObjectIterator it(*this);
   while (it.valid()) {
     Slice key = it.key(false);
@@ -681,14 +722,53 @@ Slice Slice::getFromCompactObject(std::string const& attribute) const {
   return Slice();
 }
 
+// look for the specified attribute inside a row of a shaped Array
+Slice Slice::getFromRow(std::string const& attribute) const {
+  // the shape is sorted by attribute name, so use a binary search to
+  // find the position of the attribute, then skip to its value
+  Slice const shape = getShape();
+  ValueLength l = 0;
+  ValueLength r = shape.length();
+  VELOCYPACK_COUNT(BinaryKeySearches, 1);
+
+  while (l < r) {
+    ValueLength const index = l + (r - l) / 2;
+    int const res = shape.at(index).compareString(attribute);
+    if (res == 0) {
+      return getNthValueFromRow(index);
+    }
+    if (res > 0) {
+      r = index;
+    } else {
+      l = index + 1;
+    }
+  }
+  // not found
+  return Slice();
+}
+
+// extract the nth value from a row of a shaped Array
+Slice Slice::getNthValueFromRow(ValueLength index) const {
+  if (index >= length()) {
+    throw Exception(Exception::IndexOutOfBounds);
+  }
+  uint8_t const* p = _start + 1;
+  p += getVariableValueLengthSize(p);  // byte length
+  p += getVariableValueLengthSize(p);  // distance to the shape
+  while (index-- > 0) {
+    p += Slice(p).byteSize();
+  }
+  return Slice(p);
+}
+
 // get the offset for the nth member from an Array or Object type
 ValueLength Slice::getNthOffset(ValueLength index) const {
   VELOCYPACK_ASSERT(isArray() || isObject());
 
   auto const h = head();
 
-  if (h == 0x13 || h == 0x14) {
-    // compact Array or Object
+  if (h == 0x13 || h == 0x14 || h == 0x15) {
+    // compact Array or Object, or shaped Array
     return getNthOffsetFromCompact(index);
   }
   
@@ -697,6 +777,11 @@ ValueLength Slice::getNthOffset(ValueLength index) const {
     throw Exception(Exception::IndexOutOfBounds);
   }
 
+  if (h >= 0xe0) {
+    throw Exception(Exception::InvalidValueType,
+                    "Members of packed Arrays have no VPack representation");
+  }
+
   ValueLength const offsetSize = indexEntrySize(h);
   ValueLength end = readIntegerNonEmpty<ValueLength>(_start + 1, offsetSize);
 
@@ -739,6 +824,39 @@ ValueLength Slice::getNthOffset(ValueLength index) const {
   return readIntegerNonEmpty<ValueLength>(_start + ieBase, offsetSize);
 }
 
+// convert the nth member of a packed Array into a regular VPack number
+Slice Slice::packedAt(ValueLength index, uint8_t* buffer) const {
+  if (!isPackedArray()) {
+    throw Exception(Exception::InvalidValueType, "Expecting packed Array");
+  }
+  if (isDeltaArray()) {
+    // decoded members are encoded like the members of packed Arrays
+    storeDeltaMember(buffer, DeltaSpan(_start).at(index));
+    return Slice(buffer);
+  }
+  uint8_t const* p = _start + 1;
+  ValueLength const n = readVariableValueLength<false>(p);
+  if (index >= n) {
+    throw Exception(Exception::IndexOutOfBounds);
+  }
+  p += getVariableValueLength(n);
+
+  // integers are encoded as a Builder would do, so that the members
+  // compare binary equal to the same numbers in regular Arrays
+  auto const h = head();
+  if (h == 0xe0) {
+    storePackedInt(buffer, PackedTraits<int32_t>::load(p + index * 4));
+  } else if (h == 0xe1) {
+    storePackedInt(buffer, PackedTraits<int64_t>::load(p + index * 8));
+  } else if (h == 0xe2) {
+    storePackedUInt(buffer, PackedTraits<uint64_t>::load(p + index * 8));
+  } else {
+    buffer[0] = 0x1b;
+    memcpy(buffer + 1, p + index * 8, 8);
+  }
+  return Slice(buffer);
+}
+
 // extract the nth member from an Array
 Slice Slice::getNth(ValueLength index) const {
   VELOCYPACK_ASSERT(isArray());
@@ -750,6 +868,11 @@ Slice Slice::getNth(ValueLength index) const {
 Slice Slice::getNthKey(ValueLength index, bool translate) const {
   VELOCYPACK_ASSERT(type() == ValueType::Object);
 
+  if (head() == 0x16) {
+    // the attribute names of rows of a shaped Array are stored in the shape
+    return getShape().at(index);
+  }
+
   Slice s(_start + getNthOffset(index));
 
   if (translate) {
@@ -783,7 +906,13 @@ ValueLength Slice::getNthOffsetFromCompact(ValueLength index) const {
   }
 
   auto const h = head();
-  ValueLength offset = 1 + getVariableValueLength(end);
+  // the byte length is not necessarily encoded in the minimal number of
+  // bytes, see StreamingBuilder
+  ValueLength offset = 1 + getVariableValueLengthSize(_start + 1);
+  if (h == 0x15) {
+    // skip over the shape of a shaped Array
+    offset += Slice(_start + offset).byteSize();
+  }
   ValueLength current = 0;
   while (current != index) {
     uint8_t const* s = _start + offset;
@@ -800,6 +929,7 @@ ValueLength Slice::getNthOffsetFromCompact(ValueLength index) const {
 Slice Slice::searchObjectKeyLinear(std::string const& attribute,
                                    ValueLength ieBase, ValueLength offsetSize,
                                    ValueLength n) const {
+  VELOCYPACK_COUNT(LinearKeySearches, 1);
   bool const useTranslator = (Options::Defaults.attributeTranslator != nullptr);
 
   for (ValueLength index = 0; index < n; ++index) {
@@ -837,6 +967,7 @@ template<ValueLength offsetSize>
 Slice Slice::searchObjectKeyBinary(std::string const& attribute,
                                    ValueLength ieBase,
                                    ValueLength n) const {
+  VELOCYPACK_COUNT(BinaryKeySearches, 1);
   bool const useTranslator = (Options::Defaults.attributeTranslator != nullptr);
   VELOCYPACK_ASSERT(n > 0);
 
@@ -0,0 +1,244 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/SlicePatcher.h"
+#include "velocypack/Exception.h"
+#include "velocypack/Iterator.h"
+
+using namespace arangodb::velocypack;
+
+// check if value contains a String reference
+static bool HasReferences(Slice const& value) {
+  if (value.isStringReference()) {
+    return true;
+  }
+  if (value.isObject()) {
+    ObjectIterator it(value, true);
+    while (it.valid()) {
+      if (HasReferences(it.value())) {
+        return true;
+      }
+      it.next();
+    }
+  } else if (value.isArray() && !value.isPackedArray()) {
+    ArrayIterator it(value);
+    while (it.valid()) {
+      if (HasReferences(it.value())) {
+        return true;
+      }
+      it.next();
+    }
+  }
+  return false;
+}
+
+// check if value contains a String reference outside of target to a
+// String inside of target
+static bool ReferencesInto(Slice const& value, Slice const& target) {
+  uint8_t const* begin = target.start();
+  uint8_t const* end = begin + target.byteSize();
+  if (value.start() >= begin && value.start() < end) {
+    // references inside target are replaced together with it
+    return false;
+  }
+  if (value.isStringReference()) {
+    uint8_t const* p = value.resolveStringReference().start();
+    return p >= begin && p < end;
+  }
+  if (value.isObject()) {
+    ObjectIterator it(value, true);
+    while (it.valid()) {
+      if (ReferencesInto(it.value(), target)) {
+        return true;
+      }
+      it.next();
+    }
+  } else if (value.isArray() && !value.isPackedArray()) {
+    ArrayIterator it(value);
+    while (it.valid()) {
+      if (ReferencesInto(it.value(), target)) {
+        return true;
+      }
+      it.next();
+    }
+  }
+  return false;
+}
+
+SlicePatcher::SlicePatcher(uint8_t* data, ValueLength size)
+    : _data(data), _size(size), _references(-1) {
+  if (data == nullptr || size == 0) {
+    throw Exception(Exception::InternalError, "data cannot be empty");
+  }
+}
+
+SlicePatcher::SlicePatcher(Builder& builder)
+    : SlicePatcher(builder.start(), builder.size()) {}
+
+bool SlicePatcher::patch(Slice const& target, Value const& value) {
+  uint8_t* p = mutableStart(target);
+  if (isReferenced(target)) {
+    return false;
+  }
+
+  Value::CType const type = value.cType();
+  if (type == Value::CType::Int64 && value.valueType() != ValueType::Double) {
+    return patchSigned(p, target.byteSize(), value.getInt64());
+  }
+  if (type == Value::CType::UInt64 && value.valueType() != ValueType::Double) {
+    return patchUnsigned(p, target.byteSize(), value.getUInt64());
+  }
+
+  _scratch.clear();
+  _scratch.add(value);
+  return replace(p, target.byteSize(), _scratch.slice());
+}
+
+bool SlicePatcher::patch(Slice const& target, Slice const& value) {
+  uint8_t* p = mutableStart(target);
+  if (isReferenced(target)) {
+    return false;
+  }
+  return replace(p, target.byteSize(), value.resolveStringReference());
+}
+
+bool SlicePatcher::replace(uint8_t* p, ValueLength size, Slice const& value) {
+  if (value.isInteger()) {
+    if (value.isUInt()) {
+      return patchUnsigned(p, size, value.getUInt());
+    }
+    return patchSigned(p, size, value.getInt());
+  }
+  if (value.byteSize() != size || !value.isSelfContained()) {
+    return false;
+  }
+  memmove(p, value.start(), checkOverflow(size));
+  if (_references == 0 && HasReferences(value)) {
+    _references = 1;
+  }
+  return true;
+}
+
+bool SlicePatcher::isReferenced(Slice const& target) {
+  if (!target.isString() && !target.isArray() && !target.isObject()) {
+    // only Strings can be referenced
+    return false;
+  }
+  if (target.isPackedArray()) {
+    return false;
+  }
+  if (_references == -1) {
+    _references = HasReferences(slice()) ? 1 : 0;
+  }
+  return _references == 1 && ReferencesInto(slice(), target);
+}
+
+bool SlicePatcher::patch(std::vector<std::string> const& path,
+                         Value const& value) {
+  Slice target = slice().get(path);
+  if (target.isNone()) {
+    return false;
+  }
+  return patch(target, value);
+}
+
+uint8_t* SlicePatcher::mutableStart(Slice const& target) const {
+  uint8_t const* start = target.start();
+  if (start < _data || start >= _data + _size ||
+      target.byteSize() > static_cast<ValueLength>(_data + _size - start)) {
+    throw Exception(Exception::IndexOutOfBounds,
+                    "Slice is not part of the patched data");
+  }
+  return _data + (start - _data);
+}
+
+bool SlicePatcher::patchSigned(uint8_t* p, ValueLength size, int64_t value) {
+  if (value >= 0) {
+    return patchUnsigned(p, size, static_cast<uint64_t>(value));
+  }
+  if (size == 1) {
+    if (value < -6) {
+      return false;
+    }
+    p[0] = static_cast<uint8_t>(0x40 + value);
+    return true;
+  }
+  if (size > 9) {
+    return false;
+  }
+
+  ValueLength const width = size - 1;
+  if (width < 8) {
+    int64_t const limit = -(static_cast<int64_t>(1) << (8 * width - 1));
+    if (value < limit) {
+      return false;
+    }
+  }
+  p[0] = static_cast<uint8_t>(0x1f + width);
+  uint64_t v = static_cast<uint64_t>(value);
+  for (ValueLength i = 1; i <= width; ++i) {
+    p[i] = static_cast<uint8_t>(v & 0xffU);
+    v >>= 8;
+  }
+  return true;
+}
+
+bool SlicePatcher::patchUnsigned(uint8_t* p, ValueLength size,
+                                 uint64_t value) {
+  if (size == 1) {
+    if (value > 9) {
+      return false;
+    }
+    p[0] = static_cast<uint8_t>(0x30 + value);
+    return true;
+  }
+  if (size > 9) {
+    return false;
+  }
+
+  ValueLength const width = size - 1;
+  if (width < 8 && value >= (static_cast<uint64_t>(1) << (8 * width))) {
+    return false;
+  }
+  // keep signed integers signed if the value allows it
+  bool const isSigned = (p[0] >= 0x20 && p[0] <= 0x27);
+  uint64_t const signedLimit = static_cast<uint64_t>(1) << (8 * width - 1);
+  if (isSigned && value < signedLimit) {
+    p[0] = static_cast<uint8_t>(0x1f + width);
+  } else {
+    p[0] = static_cast<uint8_t>(0x27 + width);
+  }
+  for (ValueLength i = 1; i <= width; ++i) {
+    p[i] = static_cast<uint8_t>(value & 0xffU);
+    value >>= 8;
+  }
+  return true;
+}
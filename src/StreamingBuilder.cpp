@@ -0,0 +1,269 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+
+#include "velocypack/velocypack-common.h"
+#include "velocypack/StreamingBuilder.h"
+#include "velocypack/Exception.h"
+
+using namespace arangodb::velocypack;
+
+constexpr ValueLength StreamingBuilder::DefaultChunkSize;
+
+namespace {
+
+// bytes reserved for the byte length of an Array or Object whose start
+// may be appended to the sink before it is closed. the length is then
+// stored as a non-minimal variable length integer of this size
+constexpr ValueLength ReservedLengthBytes = 8;
+
+}  // namespace
+
+StreamingBuilder::StreamingBuilder(Sink* sink, Options const* options,
+                                   ValueLength chunkSize)
+    : _sink(sink),
+      _chunkSize(chunkSize > 0 ? chunkSize : 1),
+      _flushed(0),
+      _scratch(options),
+      _done(false) {
+  if (sink == nullptr) {
+    throw Exception(Exception::InternalError, "Sink cannot be a nullptr");
+  }
+  if (options == nullptr) {
+    throw Exception(Exception::InternalError, "Options cannot be a nullptr");
+  }
+}
+
+StreamingBuilder& StreamingBuilder::add(Value const& value) {
+  ValueType const type = value.valueType();
+  if (type == ValueType::Array) {
+    return openCompound(true);
+  }
+  if (type == ValueType::Object) {
+    return openCompound(false);
+  }
+  _scratch.clear();
+  _scratch.add(value);
+  return add(_scratch.slice());
+}
+
+StreamingBuilder& StreamingBuilder::add(Slice const& value) {
+  if (!_stack.empty() && !_stack.back().isArray && !_stack.back().keyWritten) {
+    // a String added to an Object is the next attribute name
+    if (!value.isString()) {
+      throw Exception(Exception::BuilderKeyMustBeString);
+    }
+    ValueLength len;
+    char const* key = value.getString(len);
+    addKey(key, static_cast<size_t>(len));
+    return *this;
+  }
+
+  if (!value.isSelfContained()) {
+    // the scratch Builder resolves String references to data in front
+    // of the value
+    _scratch.clear();
+    _scratch.add(value);
+    return add(_scratch.slice());
+  }
+
+  beforeMember();
+  ValueLength const len = value.byteSize();
+  if (len >= _chunkSize) {
+    // hand big values to the sink directly instead of copying them
+    flush();
+    _sink->append(reinterpret_cast<char const*>(value.start()), len);
+    _flushed += len;
+  } else {
+    append(value.start(), len);
+  }
+  afterMember();
+  return *this;
+}
+
+StreamingBuilder& StreamingBuilder::close() {
+  if (_stack.empty()) {
+    throw Exception(Exception::BuilderNeedOpenCompound);
+  }
+  Level const level = _stack.back();
+  if (level.keyWritten) {
+    throw Exception(Exception::BuilderNeedSubvalue);
+  }
+  _stack.pop_back();
+
+  if (!level.headerWritten) {
+    // nothing was added, so this is an empty Array or Object
+    beforeMember();
+    uint8_t const head = level.isArray ? 0x01 : 0x0a;
+    append(&head, 1);
+    afterMember();
+    return *this;
+  }
+
+  // number of members, as a reversed variable length integer at the end
+  uint8_t buffer[10];
+  ValueLength const nLen = getVariableValueLength(level.count);
+  storeVariableValueLength<true>(buffer + nLen - 1, level.count);
+  append(buffer, nLen);
+
+  ValueLength const end = size();
+  if (level.start >= _flushed) {
+    // the whole value is still in the chunk. use the shortest encoding
+    // for the byte length and move the members to the front
+    uint8_t* start = _chunk.data() + (level.start - _flushed);
+    ValueLength const inner = end - level.start - 1 - ReservedLengthBytes;
+    ValueLength bLen = 1;
+    while (getVariableValueLength(1 + bLen + inner) != bLen) {
+      ++bLen;
+    }
+    memmove(start + 1 + bLen, start + 1 + ReservedLengthBytes,
+            checkOverflow(inner));
+    storeVariableValueLength<false>(start + 1, 1 + bLen + inner);
+    _chunk.resetTo(_chunk.size() - (ReservedLengthBytes - bLen));
+  } else {
+    ValueLength const byteSize = end - level.start;
+    if (byteSize >= (1ULL << (7 * ReservedLengthBytes))) {
+      throw Exception(Exception::NumberOutOfRange,
+                      "Array or Object too big for compact format");
+    }
+    for (ValueLength i = 0; i < ReservedLengthBytes; ++i) {
+      buffer[i] = static_cast<uint8_t>((byteSize >> (7 * i)) & 0x7fU);
+      if (i + 1 < ReservedLengthBytes) {
+        buffer[i] |= 0x80U;
+      }
+    }
+    patch(level.start + 1, buffer, ReservedLengthBytes);
+  }
+
+  afterMember();
+  return *this;
+}
+
+void StreamingBuilder::flush() {
+  if (_chunk.empty()) {
+    return;
+  }
+  _sink->append(reinterpret_cast<char const*>(_chunk.data()), _chunk.size());
+  _flushed += _chunk.size();
+  _chunk.reset();
+}
+
+StreamingBuilder& StreamingBuilder::openCompound(bool isArray) {
+  if (!_stack.empty() && !_stack.back().isArray && !_stack.back().keyWritten) {
+    throw Exception(Exception::BuilderKeyMustBeString);
+  }
+  if (_done) {
+    throw Exception(Exception::BuilderNeedOpenCompound);
+  }
+  // the head is written with the first member, so that empty values can
+  // still use their one byte encoding
+  _stack.push_back(Level{0, 0, isArray, false, false});
+  return *this;
+}
+
+void StreamingBuilder::addKey(char const* key, size_t length) {
+  if (_stack.empty() || _stack.back().isArray) {
+    throw Exception(Exception::BuilderNeedOpenObject);
+  }
+  if (_stack.back().keyWritten) {
+    throw Exception(Exception::BuilderKeyAlreadyWritten);
+  }
+  writeHeaders();
+
+  uint8_t head[9];
+  ValueLength headLen;
+  if (length <= 126) {
+    head[0] = static_cast<uint8_t>(0x40 + length);
+    headLen = 1;
+  } else {
+    head[0] = 0xbf;
+    ValueLength v = length;
+    for (size_t i = 1; i <= 8; ++i) {
+      head[i] = static_cast<uint8_t>(v & 0xff);
+      v >>= 8;
+    }
+    headLen = 9;
+  }
+  append(head, headLen);
+  append(reinterpret_cast<uint8_t const*>(key), length);
+  _stack.back().keyWritten = true;
+}
+
+void StreamingBuilder::writeHeaders() {
+  // heads are written in order, so the unwritten ones are at the end
+  size_t i = _stack.size();
+  while (i > 0 && !_stack[i - 1].headerWritten) {
+    --i;
+  }
+  for (; i < _stack.size(); ++i) {
+    Level& level = _stack[i];
+    level.start = size();
+    level.headerWritten = true;
+    uint8_t head[1 + ReservedLengthBytes] = {0};
+    head[0] = level.isArray ? 0x13 : 0x14;
+    append(head, sizeof(head));
+  }
+}
+
+void StreamingBuilder::beforeMember() {
+  if (_done) {
+    throw Exception(Exception::BuilderNeedOpenCompound);
+  }
+  writeHeaders();
+}
+
+void StreamingBuilder::afterMember() {
+  if (_stack.empty()) {
+    _done = true;
+  } else {
+    Level& level = _stack.back();
+    ++level.count;
+    level.keyWritten = false;
+  }
+  if (_chunk.size() >= _chunkSize) {
+    flush();
+  }
+}
+
+void StreamingBuilder::append(uint8_t const* p, ValueLength len) {
+  _chunk.append(p, len);
+}
+
+void StreamingBuilder::patch(ValueLength offset, uint8_t const* p,
+                             ValueLength len) {
+  if (offset < _flushed) {
+    ValueLength const n = (std::min)(len, _flushed - offset);
+    _sink->overwrite(_flushed - offset, reinterpret_cast<char const*>(p), n);
+    offset += n;
+    p += n;
+    len -= n;
+  }
+  if (len > 0) {
+    memcpy(_chunk.data() + (offset - _flushed), p, checkOverflow(len));
+  }
+}
@@ -24,6 +24,12 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Utf8Helper.h"
 
@@ -58,6 +64,30 @@ bool Utf8Helper::isValidUtf8(uint8_t const* p, ValueLength len) {
   
   uint8_t state = ValidChar;
   while (p < end) {
+    if (state == ValidChar) {
+      // fast path: skip over runs of ASCII characters, which are valid
+      // and do not change the state
+#if defined(__SSE2__)
+      while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+        if (_mm_movemask_epi8(block) != 0) {
+          break;
+        }
+        p += 16;
+      }
+#endif
+      while (end - p >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        if ((word & 0x8080808080808080ULL) != 0) {
+          break;
+        }
+        p += 8;
+      }
+      if (p == end) {
+        break;
+      }
+    }
     state = states[256 + state * 16 + states[*p]];
     if (state == InvalidChar) {
       return false;
@@ -24,6 +24,10 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 #include "velocypack/velocypack-common.h"
 #include "velocypack/Validator.h"
 #include "velocypack/Exception.h"
@@ -39,7 +43,7 @@ static ValueLength ReadVariableLengthValue(uint8_t const*& p, uint8_t const* end
   ValueLength shifter = 0;
   while (true) {
     uint8_t c = *p;
-    value += (c & 0x7fU) << shifter;
+    value += static_cast<ValueLength>(c & 0x7fU) << shifter;
     shifter += 7;
     if (reverse) {
       --p;
@@ -49,18 +53,244 @@ static ValueLength ReadVariableLengthValue(uint8_t const*& p, uint8_t const* end
     if (!(c & 0x80U)) {
       break;
     }
-    if (p == end) {
+    if (p == end || shifter > 63) {
       throw Exception(Exception::ValidatorInvalidLength, "Compound value length value is out of bounds");
     }
   }
   return value;
 }
 
-bool Validator::validate(uint8_t const* ptr, size_t length, bool isSubPart) const {
-  if (length == 0) {
-    throw Exception(Exception::ValidatorInvalidLength, "length 0 is invalid for any VelocyPack value");
+namespace {
+
+// a compound value whose members have not all been validated yet
+struct Frame {
+  uint8_t const* start;    // start of the compound value
+  uint8_t const* current;  // start of the next member, in data order
+  uint8_t const* end;      // end of the member area
+  uint8_t const* index;    // next index table entry, nullptr if no index
+  ValueLength remaining;   // number of members still to validate
+  ValueLength nrItems;     // total number of members
+  ValueLength itemSize;    // member size of Arrays without index table
+  size_t offsetsStart;     // position of this Object's entries in _offsets
+  uint8_t indexWidth;      // byte width of an index table entry
+  bool isObject;
+  bool equalSize;          // members must all have the same byte size
+  uint8_t const* shape;    // shape of a shaped Array, nullptr otherwise
+};
+
+// key string of an Object member, translated if necessary
+struct KeyRef {
+  char const* data;
+  ValueLength length;
+};
+
+static inline int CompareKeys(KeyRef const& lhs, KeyRef const& rhs) {
+  // same ordering as used by the Builder when sorting Object index tables
+  ValueLength const n = (std::min)(lhs.length, rhs.length);
+  int res = memcmp(lhs.data, rhs.data, checkOverflow(n));
+  if (res != 0) {
+    return res;
+  }
+  if (lhs.length == rhs.length) {
+    return 0;
+  }
+  return (lhs.length < rhs.length) ? -1 : 1;
+}
+
+static KeyRef ReadKey(uint8_t const* p) {
+  Slice key(p);
+  if (!key.isString()) {
+    key = key.makeKey();
+    if (!key.isString()) {
+      throw Exception(Exception::ValidatorInvalidLength, "Invalid object key type");
+    }
+  }
+  KeyRef result;
+  result.data = key.getString(result.length);
+  return result;
+}
+
+// state of a single validation. all compound values are tracked on an
+// explicit stack, and every byte of the input is looked at once
+class ValidationRun {
+ public:
+  ValidationRun(Options const* options, uint8_t const* base)
+      : _options(options), _base(base) {}
+
+  // validates the header of the value at ptr and returns its byte size.
+  // compound values are pushed onto the stack for validation of their members
+  ValueLength validateValue(uint8_t const* ptr, ValueLength length);
+
+  // validates the members of all compound values on the stack
+  void run();
+
+ private:
+  void push(Frame const& frame);
+  ValueLength validateIndexedHeader(uint8_t const* ptr, ValueLength length,
+                                    ValueLength width, char const* what,
+                                    ValueLength& nrItems,
+                                    ValueLength& dataOffset,
+                                    uint8_t const*& indexTable);
+  ValueLength validateShape(uint8_t const* ptr, ValueLength length);
+  ValueLength validateDeltaArray(uint8_t const* ptr, ValueLength length);
+  void finishObject(Frame const& frame);
+  void checkIndexTable(Frame const& frame);
+  void checkKeyOrder(Frame const& frame);
+  void checkUniqueness(Frame const& frame);
+
+  Options const* _options;
+  // start of the validated data. String references must not point
+  // in front of it
+  uint8_t const* _base;
+  // shape the next row to validate must refer to
+  uint8_t const* _rowShape = nullptr;
+  std::vector<Frame> _stack;
+  // data offsets of the members of all Objects on the stack
+  std::vector<ValueLength> _offsets;
+  std::vector<ValueLength> _entries;
+  std::vector<KeyRef> _keys;
+};
+
+void ValidationRun::push(Frame const& frame) {
+  if (_options->validatorMaxDepth != 0 &&
+      _stack.size() >= _options->validatorMaxDepth) {
+    throw Exception(Exception::ValidatorNestingTooDeep);
+  }
+  _stack.push_back(frame);
+}
+
+ValueLength ValidationRun::validateIndexedHeader(
+    uint8_t const* ptr, ValueLength length, ValueLength width,
+    char const* what, ValueLength& nrItems, ValueLength& dataOffset,
+    uint8_t const*& indexTable) {
+  if (1 + width + width + 1 > length) {
+    throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " length is out of bounds");
+  }
+  ValueLength const byteSize = readIntegerNonEmpty<ValueLength>(ptr + 1, width);
+  if (byteSize > length) {
+    throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " length is out of bounds");
+  }
+
+  ValueLength tail = 0;
+  if (width == 8) {
+    // nrItems is stored after the index table
+    dataOffset = 1 + width;
+    tail = width;
+    if (byteSize < dataOffset + tail) {
+      throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " length is out of bounds");
+    }
+    nrItems = readIntegerNonEmpty<ValueLength>(ptr + byteSize - width, width);
+  } else {
+    dataOffset = 1 + width + width;
+    if (byteSize < dataOffset) {
+      throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " length is out of bounds");
+    }
+    nrItems = readIntegerNonEmpty<ValueLength>(ptr + 1 + width, width);
+  }
+
+  if (nrItems == 0) {
+    throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " nrItems value is invalid");
+  }
+  // each member takes at least one byte plus its index table entry
+  if (nrItems > (byteSize - dataOffset - tail) / (width + 1)) {
+    throw Exception(Exception::ValidatorInvalidLength, std::string(what) + " index table is out of bounds");
+  }
+  indexTable = ptr + byteSize - tail - nrItems * width;
+  return byteSize;
+}
+
+ValueLength ValidationRun::validateShape(uint8_t const* ptr, ValueLength length) {
+  // the shape must be a non-empty Array of attribute names, sorted in
+  // the same order as the index tables of sorted Objects
+  ValidationRun shapeRun(_options, _base);
+  ValueLength const byteSize = shapeRun.validateValue(ptr, length);
+  shapeRun.run();
+
+  Slice const shape(ptr);
+  if (!shape.isArray() || shape.length() == 0) {
+    throw Exception(Exception::ValidatorInvalidType, "Invalid shape of shaped Array");
+  }
+  KeyRef previous{nullptr, 0};
+  ValueLength const n = shape.length();
+  for (ValueLength i = 0; i < n; ++i) {
+    Slice const key = shape.at(i);
+    if (!key.isString() || key.isStringReference()) {
+      throw Exception(Exception::ValidatorInvalidType, "Invalid attribute name in shape of shaped Array");
+    }
+    KeyRef current;
+    current.data = key.getString(current.length);
+    if (previous.data != nullptr) {
+      int const res = CompareKeys(previous, current);
+      if (res == 0) {
+        throw Exception(Exception::DuplicateAttributeName);
+      }
+      if (res > 0) {
+        throw Exception(Exception::ValidatorInvalidKeyOrder);
+      }
+    }
+    previous = current;
+  }
+  return byteSize;
+}
+
+ValueLength ValidationRun::validateDeltaArray(uint8_t const* ptr, ValueLength length) {
+  if (length < 3) {
+    throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+  }
+  uint8_t const* p = ptr + 1;
+  ValueLength const byteSize = ReadVariableLengthValue<false>(p, ptr + length);
+  if (byteSize > length || p >= ptr + byteSize) {
+    throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+  }
+  uint8_t const* end = ptr + byteSize;
+  ValueLength const nrItems = ReadVariableLengthValue<false>(p, end);
+  ValueLength const blockSize = DeltaSpan::blockSize;
+  ValueLength const nrBlocks = nrItems / blockSize + (nrItems % blockSize != 0 ? 1 : 0);
+  ValueLength const tableSize = (nrBlocks > 1 ? (nrBlocks - 1) * 4 : 0);
+  if (p > end || tableSize > static_cast<ValueLength>(end - p)) {
+    throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+  }
+
+  // blocks must follow each other without gaps, in the order of the
+  // offset table
+  uint8_t const* table = end - tableSize;
+  for (ValueLength block = 0; block < nrBlocks; ++block) {
+    if (block > 0 &&
+        readIntegerFixed<ValueLength, 4>(table + (block - 1) * 4) != static_cast<ValueLength>(p - ptr)) {
+      throw Exception(Exception::ValidatorInvalidLength, "Delta-encoded Array block offset is invalid");
+    }
+    ValueLength const members = (std::min)(blockSize, nrItems - block * blockSize);
+    if (p >= table) {
+      throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+    }
+    ReadVariableLengthValue<false>(p, table);
+    if (members == 1) {
+      continue;
+    }
+    if (p >= table) {
+      throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+    }
+    ReadVariableLengthValue<false>(p, table);
+    if (p >= table) {
+      throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+    }
+    uint8_t const width = *p++;
+    if (width != 0 && width != 1 && width != 2 && width != 4 && width != 8) {
+      throw Exception(Exception::ValidatorInvalidType, "Invalid width in delta-encoded Array");
+    }
+    if ((members - 1) * width > static_cast<ValueLength>(table - p)) {
+      throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+    }
+    p += (members - 1) * width;
+  }
+  if (p != table) {
+    throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
   }
+  return byteSize;
+}
 
+ValueLength ValidationRun::validateValue(uint8_t const* ptr, ValueLength length) {
+  VELOCYPACK_ASSERT(length > 0);
   uint8_t const head = *ptr;
 
   // type() only reads the first byte, which is safe
@@ -71,52 +301,259 @@ bool Validator::validate(uint8_t const* ptr, size_t length, bool isSubPart) cons
     throw Exception(Exception::ValidatorInvalidType);
   }
 
-  // special handling for certain types...
+  ValueLength byteSize = 0;
+
   switch (type) {
     case ValueType::None:
-    case ValueType::Null: 
-    case ValueType::Bool: 
-    case ValueType::MinKey: 
-    case ValueType::MaxKey:  
+    case ValueType::Null:
+    case ValueType::Bool:
+    case ValueType::MinKey:
+    case ValueType::MaxKey:
     case ValueType::SmallInt:
-    case ValueType::Int: 
-    case ValueType::UInt: 
-    case ValueType::Double: 
-    case ValueType::UTCDate: 
-    case ValueType::Binary:
+    case ValueType::Int:
+    case ValueType::UInt:
+    case ValueType::Double:
+    case ValueType::UTCDate:
     case ValueType::Illegal: {
+      // fixed size, determined by the head byte alone
+      byteSize = Slice(ptr).byteSize();
       break;
     }
-    
+
     case ValueType::String: {
       uint8_t const* p;
       ValueLength len;
-      if (head == 0xbfU) {
+      if (head >= 0xd8U && head <= 0xdbU) {
+        // reference to an earlier String. the referenced value must be
+        // a complete String located in front of the reference
+        ValueLength const n = 1ULL << (head - 0xd8U);
+        if (1 + n > length) {
+          throw Exception(Exception::ValidatorInvalidLength, "String reference is out of bounds");
+        }
+        ValueLength const distance = readIntegerNonEmpty<ValueLength>(ptr + 1, n);
+        if (distance == 0 || distance > static_cast<ValueLength>(ptr - _base)) {
+          throw Exception(Exception::ValidatorInvalidLength, "String reference target is out of bounds");
+        }
+        uint8_t const* target = ptr - distance;
+        uint8_t const h = *target;
+        if (h < 0x40U || h > 0xbfU) {
+          throw Exception(Exception::ValidatorInvalidType, "String reference target is not a String");
+        }
+        if (h == 0xbfU) {
+          if (1 + 8 > distance) {
+            throw Exception(Exception::ValidatorInvalidLength, "String reference target is out of bounds");
+          }
+          len = readIntegerFixed<ValueLength, 8>(target + 1);
+          if (len > distance - 1 - 8) {
+            throw Exception(Exception::ValidatorInvalidLength, "String reference target is out of bounds");
+          }
+          p = target + 1 + 8;
+        } else {
+          len = h - 0x40U;
+          if (1 + len > distance) {
+            throw Exception(Exception::ValidatorInvalidLength, "String reference target is out of bounds");
+          }
+          p = target + 1;
+        }
+        byteSize = 1 + n;
+      } else if (head == 0xbfU) {
         // long UTF-8 string. must be at least 9 bytes long so we
         // can read the entire string length safely
-        validateBufferLength(1 + 8, length, true);
+        if (1 + 8 > length) {
+          throw Exception(Exception::ValidatorInvalidLength, "String length is out of bounds");
+        }
         len = readIntegerFixed<ValueLength, 8>(ptr + 1);
+        if (len > length - 1 - 8) {
+          throw Exception(Exception::ValidatorInvalidLength, "String length is out of bounds");
+        }
         p = ptr + 1 + 8;
-        validateBufferLength(len + 1 + 8, length, true);
+        byteSize = 1 + 8 + len;
       } else {
         len = head - 0x40U;
         p = ptr + 1;
-        validateBufferLength(len + 1, length, true);
+        byteSize = 1 + len;
       }
 
-      if (options->validateUtf8Strings && !Utf8Helper::isValidUtf8(p, len)) {
+      if (_options->validateUtf8Strings && byteSize <= length &&
+          !Utf8Helper::isValidUtf8(p, len)) {
         throw Exception(Exception::InvalidUtf8Sequence);
       }
       break;
     }
 
+    case ValueType::Binary: {
+      ValueLength const n = head - 0xbfU;
+      if (1 + n > length) {
+        throw Exception(Exception::ValidatorInvalidLength, "Binary length is out of bounds");
+      }
+      ValueLength const len = readIntegerNonEmpty<ValueLength>(ptr + 1, n);
+      if (len > length - 1 - n) {
+        throw Exception(Exception::ValidatorInvalidLength, "Binary length is out of bounds");
+      }
+      byteSize = 1 + n + len;
+      break;
+    }
+
     case ValueType::Array: {
-      validateArray(ptr, length);
+      if (head == 0x01U) {
+        // empty array. always valid
+        byteSize = 1;
+      } else if (head == 0x13U) {
+        // compact Array without index table
+        if (length < 4) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        uint8_t const* p = ptr + 1;
+        byteSize = ReadVariableLengthValue<false>(p, ptr + length);
+        if (byteSize > length || byteSize < 4 || p >= ptr + byteSize - 1) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        uint8_t const* data = p;
+        p = ptr + byteSize - 1;
+        ValueLength const nrItems = ReadVariableLengthValue<true>(p, data - 1);
+        if (nrItems == 0) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        push(Frame{ptr, data, p + 1, nullptr, nrItems, nrItems, 0, 0, 0, false, false, nullptr});
+      } else if (head == 0x15U) {
+        // shaped Array: the shape is followed by the rows
+        if (length < 4) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        uint8_t const* p = ptr + 1;
+        byteSize = ReadVariableLengthValue<false>(p, ptr + length);
+        if (byteSize > length || byteSize < 4 || p >= ptr + byteSize - 1) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        uint8_t const* data = p;
+        p = ptr + byteSize - 1;
+        ValueLength const nrItems = ReadVariableLengthValue<true>(p, data - 1);
+        if (nrItems == 0) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        ValueLength const shapeSize = validateShape(data, p + 1 - data);
+        push(Frame{ptr, data + shapeSize, p + 1, nullptr, nrItems, nrItems, 0, 0, 0, false, false, data});
+      } else if (head == 0xe4U) {
+        // delta-encoded Array. as for packed Arrays, the members are plain
+        // numbers, so only the block structure needs to be checked
+        byteSize = validateDeltaArray(ptr, length);
+      } else if (head >= 0xe0U) {
+        // packed Array: number of members followed by the payload. the
+        // members are plain numbers, so any payload is valid
+        if (length < 2) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
+        }
+        uint8_t const* p = ptr + 1;
+        ValueLength const nrItems = ReadVariableLengthValue<false>(p, ptr + length);
+        ValueLength const headerSize = static_cast<ValueLength>(p - ptr);
+        ValueLength const width = (head == 0xe0U ? 4 : 8);
+        if (headerSize > length || nrItems > (length - headerSize) / width) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+        }
+        byteSize = headerSize + nrItems * width;
+      } else if (head <= 0x05U) {
+        // Array without index table, with 1-8 bytes lengths, all values with
+        // same length
+        ValueLength const width = 1ULL << (head - 0x02U);
+        if (1 + width + 1 > length) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+        }
+        byteSize = readIntegerNonEmpty<ValueLength>(ptr + 1, width);
+        if (byteSize > length) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+        }
+        // skip over padding
+        uint8_t const* p = ptr + 1 + width;
+        uint8_t const* e = (std::min)(ptr + 1 + 8, ptr + byteSize);
+        while (p < e && *p == 0x00U) {
+          ++p;
+        }
+        if (p >= ptr + byteSize) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array structure is invalid");
+        }
+        // the number of members is known once the first one is validated
+        push(Frame{ptr, p, ptr + byteSize, nullptr, 1, 0, 0, 0, 0, false, true, nullptr});
+      } else {
+        // Array with index table, with 1-8 bytes lengths
+        ValueLength const width = 1ULL << (head - 0x06U);
+        ValueLength nrItems, dataOffset;
+        uint8_t const* indexTable;
+        byteSize = validateIndexedHeader(ptr, length, width, "Array", nrItems,
+                                         dataOffset, indexTable);
+        // members are stored in index order, so the first entry tells
+        // where the data starts, and every further entry must point to
+        // the end of its predecessor
+        ValueLength const first = readIntegerNonEmpty<ValueLength>(indexTable, width);
+        if (first < dataOffset || first >= static_cast<ValueLength>(indexTable - ptr)) {
+          throw Exception(Exception::ValidatorInvalidLength, "Array index table entry is out of bounds");
+        }
+        push(Frame{ptr, ptr + first, indexTable, indexTable, nrItems, nrItems, 0,
+                   0, static_cast<uint8_t>(width), false, false, nullptr});
+      }
       break;
     }
-    
+
     case ValueType::Object: {
-      validateObject(ptr, length);
+      if (head == 0x0aU) {
+        // empty object. always valid
+        byteSize = 1;
+      } else if (head == 0x14U) {
+        // compact Object without index table
+        if (length < 5) {
+          throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+        }
+        uint8_t const* p = ptr + 1;
+        byteSize = ReadVariableLengthValue<false>(p, ptr + length);
+        if (byteSize > length || byteSize < 5 || p >= ptr + byteSize - 1) {
+          throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+        }
+        uint8_t const* data = p;
+        p = ptr + byteSize - 1;
+        ValueLength const nrItems = ReadVariableLengthValue<true>(p, data - 1);
+        if (nrItems == 0) {
+          throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+        }
+        push(Frame{ptr, data, p + 1, nullptr, nrItems, nrItems, 0,
+                   _offsets.size(), 0, true, false, nullptr});
+      } else if (head == 0x16U) {
+        // row of a shaped Array. its attribute names are stored in the
+        // shape of the Array, the row only contains the values
+        uint8_t const* shape = _rowShape;
+        _rowShape = nullptr;
+        if (shape == nullptr) {
+          throw Exception(Exception::ValidatorInvalidType, "Row of shaped Array found outside of shaped Array");
+        }
+        if (length < 3) {
+          throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+        }
+        uint8_t const* p = ptr + 1;
+        byteSize = ReadVariableLengthValue<false>(p, ptr + length);
+        if (byteSize > length || p >= ptr + byteSize) {
+          throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+        }
+        ValueLength const distance = ReadVariableLengthValue<false>(p, ptr + byteSize);
+        if (distance != static_cast<ValueLength>(ptr - shape)) {
+          throw Exception(Exception::ValidatorInvalidLength, "Row does not refer to the shape of its shaped Array");
+        }
+        ValueLength const nrItems = Slice(shape).length();
+        push(Frame{ptr, p, ptr + byteSize, nullptr, nrItems, nrItems, 0, 0, 0,
+                   false, false, nullptr});
+      } else {
+        // Object with index table, with 1-8 bytes lengths
+        ValueLength const width = 1ULL << ((head - 0x0bU) & 0x03U);
+        ValueLength nrItems, dataOffset;
+        uint8_t const* indexTable;
+        byteSize = validateIndexedHeader(ptr, length, width, "Object", nrItems,
+                                         dataOffset, indexTable);
+        // skip over padding. keys can never start with a 0x00 byte
+        uint8_t const* p = ptr + dataOffset;
+        uint8_t const* e = (std::min)(ptr + 1 + 8, indexTable);
+        while (p < e && *p == 0x00U) {
+          ++p;
+        }
+        push(Frame{ptr, p, indexTable, indexTable, nrItems, nrItems, 0,
+                   _offsets.size(), static_cast<uint8_t>(width), true, false, nullptr});
+      }
       break;
     }
 
@@ -126,364 +563,232 @@ bool Validator::validate(uint8_t const* ptr, size_t length, bool isSubPart) cons
 
     case ValueType::External: {
       // check if Externals are forbidden
-      if (options->disallowExternals) {
+      if (_options->disallowExternals) {
         throw Exception(Exception::BuilderExternalsDisallowed);
       }
-      // validate if Slice length exceeds the given buffer
-      validateBufferLength(1 + sizeof(void*), length, true);
       // do not perform pointer validation
+      byteSize = 1 + sizeof(void*);
       break;
     }
 
     case ValueType::Custom: {
-      ValueLength byteSize = 0;
-
-      if (head == 0xf0U) {
-        byteSize = 1 + 1;
-      } else if (head == 0xf1U) {
-        byteSize = 1 + 2;
-      } else if (head == 0xf2U) {
-        byteSize = 1 + 4;
-      } else if (head == 0xf3U) {
-        byteSize = 1 + 8;
-      } else if (head >= 0xf4U && head <= 0xf6U) {
-        validateBufferLength(1 + 1, length, true);
-        byteSize = 1 + 1 + readIntegerNonEmpty<ValueLength>(ptr + 1, 1);
-        if (byteSize == 1 + 1) {
-          throw Exception(Exception::ValidatorInvalidLength, "Invalid size for Custom type");
-        }
-      } else if (head >= 0xf7U && head <= 0xf9U) {
-        validateBufferLength(1 + 2, length, true);
-        byteSize = 1 + 2 + readIntegerNonEmpty<ValueLength>(ptr + 1, 2); 
-        if (byteSize == 1 + 2) {
-          throw Exception(Exception::ValidatorInvalidLength, "Invalid size for Custom type");
+      if (head <= 0xf3U) {
+        byteSize = 1 + (1ULL << (head - 0xf0U));
+      } else {
+        ValueLength width;
+        if (head <= 0xf6U) {
+          width = 1;
+        } else if (head <= 0xf9U) {
+          width = 2;
+        } else if (head <= 0xfcU) {
+          width = 4;
+        } else {
+          width = 8;
         }
-      } else if (head >= 0xfaU && head <= 0xfcU) {
-        validateBufferLength(1 + 4, length, true);
-        byteSize = 1 + 4 + readIntegerNonEmpty<ValueLength>(ptr + 1, 4); 
-        if (byteSize == 1 + 4) {
+        if (1 + width > length) {
           throw Exception(Exception::ValidatorInvalidLength, "Invalid size for Custom type");
         }
-      } else if (head >= 0xfdU) {
-        validateBufferLength(1 + 8, length, true);
-        byteSize = 1 + 8 + readIntegerNonEmpty<ValueLength>(ptr + 1, 8); 
-        if (byteSize == 1 + 8) {
+        ValueLength const len = readIntegerNonEmpty<ValueLength>(ptr + 1, width);
+        if (len == 0 || len > length - 1 - width) {
           throw Exception(Exception::ValidatorInvalidLength, "Invalid size for Custom type");
         }
+        byteSize = 1 + width + len;
       }
-  
-      validateSliceLength(ptr, byteSize, isSubPart);
       break;
     }
   }
-     
-  // common validation that must happen for all types 
-  validateSliceLength(ptr, length, isSubPart);
-  return true;
-}
 
-void Validator::validateArray(uint8_t const* ptr, size_t length) const {
-  uint8_t head = *ptr;
-
-  if (head == 0x13U) {
-    // compact array
-    validateCompactArray(ptr, length);
-  } else if (head >= 0x02U && head <= 0x05U) {
-    // array without index table
-    validateUnindexedArray(ptr, length);
-  } else if (head >= 0x06U && head <= 0x09U) {
-    // array with index table
-    validateIndexedArray(ptr, length);
-  } else if (head == 0x01U) {
-    // empty array. always valid
+  if (byteSize > length) {
+    throw Exception(Exception::ValidatorInvalidLength, "given buffer length is unequal to actual length of Slice in buffer");
   }
+  return byteSize;
 }
 
-void Validator::validateCompactArray(uint8_t const* ptr, size_t length) const {
-  // compact Array without index table
-  validateBufferLength(4, length, true);
+void ValidationRun::run() {
+  while (!_stack.empty()) {
+    size_t const depth = _stack.size() - 1;
+    Frame& frame = _stack.back();
+
+    if (frame.remaining == 0) {
+      // members of values without index table must end exactly at the
+      // end of the compound value
+      if (frame.index == nullptr && frame.current != frame.end) {
+        throw Exception(Exception::ValidatorInvalidLength,
+                        frame.isObject ? "Object members do not match Object length"
+                                       : "Array members do not match Array length");
+      }
+      if (frame.isObject) {
+        finishObject(frame);
+      }
+      _stack.pop_back();
+      continue;
+    }
+    --frame.remaining;
 
-  uint8_t const* p = ptr + 1;
-  // read byteLength
-  ValueLength const byteSize = ReadVariableLengthValue<false>(p, p + length);
-  if (byteSize > length || byteSize < 4) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
-  }
+    uint8_t const* p = frame.current;
+    if (p >= frame.end) {
+      throw Exception(Exception::ValidatorInvalidLength,
+                      frame.isObject ? "Object value is out of bounds"
+                                     : "Array value is out of bounds");
+    }
 
-  // read nrItems
-  uint8_t const* data = p;
-  p = ptr + byteSize - 1;
-  ValueLength nrItems = ReadVariableLengthValue<true>(p, ptr + byteSize);
-  if (nrItems == 0) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array length value is out of bounds");
-  }
-  ++p;
-  
-  // validate the array members 
-  uint8_t const* e = p;
-  p = data;
-  while (nrItems-- > 0) { 
-    validate(p, e - p, true);
-    p += Slice(p).byteSize();
-  }
-}
+    if (frame.isObject) {
+      // validate key
+      Slice key(p);
+      if (!key.isString() && !key.isInteger()) {
+        throw Exception(Exception::ValidatorInvalidLength, "Invalid object key type");
+      }
+      if (key.isStringReference()) {
+        throw Exception(Exception::ValidatorInvalidType, "String references cannot be used as object keys");
+      }
+      if (frame.index != nullptr || _options->checkAttributeUniqueness) {
+        _offsets.push_back(static_cast<ValueLength>(p - frame.start));
+      }
+      p += validateValue(p, frame.end - p);
+      if (p >= frame.end) {
+        throw Exception(Exception::ValidatorInvalidLength, "Object value is out of bounds");
+      }
+      frame.current = p;
+    } else if (frame.index != nullptr) {
+      // index table entries of Arrays must follow the data order
+      ValueLength const offset = readIntegerNonEmpty<ValueLength>(frame.index, frame.indexWidth);
+      if (offset != static_cast<ValueLength>(p - frame.start)) {
+        throw Exception(Exception::ValidatorInvalidLength, "Array index table entry is out of bounds");
+      }
+      frame.index += frame.indexWidth;
+    }
 
-void Validator::validateUnindexedArray(uint8_t const* ptr, size_t length) const {
-  // Array without index table, with 1-8 bytes lengths, all values with same length
-  uint8_t head = *ptr;
-  ValueLength const byteSizeLength = 1ULL << (static_cast<ValueLength>(head) - 0x02U);
-  validateBufferLength(1 + byteSizeLength + 1, length, true);
-  ValueLength const byteSize = readIntegerNonEmpty<ValueLength>(ptr + 1, byteSizeLength);
-  
-  if (byteSize > length) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
+    if (frame.shape != nullptr) {
+      // members of shaped Arrays must be rows referring to its shape
+      if (*p != 0x16U) {
+        throw Exception(Exception::ValidatorInvalidType, "Member of shaped Array is not a row");
+      }
+      _rowShape = frame.shape;
+    }
+
+    // validate the member. this may push a new frame and invalidate
+    // the frame reference
+    ValueLength const size = validateValue(p, frame.end - p);
+    Frame& f = _stack[depth];
+    if (f.equalSize) {
+      if (f.itemSize == 0) {
+        // first member of an Array without index table: all other
+        // members must have the same size
+        ValueLength const available = f.end - p;
+        if (available % size != 0) {
+          throw Exception(Exception::ValidatorInvalidLength, "Unexpected Array value length");
+        }
+        f.itemSize = size;
+        f.nrItems = available / size;
+        f.remaining = f.nrItems - 1;
+      } else if (size != f.itemSize) {
+        // got a sub-object with a different size. this is not allowed
+        throw Exception(Exception::ValidatorInvalidLength, "Unexpected Array value length");
+      }
+    }
+    f.current = p + size;
   }
+}
 
-  // look up first member
-  uint8_t const* p = ptr + 1 + byteSizeLength;
-  uint8_t const* e = ptr + 1 + byteSizeLength + (8 - byteSizeLength);
-  
-  if (e > ptr + byteSize) {
-    e = ptr + byteSize;
+void ValidationRun::finishObject(Frame const& frame) {
+  uint8_t const head = *frame.start;
+  if (frame.index != nullptr) {
+    checkIndexTable(frame);
   }
-  while (p < e && *p == '\x00') {
-    ++p;
+  bool const isSorted = (head >= 0x0bU && head <= 0x0eU);
+  if (isSorted && _options->validatorCheckKeyOrder) {
+    // also detects duplicates
+    checkKeyOrder(frame);
+  } else if (_options->checkAttributeUniqueness) {
+    checkUniqueness(frame);
   }
+  _offsets.resize(frame.offsetsStart);
+}
 
-  if (p >= ptr + byteSize) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array structure is invalid");
+void ValidationRun::checkIndexTable(Frame const& frame) {
+  // the index table must be a permutation of the members' offsets
+  ValueLength const* offsets = _offsets.data() + frame.offsetsStart;
+  ValueLength const n = frame.nrItems;
+  VELOCYPACK_ASSERT(_offsets.size() - frame.offsetsStart == n);
+
+  uint8_t const* index = frame.end;
+  ValueLength i = 0;
+  // fast path: index table in data order, e.g. for unsorted Objects
+  while (i < n && readIntegerNonEmpty<ValueLength>(index, frame.indexWidth) == offsets[i]) {
+    index += frame.indexWidth;
+    ++i;
   }
-  
-  validate(p, length - (p - ptr), true);
-  ValueLength itemSize = Slice(p).byteSize();
-  if (itemSize == 0) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array itemSize value is invalid");
+  if (i == n) {
+    return;
   }
-  ValueLength nrItems = (byteSize - (p - ptr)) / itemSize; 
 
-  if (nrItems == 0) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array nrItems value is invalid");
+  _entries.clear();
+  for (i = 0; i < n; ++i) {
+    _entries.push_back(readIntegerNonEmpty<ValueLength>(frame.end + i * frame.indexWidth, frame.indexWidth));
   }
-
-  e = ptr + length;
-  while (nrItems > 0) {
-    if (p >= e) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array value is out of bounds");
-    }
-    // validate sub value
-    validate(p, e - p, true);
-    if (Slice(p).byteSize() != itemSize) {
-      // got a sub-object with a different size. this is not allowed
-      throw Exception(Exception::ValidatorInvalidLength, "Unexpected Array value length");
-    }
-    p += itemSize;
-    --nrItems;
+  std::sort(_entries.begin(), _entries.end());
+  if (!std::equal(_entries.begin(), _entries.end(), offsets)) {
+    throw Exception(Exception::ValidatorInvalidLength, "Object index table entry is out of bounds");
   }
 }
 
-void Validator::validateIndexedArray(uint8_t const* ptr, size_t length) const {
-  // Array with index table, with 1-8 bytes lengths
-  uint8_t head = *ptr;
-  ValueLength const byteSizeLength = 1ULL << (static_cast<ValueLength>(head) - 0x06U);
-  validateBufferLength(1 + byteSizeLength + byteSizeLength + 1, length, true);
-  ValueLength byteSize = readIntegerNonEmpty<ValueLength>(ptr + 1, byteSizeLength);
-
-  if (byteSize > length) {
-    throw Exception(Exception::ValidatorInvalidLength, "Array length is out of bounds");
-  }
-
-  ValueLength nrItems;
-  ValueLength dataOffset;
-  uint8_t const* indexTable;
-
-  if (head == 0x09U) {
-    // byte length = 8
-    nrItems = readIntegerNonEmpty<ValueLength>(ptr + byteSize - byteSizeLength, byteSizeLength);
-    
-    if (nrItems == 0) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array nrItems value is invalid");
-    }
-
-    indexTable = ptr + byteSize - byteSizeLength - (nrItems * byteSizeLength);
-    if (indexTable < ptr + byteSizeLength) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array index table is out of bounds");
-    }
-    
-    dataOffset = 1 + byteSizeLength;
-  } else {
-    // byte length = 1, 2 or 4
-    nrItems = readIntegerNonEmpty<ValueLength>(ptr + 1 + byteSizeLength, byteSizeLength);
-    
-    if (nrItems == 0) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array nrItems value is invalid");
-    }
-    
-    // look up first member
-    uint8_t const* p = ptr + 1 + byteSizeLength + byteSizeLength;
-    uint8_t const* e = ptr + 1 + (8 - byteSizeLength - byteSizeLength);
-    if (e > ptr + byteSize) {
-      e = ptr + byteSize;
+void ValidationRun::checkKeyOrder(Frame const& frame) {
+  bool const checkUnique = _options->checkAttributeUniqueness;
+  uint8_t const* index = frame.end;
+  KeyRef previous = ReadKey(frame.start + readIntegerNonEmpty<ValueLength>(index, frame.indexWidth));
+  for (ValueLength i = 1; i < frame.nrItems; ++i) {
+    index += frame.indexWidth;
+    KeyRef current = ReadKey(frame.start + readIntegerNonEmpty<ValueLength>(index, frame.indexWidth));
+    int res = CompareKeys(previous, current);
+    if (res > 0) {
+      throw Exception(Exception::ValidatorInvalidKeyOrder);
     }
-    while (p < e && *p == '\x00') {
-      ++p;
-    }
-
-    indexTable = ptr + byteSize - (nrItems * byteSizeLength);
-    if (indexTable < ptr + byteSizeLength + byteSizeLength || indexTable < p) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array index table is out of bounds");
-    }
-    
-    dataOffset = 1 + byteSizeLength + byteSizeLength;
-  }
-
-  while (nrItems > 0) {
-    ValueLength const offset = readIntegerNonEmpty<ValueLength>(indexTable, byteSizeLength);
-    if (offset < dataOffset || offset >= static_cast<ValueLength>(indexTable - ptr)) {
-      throw Exception(Exception::ValidatorInvalidLength, "Array index table entry is out of bounds");
+    if (res == 0 && checkUnique) {
+      throw Exception(Exception::DuplicateAttributeName);
     }
-    validate(ptr + offset, length - offset, true);
-    indexTable += byteSizeLength; 
-    --nrItems;
+    previous = current;
   }
 }
 
-void Validator::validateObject(uint8_t const* ptr, size_t length) const {
-  uint8_t head = *ptr;
-
-  if (head == 0x14U) {
-    // compact object
-    validateCompactObject(ptr, length);
-  } else if (head >= 0x0bU && head <= 0x12U) {
-    // regular object
-    validateIndexedObject(ptr, length);
-  } else if (head == 0x0aU) {
-    // empty object. always valid
+void ValidationRun::checkUniqueness(Frame const& frame) {
+  ValueLength const n = frame.nrItems;
+  if (n < 2) {
+    return;
   }
-}
-
-void Validator::validateCompactObject(uint8_t const* ptr, size_t length) const {
-  // compact Object without index table
-  validateBufferLength(5, length, true);
+  ValueLength const* offsets = _offsets.data() + frame.offsetsStart;
 
-  uint8_t const* p = ptr + 1;
-  // read byteLength
-  ValueLength const byteSize = ReadVariableLengthValue<false>(p, p + length);
-  if (byteSize > length || byteSize < 5) {
-    throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
+  _keys.clear();
+  for (ValueLength i = 0; i < n; ++i) {
+    _keys.push_back(ReadKey(frame.start + offsets[i]));
   }
-
-  // read nrItems
-  uint8_t const* data = p;
-  p = ptr + byteSize - 1;
-  ValueLength nrItems = ReadVariableLengthValue<true>(p, ptr + byteSize);
-  if (nrItems == 0) {
-    throw Exception(Exception::ValidatorInvalidLength, "Object length value is out of bounds");
-  }
-  ++p;
-  
-  // validate the object members 
-  uint8_t const* e = p;
-  p = data;
-  while (nrItems-- > 0) {
-    // validate key 
-    validate(p, e - p, true);
-    Slice key(p);
-    if (!key.isString() && !key.isInteger()) {
-      throw Exception(Exception::ValidatorInvalidLength, "Invalid object key type");
+  std::sort(_keys.begin(), _keys.end(), [](KeyRef const& lhs, KeyRef const& rhs) {
+    return CompareKeys(lhs, rhs) < 0;
+  });
+  for (size_t i = 1; i < _keys.size(); ++i) {
+    if (CompareKeys(_keys[i - 1], _keys[i]) == 0) {
+      throw Exception(Exception::DuplicateAttributeName);
     }
-
-    // validate value
-    p += key.byteSize();
-    validate(p, e - p, true);
-    p += Slice(p).byteSize();
   }
 }
 
-void Validator::validateIndexedObject(uint8_t const* ptr, size_t length) const {
-  // Object with index table, with 1-8 bytes lengths
-  uint8_t head = *ptr;
-  ValueLength const byteSizeLength = 1ULL << (static_cast<ValueLength>(head) - 0x0bU);
-  validateBufferLength(1 + byteSizeLength + byteSizeLength + 1, length, true);
-  ValueLength const byteSize = readIntegerNonEmpty<ValueLength>(ptr + 1, byteSizeLength);
+}  // namespace
 
-  if (byteSize > length) {
-    throw Exception(Exception::ValidatorInvalidLength, "Object length is out of bounds");
+bool Validator::validate(uint8_t const* ptr, size_t length, bool isSubPart) const {
+  if (length == 0) {
+    throw Exception(Exception::ValidatorInvalidLength, "length 0 is invalid for any VelocyPack value");
   }
 
-  ValueLength nrItems;
-  ValueLength dataOffset;
-  uint8_t const* indexTable;
-
-  if (head == 0x12U) {
-    // byte length = 8
-    nrItems = readIntegerNonEmpty<ValueLength>(ptr + byteSize - byteSizeLength, byteSizeLength);
-    
-    if (nrItems == 0) {
-      throw Exception(Exception::ValidatorInvalidLength, "Object nrItems value is invalid");
-    }
-
-    indexTable = ptr + byteSize - byteSizeLength - (nrItems * byteSizeLength);
-    if (indexTable < ptr + byteSizeLength) {
-      throw Exception(Exception::ValidatorInvalidLength, "Object index table is out of bounds");
-    }
-    
-    dataOffset = 1 + byteSizeLength;
-  } else {
-    // byte length = 1, 2 or 4
-    nrItems = readIntegerNonEmpty<ValueLength>(ptr + 1 + byteSizeLength, byteSizeLength);
-    
-    if (nrItems == 0) {
-      throw Exception(Exception::ValidatorInvalidLength, "Object nrItems value is invalid");
-    }
-    
-    // look up first member
-    uint8_t const* p = ptr + 1 + byteSizeLength + byteSizeLength;
-    uint8_t const* e = ptr + 1 + (8 - byteSizeLength - byteSizeLength);
-    if (e > ptr + byteSize) {
-      e = ptr + byteSize;
-    }
-    while (p < e && *p == '\x00') {
-      ++p;
-    }
+  ValidationRun state(options, ptr);
+  ValueLength const byteSize = state.validateValue(ptr, length);
 
-    indexTable = ptr + byteSize - (nrItems * byteSizeLength);
-    if (indexTable < ptr + byteSizeLength + byteSizeLength || indexTable < p) {
-      throw Exception(Exception::ValidatorInvalidLength, "Object index table is out of bounds");
-    }
-    
-    dataOffset = 1 + byteSizeLength + byteSizeLength;
+  // common validation that must happen for all types
+  if (byteSize != length && !isSubPart) {
+    throw Exception(Exception::ValidatorInvalidLength, "given buffer length is unequal to actual length of Slice in buffer");
   }
-
-  while (nrItems > 0) {
-    ValueLength offset = readIntegerNonEmpty<ValueLength>(indexTable, byteSizeLength);
-    if (offset < dataOffset || offset >= static_cast<ValueLength>(indexTable - ptr)) {
-      throw Exception(Exception::ValidatorInvalidLength, "Object index table entry is out of bounds");
-    }
-    // validate key
-    validate(ptr + offset, length - offset, true);
-    Slice key(ptr + offset);
-    if (!key.isString() && !key.isInteger()) {
-      throw Exception(Exception::ValidatorInvalidLength, "Invalid object key type");
-    }
-    
-    // validate value
-    offset += key.byteSize();
-    validate(ptr + offset, length - offset, true);
-
-    indexTable += byteSizeLength; 
-    --nrItems;
+  if (options->validatorMaxSize != 0 && byteSize > options->validatorMaxSize) {
+    throw Exception(Exception::ValidatorInvalidLength, "Value exceeds the maximum allowed size");
   }
-}
 
-void Validator::validateBufferLength(size_t expected, size_t actual, bool isSubPart) const {
-  if ((expected > actual) ||
-      (expected != actual && !isSubPart)) {
-    throw Exception(Exception::ValidatorInvalidLength, "given buffer length is unequal to actual length of Slice in buffer");
-  }
-}
-        
-void Validator::validateSliceLength(uint8_t const* ptr, size_t length, bool isSubPart) const {
-  size_t actual = static_cast<size_t>(Slice(ptr).byteSize());
-  validateBufferLength(actual, length, isSubPart);
+  state.run();
+  return true;
 }
-
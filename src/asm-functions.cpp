@@ -24,27 +24,144 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <iostream>
+#include <limits>
 
 #include "velocypack/velocypack-common.h"
+#include "velocypack/DeltaArray.h"
+#include "velocypack/Instrumentation.h"
+#include "velocypack/PackedArray.h"
 #include "asm-functions.h"
 
 using namespace arangodb::velocypack;
 
 size_t JSONStringCopyC(uint8_t* dst, uint8_t const* src, size_t limit) {
+  VELOCYPACK_COUNT(ParserScalarCalls, 1);
   return JSONStringCopyInline(dst, src, limit);
 }
 
 size_t JSONStringCopyCheckUtf8C(uint8_t* dst, uint8_t const* src,
                                 size_t limit) {
+  VELOCYPACK_COUNT(ParserScalarCalls, 1);
   return JSONStringCopyCheckUtf8Inline(dst, src, limit);
 }
 
 size_t JSONSkipWhiteSpaceC(uint8_t const* ptr, size_t limit) {
+  VELOCYPACK_COUNT(ParserScalarCalls, 1);
   return JSONSkipWhiteSpaceInline(ptr, limit);
 }
 
+// scalar aggregation of integer members, also used for the remainders
+// of the vectorized versions
+template<typename T, typename S>
+static void PackedAggregateInline(uint8_t const* data, size_t n, S* sum,
+                                  T* min, T* max) {
+  S s = *sum;
+  T lo = *min;
+  T hi = *max;
+  for (size_t i = 0; i < n; ++i) {
+    T const v = PackedTraits<T>::load(data + i * sizeof(T));
+    // sum in unsigned arithmetic, so that overflow wraps around
+    s = static_cast<S>(static_cast<uint64_t>(s) + static_cast<uint64_t>(v));
+    if (v < lo) {
+      lo = v;
+    }
+    if (v > hi) {
+      hi = v;
+    }
+  }
+  *sum = s;
+  *min = lo;
+  *max = hi;
+}
+
+static void PackedAggregateDoubleInline(uint8_t const* data, size_t n,
+                                        size_t* count, double* sum,
+                                        double* min, double* max) {
+  size_t c = *count;
+  double s = *sum;
+  double lo = *min;
+  double hi = *max;
+  for (size_t i = 0; i < n; ++i) {
+    double const v = PackedTraits<double>::load(data + i * sizeof(double));
+    if (std::isnan(v)) {
+      continue;
+    }
+    ++c;
+    s += v;
+    if (v < lo) {
+      lo = v;
+    }
+    if (v > hi) {
+      hi = v;
+    }
+  }
+  *count = c;
+  *sum = s;
+  *min = lo;
+  *max = hi;
+}
+
+void PackedAggregateInt32C(uint8_t const* data, size_t n, int64_t* sum,
+                           int32_t* min, int32_t* max) {
+  VELOCYPACK_COUNT(PackedScalarCalls, 1);
+  *sum = 0;
+  *min = (std::numeric_limits<int32_t>::max)();
+  *max = (std::numeric_limits<int32_t>::min)();
+  PackedAggregateInline<int32_t>(data, n, sum, min, max);
+}
+
+void PackedAggregateInt64C(uint8_t const* data, size_t n, int64_t* sum,
+                           int64_t* min, int64_t* max) {
+  VELOCYPACK_COUNT(PackedScalarCalls, 1);
+  *sum = 0;
+  *min = (std::numeric_limits<int64_t>::max)();
+  *max = (std::numeric_limits<int64_t>::min)();
+  PackedAggregateInline<int64_t>(data, n, sum, min, max);
+}
+
+void PackedAggregateUInt64C(uint8_t const* data, size_t n, uint64_t* sum,
+                            uint64_t* min, uint64_t* max) {
+  VELOCYPACK_COUNT(PackedScalarCalls, 1);
+  *sum = 0;
+  *min = (std::numeric_limits<uint64_t>::max)();
+  *max = 0;
+  PackedAggregateInline<uint64_t>(data, n, sum, min, max);
+}
+
+void PackedAggregateDoubleC(uint8_t const* data, size_t n, size_t* count,
+                            double* sum, double* min, double* max) {
+  VELOCYPACK_COUNT(PackedScalarCalls, 1);
+  *count = 0;
+  *sum = 0.0;
+  *min = std::numeric_limits<double>::infinity();
+  *max = -std::numeric_limits<double>::infinity();
+  PackedAggregateDoubleInline(data, n, count, sum, min, max);
+}
+
+// scalar decoding of the members 1 to n - 1 of a delta-encoded Array
+// block, starting with the member in out[0]. also used for the
+// remainders of the vectorized version
+static void DeltaDecodeInline(uint8_t const* data, size_t n, uint8_t width,
+                              uint64_t step, uint64_t* out) {
+  uint64_t v = out[0];
+  for (size_t i = 1; i < n; ++i) {
+    v += step + DeltaSpan::readDelta(data, width);
+    data += width;
+    out[i] = v;
+  }
+}
+
+void DeltaDecodeBlockC(uint8_t const* data, size_t n, uint8_t width,
+                       uint64_t base, uint64_t step, uint64_t* out) {
+  VELOCYPACK_COUNT(DeltaScalarCalls, 1);
+  out[0] = base;
+  DeltaDecodeInline(data, n, width, step, out);
+}
+
 #if defined(__SSE4_2__) && ASM_OPTIMIZATIONS == 1
 
 #include <cpuid.h>
@@ -65,6 +182,7 @@ static bool HasSSE42() {
 
 static size_t JSONStringCopySSE42(uint8_t* dst, uint8_t const* src,
                                   size_t limit) {
+  VELOCYPACK_COUNT(ParserSimdCalls, 1);
   alignas(16) static char const ranges[17] =
       "\x20\x21\x23\x5b\x5d\xff          ";
   //= "\x01\x1f\"\"\\\\\"\"\"\"\"\"\"\"\"\"";
@@ -113,6 +231,7 @@ static size_t DoInitCopy(uint8_t* dst, uint8_t const* src, size_t limit) {
 
 static size_t JSONStringCopyCheckUtf8SSE42(uint8_t* dst, uint8_t const* src,
                                            size_t limit) {
+  VELOCYPACK_COUNT(ParserSimdCalls, 1);
   alignas(16) static unsigned char const ranges[17] =
       "\x20\x21\x23\x5b\x5d\x7f          ";
   //= "\x01\x1f\x80\xff\"\"\\\\\"\"\"\"\"\"\"\"";
@@ -161,6 +280,7 @@ static size_t DoInitCopyCheckUtf8(uint8_t* dst, uint8_t const* src,
 }
 
 static size_t JSONSkipWhiteSpaceSSE42(uint8_t const* ptr, size_t limit) {
+  VELOCYPACK_COUNT(ParserSimdCalls, 1);
   alignas(16) static char const white[17] = " \t\n\r            ";
   __m128i const w = _mm_load_si128(reinterpret_cast<__m128i const*>(white));
   size_t count = 0;
@@ -201,6 +321,251 @@ static size_t DoInitSkip(uint8_t const* ptr, size_t limit) {
   return (*JSONSkipWhiteSpace)(ptr, limit);
 }
 
+// the payload of packed Arrays is little endian, as x86 is. loads are
+// unaligned, since packed Arrays can start anywhere in a buffer
+
+static void PackedAggregateInt32SSE42(uint8_t const* data, size_t n,
+                                      int64_t* sum, int32_t* min,
+                                      int32_t* max) {
+  VELOCYPACK_COUNT(PackedSimdCalls, 1);
+  __m128i s = _mm_setzero_si128();
+  __m128i lo = _mm_set1_epi32((std::numeric_limits<int32_t>::max)());
+  __m128i hi = _mm_set1_epi32((std::numeric_limits<int32_t>::min)());
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    __m128i const v =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 4));
+    // widen to 64 bits, so that the sum cannot overflow
+    s = _mm_add_epi64(s, _mm_cvtepi32_epi64(v));
+    s = _mm_add_epi64(s, _mm_cvtepi32_epi64(_mm_srli_si128(v, 8)));
+    lo = _mm_min_epi32(lo, v);
+    hi = _mm_max_epi32(hi, v);
+  }
+  alignas(16) int64_t sums[2];
+  alignas(16) int32_t los[4];
+  alignas(16) int32_t his[4];
+  _mm_store_si128(reinterpret_cast<__m128i*>(sums), s);
+  _mm_store_si128(reinterpret_cast<__m128i*>(los), lo);
+  _mm_store_si128(reinterpret_cast<__m128i*>(his), hi);
+  *sum = sums[0] + sums[1];
+  *min = (std::min)((std::min)(los[0], los[1]), (std::min)(los[2], los[3]));
+  *max = (std::max)((std::max)(his[0], his[1]), (std::max)(his[2], his[3]));
+  PackedAggregateInline<int32_t>(data + i * 4, n - i, sum, min, max);
+}
+
+static void PackedAggregateInt64SSE42(uint8_t const* data, size_t n,
+                                      int64_t* sum, int64_t* min,
+                                      int64_t* max) {
+  VELOCYPACK_COUNT(PackedSimdCalls, 1);
+  __m128i s = _mm_setzero_si128();
+  __m128i lo = _mm_set1_epi64x((std::numeric_limits<int64_t>::max)());
+  __m128i hi = _mm_set1_epi64x((std::numeric_limits<int64_t>::min)());
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i const v =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 8));
+    s = _mm_add_epi64(s, v);
+    lo = _mm_blendv_epi8(lo, v, _mm_cmpgt_epi64(lo, v));
+    hi = _mm_blendv_epi8(hi, v, _mm_cmpgt_epi64(v, hi));
+  }
+  alignas(16) int64_t sums[2];
+  alignas(16) int64_t los[2];
+  alignas(16) int64_t his[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(sums), s);
+  _mm_store_si128(reinterpret_cast<__m128i*>(los), lo);
+  _mm_store_si128(reinterpret_cast<__m128i*>(his), hi);
+  *sum = static_cast<int64_t>(static_cast<uint64_t>(sums[0]) +
+                              static_cast<uint64_t>(sums[1]));
+  *min = (std::min)(los[0], los[1]);
+  *max = (std::max)(his[0], his[1]);
+  PackedAggregateInline<int64_t>(data + i * 8, n - i, sum, min, max);
+}
+
+static void PackedAggregateUInt64SSE42(uint8_t const* data, size_t n,
+                                       uint64_t* sum, uint64_t* min,
+                                       uint64_t* max) {
+  VELOCYPACK_COUNT(PackedSimdCalls, 1);
+  // there is no unsigned 64 bit comparison, so flip the sign bits and
+  // compare signed
+  __m128i const bias = _mm_set1_epi64x((std::numeric_limits<int64_t>::min)());
+  __m128i s = _mm_setzero_si128();
+  __m128i lo = _mm_set1_epi64x(-1);
+  __m128i hi = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128i const v =
+        _mm_loadu_si128(reinterpret_cast<__m128i const*>(data + i * 8));
+    __m128i const b = _mm_xor_si128(v, bias);
+    s = _mm_add_epi64(s, v);
+    lo = _mm_blendv_epi8(
+        lo, v, _mm_cmpgt_epi64(_mm_xor_si128(lo, bias), b));
+    hi = _mm_blendv_epi8(
+        hi, v, _mm_cmpgt_epi64(b, _mm_xor_si128(hi, bias)));
+  }
+  alignas(16) uint64_t sums[2];
+  alignas(16) uint64_t los[2];
+  alignas(16) uint64_t his[2];
+  _mm_store_si128(reinterpret_cast<__m128i*>(sums), s);
+  _mm_store_si128(reinterpret_cast<__m128i*>(los), lo);
+  _mm_store_si128(reinterpret_cast<__m128i*>(his), hi);
+  *sum = sums[0] + sums[1];
+  *min = (std::min)(los[0], los[1]);
+  *max = (std::max)(his[0], his[1]);
+  PackedAggregateInline<uint64_t>(data + i * 8, n - i, sum, min, max);
+}
+
+static void PackedAggregateDoubleSSE42(uint8_t const* data, size_t n,
+                                       size_t* count, double* sum,
+                                       double* min, double* max) {
+  VELOCYPACK_COUNT(PackedSimdCalls, 1);
+  __m128d s = _mm_setzero_pd();
+  __m128d lo = _mm_set1_pd(std::numeric_limits<double>::infinity());
+  __m128d hi = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+  __m128i c = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 2 <= n; i += 2) {
+    __m128d const v =
+        _mm_loadu_pd(reinterpret_cast<double const*>(data + i * 8));
+    // all bits set for values that are not NaN
+    __m128d const valid = _mm_cmpord_pd(v, v);
+    s = _mm_add_pd(s, _mm_and_pd(v, valid));
+    c = _mm_sub_epi64(c, _mm_castpd_si128(valid));
+    // minpd and maxpd return the second operand if one of them is NaN
+    lo = _mm_min_pd(v, lo);
+    hi = _mm_max_pd(v, hi);
+  }
+  alignas(16) double sums[2];
+  alignas(16) double los[2];
+  alignas(16) double his[2];
+  alignas(16) uint64_t counts[2];
+  _mm_store_pd(sums, s);
+  _mm_store_pd(los, lo);
+  _mm_store_pd(his, hi);
+  _mm_store_si128(reinterpret_cast<__m128i*>(counts), c);
+  *count = static_cast<size_t>(counts[0] + counts[1]);
+  *sum = sums[0] + sums[1];
+  *min = (std::min)(los[0], los[1]);
+  *max = (std::max)(his[0], his[1]);
+  PackedAggregateDoubleInline(data + i * 8, n - i, count, sum, min, max);
+}
+
+static void DoInitPackedInt32(uint8_t const* data, size_t n, int64_t* sum,
+                              int32_t* min, int32_t* max) {
+  if (assemblerFunctionsEnabled() && HasSSE42()) {
+    PackedAggregateInt32 = PackedAggregateInt32SSE42;
+  } else {
+    PackedAggregateInt32 = PackedAggregateInt32C;
+  }
+  (*PackedAggregateInt32)(data, n, sum, min, max);
+}
+
+static void DoInitPackedInt64(uint8_t const* data, size_t n, int64_t* sum,
+                              int64_t* min, int64_t* max) {
+  if (assemblerFunctionsEnabled() && HasSSE42()) {
+    PackedAggregateInt64 = PackedAggregateInt64SSE42;
+  } else {
+    PackedAggregateInt64 = PackedAggregateInt64C;
+  }
+  (*PackedAggregateInt64)(data, n, sum, min, max);
+}
+
+static void DoInitPackedUInt64(uint8_t const* data, size_t n, uint64_t* sum,
+                               uint64_t* min, uint64_t* max) {
+  if (assemblerFunctionsEnabled() && HasSSE42()) {
+    PackedAggregateUInt64 = PackedAggregateUInt64SSE42;
+  } else {
+    PackedAggregateUInt64 = PackedAggregateUInt64C;
+  }
+  (*PackedAggregateUInt64)(data, n, sum, min, max);
+}
+
+static void DoInitPackedDouble(uint8_t const* data, size_t n, size_t* count,
+                               double* sum, double* min, double* max) {
+  if (assemblerFunctionsEnabled() && HasSSE42()) {
+    PackedAggregateDouble = PackedAggregateDoubleSSE42;
+  } else {
+    PackedAggregateDouble = PackedAggregateDoubleC;
+  }
+  (*PackedAggregateDouble)(data, n, count, sum, min, max);
+}
+
+// loads the next two differences of a delta-encoded Array block with W
+// bytes each, zero-extended to 64 bits
+template<int W>
+static inline __m128i DeltaLoad2(uint8_t const* p) {
+  switch (W) {
+    case 0:
+      return _mm_setzero_si128();
+    case 1: {
+      uint16_t v;
+      memcpy(&v, p, sizeof(v));
+      return _mm_cvtepu8_epi64(_mm_cvtsi32_si128(v));
+    }
+    case 2: {
+      uint32_t v;
+      memcpy(&v, p, sizeof(v));
+      return _mm_cvtepu16_epi64(_mm_cvtsi32_si128(static_cast<int>(v)));
+    }
+    case 4:
+      return _mm_cvtepu32_epi64(
+          _mm_loadl_epi64(reinterpret_cast<__m128i const*>(p)));
+    default:
+      return _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+  }
+}
+
+// decodes two members per step: the differences plus the step are
+// summed up within the register, then the previous member is added
+template<int W>
+static void DeltaDecodeSSE42Inline(uint8_t const* data, size_t n,
+                                   uint64_t step, uint64_t* out) {
+  __m128i const steps = _mm_set1_epi64x(static_cast<long long>(step));
+  __m128i previous = _mm_set1_epi64x(static_cast<long long>(out[0]));
+  size_t i = 1;
+  for (; i + 2 <= n; i += 2) {
+    __m128i d = _mm_add_epi64(DeltaLoad2<W>(data + (i - 1) * W), steps);
+    d = _mm_add_epi64(d, _mm_slli_si128(d, 8));
+    __m128i const v = _mm_add_epi64(d, previous);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+    previous = _mm_unpackhi_epi64(v, v);
+  }
+  DeltaDecodeInline(data + (i - 1) * W, n - i + 1, W, step, out + i - 1);
+}
+
+static void DeltaDecodeBlockSSE42(uint8_t const* data, size_t n,
+                                  uint8_t width, uint64_t base, uint64_t step,
+                                  uint64_t* out) {
+  VELOCYPACK_COUNT(DeltaSimdCalls, 1);
+  out[0] = base;
+  switch (width) {
+    case 0:
+      DeltaDecodeSSE42Inline<0>(data, n, step, out);
+      break;
+    case 1:
+      DeltaDecodeSSE42Inline<1>(data, n, step, out);
+      break;
+    case 2:
+      DeltaDecodeSSE42Inline<2>(data, n, step, out);
+      break;
+    case 4:
+      DeltaDecodeSSE42Inline<4>(data, n, step, out);
+      break;
+    default:
+      DeltaDecodeSSE42Inline<8>(data, n, step, out);
+      break;
+  }
+}
+
+static void DoInitDeltaDecode(uint8_t const* data, size_t n, uint8_t width,
+                              uint64_t base, uint64_t step, uint64_t* out) {
+  if (assemblerFunctionsEnabled() && HasSSE42()) {
+    DeltaDecodeBlock = DeltaDecodeBlockSSE42;
+  } else {
+    DeltaDecodeBlock = DeltaDecodeBlockC;
+  }
+  (*DeltaDecodeBlock)(data, n, width, base, step, out);
+}
+
 #else
 
 static size_t DoInitCopy(uint8_t* dst, uint8_t const* src, size_t limit) {
@@ -219,12 +584,52 @@ static size_t DoInitSkip(uint8_t const* ptr, size_t limit) {
   return JSONSkipWhiteSpace(ptr, limit);
 }
 
+static void DoInitPackedInt32(uint8_t const* data, size_t n, int64_t* sum,
+                              int32_t* min, int32_t* max) {
+  PackedAggregateInt32 = PackedAggregateInt32C;
+  PackedAggregateInt32C(data, n, sum, min, max);
+}
+
+static void DoInitPackedInt64(uint8_t const* data, size_t n, int64_t* sum,
+                              int64_t* min, int64_t* max) {
+  PackedAggregateInt64 = PackedAggregateInt64C;
+  PackedAggregateInt64C(data, n, sum, min, max);
+}
+
+static void DoInitPackedUInt64(uint8_t const* data, size_t n, uint64_t* sum,
+                               uint64_t* min, uint64_t* max) {
+  PackedAggregateUInt64 = PackedAggregateUInt64C;
+  PackedAggregateUInt64C(data, n, sum, min, max);
+}
+
+static void DoInitPackedDouble(uint8_t const* data, size_t n, size_t* count,
+                               double* sum, double* min, double* max) {
+  PackedAggregateDouble = PackedAggregateDoubleC;
+  PackedAggregateDoubleC(data, n, count, sum, min, max);
+}
+
+static void DoInitDeltaDecode(uint8_t const* data, size_t n, uint8_t width,
+                              uint64_t base, uint64_t step, uint64_t* out) {
+  DeltaDecodeBlock = DeltaDecodeBlockC;
+  DeltaDecodeBlockC(data, n, width, base, step, out);
+}
+
 #endif
 
 size_t (*JSONStringCopy)(uint8_t*, uint8_t const*, size_t) = DoInitCopy;
 size_t (*JSONStringCopyCheckUtf8)(uint8_t*, uint8_t const*,
                                   size_t) = DoInitCopyCheckUtf8;
 size_t (*JSONSkipWhiteSpace)(uint8_t const*, size_t) = DoInitSkip;
+void (*PackedAggregateInt32)(uint8_t const*, size_t, int64_t*, int32_t*,
+                             int32_t*) = DoInitPackedInt32;
+void (*PackedAggregateInt64)(uint8_t const*, size_t, int64_t*, int64_t*,
+                             int64_t*) = DoInitPackedInt64;
+void (*PackedAggregateUInt64)(uint8_t const*, size_t, uint64_t*, uint64_t*,
+                              uint64_t*) = DoInitPackedUInt64;
+void (*PackedAggregateDouble)(uint8_t const*, size_t, size_t*, double*,
+                              double*, double*) = DoInitPackedDouble;
+void (*DeltaDecodeBlock)(uint8_t const*, size_t, uint8_t, uint64_t, uint64_t,
+                         uint64_t*) = DoInitDeltaDecode;
 
 #if defined(COMPILE_VELOCYPACK_ASM_UNITTESTS)
 
@@ -87,4 +87,38 @@ static inline size_t JSONSkipWhiteSpaceInline(uint8_t const* ptr,
 size_t JSONSkipWhiteSpaceC(uint8_t const* ptr, size_t limit);
 extern size_t (*JSONSkipWhiteSpace)(uint8_t const*, size_t);
 
+// Aggregation of the little endian payload of packed Arrays. n must be
+// greater than 0. The double version skips NaN values and reports the
+// number of values aggregated in count:
+
+void PackedAggregateInt32C(uint8_t const* data, size_t n, int64_t* sum,
+                           int32_t* min, int32_t* max);
+extern void (*PackedAggregateInt32)(uint8_t const*, size_t, int64_t*,
+                                    int32_t*, int32_t*);
+
+void PackedAggregateInt64C(uint8_t const* data, size_t n, int64_t* sum,
+                           int64_t* min, int64_t* max);
+extern void (*PackedAggregateInt64)(uint8_t const*, size_t, int64_t*,
+                                    int64_t*, int64_t*);
+
+void PackedAggregateUInt64C(uint8_t const* data, size_t n, uint64_t* sum,
+                            uint64_t* min, uint64_t* max);
+extern void (*PackedAggregateUInt64)(uint8_t const*, size_t, uint64_t*,
+                                     uint64_t*, uint64_t*);
+
+void PackedAggregateDoubleC(uint8_t const* data, size_t n, size_t* count,
+                            double* sum, double* min, double* max);
+extern void (*PackedAggregateDouble)(uint8_t const*, size_t, size_t*,
+                                     double*, double*, double*);
+
+// Decoding of a block of a delta-encoded Array with n members, n must be
+// greater than 0. out[0] is set to base, every following member is the
+// previous one plus step plus the next difference of the given byte
+// width from data. All arithmetic wraps around:
+
+void DeltaDecodeBlockC(uint8_t const* data, size_t n, uint8_t width,
+                       uint64_t base, uint64_t step, uint64_t* out);
+extern void (*DeltaDecodeBlock)(uint8_t const*, size_t, uint8_t, uint64_t,
+                                uint64_t, uint64_t*);
+
 #endif
@@ -4,17 +4,28 @@
 #include "velocypack/Basics.h"
 #include "velocypack/Buffer.h"
 #include "velocypack/Builder.h"
+#include "velocypack/Cbor.h"
 #include "velocypack/Collection.h"
+#include "velocypack/DeltaArray.h"
 #include "velocypack/Dumper.h"
 #include "velocypack/Exception.h"
+#include "velocypack/Executor.h"
+#include "velocypack/FramedFile.h"
 #include "velocypack/Helpers.h"
 #include "velocypack/HexDump.h"
+#include "velocypack/Instrumentation.h"
 #include "velocypack/Iterator.h"
+#include "velocypack/MsgPack.h"
 #include "velocypack/Options.h"
+#include "velocypack/OverlaySlice.h"
+#include "velocypack/PackedArray.h"
 #include "velocypack/Parser.h"
+#include "velocypack/SharedSlice.h"
 #include "velocypack/Sink.h"
 #include "velocypack/Slice.h"
 #include "velocypack/SliceContainer.h"
+#include "velocypack/SlicePatcher.h"
+#include "velocypack/StreamingBuilder.h"
 #include "velocypack/Validator.h"
 #include "velocypack/Value.h"
 #include "velocypack/ValueType.h"
@@ -58,6 +69,15 @@ static void checkDump(Slice s, std::string const& knownGood) {
   ASSERT_EQ(knownGood, buffer);
 }
 
+// don't complain if this function is not called
+static bool isValid(Slice) VELOCYPACK_UNUSED;
+
+// checks a VPack value with a Validator using the default Options
+static bool isValid(Slice s) {
+  Validator validator;
+  return validator.validate(s.start(), s.byteSize());
+}
+
 // don't complain if this function is not called
 static void checkBuild(Slice, ValueType, ValueLength) VELOCYPACK_UNUSED;
 
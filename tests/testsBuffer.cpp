@@ -466,6 +466,28 @@ TEST(BufferTest, ResetToTest) {
   ASSERT_EQ(std::string("f"), std::string(reinterpret_cast<char const*>(buffer.data()), buffer.size()));
 }
 
+TEST(BufferTest, StealTest) {
+  Buffer<uint8_t> buffer;
+  buffer.append("foobar");
+  uint8_t* data = buffer.steal();
+  ASSERT_EQ(std::string("foobar"), std::string(reinterpret_cast<char const*>(data), 6));
+  ASSERT_TRUE(buffer.empty());
+  delete[] data;
+
+  std::string large(1000, 'x');
+  buffer.append(large);
+  uint8_t const* start = buffer.data();
+  data = buffer.steal();
+  ASSERT_EQ(start, data);
+  ASSERT_EQ(large, std::string(reinterpret_cast<char const*>(data), large.size()));
+  ASSERT_TRUE(buffer.empty());
+  ASSERT_NE(start, buffer.data());
+  delete[] data;
+
+  buffer.append("baz");
+  ASSERT_EQ(std::string("baz"), buffer.toString());
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -0,0 +1,251 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+
+#include "tests-common.h"
+
+static std::string fromHex(char const* hex) {
+  std::string result;
+  while (*hex != '\0' && *(hex + 1) != '\0') {
+    if (*hex == ' ') {
+      ++hex;
+      continue;
+    }
+    result.push_back(static_cast<char>(std::stoi(std::string(hex, 2), nullptr, 16)));
+    hex += 2;
+  }
+  return result;
+}
+
+TEST(CborTest, CreateWithoutOptions) {
+  ASSERT_VELOCYPACK_EXCEPTION(new CborParser(nullptr),
+                              Exception::InternalError);
+
+  std::string result;
+  StringSink sink(&result);
+  ASSERT_VELOCYPACK_EXCEPTION(new CborDumper(&sink, nullptr),
+                              Exception::InternalError);
+  ASSERT_VELOCYPACK_EXCEPTION(new CborDumper(nullptr),
+                              Exception::InternalError);
+}
+
+TEST(CborTest, DumpScalars) {
+  Builder b;
+  b.openArray();
+  b.add(Value(ValueType::Null));
+  b.add(Value(false));
+  b.add(Value(true));
+  b.add(Value(10));
+  b.add(Value(23));
+  b.add(Value(24));
+  b.add(Value(1000));
+  b.add(Value(1000000));
+  b.add(Value(uint64_t(1000000000000ULL)));
+  b.add(Value(-1));
+  b.add(Value(-1000));
+  b.add(Value(1.1));
+  b.add(Value("IETF"));
+  b.close();
+
+  std::string expected = fromHex(
+      "8d f6 f4 f5 0a 17 18 18 19 03 e8 1a 00 0f 42 40"
+      "1b 00 00 00 e8 d4 a5 10 00 20 39 03 e7"
+      "fb 3f f1 99 99 99 99 99 9a 64 49 45 54 46");
+  ASSERT_EQ(expected, CborDumper::toString(b.slice()));
+}
+
+TEST(CborTest, ParseScalars) {
+  // examples from RFC 7049, appendix A
+  struct {
+    char const* hex;
+    char const* json;
+  } const tests[] = {
+      {"00", "0"},
+      {"17", "23"},
+      {"18 64", "100"},
+      {"1b 00 00 00 e8 d4 a5 10 00", "1000000000000"},
+      {"1b ff ff ff ff ff ff ff ff", "18446744073709551615"},
+      {"20", "-1"},
+      {"38 63", "-100"},
+      {"39 03 e7", "-1000"},
+      {"f9 00 00", "0"},
+      {"f9 3c 00", "1"},
+      {"f9 3e 00", "1.5"},
+      {"f9 c4 00", "-4"},
+      {"f9 00 01", "5.960464477539063e-8"},
+      {"fa 47 c3 50 00", "100000"},
+      {"fb 3f f1 99 99 99 99 99 9a", "1.1"},
+      {"f4", "false"},
+      {"f5", "true"},
+      {"f6", "null"},
+      {"f7", "null"},
+      {"f0", "null"},
+      {"f8 ff", "null"},
+      {"c2 49 01 00 00 00 00 00 00 00 00", "18446744073709551616"},
+      {"c2 48 ff ff ff ff ff ff ff ff", "18446744073709551615"},
+      {"c3 41 63", "-100"},
+      {"d8 20 76 68 74 74 70 3a 2f 2f 77 77 77 2e 65 78 61 6d 70 6c 65 2e 63 6f 6d",
+       "\"http://www.example.com\""},
+      {"60", "\"\""},
+      {"64 49 45 54 46", "\"IETF\""},
+      {"80", "[]"},
+      {"83 01 02 03", "[1,2,3]"},
+      {"83 01 82 02 03 82 04 05", "[1,[2,3],[4,5]]"},
+      {"a0", "{}"},
+      {"a2 01 02 03 04", "{\"1\":2,\"3\":4}"},
+      {"a2 61 61 01 61 62 82 02 03", "{\"a\":1,\"b\":[2,3]}"},
+      {"7f 65 73 74 72 65 61 64 6d 69 6e 67 ff", "\"streaming\""},
+      {"9f ff", "[]"},
+      {"9f 01 82 02 03 9f 04 05 ff ff", "[1,[2,3],[4,5]]"},
+      {"bf 61 61 01 61 62 9f 02 03 ff ff", "{\"a\":1,\"b\":[2,3]}"},
+  };
+
+  for (auto const& test : tests) {
+    std::string data = fromHex(test.hex);
+    if (std::string(test.json) == "18446744073709551616") {
+      ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(data),
+                                  Exception::NumberOutOfRange);
+      continue;
+    }
+    std::shared_ptr<Builder> b = CborParser::fromCbor(data);
+    ASSERT_EQ(std::string(test.json), b->slice().toJson()) << test.hex;
+  }
+}
+
+TEST(CborTest, IndefiniteBinary) {
+  std::string data = fromHex("5f 42 01 02 43 03 04 05 ff");
+  std::shared_ptr<Builder> b = CborParser::fromCbor(data);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.isBinary());
+  std::vector<uint8_t> binary = s.copyBinary();
+  ASSERT_EQ(std::vector<uint8_t>({1, 2, 3, 4, 5}), binary);
+
+  ASSERT_EQ(fromHex("45 01 02 03 04 05"), CborDumper::toString(s));
+}
+
+TEST(CborTest, RoundTripJson) {
+  std::vector<std::string> values = {
+      "null", "true", "false", "0", "-1", "23", "24", "-24", "-25",
+      "255", "256", "65535", "65536", "4294967295", "4294967296",
+      "18446744073709551615", "-9223372036854775808", "1.25",
+      "-1.0e100", "\"\"", "\"foo\"", "[]", "{}", "[1,2,3]",
+      "{\"a\":1,\"b\":[true,{\"c\":\"d\"}]}"};
+
+  for (auto const& value : values) {
+    Options options;
+    std::shared_ptr<Builder> b = Parser::fromJson(value, &options);
+    std::string cbor = CborDumper::toString(b->slice(), &options);
+    std::shared_ptr<Builder> b2 = CborParser::fromCbor(cbor, &options);
+    ASSERT_EQ(b->slice().toJson(), b2->slice().toJson());
+  }
+}
+
+TEST(CborTest, UTCDate) {
+  for (int64_t value : {int64_t(0), int64_t(1000), int64_t(1500),
+                        int64_t(1363896240000LL), int64_t(1363896240500LL),
+                        int64_t(-1), int64_t(-86400000)}) {
+    Builder b;
+    b.add(Value(value, ValueType::UTCDate));
+
+    std::string data = CborDumper::toString(b.slice());
+    std::shared_ptr<Builder> b2 = CborParser::fromCbor(data);
+    Slice s = b2->slice();
+    ASSERT_TRUE(s.isUTCDate());
+    ASSERT_EQ(value, s.getUTCDate());
+  }
+
+  // examples from RFC 7049
+  std::shared_ptr<Builder> b = CborParser::fromCbor(fromHex("c1 1a 51 4b 67 b0"));
+  ASSERT_EQ(1363896240000LL, b->slice().getUTCDate());
+  b = CborParser::fromCbor(fromHex("c1 fb 41 d4 52 d9 ec 20 00 00"));
+  ASSERT_EQ(1363896240500LL, b->slice().getUTCDate());
+
+  Builder date;
+  date.add(Value(int64_t(1363896240000LL), ValueType::UTCDate));
+  ASSERT_EQ(fromHex("c1 1a 51 4b 67 b0"), CborDumper::toString(date.slice()));
+
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("c1 61 61")),
+                              Exception::ParseError);
+}
+
+TEST(CborTest, InvalidInput) {
+  // truncated
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("82 01")),
+                              Exception::ParseError);
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("63 61 62")),
+                              Exception::ParseError);
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("9f 01")),
+                              Exception::ParseError);
+  // reserved additional information
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("1c")),
+                              Exception::ParseError);
+  // unexpected break
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("ff")),
+                              Exception::ParseError);
+  // invalid chunk in indefinite string
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("7f 41 00 ff")),
+                              Exception::ParseError);
+  // array as key
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("a1 80 01")),
+                              Exception::ParseError);
+  // negative number out of range
+  ASSERT_VELOCYPACK_EXCEPTION(
+      CborParser::fromCbor(fromHex("3b ff ff ff ff ff ff ff ff")),
+      Exception::NumberOutOfRange);
+  // trailing data
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("01 02")),
+                              Exception::ParseError);
+  // invalid UTF-8
+  Options options;
+  options.validateUtf8Strings = true;
+  ASSERT_VELOCYPACK_EXCEPTION(CborParser::fromCbor(fromHex("61 ff"), &options),
+                              Exception::InvalidUtf8Sequence);
+}
+
+TEST(CborTest, UnsupportedTypes) {
+  Builder b;
+  b.add(Value(ValueType::MaxKey));
+
+  Options options;
+  options.unsupportedTypeBehavior = Options::FailOnUnsupportedType;
+  ASSERT_VELOCYPACK_EXCEPTION(CborDumper::toString(b.slice(), &options),
+                              Exception::NoJsonEquivalent);
+
+  options.unsupportedTypeBehavior = Options::NullifyUnsupportedType;
+  ASSERT_EQ(fromHex("f6"), CborDumper::toString(b.slice(), &options));
+
+  options.unsupportedTypeBehavior = Options::ConvertUnsupportedType;
+  std::shared_ptr<Builder> b2 =
+      CborParser::fromCbor(CborDumper::toString(b.slice(), &options));
+  ASSERT_EQ("(non-representable type max-key)", b2->slice().copyString());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -24,6 +24,8 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <atomic>
+#include <limits>
 #include <set>
 #include <string>
 #include <unordered_set>
@@ -549,6 +551,66 @@ TEST(CollectionTest, FilterArray) {
   ASSERT_EQ(19, s.at(4).getInt());
 }
 
+struct CountingPredicate {
+  explicit CountingPredicate(int64_t limit) : limit(limit), calls(0) {}
+  bool operator()(Slice const& slice, ValueLength) {
+    ++calls;
+    return slice.getInt() < limit;
+  }
+  int64_t limit;
+  size_t calls;
+};
+
+static bool IsEven(Slice const& slice, ValueLength) {
+  return slice.getInt() % 2 == 0;
+}
+
+TEST(CollectionTest, FunctorOverloads) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1,2,3,4,5,6]");
+  Slice s = b->slice();
+
+  CountingPredicate less4(4);
+  Builder filtered = Collection::filter(s, less4);
+  ASSERT_EQ("[1,2,3]", filtered.slice().toJson());
+
+  CountingPredicate counter(4);
+  Collection::forEach(s, std::ref(counter));
+  ASSERT_EQ(4UL, counter.calls);
+
+  ASSERT_EQ(4, Collection::find(s, [](Slice const& slice, ValueLength) { return slice.getInt() > 3; }).getInt());
+  ASSERT_EQ(2, Collection::find(s, &IsEven).getInt());
+  ASSERT_TRUE(Collection::contains(s, &IsEven));
+  ASSERT_TRUE(Collection::any(s, &IsEven));
+  ASSERT_FALSE(Collection::all(s, &IsEven));
+  ASSERT_TRUE(Collection::all(s, CountingPredicate(7)));
+  ASSERT_FALSE(Collection::any(s, CountingPredicate(1)));
+
+  // std::function based predicates still work
+  Collection::Predicate predicate = [](Slice const& slice, ValueLength) {
+    return slice.getInt() > 5;
+  };
+  ASSERT_EQ("[6]", Collection::filter(s, predicate).slice().toJson());
+  ASSERT_TRUE(Collection::contains(s, predicate));
+
+  // comparison with a value still uses equals()
+  ASSERT_TRUE(Collection::contains(s, s[2]));
+}
+
+TEST(CollectionTest, FilterUnindexed) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1,\"foo\",2,\"barbaz\",3,[4]]");
+  auto notString = [](Slice const& slice, ValueLength) { return !slice.isString(); };
+
+  Builder indexed = Collection::filter(b->slice(), notString);
+  ASSERT_EQ(0x06, indexed.slice().head());
+
+  Options options;
+  options.buildUnindexedArrays = true;
+  Builder compact = Collection::filter(b->slice(), notString, &options);
+  ASSERT_EQ(0x13, compact.slice().head());
+  ASSERT_EQ("[1,2,3,[4]]", compact.slice().toJson());
+  ASSERT_TRUE(compact.size() < indexed.size());
+}
+
 TEST(CollectionTest, FindNonArray) {
   std::string const value("null");
   Parser parser;
@@ -1262,6 +1324,89 @@ TEST(CollectionTest, KeepManyAttributes) {
   }
 }
 
+TEST(CollectionTest, SortedKeySet) {
+  SortedKeySet keys{"foo", "bar", "a", "foobar", "bar"};
+  ASSERT_EQ(4UL, keys.size());
+  ASSERT_EQ("a", keys.keys()[0].toString());
+  ASSERT_EQ("bar", keys.keys()[1].toString());
+  ASSERT_EQ("foo", keys.keys()[2].toString());
+  ASSERT_EQ("foobar", keys.keys()[3].toString());
+  ASSERT_TRUE(keys.contains(StringRef("foo")));
+  ASSERT_TRUE(keys.contains(StringRef("a")));
+  ASSERT_FALSE(keys.contains(StringRef("fo")));
+  ASSERT_FALSE(keys.contains(StringRef("fooba")));
+  ASSERT_FALSE(keys.contains(StringRef("")));
+
+  SortedKeySet empty;
+  ASSERT_TRUE(empty.empty());
+  ASSERT_FALSE(empty.contains(StringRef("foo")));
+}
+
+TEST(CollectionTest, KeepSortedKeySet) {
+  std::string const value("{\"foo\":1,\"bar\":2,\"baz\":3,\"qux\":{\"foo\":1},\"z\":null,\"a\":[1]}");
+  std::shared_ptr<Builder> p1 = Parser::fromJson(value);
+  Options options;
+  options.buildUnindexedObjects = true;
+  std::shared_ptr<Builder> p2 = Parser::fromJson(value, &options);
+  ASSERT_EQ(0x14, p2->slice().head());
+
+  std::vector<std::string> names{"qux", "a", "nope", "foo"};
+  SortedKeySet keys(names);
+  for (auto const& slice : {p1->slice(), p2->slice()}) {
+    Builder b = Collection::keep(slice, keys);
+    ASSERT_EQ("{\"a\":[1],\"foo\":1,\"qux\":{\"foo\":1}}", b.slice().toJson());
+
+    b = Collection::remove(slice, keys);
+    ASSERT_EQ("{\"bar\":2,\"baz\":3,\"z\":null}", b.slice().toJson());
+
+    b = Collection::keep(slice, SortedKeySet());
+    ASSERT_EQ("{}", b.slice().toJson());
+
+    b = Collection::remove(slice, SortedKeySet());
+    ASSERT_TRUE(b.slice().equals(Collection::keep(slice, std::vector<std::string>{"a", "bar", "baz", "foo", "qux", "z"}).slice()));
+  }
+
+  Builder b;
+  b.openArray();
+  Collection::keep(b, p1->slice(), SortedKeySet{"z"});
+  Collection::remove(b, p1->slice(), SortedKeySet{"a", "bar", "baz", "foo", "qux"});
+  b.close();
+  ASSERT_EQ("[{\"z\":null},{\"z\":null}]", b.slice().toJson());
+
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::keep(Slice::nullSlice(), keys), Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::remove(Slice::nullSlice(), keys), Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, KeepSortedKeySetLarge) {
+  Builder obj;
+  obj.openObject();
+  for (size_t i = 0; i < 500; ++i) {
+    obj.add("attr" + std::to_string(i), Value(i));
+  }
+  obj.close();
+
+  std::vector<std::string> names;
+  for (size_t i = 0; i < 600; i += 7) {
+    names.emplace_back("attr" + std::to_string(i));
+  }
+  SortedKeySet keys(names);
+
+  Builder kept = Collection::keep(obj.slice(), keys);
+  Builder removed = Collection::remove(obj.slice(), keys);
+  ASSERT_EQ(72UL, kept.slice().length());
+  ASSERT_EQ(428UL, removed.slice().length());
+  for (size_t i = 0; i < 500; ++i) {
+    std::string name("attr" + std::to_string(i));
+    ASSERT_EQ(i % 7 == 0, kept.slice().hasKey(name));
+    ASSERT_EQ(i % 7 != 0, removed.slice().hasKey(name));
+  }
+
+  // results must be identical to the std::unordered_set variants
+  std::unordered_set<std::string> set(names.begin(), names.end());
+  ASSERT_TRUE(kept.slice().equals(Collection::keep(obj.slice(), set).slice()));
+  ASSERT_TRUE(removed.slice().equals(Collection::remove(obj.slice(), set).slice()));
+}
+
 TEST(CollectionTest, RemoveNonObject) {
   std::string const value("[]");
 
@@ -1458,6 +1603,64 @@ TEST(CollectionTest, RemoveNonExistingAttributesUsingSet) {
   ASSERT_FALSE(s.hasKey("empty"));
 }
 
+TEST(CollectionTest, Distinct) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1,\"a\",1,null,[1,2],\"b\",\"a\",[1,2],{\"x\":1},null,1.5,{\"x\":1},[2,1]]");
+  Builder result = Collection::distinct(b->slice());
+  ASSERT_EQ("[1,\"a\",null,[1,2],\"b\",{\"x\":1},1.5,[2,1]]", result.slice().toJson());
+
+  std::shared_ptr<Builder> empty = Parser::fromJson("[]");
+  ASSERT_EQ("[]", Collection::distinct(empty->slice()).slice().toJson());
+
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::distinct(Slice::nullSlice()), Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, DistinctLarge) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 100000; ++i) {
+    b.add(Value("value" + std::to_string(i % 1234)));
+  }
+  b.close();
+
+  Builder result = Collection::distinct(b.slice());
+  Slice s = result.slice();
+  ASSERT_EQ(1234UL, s.length());
+  for (size_t i = 0; i < 1234; ++i) {
+    ASSERT_EQ("value" + std::to_string(i), s[i].copyString());
+  }
+}
+
+TEST(CollectionTest, SetOperations) {
+  std::shared_ptr<Builder> l = Parser::fromJson("[1,2,3,\"a\",2,[1],{\"a\":1},1]");
+  std::shared_ptr<Builder> r = Parser::fromJson("[3,\"b\",[1],4,{\"a\":1},3]");
+
+  ASSERT_EQ("[3,[1],{\"a\":1}]", Collection::intersect(l->slice(), r->slice()).slice().toJson());
+  ASSERT_EQ("[1,2,3,\"a\",[1],{\"a\":1},\"b\",4]", Collection::unionOf(l->slice(), r->slice()).slice().toJson());
+  ASSERT_EQ("[1,2,\"a\"]", Collection::difference(l->slice(), r->slice()).slice().toJson());
+  ASSERT_EQ("[\"b\",4]", Collection::difference(r->slice(), l->slice()).slice().toJson());
+
+  std::shared_ptr<Builder> empty = Parser::fromJson("[]");
+  ASSERT_EQ("[]", Collection::intersect(l->slice(), empty->slice()).slice().toJson());
+  ASSERT_EQ("[1,2,3,\"a\",[1],{\"a\":1}]", Collection::unionOf(l->slice(), empty->slice()).slice().toJson());
+  ASSERT_EQ("[1,2,3,\"a\",[1],{\"a\":1}]", Collection::difference(l->slice(), empty->slice()).slice().toJson());
+
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::intersect(l->slice(), Slice::nullSlice()), Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::unionOf(Slice::nullSlice(), r->slice()), Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, GroupBy) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[{\"t\":{\"k\":\"a\"},\"v\":1},{\"t\":{\"k\":\"b\"},\"v\":2},{\"v\":3},{\"t\":{\"k\":\"a\"},\"v\":4},5,{\"t\":{\"k\":null},\"v\":6}]");
+
+  Builder result = Collection::groupBy(b->slice(), std::vector<std::string>{"t", "k"});
+  ASSERT_EQ("[[\"a\",[{\"t\":{\"k\":\"a\"},\"v\":1},{\"t\":{\"k\":\"a\"},\"v\":4}]],[\"b\",[{\"t\":{\"k\":\"b\"},\"v\":2}]],[null,[{\"v\":3},5,{\"t\":{\"k\":null},\"v\":6}]]]", result.slice().toJson());
+
+  result = Collection::groupBy(b->slice(), "v");
+  ASSERT_EQ(6UL, result.slice().length());
+
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::groupBy(b->slice(), std::vector<std::string>()), Exception::InvalidAttributePath);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::groupBy(Slice::nullSlice(), "v"), Exception::InvalidValueType);
+}
+
 TEST(CollectionTest, MergeNonObject) {
   Builder b1;
   b1.add(Value(ValueType::Array));
@@ -1694,6 +1897,80 @@ TEST(CollectionTest, MergeNullMeansRemoveRecursive) {
   ASSERT_FALSE(s.hasKey("baz"));
 }
 
+TEST(CollectionTest, MergeKeysInOrder) {
+  Options options;
+  options.buildUnindexedObjects = true;
+  std::shared_ptr<Builder> p1 = Parser::fromJson("{\"z\":1,\"m\":{\"y\":1,\"b\":2},\"a\":3,\"c\":null}", &options);
+  std::shared_ptr<Builder> p2 = Parser::fromJson("{\"n\":4,\"m\":{\"c\":3,\"a\":null},\"b\":null,\"a\":5}");
+  ASSERT_EQ(0x14, p1->slice().head());
+
+  Builder b = Collection::merge(p1->slice(), p2->slice(), true, true);
+  Slice s = b.slice();
+  ASSERT_EQ("{\"a\":5,\"c\":null,\"m\":{\"b\":2,\"c\":3,\"y\":1},\"n\":4,\"z\":1}", s.toJson());
+
+  // attributes are stored in index order
+  ObjectIterator it(s, true);
+  std::vector<std::string> keys;
+  while (it.valid()) {
+    keys.emplace_back(it.key().copyString());
+    it.next();
+  }
+  ASSERT_EQ((std::vector<std::string>{"a", "c", "m", "n", "z"}), keys);
+
+  Builder b2 = Collection::merge(p1->slice(), p2->slice(), false, false);
+  ASSERT_EQ("{\"a\":5,\"b\":null,\"c\":null,\"m\":{\"a\":null,\"c\":3},\"n\":4,\"z\":1}", b2.slice().toJson());
+}
+
+TEST(CollectionTest, MergeIntoOpenBuilder) {
+  std::shared_ptr<Builder> p1 = Parser::fromJson("{\"a\":{\"b\":{\"c\":1,\"d\":2}},\"e\":1}");
+  std::shared_ptr<Builder> p2 = Parser::fromJson("{\"a\":{\"b\":{\"d\":3,\"f\":4}},\"g\":[1]}");
+
+  Builder b;
+  b.openArray();
+  b.add(Value(1));
+  Collection::merge(b, p1->slice(), p2->slice(), true);
+  b.add(Value(2));
+  b.close();
+  ASSERT_EQ("[1,{\"a\":{\"b\":{\"c\":1,\"d\":3,\"f\":4}},\"e\":1,\"g\":[1]},2]", b.slice().toJson());
+}
+
+TEST(CollectionTest, MergeDuplicateKeys) {
+  std::shared_ptr<Builder> p1 = Parser::fromJson("{\"a\":1,\"a\":2,\"b\":1}");
+  std::shared_ptr<Builder> p2 = Parser::fromJson("{\"a\":3,\"c\":1}");
+
+  Builder b = Collection::merge(p1->slice(), p2->slice(), false);
+  ASSERT_EQ("{\"a\":3,\"b\":1,\"c\":1}", b.slice().toJson());
+}
+
+TEST(CollectionTest, MergeLarge) {
+  Builder left;
+  left.openObject();
+  for (size_t i = 0; i < 1000; i += 2) {
+    left.add("key" + std::to_string(i), Value(i));
+  }
+  left.close();
+  Builder right;
+  right.openObject();
+  for (size_t i = 0; i < 1000; i += 3) {
+    right.add("key" + std::to_string(i), Value(i * 10));
+  }
+  right.close();
+
+  Builder b = Collection::merge(left.slice(), right.slice(), false);
+  Slice s = b.slice();
+  ASSERT_EQ(667UL, s.length());
+  for (size_t i = 0; i < 1000; ++i) {
+    Slice v = s.get("key" + std::to_string(i));
+    if (i % 3 == 0) {
+      ASSERT_EQ(i * 10, v.getUInt());
+    } else if (i % 2 == 0) {
+      ASSERT_EQ(i, v.getUInt());
+    } else {
+      ASSERT_TRUE(v.isNone());
+    }
+  }
+}
+
 TEST(CollectionTest, VisitRecursiveNonCompound) {
   std::string const value("[1,null,true,\"foo\"]");
 
@@ -2101,6 +2378,773 @@ TEST(CollectionTest, SortNonArray) {
   ASSERT_VELOCYPACK_EXCEPTION(Collection::sort(b.slice(), &lt), Exception::InvalidValueType);
 }
 
+TEST(CollectionTest, SortLambda) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[\"foo\",\"a\",\"foobar\",\"ba\"]");
+  Builder b2 = Collection::sort(b->slice(), [](Slice const& lhs, Slice const& rhs) {
+    return lhs.getStringLength() < rhs.getStringLength();
+  });
+  ASSERT_EQ("[\"a\",\"ba\",\"foo\",\"foobar\"]", b2.slice().toJson());
+}
+
+TEST(CollectionTest, CompareTypes) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[null,false,true,-5,0,3.5,\"\",\"a\",[],[1],{},{\"a\":1}]");
+  Slice s = b->slice();
+  ValueLength const n = s.length();
+  for (ValueLength i = 0; i < n; ++i) {
+    for (ValueLength j = 0; j < n; ++j) {
+      int res = Collection::compare(s[i], s[j]);
+      if (i < j) {
+        ASSERT_TRUE(res < 0);
+      } else if (i > j) {
+        ASSERT_TRUE(res > 0);
+      } else {
+        ASSERT_EQ(0, res);
+      }
+    }
+  }
+
+  Builder special;
+  special.openArray();
+  special.add(Value(ValueType::MinKey));
+  special.add(Value(ValueType::Null));
+  special.add(Value(ValueType::MaxKey));
+  special.close();
+  ASSERT_TRUE(Collection::compare(special.slice()[0], special.slice()[1]) < 0);
+  ASSERT_TRUE(Collection::compare(special.slice()[2], special.slice()[1]) > 0);
+  ASSERT_TRUE(Collection::compare(special.slice()[2], b->slice()) > 0);
+}
+
+TEST(CollectionTest, CompareNumbers) {
+  Builder b;
+  b.openArray();
+  b.add(Value(std::numeric_limits<double>::quiet_NaN()));
+  b.add(Value(-1.0e300));
+  b.add(Value(std::numeric_limits<int64_t>::min()));
+  b.add(Value(-100.5));
+  b.add(Value(-100));
+  b.add(Value(-99.5));
+  b.add(Value(0));
+  b.add(Value(0.25));
+  b.add(Value(1));
+  b.add(Value(static_cast<uint64_t>(std::numeric_limits<int64_t>::max())));
+  b.add(Value(9223372036854775808.0));
+  b.add(Value(std::numeric_limits<uint64_t>::max()));
+  b.add(Value(1.0e300));
+  b.close();
+
+  Slice s = b.slice();
+  ValueLength const n = s.length();
+  for (ValueLength i = 0; i + 1 < n; ++i) {
+    ASSERT_TRUE(Collection::compare(s[i], s[i + 1]) < 0);
+    ASSERT_TRUE(Collection::compare(s[i + 1], s[i]) > 0);
+  }
+
+  Builder same;
+  same.openArray();
+  same.add(Value(42));
+  same.add(Value(42.0));
+  same.add(Value(static_cast<uint64_t>(42)));
+  same.add(Value(-0.0));
+  same.add(Value(0));
+  same.close();
+  ASSERT_EQ(0, Collection::compare(same.slice()[0], same.slice()[1]));
+  ASSERT_EQ(0, Collection::compare(same.slice()[1], same.slice()[2]));
+  ASSERT_EQ(0, Collection::compare(same.slice()[0], same.slice()[2]));
+  ASSERT_EQ(0, Collection::compare(same.slice()[3], same.slice()[4]));
+}
+
+TEST(CollectionTest, CompareObjects) {
+  std::shared_ptr<Builder> b1 = Parser::fromJson("{\"b\":1,\"a\":2}");
+  Options options;
+  options.buildUnindexedObjects = true;
+  std::shared_ptr<Builder> b2 = Parser::fromJson("{\"a\":2,\"b\":1}", &options);
+  std::shared_ptr<Builder> b3 = Parser::fromJson("{\"a\":2,\"b\":2}");
+  std::shared_ptr<Builder> b4 = Parser::fromJson("{\"a\":2,\"b\":1,\"c\":0}");
+
+  ASSERT_EQ(0, Collection::compare(b1->slice(), b2->slice()));
+  ASSERT_TRUE(Collection::compare(b1->slice(), b3->slice()) < 0);
+  ASSERT_TRUE(Collection::compare(b1->slice(), b4->slice()) < 0);
+  ASSERT_TRUE(Collection::compare(b4->slice(), b3->slice()) < 0);
+}
+
+TEST(CollectionTest, SortNormalized) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[{\"a\":1},3,\"x\",null,[2],-1.5,true,\"abc\",[1,2],false,2]");
+  Builder b2 = Collection::sort(b->slice());
+  ASSERT_EQ("[null,false,true,-1.5,2,3,\"abc\",\"x\",[1,2],[2],{\"a\":1}]", b2.slice().toJson());
+}
+
+TEST(CollectionTest, SortBy) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[{\"v\":{\"x\":3},\"id\":1},{\"v\":{\"x\":1},\"id\":2},{\"id\":3},{\"v\":{\"x\":3},\"id\":4},5,{\"v\":{\"x\":2},\"id\":6}]");
+
+  Builder b2 = Collection::sortBy(b->slice(), std::vector<std::string>{"v", "x"});
+  std::string expected("[{\"id\":3},5,{\"id\":2,\"v\":{\"x\":1}},{\"id\":6,\"v\":{\"x\":2}},{\"id\":1,\"v\":{\"x\":3}},{\"id\":4,\"v\":{\"x\":3}}]");
+  ASSERT_EQ(expected, b2.slice().toJson());
+
+  Builder b3 = Collection::sortBy(b->slice(), std::vector<std::string>{"v", "x"}, false);
+  expected = "[{\"id\":1,\"v\":{\"x\":3}},{\"id\":4,\"v\":{\"x\":3}},{\"id\":6,\"v\":{\"x\":2}},{\"id\":2,\"v\":{\"x\":1}},{\"id\":3},5]";
+  ASSERT_EQ(expected, b3.slice().toJson());
+
+  Builder b4 = Collection::sortBy(b->slice(), "id", false);
+  expected = "[{\"id\":6,\"v\":{\"x\":2}},{\"id\":4,\"v\":{\"x\":3}},{\"id\":3},{\"id\":2,\"v\":{\"x\":1}},{\"id\":1,\"v\":{\"x\":3}},5]";
+  ASSERT_EQ(expected, b4.slice().toJson());
+
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::sortBy(b->slice(), std::vector<std::string>()), Exception::InvalidAttributePath);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::sortBy(b->slice()[0], "id"), Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, SortParallel) {
+  size_t const n = Collection::ParallelSortThreshold * 3 + 17;
+  Builder b;
+  b.openArray();
+  uint64_t value = 12345;
+  for (size_t i = 0; i < n; ++i) {
+    value = value * 6364136223846793005ULL + 1442695040888963407ULL;
+    b.add(Value(static_cast<int64_t>(value >> 40) - 8000000));
+  }
+  b.close();
+
+  Builder sequential = Collection::sort(b.slice(), &lt);
+  for (size_t threads : {0, 2, 3, 8}) {
+    Builder parallel = Collection::sort(b.slice(), &lt, threads);
+    ASSERT_EQ(sequential.size(), parallel.size());
+    ASSERT_TRUE(sequential.slice().equals(parallel.slice()));
+  }
+
+  Builder normalized = Collection::sort(b.slice(), NormalizedLess(), 4);
+  ASSERT_TRUE(sequential.slice().equals(normalized.slice()));
+}
+
+TEST(CollectionTest, SortByParallel) {
+  size_t const n = Collection::ParallelSortThreshold * 2;
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < n; ++i) {
+    b.openObject();
+    b.add("key", Value((i * 7919) % 1000));
+    b.add("pos", Value(i));
+    b.close();
+  }
+  b.close();
+
+  Builder sequential = Collection::sortBy(b.slice(), "key");
+  Builder parallel = Collection::sortBy(b.slice(), "key", true, 4);
+  ASSERT_TRUE(sequential.slice().equals(parallel.slice()));
+
+  // equal keys keep their original order
+  Slice s = parallel.slice();
+  for (ValueLength i = 1; i < s.length(); ++i) {
+    uint64_t k1 = s[i - 1].get("key").getUInt();
+    uint64_t k2 = s[i].get("key").getUInt();
+    ASSERT_TRUE(k1 <= k2);
+    if (k1 == k2) {
+      ASSERT_TRUE(s[i - 1].get("pos").getUInt() < s[i].get("pos").getUInt());
+    }
+  }
+}
+
+TEST(CollectionTest, SortParallelException) {
+  size_t const n = Collection::ParallelSortThreshold * 2;
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < n; ++i) {
+    b.add(Value(n - i));
+  }
+  b.add(Value("foo"));
+  b.close();
+
+  auto cmp = [](Slice const& lhs, Slice const& rhs) {
+    return lhs.getUInt() < rhs.getUInt();
+  };
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::sort(b.slice(), cmp, 4), Exception::InvalidValueType);
+}
+
+static Builder parallelTestArray(size_t n, bool compact) {
+  Options options;
+  options.buildUnindexedArrays = compact;
+  Builder b(&options);
+  b.openArray();
+  for (size_t i = 0; i < n; ++i) {
+    if (i % 3 == 0) {
+      b.add(Value(i));
+    } else {
+      b.openArray();
+      b.add(Value(i));
+      b.add(Value("foo"));
+      b.close();
+    }
+  }
+  b.close();
+  return b;
+}
+
+static uint64_t parallelTestValue(Slice const& s) {
+  return s.isArray() ? s.at(0).getUInt() : s.getUInt();
+}
+
+TEST(CollectionTest, ParallelForEach) {
+  ThreadPool pool(4);
+  for (bool compact : {false, true}) {
+    for (size_t n : {0, 1, 10, 1000, 10007}) {
+      Builder b = parallelTestArray(n, compact);
+      for (ValueLength chunkSize : {1, 7, 100000}) {
+        ParallelPolicy policy(&pool, chunkSize);
+        std::vector<std::atomic<int>> seen(n);
+        for (auto& it : seen) {
+          it.store(0);
+        }
+        Collection::forEach(policy, b.slice(),
+                            [&seen](Slice const& s, ValueLength index) {
+          EXPECT_EQ(index, parallelTestValue(s));
+          ++seen[index];
+          return true;
+        });
+        for (auto const& it : seen) {
+          ASSERT_EQ(1, it.load());
+        }
+      }
+    }
+  }
+}
+
+TEST(CollectionTest, ParallelForEachAbort) {
+  ThreadPool pool(4);
+  Builder b = parallelTestArray(10000, false);
+  ParallelPolicy policy(&pool, 10);
+  std::atomic<size_t> seen(0);
+  Collection::forEach(policy, b.slice(), [&seen](Slice const&, ValueLength) {
+    ++seen;
+    return false;
+  });
+  // every chunk stops after its first member at the latest
+  ASSERT_TRUE(seen.load() >= 1);
+  ASSERT_TRUE(seen.load() <= pool.concurrency() * 4);
+}
+
+TEST(CollectionTest, ParallelFilter) {
+  ThreadPool pool(3);
+  for (bool compact : {false, true}) {
+    Builder b = parallelTestArray(20000, compact);
+    auto isOdd = [](Slice const& s, ValueLength) {
+      return parallelTestValue(s) % 2 == 1;
+    };
+    Builder expected = Collection::filter(b.slice(), isOdd);
+    for (ValueLength chunkSize : {1, 100, 100000}) {
+      Builder result =
+          Collection::filter(ParallelPolicy(&pool, chunkSize), b.slice(), isOdd);
+      ASSERT_EQ(10000UL, result.slice().length());
+      ASSERT_TRUE(expected.slice().equals(result.slice()));
+    }
+
+    Options options;
+    options.buildUnindexedArrays = true;
+    Builder result = Collection::filter(ParallelPolicy(&pool, 100), b.slice(),
+                                        isOdd, &options);
+    ASSERT_EQ(0x13, result.slice().head());
+    ASSERT_EQ(expected.slice().length(), result.slice().length());
+    for (ValueLength i = 0; i < result.slice().length(); ++i) {
+      ASSERT_TRUE(expected.slice().at(i).equals(result.slice().at(i)));
+    }
+  }
+}
+
+TEST(CollectionTest, ParallelFind) {
+  ThreadPool pool(4);
+  Builder b = parallelTestArray(50000, false);
+  ParallelPolicy policy(&pool, 100);
+
+  for (uint64_t wanted : {0, 1, 4999, 25000, 49999}) {
+    // several members match, the first one must be returned
+    Slice found = Collection::find(policy, b.slice(),
+                                   [wanted](Slice const& s, ValueLength) {
+      return parallelTestValue(s) >= wanted;
+    });
+    ASSERT_EQ(wanted, parallelTestValue(found));
+  }
+
+  Slice found = Collection::find(policy, b.slice(), [](Slice const&, ValueLength) {
+    return false;
+  });
+  ASSERT_TRUE(found.isNone());
+}
+
+TEST(CollectionTest, ParallelAllAny) {
+  ThreadPool pool(4);
+  Builder b = parallelTestArray(30000, true);
+  ParallelPolicy policy(&pool, 1000);
+
+  auto below = [](uint64_t limit) {
+    return [limit](Slice const& s, ValueLength) {
+      return parallelTestValue(s) < limit;
+    };
+  };
+  ASSERT_TRUE(Collection::all(policy, b.slice(), below(30000)));
+  ASSERT_FALSE(Collection::all(policy, b.slice(), below(29999)));
+  ASSERT_TRUE(Collection::any(policy, b.slice(), below(1)));
+  ASSERT_FALSE(Collection::any(policy, b.slice(), below(0)));
+  ASSERT_TRUE(Collection::contains(policy, b.slice(), below(20000)));
+
+  Builder empty;
+  empty.openArray();
+  empty.close();
+  ASSERT_TRUE(Collection::all(policy, empty.slice(), below(0)));
+  ASSERT_FALSE(Collection::any(policy, empty.slice(), below(1)));
+}
+
+TEST(CollectionTest, ParallelDefaultPool) {
+  Builder b = parallelTestArray(100000, false);
+  std::atomic<uint64_t> sum(0);
+  Collection::forEach(ParallelPolicy(), b.slice(),
+                      [&sum](Slice const& s, ValueLength) {
+    sum += parallelTestValue(s);
+    return true;
+  });
+  ASSERT_EQ(100000ULL * 99999 / 2, sum.load());
+}
+
+TEST(CollectionTest, ParallelNonArray) {
+  Builder b;
+  b.openObject();
+  b.close();
+  ParallelPolicy policy;
+  auto pred = [](Slice const&, ValueLength) { return true; };
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::forEach(policy, b.slice(), pred),
+                              Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::filter(policy, b.slice(), pred),
+                              Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::all(policy, b.slice(), pred),
+                              Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, ParallelException) {
+  ThreadPool pool(4);
+  Builder b = parallelTestArray(10000, false);
+  auto pred = [](Slice const& s, ValueLength) {
+    return s.getUInt() > 0;  // throws for the Array members
+  };
+  ASSERT_VELOCYPACK_EXCEPTION(
+      Collection::filter(ParallelPolicy(&pool, 100), b.slice(), pred),
+      Exception::InvalidValueType);
+}
+
+TEST(CollectionTest, ParallelVisitRecursive) {
+  ThreadPool pool(4);
+  Builder b = parallelTestArray(9000, false);
+
+  for (auto order : {Collection::PreOrder, Collection::PostOrder}) {
+    std::atomic<size_t> values(0);
+    std::atomic<size_t> strings(0);
+    Collection::visitRecursive(ParallelPolicy(&pool, 100), b.slice(), order,
+                               [&](Slice const& key, Slice const& value) {
+      EXPECT_TRUE(key.isNone());
+      ++values;
+      if (value.isString()) {
+        ++strings;
+      }
+      return true;
+    });
+    // 9000 top-level members, plus two in each of the 6000 sub-Arrays
+    ASSERT_EQ(9000UL + 2 * 6000, values.load());
+    ASSERT_EQ(6000UL, strings.load());
+
+    std::atomic<size_t> visited(0);
+    Collection::visitRecursive(ParallelPolicy(&pool, 100), b.slice(), order,
+                               [&visited](Slice const&, Slice const&) {
+      ++visited;
+      return false;
+    });
+    ASSERT_TRUE(visited.load() >= 1);
+    ASSERT_TRUE(visited.load() <= pool.concurrency() * 4);
+  }
+
+  // Objects are visited sequentially
+  Builder obj;
+  obj.openObject();
+  obj.add("a", Value(1));
+  obj.add("b", b.slice());
+  obj.close();
+  std::atomic<size_t> values(0);
+  Collection::visitRecursive(ParallelPolicy(&pool, 100), obj.slice(),
+                             Collection::PreOrder,
+                             [&values](Slice const&, Slice const&) {
+    ++values;
+    return true;
+  });
+  ASSERT_EQ(2UL + 9000 + 2 * 6000, values.load());
+}
+
+TEST(CollectionTest, VisitOrderAndPaths) {
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"a\":1,\"b\":[2,{\"c\":3,\"d\":[]}],\"e\":{\"f\":[4,[5]]}}");
+
+  std::vector<std::string> seen;
+  Collection::visit(b->slice(), [&seen](VisitPath const& path, Slice const& value) {
+    seen.push_back(path.toString() + "=" + value.toJson());
+    return Collection::Continue;
+  });
+
+  std::vector<std::string> expected{
+      "={\"a\":1,\"b\":[2,{\"c\":3,\"d\":[]}],\"e\":{\"f\":[4,[5]]}}",
+      "a=1",
+      "b=[2,{\"c\":3,\"d\":[]}]",
+      "b[0]=2",
+      "b[1]={\"c\":3,\"d\":[]}",
+      "b[1].c=3",
+      "b[1].d=[]",
+      "e={\"f\":[4,[5]]}",
+      "e.f=[4,[5]]",
+      "e.f[0]=4",
+      "e.f[1]=[5]",
+      "e.f[1][0]=5"};
+  ASSERT_EQ(expected, seen);
+}
+
+TEST(CollectionTest, VisitPathSteps) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[{\"x\":[true]}]");
+
+  size_t calls = 0;
+  Collection::visit(b->slice(), [&calls](VisitPath const& path, Slice const& value) {
+    ++calls;
+    if (value.isBool()) {
+      EXPECT_EQ(3UL, path.size());
+      EXPECT_TRUE(path[0].isArrayMember());
+      EXPECT_EQ(0UL, path[0].index);
+      EXPECT_FALSE(path[1].isArrayMember());
+      EXPECT_TRUE(path[1].key.isEqualString("x"));
+      EXPECT_TRUE(path.back().isArrayMember());
+    }
+    return Collection::Continue;
+  });
+  ASSERT_EQ(4UL, calls);
+}
+
+TEST(CollectionTest, VisitNonCompound) {
+  Builder b;
+  b.add(Value("foo"));
+
+  size_t calls = 0;
+  Collection::visit(b.slice(), [&calls](VisitPath const& path, Slice const& value) {
+    EXPECT_TRUE(path.empty());
+    EXPECT_TRUE(value.isString());
+    ++calls;
+    return Collection::Continue;
+  });
+  ASSERT_EQ(1UL, calls);
+}
+
+TEST(CollectionTest, VisitSkipChildren) {
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"skip\":{\"a\":1,\"b\":[1,2,3]},\"keep\":{\"c\":[4]}}");
+
+  std::vector<std::string> seen;
+  Collection::visit(b->slice(), [&seen](VisitPath const& path, Slice const&) {
+    seen.push_back(path.toString());
+    if (path.size() == 1 && path.back().key.isEqualString("skip")) {
+      return Collection::SkipChildren;
+    }
+    return Collection::Continue;
+  });
+
+  std::vector<std::string> expected{"", "skip", "keep", "keep.c", "keep.c[0]"};
+  ASSERT_EQ(expected, seen);
+
+  seen.clear();
+  Collection::visit(b->slice(), [&seen](VisitPath const& path, Slice const&) {
+    seen.push_back(path.toString());
+    return Collection::SkipChildren;
+  });
+  ASSERT_EQ(std::vector<std::string>{""}, seen);
+}
+
+TEST(CollectionTest, VisitStop) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[[1,2,[3]],4,[5]]");
+
+  std::vector<uint64_t> seen;
+  Collection::visit(b->slice(), [&seen](VisitPath const&, Slice const& value) {
+    if (value.isNumber()) {
+      seen.push_back(value.getUInt());
+      if (value.getUInt() == 3) {
+        return Collection::Stop;
+      }
+    }
+    return Collection::Continue;
+  });
+  ASSERT_EQ((std::vector<uint64_t>{1, 2, 3}), seen);
+}
+
+TEST(CollectionTest, VisitCompactAndUnsorted) {
+  Options options;
+  options.buildUnindexedArrays = true;
+  options.buildUnindexedObjects = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"z\":[1,{\"y\":2}],\"a\":3}", &options);
+  ASSERT_EQ(0x14, b->slice().head());
+
+  std::vector<std::string> seen;
+  VisitPath path;
+  for (size_t i = 0; i < 2; ++i) {
+    seen.clear();
+    Collection::visit(b->slice(), [&seen](VisitPath const& path, Slice const&) {
+      seen.push_back(path.toString());
+      return Collection::Continue;
+    }, path);
+    std::vector<std::string> expected{"", "z", "z[0]", "z[1]", "z[1].y", "a"};
+    ASSERT_EQ(expected, seen);
+  }
+}
+
+TEST(CollectionTest, VisitDeeplyNested) {
+  size_t const depth = 100000;
+  Builder b;
+  // Arrays on even levels, Objects with a single attribute on odd ones
+  b.openArray();
+  for (size_t i = 1; i < depth; ++i) {
+    if (i % 2 == 0) {
+      b.add("a", Value(ValueType::Array));
+    } else {
+      b.add(Value(ValueType::Object));
+    }
+  }
+  b.add("a", Value(42));
+  for (size_t i = 0; i < depth; ++i) {
+    b.close();
+  }
+
+  size_t maxDepth = 0;
+  size_t calls = 0;
+  Collection::visit(b.slice(), [&](VisitPath const& path, Slice const& value) {
+    ++calls;
+    if (value.isNumber()) {
+      maxDepth = path.size();
+    }
+    return Collection::Continue;
+  });
+  ASSERT_EQ(depth + 1, calls);
+  ASSERT_EQ(depth, maxDepth);
+}
+
+static void checkDiff(Slice oldValue, Slice newValue,
+                      Options const* options = &Options::Defaults) {
+  Builder patch = Collection::diff(oldValue, newValue, options);
+  Builder result(options);
+  Collection::apply(result, oldValue, patch.slice());
+  ASSERT_EQ(0, Collection::compare(newValue, result.slice()));
+  ASSERT_EQ(newValue.toJson(), result.slice().toJson());
+}
+
+TEST(CollectionTest, DiffEqualValues) {
+  for (std::string const json :
+       {"null", "1", "\"foo\"", "[]", "{}", "[1,2,[3,{\"a\":4}]]",
+        "{\"a\":{\"b\":[1,2,3]},\"c\":\"d\"}"}) {
+    std::shared_ptr<Builder> b = Parser::fromJson(json);
+    Builder patch = Collection::diff(b->slice(), b->slice());
+    ASSERT_EQ("[]", patch.slice().toJson());
+    ASSERT_EQ(json, Collection::apply(b->slice(), patch.slice()).slice().toJson());
+  }
+
+  // the same values in different encodings
+  Slice int1(reinterpret_cast<uint8_t const*>("\x21\xe8\x03"));
+  Slice int2(reinterpret_cast<uint8_t const*>("\x22\xe8\x03\x00"));
+  ASSERT_EQ("[]", Collection::diff(int1, int2).slice().toJson());
+
+  Options options;
+  options.buildUnindexedObjects = true;
+  options.buildUnindexedArrays = true;
+  std::string const json("{\"b\":[1,\"foo\",2.5],\"a\":{\"c\":null}}");
+  std::shared_ptr<Builder> compact = Parser::fromJson(json, &options);
+  std::shared_ptr<Builder> indexed = Parser::fromJson(json);
+  ASSERT_NE(compact->slice().byteSize(), indexed->slice().byteSize());
+  ASSERT_EQ("[]", Collection::diff(compact->slice(), indexed->slice())
+                      .slice().toJson());
+}
+
+TEST(CollectionTest, DiffObjects) {
+  std::string const text(40, 'x');
+  std::shared_ptr<Builder> oldValue = Parser::fromJson(
+      "{\"name\":\"foo\",\"tags\":[\"a\",\"b\",\"c\"],\"gone\":true,"
+      "\"nested\":{\"x\":1,\"text\":\"" + text + "\"}}");
+  std::shared_ptr<Builder> newValue = Parser::fromJson(
+      "{\"name\":\"foo\",\"tags\":[\"a\",\"b\",\"c\",\"d\"],\"new\":null,"
+      "\"nested\":{\"x\":2,\"text\":\"" + text + "\"}}");
+
+  Builder patch = Collection::diff(oldValue->slice(), newValue->slice());
+  // the patch for tags would be larger than the new Array
+  ASSERT_EQ(
+      "[2,{\"gone\":[0],\"nested\":[2,{\"x\":[1,2]}],\"new\":[1,null],"
+      "\"tags\":[1,[\"a\",\"b\",\"c\",\"d\"]]}]",
+      patch.slice().toJson());
+  ASSERT_LT(patch.slice().byteSize(), newValue->slice().byteSize());
+  checkDiff(oldValue->slice(), newValue->slice());
+
+  // and back
+  checkDiff(newValue->slice(), oldValue->slice());
+}
+
+TEST(CollectionTest, DiffArrays) {
+  Builder oldValue;
+  oldValue.openArray();
+  for (int i = 0; i < 100; ++i) {
+    oldValue.add(Value(i));
+  }
+  oldValue.close();
+
+  auto modified = [&oldValue](ValueLength length,
+                              std::function<void(Builder&, int)> member) {
+    Builder b;
+    b.openArray();
+    for (ValueLength i = 0; i < length; ++i) {
+      member(b, static_cast<int>(i));
+    }
+    b.close();
+    return b;
+  };
+
+  Builder changed = modified(100, [](Builder& b, int i) {
+    b.add(Value(i == 10 ? 1000 : (i == 50 ? -5 : i)));
+  });
+  ASSERT_EQ("[3,100,10,[1,1000],50,[1,-5]]",
+            Collection::diff(oldValue.slice(), changed.slice()).slice().toJson());
+  checkDiff(oldValue.slice(), changed.slice());
+
+  Builder appended = modified(102, [](Builder& b, int i) { b.add(Value(i)); });
+  ASSERT_EQ("[3,102,100,[1,100],101,[1,101]]",
+            Collection::diff(oldValue.slice(), appended.slice()).slice().toJson());
+  checkDiff(oldValue.slice(), appended.slice());
+
+  Builder truncated = modified(90, [](Builder& b, int i) { b.add(Value(i)); });
+  ASSERT_EQ("[3,90]",
+            Collection::diff(oldValue.slice(), truncated.slice()).slice().toJson());
+  checkDiff(oldValue.slice(), truncated.slice());
+  checkDiff(truncated.slice(), oldValue.slice());
+}
+
+TEST(CollectionTest, DiffReplace) {
+  std::shared_ptr<Builder> object = Parser::fromJson("{\"a\":1}");
+  std::shared_ptr<Builder> array = Parser::fromJson("[1]");
+  ASSERT_EQ("[1,[1]]", Collection::diff(object->slice(), array->slice())
+                           .slice().toJson());
+  ASSERT_EQ("[1,\"y\"]", Collection::diff(Parser::fromJson("\"x\"")->slice(),
+                                          Parser::fromJson("\"y\"")->slice())
+                             .slice().toJson());
+  ASSERT_EQ("[1,1.5]", Collection::diff(Parser::fromJson("1")->slice(),
+                                        Parser::fromJson("1.5")->slice())
+                           .slice().toJson());
+  checkDiff(object->slice(), array->slice());
+}
+
+TEST(CollectionTest, DiffNestedDocuments) {
+  std::string const json(
+      "{\"_key\":\"abc\",\"values\":[1,2,3,{\"deep\":{\"er\":[true,false]}}],"
+      "\"attrs\":{\"a\":\"a\",\"b\":\"b\",\"c\":{\"d\":[\"e\",\"f\"]}},"
+      "\"padding\":\"" + std::string(200, '.') + "\"}");
+  std::shared_ptr<Builder> base = Parser::fromJson(json);
+
+  std::vector<std::string> const variants{
+      "{\"_key\":\"abc\",\"values\":[1,2,3,{\"deep\":{\"er\":[true,true]}}],"
+      "\"attrs\":{\"a\":\"a\",\"b\":\"b\",\"c\":{\"d\":[\"e\",\"f\"]}},"
+      "\"padding\":\"" + std::string(200, '.') + "\"}",
+      "{\"_key\":\"abc\",\"values\":[1,2,3,{\"deep\":{\"er\":[true,false]}}],"
+      "\"attrs\":{\"b\":\"b\",\"c\":{\"d\":[\"e\",\"f\",\"g\"]},\"z\":[]},"
+      "\"padding\":\"" + std::string(200, '.') + "\"}",
+      "{\"_key\":\"abd\",\"values\":[],\"attrs\":null,"
+      "\"padding\":\"" + std::string(200, '.') + "\"}",
+      "[1,2,3]",
+      "{}"};
+
+  for (auto const& variant : variants) {
+    std::shared_ptr<Builder> other = Parser::fromJson(variant);
+    checkDiff(base->slice(), other->slice());
+    checkDiff(other->slice(), base->slice());
+
+    // at worst, the patch replaces the value
+    Builder patch = Collection::diff(base->slice(), other->slice());
+    ASSERT_LE(patch.slice().byteSize(), other->slice().byteSize() + 10);
+  }
+
+  // a small edit results in a small patch
+  std::shared_ptr<Builder> edited = Parser::fromJson(variants[0]);
+  ASSERT_LT(Collection::diff(base->slice(), edited->slice()).slice().byteSize(),
+            edited->slice().byteSize() / 4);
+}
+
+TEST(CollectionTest, DiffStringReferences) {
+  Options options;
+  options.dedupeStrings = true;
+
+  // the inner Arrays have equal bytes, but refer to different Strings
+  std::string const padding(",\"" + std::string(100, '.') + "\"]");
+  std::shared_ptr<Builder> oldValue =
+      Parser::fromJson("[\"aaaaaaaa\",[\"aaaaaaaa\"]" + padding, &options);
+  std::shared_ptr<Builder> newValue =
+      Parser::fromJson("[\"bbbbbbbb\",[\"bbbbbbbb\"]" + padding, &options);
+  ASSERT_TRUE(oldValue->slice().at(1).at(0).isStringReference());
+  ASSERT_EQ(oldValue->slice().at(1).byteSize(),
+            newValue->slice().at(1).byteSize());
+  ASSERT_EQ(0, memcmp(oldValue->slice().at(1).start(),
+                      newValue->slice().at(1).start(),
+                      oldValue->slice().at(1).byteSize()));
+
+  Builder patch =
+      Collection::diff(oldValue->slice(), newValue->slice(), &options);
+  ASSERT_EQ("[3,3,0,[1,\"bbbbbbbb\"],1,[1,[\"bbbbbbbb\"]]]",
+            patch.slice().toJson());
+  checkDiff(oldValue->slice(), newValue->slice(), &options);
+
+  Builder result =
+      Collection::apply(oldValue->slice(), patch.slice(), &options);
+  ASSERT_TRUE(isValid(result.slice()));
+  ASSERT_TRUE(result.slice().at(1).at(0).isStringReference());
+  ASSERT_EQ(newValue->slice().toJson(), result.slice().toJson());
+
+  // without dedupeStrings, the referenced Strings are copied themselves
+  result = Collection::apply(oldValue->slice(), patch.slice());
+  ASSERT_TRUE(isValid(result.slice()));
+  ASSERT_FALSE(result.slice().at(1).at(0).isStringReference());
+  ASSERT_EQ(newValue->slice().toJson(), result.slice().toJson());
+
+  // a String and a reference to an equal String are equal
+  std::shared_ptr<Builder> plain =
+      Parser::fromJson("[\"aaaaaaaa\",[\"aaaaaaaa\"]" + padding);
+  ASSERT_EQ("[]", Collection::diff(oldValue->slice(), plain->slice(), &options)
+                      .slice().toJson());
+}
+
+TEST(CollectionTest, ApplyPatchFromJson) {
+  std::shared_ptr<Builder> value =
+      Parser::fromJson("{\"a\":[1,2,3],\"b\":{\"c\":1}}");
+  std::shared_ptr<Builder> patch = Parser::fromJson(
+      "[2,{\"a\":[3,4,1,[1,\"x\"],3,[1,4]],\"b\":[2,{\"c\":[0],\"d\":[1,2]}]}]");
+  ASSERT_EQ("{\"a\":[1,\"x\",3,4],\"b\":{\"d\":2}}",
+            Collection::apply(value->slice(), patch->slice()).slice().toJson());
+}
+
+TEST(CollectionTest, ApplyInvalidPatch) {
+  std::shared_ptr<Builder> object = Parser::fromJson("{\"a\":1}");
+  std::shared_ptr<Builder> array = Parser::fromJson("[1,2]");
+
+  for (std::string const json :
+       {"{}", "1", "[-1]", "[4]", "[\"x\"]", "[0]", "[1]", "[1,2,3]",
+        "[2,[]]", "[2,{\"a\":5}]", "[2,{\"a\":[0,1]}]", "[3,2]", "[2]"}) {
+    std::shared_ptr<Builder> patch = Parser::fromJson(json);
+    ASSERT_VELOCYPACK_EXCEPTION(Collection::apply(object->slice(), patch->slice()),
+                                Exception::InvalidValueType);
+  }
+
+  for (std::string const json :
+       {"[2,{}]", "[3,3]", "[3,2,0]", "[3,2,1,[1,1],0,[1,1]]",
+        "[3,2,2,[1,1]]", "[3,3,2,[0]]", "[3,3,2,[2,{}]]", "[3,2,-1,[1,1]]"}) {
+    std::shared_ptr<Builder> patch = Parser::fromJson(json);
+    ASSERT_VELOCYPACK_EXCEPTION(Collection::apply(array->slice(), patch->slice()),
+                                Exception::InvalidValueType);
+  }
+
+  // removing or patching a missing attribute
+  for (std::string const json : {"[2,{\"b\":[0]}]", "[2,{\"b\":[2,{}]}]"}) {
+    std::shared_ptr<Builder> patch = Parser::fromJson(json);
+    ASSERT_VELOCYPACK_EXCEPTION(Collection::apply(object->slice(), patch->slice()),
+                                Exception::InvalidValueType);
+  }
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
 
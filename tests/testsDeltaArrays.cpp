@@ -0,0 +1,353 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "tests-common.h"
+
+static void checkMembers(Slice s, std::vector<int64_t> const& values) {
+  ASSERT_TRUE(s.isDeltaArray());
+  ASSERT_TRUE(s.isPackedArray());
+  ASSERT_TRUE(s.isArray());
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(values.size(), s.length());
+
+  DeltaSpan span = s.getDelta();
+  ASSERT_EQ(values.size(), span.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(values[i], span[i]);
+    ASSERT_EQ(values[i], span.at(i));
+  }
+
+  size_t i = 0;
+  for (int64_t v : span) {
+    ASSERT_EQ(values[i], v);
+    ++i;
+  }
+  ASSERT_EQ(values.size(), i);
+
+  std::vector<int64_t> decoded(values.size());
+  span.copyTo(decoded.data());
+  ASSERT_EQ(values, decoded);
+
+  i = 0;
+  for (auto member : ArrayIterator(s)) {
+    ASSERT_TRUE(member.isInteger());
+    ASSERT_TRUE(isValid(member));
+    ASSERT_EQ(values[i], member.getInt());
+    ++i;
+  }
+  ASSERT_EQ(values.size(), i);
+}
+
+TEST(DeltaArraysTest, Format) {
+  Builder b;
+  int64_t const values[] = {1000, 1010, 1020, 1031};
+  b.addDelta(values, 4);
+
+  uint8_t const expected[] = {0xe4, 0x0a, 0x04, 0xd0, 0x0f,
+                              0x14, 0x01, 0x00, 0x00, 0x01};
+  Slice s = b.slice();
+  ASSERT_EQ(sizeof(expected), s.byteSize());
+  ASSERT_EQ(0, memcmp(expected, s.start(), sizeof(expected)));
+  ASSERT_EQ(ValueType::Array, s.type());
+  ASSERT_EQ("[1000,1010,1020,1031]", s.toJson());
+  checkMembers(s, {1000, 1010, 1020, 1031});
+}
+
+TEST(DeltaArraysTest, Empty) {
+  Builder b;
+  b.addDelta(nullptr, 0);
+
+  Slice s = b.slice();
+  ASSERT_EQ(3UL, s.byteSize());
+  ASSERT_EQ(0UL, s.length());
+  ASSERT_TRUE(s.getDelta().empty());
+  ASSERT_EQ("[]", s.toJson());
+  checkMembers(s, {});
+}
+
+TEST(DeltaArraysTest, ZigZag) {
+  ASSERT_EQ(0ULL, zigZagEncode(0));
+  ASSERT_EQ(1ULL, zigZagEncode(-1));
+  ASSERT_EQ(2ULL, zigZagEncode(1));
+  ASSERT_EQ(3ULL, zigZagEncode(-2));
+  for (int64_t v : {int64_t(0), int64_t(1), int64_t(-1), int64_t(123456789),
+                    int64_t(-987654321),
+                    (std::numeric_limits<int64_t>::min)(),
+                    (std::numeric_limits<int64_t>::max)()}) {
+    ASSERT_EQ(v, zigZagDecode(zigZagEncode(v)));
+  }
+}
+
+TEST(DeltaArraysTest, BuildTimestamps) {
+  Options options;
+  options.buildDeltaArrays = true;
+
+  Builder plain;
+  Builder b(&options);
+  plain.openArray();
+  b.openArray();
+  std::vector<int64_t> values;
+  int64_t t = 1500000000000LL;
+  for (int i = 0; i < 1000; ++i) {
+    // regular intervals with some jitter
+    t += 1000 + (i % 7 == 0 ? 3 : 0);
+    values.push_back(t);
+    plain.add(Value(t));
+    b.add(Value(t));
+  }
+  plain.close();
+  b.close();
+
+  Slice s = b.slice();
+  checkMembers(s, values);
+  ASSERT_LT(s.byteSize() * 5, plain.slice().byteSize());
+  ASSERT_EQ(plain.slice().toJson(), s.toJson());
+  ASSERT_EQ(plain.slice().normalizedHash(), s.normalizedHash());
+}
+
+TEST(DeltaArraysTest, Widths) {
+  for (int64_t range : {int64_t(0), int64_t(200), int64_t(60000),
+                        int64_t(4000000000LL), int64_t(1LL << 40)}) {
+    std::vector<int64_t> values;
+    int64_t v = -5000;
+    for (int i = 0; i < 150; ++i) {
+      values.push_back(v);
+      v += 17 + (i % 2 == 0 ? range : 0);
+    }
+    Builder b;
+    b.addDelta(values.data(), values.size());
+    checkMembers(b.slice(), values);
+  }
+}
+
+TEST(DeltaArraysTest, WrapAround) {
+  int64_t const lo = (std::numeric_limits<int64_t>::min)();
+  int64_t const hi = (std::numeric_limits<int64_t>::max)();
+  std::vector<int64_t> values{lo, hi, lo, 0, hi, -1, 1, lo, lo, hi};
+
+  Builder b;
+  b.addDelta(values.data(), values.size());
+  checkMembers(b.slice(), values);
+}
+
+TEST(DeltaArraysTest, BlockBoundaries) {
+  uint64_t seed = 42;
+  for (size_t n : {1, 2, 3, 63, 64, 65, 127, 128, 129, 200, 1000}) {
+    std::vector<int64_t> values;
+    for (size_t i = 0; i < n; ++i) {
+      seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+      values.push_back(static_cast<int64_t>(i * 100) +
+                       static_cast<int64_t>(seed >> 58));
+    }
+    Builder b;
+    b.addDelta(values.data(), values.size());
+    checkMembers(b.slice(), values);
+
+    uint8_t buffer[9];
+    for (size_t i = 0; i < n; ++i) {
+      Slice member = b.slice().packedAt(i, buffer);
+      ASSERT_EQ(values[i], member.getInt());
+    }
+    ASSERT_VELOCYPACK_EXCEPTION(b.slice().packedAt(n, buffer),
+                                Exception::IndexOutOfBounds);
+    ASSERT_VELOCYPACK_EXCEPTION(b.slice().getDelta().at(n),
+                                Exception::IndexOutOfBounds);
+  }
+}
+
+TEST(DeltaArraysTest, IteratorForward) {
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < 300; ++i) {
+    values.push_back(i * i);
+  }
+  Builder b;
+  b.addDelta(values.data(), values.size());
+
+  ArrayIterator it(b.slice());
+  it.forward(10);
+  ASSERT_EQ(100, (*it).getInt());
+  it.forward(100);
+  ASSERT_EQ(110 * 110, (*it).getInt());
+  it.next();
+  ASSERT_EQ(111 * 111, it.value().getInt());
+  it.forward(188);
+  ASSERT_TRUE(it.valid());
+  ASSERT_EQ(299 * 299, it.value().getInt());
+  it.next();
+  ASSERT_FALSE(it.valid());
+
+  it.reset();
+  ASSERT_EQ(0, it.value().getInt());
+}
+
+TEST(DeltaArraysTest, MembersCompareToRegularValues) {
+  std::vector<int64_t> values;
+  for (int64_t i = 100; i <= 113; ++i) {
+    values.push_back(i);
+  }
+  values.push_back(-3);
+  values.push_back(int64_t(1) << 40);
+  Builder b;
+  b.addDelta(values.data(), values.size());
+  Slice s = b.slice();
+
+  for (size_t i = 0; i < values.size(); ++i) {
+    Builder v;
+    v.add(Value(values[i]));
+    ASSERT_TRUE(Collection::contains(s, v.slice()));
+    ASSERT_EQ(i, Collection::indexOf(s, v.slice()));
+  }
+
+  Builder missing;
+  missing.add(Value(114));
+  ASSERT_FALSE(Collection::contains(s, missing.slice()));
+  ASSERT_EQ(Collection::NotFound, Collection::indexOf(s, missing.slice()));
+}
+
+TEST(DeltaArraysTest, NotEligible) {
+  Options options;
+  options.buildDeltaArrays = true;
+
+  for (std::string const json :
+       {"[1,2,3]", "[1000,2000.5,3000]", "[1000,\"a\",3000]",
+        "[18446744073709551615,1,2,3,4,5,6,7,8,9,10,11]",
+        "[1000,2000,3000,[4000]]", "[]"}) {
+    std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+    ASSERT_FALSE(b->slice().isDeltaArray());
+    ASSERT_EQ(json, b->slice().toJson());
+  }
+
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("[100000,100001,100002,100003]", &options);
+  ASSERT_TRUE(b->slice().isDeltaArray());
+  ASSERT_EQ("[100000,100001,100002,100003]", b->slice().toJson());
+}
+
+TEST(DeltaArraysTest, PackedArraysPreferredIfSmaller) {
+  Options options;
+  options.buildDeltaArrays = true;
+  options.buildPackedArrays = true;
+
+  // random values: differences are as large as the values
+  uint64_t seed = 1;
+  std::string json = "[";
+  for (int i = 0; i < 100; ++i) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json += std::to_string(static_cast<int64_t>(seed));
+  }
+  json.push_back(']');
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  ASSERT_TRUE(b->slice().isPackedArray());
+  ASSERT_FALSE(b->slice().isDeltaArray());
+  ASSERT_EQ(0xe1, b->slice().head());
+
+  json = "[";
+  for (int i = 0; i < 100; ++i) {
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json += std::to_string(1000000 + i);
+  }
+  json.push_back(']');
+  b = Parser::fromJson(json, &options);
+  ASSERT_TRUE(b->slice().isDeltaArray());
+}
+
+TEST(DeltaArraysTest, Nested) {
+  Options options;
+  options.buildDeltaArrays = true;
+
+  std::string const json(
+      "{\"events\":[1500000000000,1500000001000,1500000002000,"
+      "1500000003000,1500000004000],\"name\":\"foo\"}");
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_TRUE(s.get("events").isDeltaArray());
+  ASSERT_EQ(5UL, s.get("events").length());
+  ASSERT_EQ(json, s.toJson());
+  ASSERT_VELOCYPACK_EXCEPTION(s.get("events").at(0),
+                              Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(s.get("name").getDelta(),
+                              Exception::InvalidValueType);
+}
+
+TEST(DeltaArraysTest, Validator) {
+  Validator validator;
+
+  std::vector<int64_t> values;
+  for (int64_t i = 0; i < 200; ++i) {
+    values.push_back(i * 3 + (i % 5));
+  }
+  Builder b;
+  b.addDelta(values.data(), values.size());
+  std::string data(b.slice().startAs<char>(), b.slice().byteSize());
+  ASSERT_TRUE(validator.validate(data.data(), data.size()));
+
+  // truncated
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(data.data(), data.size() - 1),
+                              Exception::ValidatorInvalidLength);
+
+  // block offset not matching the blocks
+  std::string broken(data);
+  broken[broken.size() - 4]++;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(broken.data(), broken.size()),
+                              Exception::ValidatorInvalidLength);
+
+  // invalid width in the first block, which follows the type byte, two
+  // bytes each of byte length and number of members, and one byte each
+  // of base and step
+  broken = data;
+  ASSERT_EQ(1, broken[7]);
+  broken[7] = 3;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(broken.data(), broken.size()),
+                              Exception::ValidatorInvalidType);
+
+  // too many members for the payload
+  char const tooMany[] = "\xe4\x06\x03\x02\x02\x01";
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(tooMany, 6),
+                              Exception::ValidatorInvalidLength);
+  char const valid[] = "\xe4\x06\x03\x02\x02\x00";
+  ASSERT_TRUE(validator.validate(valid, 6));
+
+  // unused bytes after the blocks
+  char const trailing[] = "\xe4\x05\x01\x02\x00";
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(trailing, 5),
+                              Exception::ValidatorInvalidLength);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -27,6 +27,11 @@
 #include <ostream>
 #include <string>
 
+#ifndef _WIN32
+#include <cstdlib>
+#include <unistd.h>
+#endif
+
 #include "tests-common.h"
 
 static unsigned char LocalBuffer[4096];
@@ -132,6 +137,125 @@ TEST(SinkTest, OStreamAppenders) {
   ASSERT_EQ("1abcdeffoobarquetzalcoatl*", result.str());
 }
 
+#ifndef _WIN32
+static std::string readFdContents(int fd) {
+  std::string result;
+  char buffer[4096];
+  ::lseek(fd, 0, SEEK_SET);
+  while (true) {
+    ssize_t n = ::read(fd, &buffer[0], sizeof(buffer));
+    if (n <= 0) {
+      break;
+    }
+    result.append(&buffer[0], static_cast<size_t>(n));
+  }
+  return result;
+}
+
+static int makeTempFile() {
+  char name[] = "/tmp/vpack-fdsink-XXXXXX";
+  int fd = ::mkstemp(&name[0]);
+  if (fd >= 0) {
+    ::unlink(&name[0]);
+  }
+  return fd;
+}
+
+TEST(SinkTest, FdAppenders) {
+  int fd = makeTempFile();
+  ASSERT_TRUE(fd >= 0);
+
+  {
+    // use a tiny buffer so that all code paths are taken
+    FdSink sink(fd, 8);
+    sink.push_back('1');
+    ASSERT_EQ(1UL, sink.bytesWritten());
+    // nothing written yet
+    ASSERT_EQ("", readFdContents(fd));
+
+    sink.append(std::string("abcdef"));
+    ASSERT_EQ(7UL, sink.bytesWritten());
+
+    sink.append("foobar", strlen("foobar"));
+    ASSERT_EQ(13UL, sink.bytesWritten());
+
+    sink.append("quetzalcoatl");
+    ASSERT_EQ(25UL, sink.bytesWritten());
+
+    sink.push_back('*');
+    ASSERT_EQ(26UL, sink.bytesWritten());
+
+    sink.flush();
+    ASSERT_EQ("1abcdeffoobarquetzalcoatl*", readFdContents(fd));
+
+    sink.push_back('!');
+  }
+
+  // destructor must have flushed
+  ASSERT_EQ("1abcdeffoobarquetzalcoatl*!", readFdContents(fd));
+  ::close(fd);
+}
+
+TEST(SinkTest, FdLargeAppends) {
+  int fd = makeTempFile();
+  ASSERT_TRUE(fd >= 0);
+
+  std::string expected;
+  {
+    FdSink sink(fd, 1024);
+    for (size_t i = 0; i < 100; ++i) {
+      std::string chunk(i * 97, static_cast<char>('a' + (i % 26)));
+      sink.append(chunk);
+      sink.push_back('|');
+      expected.append(chunk);
+      expected.push_back('|');
+    }
+    ASSERT_EQ(expected.size(), sink.bytesWritten());
+    sink.flush();
+  }
+
+  ASSERT_EQ(expected, readFdContents(fd));
+  ::close(fd);
+}
+
+TEST(SinkTest, FdDumperOutput) {
+  std::string const value(
+      "{\"foo\":\"bar\",\"baz\":[1,2,3,[4]],\"bark\":[{\"troet\\nmann\":1,"
+      "\"mötör\":[2,3.4,-42.5,true,false,null,\"some\\nstring\"]}]}");
+
+  Parser parser;
+  parser.parse(value);
+  Slice s(parser.start());
+
+  Options options;
+  options.prettyPrint = true;
+
+  std::string expected;
+  StringSink stringSink(&expected);
+  Dumper(&stringSink, &options).dump(s);
+
+  int fd = makeTempFile();
+  ASSERT_TRUE(fd >= 0);
+  {
+    FdSink sink(fd, 16);
+    Dumper dumper(&sink, &options);
+    dumper.dump(s);
+    sink.flush();
+    ASSERT_EQ(expected.size(), sink.bytesWritten());
+  }
+
+  ASSERT_EQ(expected, readFdContents(fd));
+  ::close(fd);
+}
+
+TEST(SinkTest, FdWriteError) {
+  FdSink sink(-1, 4);
+  sink.append("abc");
+  ASSERT_VELOCYPACK_EXCEPTION(sink.flush(), Exception::InternalError);
+  // the failed data is discarded, so destruction won't throw
+}
+#endif
+
 TEST(OutStreamTest, StringifyComplexObject) {
   std::string const value(
       "{\"foo\":\"bar\",\"baz\":[1,2,3,[4]],\"bark\":[{\"troet\\nmann\":1,"
@@ -1476,6 +1600,117 @@ TEST(DumperTest, EmptyAttributeName) {
   ASSERT_EQ(std::string(R"({"":123,"a":"abc"})"), buffer);
 }
 
+static void buildParallelTestData(Builder& b, bool object) {
+  if (object) {
+    b.openObject();
+  } else {
+    b.openArray();
+  }
+  for (size_t i = 0; i < 1000; ++i) {
+    if (object) {
+      b.add(Value("key" + std::to_string(i)));
+    }
+    b.openObject();
+    b.add("id", Value(i));
+    b.add("name", Value("name \"" + std::to_string(i) + "\"\n"));
+    b.add("values", Value(ValueType::Array));
+    for (size_t j = 0; j < i % 5; ++j) {
+      b.add(Value(j * 1.5));
+    }
+    b.close();
+    b.close();
+  }
+  b.close();
+}
+
+static void checkParallelDump(Slice const& s) {
+  for (bool pretty : {false, true}) {
+    Options options;
+    options.prettyPrint = pretty;
+
+    std::string const expected = Dumper::toString(s, &options);
+
+    for (size_t threads : {2, 3, 8}) {
+      for (ValueLength chunkSize : {1, 17, 1000, 100000}) {
+        std::string result;
+        StringSink sink(&result);
+        Dumper dumper(&sink, &options);
+        dumper.dumpParallel(s, threads, chunkSize);
+        ASSERT_EQ(expected, result);
+      }
+    }
+  }
+}
+
+TEST(DumperTest, ParallelArray) {
+  Builder b;
+  buildParallelTestData(b, false);
+  checkParallelDump(b.slice());
+}
+
+TEST(DumperTest, ParallelCompactArray) {
+  Options options;
+  options.buildUnindexedArrays = true;
+  options.buildUnindexedObjects = true;
+  Builder b(&options);
+  buildParallelTestData(b, false);
+  ASSERT_EQ(0x13, b.slice().head());
+  checkParallelDump(b.slice());
+}
+
+TEST(DumperTest, ParallelObject) {
+  Builder b;
+  buildParallelTestData(b, true);
+  checkParallelDump(b.slice());
+}
+
+TEST(DumperTest, ParallelCompactObject) {
+  Options options;
+  options.buildUnindexedObjects = true;
+  Builder b(&options);
+  buildParallelTestData(b, true);
+  ASSERT_EQ(0x14, b.slice().head());
+  checkParallelDump(b.slice());
+}
+
+TEST(DumperTest, ParallelFallbacks) {
+  Builder b;
+  b.add(Value("foobar"));
+  checkParallelDump(b.slice());
+
+  b.clear();
+  b.openArray();
+  b.close();
+  checkParallelDump(b.slice());
+
+  b.clear();
+  b.openObject();
+  b.add("a", Value(1));
+  b.close();
+  checkParallelDump(b.slice());
+}
+
+TEST(DumperTest, ParallelUnsupportedType) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 1000; ++i) {
+    if (i == 777) {
+      b.add(Value(ValueType::MinKey));
+    } else {
+      b.add(Value(i));
+    }
+  }
+  b.close();
+
+  Options options;
+  options.unsupportedTypeBehavior = Options::FailOnUnsupportedType;
+  std::string result;
+  StringSink sink(&result);
+  Dumper dumper(&sink, &options);
+  ASSERT_VELOCYPACK_EXCEPTION(dumper.dumpParallel(b.slice(), 4, 16),
+                              Exception::NoJsonEquivalent);
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
 
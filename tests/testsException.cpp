@@ -74,6 +74,12 @@ TEST(ExceptionTest, TestMessages) {
                Exception::message(Exception::ValidatorInvalidType));
   ASSERT_STREQ("Invalid length found in binary data",
                Exception::message(Exception::ValidatorInvalidLength));
+  ASSERT_STREQ("Cannot access file",
+               Exception::message(Exception::FileError));
+  ASSERT_STREQ("Invalid file format",
+               Exception::message(Exception::FileInvalidFormat));
+  ASSERT_STREQ("Checksum mismatch",
+               Exception::message(Exception::FileChecksumMismatch));
 
   ASSERT_STREQ("Unknown error", Exception::message(Exception::UnknownError));
   ASSERT_STREQ("Unknown error",
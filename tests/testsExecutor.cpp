@@ -0,0 +1,147 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+#include "tests-common.h"
+
+TEST(ExecutorTest, Concurrency) {
+  ThreadPool single(1);
+  ASSERT_EQ(1UL, single.concurrency());
+
+  ThreadPool pool(4);
+  ASSERT_EQ(4UL, pool.concurrency());
+
+  ThreadPool defaults;
+  ASSERT_TRUE(defaults.concurrency() >= 1);
+  ASSERT_TRUE(ThreadPool::instance().concurrency() >= 1);
+}
+
+TEST(ExecutorTest, RunNoTasks) {
+  ThreadPool pool(3);
+  std::vector<std::function<void()>> tasks;
+  pool.run(tasks);
+}
+
+TEST(ExecutorTest, RunAllTasks) {
+  for (size_t concurrency : {1, 2, 4, 7}) {
+    ThreadPool pool(concurrency);
+    for (size_t n : {1, 3, 100}) {
+      std::vector<std::atomic<int>> counters(n);
+      for (auto& it : counters) {
+        it.store(0);
+      }
+      std::vector<std::function<void()>> tasks;
+      for (size_t i = 0; i < n; ++i) {
+        tasks.emplace_back([&counters, i]() { ++counters[i]; });
+      }
+      pool.run(tasks);
+      for (auto const& it : counters) {
+        ASSERT_EQ(1, it.load());
+      }
+    }
+  }
+}
+
+TEST(ExecutorTest, RunRepeatedly) {
+  ThreadPool pool(4);
+  std::atomic<size_t> sum(0);
+  for (size_t round = 0; round < 200; ++round) {
+    std::vector<std::function<void()>> tasks;
+    for (size_t i = 0; i < 8; ++i) {
+      tasks.emplace_back([&sum, i]() { sum += i; });
+    }
+    pool.run(tasks);
+  }
+  ASSERT_EQ(200UL * 28, sum.load());
+}
+
+TEST(ExecutorTest, RunNested) {
+  ThreadPool pool(3);
+  std::atomic<size_t> count(0);
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < 6; ++i) {
+    tasks.emplace_back([&pool, &count]() {
+      std::vector<std::function<void()>> inner;
+      for (size_t j = 0; j < 6; ++j) {
+        inner.emplace_back([&count]() { ++count; });
+      }
+      pool.run(inner);
+    });
+  }
+  pool.run(tasks);
+  ASSERT_EQ(36UL, count.load());
+}
+
+TEST(ExecutorTest, RunFromSeveralThreads) {
+  ThreadPool pool(2);
+  std::atomic<size_t> count(0);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([&pool, &count]() {
+      for (size_t round = 0; round < 50; ++round) {
+        std::vector<std::function<void()>> tasks;
+        for (size_t i = 0; i < 5; ++i) {
+          tasks.emplace_back([&count]() { ++count; });
+        }
+        pool.run(tasks);
+      }
+    });
+  }
+  for (auto& it : threads) {
+    it.join();
+  }
+  ASSERT_EQ(4UL * 50 * 5, count.load());
+}
+
+TEST(ExecutorTest, RunRethrows) {
+  ThreadPool pool(4);
+  std::atomic<size_t> count(0);
+  std::vector<std::function<void()>> tasks;
+  for (size_t i = 0; i < 10; ++i) {
+    tasks.emplace_back([&count, i]() {
+      ++count;
+      if (i == 5) {
+        throw Exception(Exception::InternalError);
+      }
+    });
+  }
+  ASSERT_VELOCYPACK_EXCEPTION(pool.run(tasks), Exception::InternalError);
+  // all tasks ran nevertheless
+  ASSERT_EQ(10UL, count.load());
+
+  tasks.clear();
+  tasks.emplace_back([]() { throw std::runtime_error("foo"); });
+  ASSERT_THROW(pool.run(tasks), std::runtime_error);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
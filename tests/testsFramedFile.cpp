@@ -0,0 +1,333 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "tests-common.h"
+
+namespace {
+
+// a temporary file that is removed at the end of the test
+struct TempFile {
+  TempFile() {
+#ifndef _WIN32
+    char name[] = "/tmp/vpack-framed-XXXXXX";
+    int fd = ::mkstemp(name);
+    if (fd >= 0) {
+      ::close(fd);
+    }
+    path = name;
+#else
+    path = std::tmpnam(nullptr);
+#endif
+  }
+
+  ~TempFile() { std::remove(path.c_str()); }
+
+  std::string path;
+};
+
+std::string readContents(std::string const& path) {
+  std::ifstream ifs(path, std::ifstream::in | std::ifstream::binary);
+  return std::string(std::istreambuf_iterator<char>(ifs),
+                     std::istreambuf_iterator<char>());
+}
+
+void writeDocuments(std::string const& path, size_t n, bool checksums) {
+  FramedFileWriter writer(path, checksums);
+  for (size_t i = 0; i < n; ++i) {
+    Builder b;
+    b.openObject();
+    b.add("id", Value(i));
+    b.add("name", Value("document" + std::to_string(i)));
+    b.close();
+    writer.append(b.slice());
+  }
+  ASSERT_EQ(n, writer.size());
+  writer.finish();
+}
+
+}  // namespace
+
+TEST(FramedFileTest, Format) {
+  TempFile file;
+  {
+    FramedFileWriter writer(file.path, false);
+    writer.append(Slice::trueSlice());
+    Builder b;
+    b.add(Value("a"));
+    writer.append(b.slice());
+    writer.finish();
+  }
+
+  std::string const expected(
+      "VPKF\x01\x00\x00\x00"
+      "\x01\x00\x00\x00\x00\x00\x00\x00\x1a"
+      "\x02\x00\x00\x00\x00\x00\x00\x00\x41\x61"
+      "\x08\x00\x00\x00\x00\x00\x00\x00"
+      "\x11\x00\x00\x00\x00\x00\x00\x00"
+      "\x1b\x00\x00\x00\x00\x00\x00\x00"
+      "\x02\x00\x00\x00\x00\x00\x00\x00"
+      "VPKF",
+      63);
+  ASSERT_EQ(expected, readContents(file.path));
+
+  FramedFileReader reader(file.path);
+  ASSERT_FALSE(reader.hasChecksums());
+  ASSERT_EQ(2UL, reader.size());
+  ASSERT_TRUE(reader.document(0).isTrue());
+  ASSERT_EQ("a", reader[1].copyString());
+}
+
+TEST(FramedFileTest, WriteAndRead) {
+  TempFile file;
+  size_t const n = 1000;
+  writeDocuments(file.path, n, true);
+
+  FramedFileReader reader(file.path);
+  ASSERT_TRUE(reader.hasChecksums());
+  ASSERT_FALSE(reader.empty());
+  ASSERT_EQ(n, reader.size());
+  for (size_t i : {size_t(0), size_t(1), size_t(500), n - 1}) {
+    Slice s = reader.document(i);
+    ASSERT_EQ(i, s.get("id").getUInt());
+    ASSERT_EQ("document" + std::to_string(i), s.get("name").copyString());
+  }
+
+  size_t i = 0;
+  for (Slice s : reader) {
+    ASSERT_EQ(i, s.get("id").getUInt());
+    reader.verify(i);
+    ++i;
+  }
+  ASSERT_EQ(n, i);
+
+  ASSERT_VELOCYPACK_EXCEPTION(reader.document(n), Exception::IndexOutOfBounds);
+  ASSERT_VELOCYPACK_EXCEPTION(reader.verify(n), Exception::IndexOutOfBounds);
+}
+
+TEST(FramedFileTest, WithoutChecksums) {
+  TempFile file;
+  writeDocuments(file.path, 10, false);
+
+  FramedFileReader reader(file.path);
+  ASSERT_FALSE(reader.hasChecksums());
+  ASSERT_EQ(10UL, reader.size());
+  for (size_t i = 0; i < reader.size(); ++i) {
+    reader.verify(i);
+    ASSERT_EQ(i, reader[i].get("id").getUInt());
+  }
+}
+
+TEST(FramedFileTest, Empty) {
+  TempFile file;
+  writeDocuments(file.path, 0, true);
+  ASSERT_EQ(28UL, readContents(file.path).size());
+
+  FramedFileReader reader(file.path);
+  ASSERT_TRUE(reader.empty());
+  ASSERT_FALSE(reader.begin() != reader.end());
+  ASSERT_TRUE(reader.split(4).empty());
+  reader.forEach(ParallelPolicy(), [](Slice, ValueLength) -> bool {
+    throw "must not be called";
+  });
+}
+
+TEST(FramedFileTest, DestructorFinishes) {
+  TempFile file;
+  {
+    FramedFileWriter writer(file.path);
+    writer.append(Slice::nullSlice());
+  }
+  FramedFileReader reader(file.path);
+  ASSERT_EQ(1UL, reader.size());
+  ASSERT_TRUE(reader[0].isNull());
+}
+
+TEST(FramedFileTest, AppendAfterFinish) {
+  TempFile file;
+  FramedFileWriter writer(file.path);
+  writer.finish();
+  writer.finish();
+  ASSERT_VELOCYPACK_EXCEPTION(writer.append(Slice::nullSlice()),
+                              Exception::FileError);
+}
+
+TEST(FramedFileTest, MissingFile) {
+  ASSERT_VELOCYPACK_EXCEPTION(
+      FramedFileReader("/this/file/does/not/exist.vpack"),
+      Exception::FileError);
+  ASSERT_VELOCYPACK_EXCEPTION(
+      FramedFileWriter("/this/directory/does/not/exist/file.vpack"),
+      Exception::FileError);
+}
+
+TEST(FramedFileTest, InvalidFiles) {
+  TempFile file;
+  writeDocuments(file.path, 3, true);
+  std::string const data = readContents(file.path);
+  auto open = [](std::string const& data) {
+    FramedFileReader reader(reinterpret_cast<uint8_t const*>(data.data()),
+                            data.size());
+    return reader.size();
+  };
+  ASSERT_EQ(3UL, open(data));
+
+  // not finished by the writer
+  ASSERT_VELOCYPACK_EXCEPTION(open(data.substr(0, data.size() - 1)),
+                              Exception::FileInvalidFormat);
+  ASSERT_VELOCYPACK_EXCEPTION(open(data.substr(0, 10)),
+                              Exception::FileInvalidFormat);
+  ASSERT_VELOCYPACK_EXCEPTION(open(std::string()),
+                              Exception::FileInvalidFormat);
+
+  std::string broken(data);
+  broken[0] = 'X';
+  ASSERT_VELOCYPACK_EXCEPTION(open(broken), Exception::FileInvalidFormat);
+
+  broken = data;
+  broken[4] = 2;
+  ASSERT_VELOCYPACK_EXCEPTION(open(broken), Exception::FileInvalidFormat);
+
+  // number of documents does not match the index
+  broken = data;
+  broken[broken.size() - 12]++;
+  ASSERT_VELOCYPACK_EXCEPTION(open(broken), Exception::FileInvalidFormat);
+
+  // offsets in the index out of order
+  broken = data;
+  broken[broken.size() - 20 - 8] = 8;
+  ASSERT_VELOCYPACK_EXCEPTION(open(broken), Exception::FileInvalidFormat);
+}
+
+TEST(FramedFileTest, CorruptDocuments) {
+  TempFile file;
+  writeDocuments(file.path, 3, true);
+  std::string data = readContents(file.path);
+
+  {
+    // flip a byte in the payload of the second document's name
+    std::string broken(data);
+    FramedFileReader reader(reinterpret_cast<uint8_t const*>(data.data()),
+                            data.size());
+    Slice name = reader[1].get("name");
+    size_t const pos = name.start() + 3 - reinterpret_cast<uint8_t const*>(data.data());
+    broken[pos] ^= 0x20;
+
+    FramedFileReader other(reinterpret_cast<uint8_t const*>(broken.data()),
+                           broken.size());
+    other.verify(0);
+    ASSERT_VELOCYPACK_EXCEPTION(other.verify(1),
+                                Exception::FileChecksumMismatch);
+    other.verify(2);
+  }
+
+  {
+    // document length not matching the frame
+    std::string broken(data);
+    broken[8]++;
+    FramedFileReader reader(reinterpret_cast<uint8_t const*>(broken.data()),
+                            broken.size());
+    ASSERT_VELOCYPACK_EXCEPTION(reader.document(0),
+                                Exception::FileInvalidFormat);
+    ASSERT_EQ(1UL, reader[1].get("id").getUInt());
+  }
+}
+
+TEST(FramedFileTest, Split) {
+  TempFile file;
+  writeDocuments(file.path, 10, true);
+  FramedFileReader reader(file.path);
+
+  auto ranges = reader.split(3);
+  ASSERT_EQ(3UL, ranges.size());
+  ValueLength expected = 0;
+  for (auto const& range : ranges) {
+    ASSERT_EQ(expected, range.from);
+    for (Slice s : range) {
+      ASSERT_EQ(expected, s.get("id").getUInt());
+      ++expected;
+    }
+    ASSERT_EQ(expected, range.to);
+  }
+  ASSERT_EQ(10UL, expected);
+
+  ASSERT_EQ(10UL, reader.split(100).size());
+  ASSERT_EQ(1UL, reader.split(0).size());
+}
+
+TEST(FramedFileTest, ParallelScan) {
+  TempFile file;
+  size_t const n = 5000;
+  writeDocuments(file.path, n, true);
+  FramedFileReader reader(file.path);
+
+  ThreadPool pool(4);
+  ParallelPolicy policy(&pool, 100);
+
+  std::atomic<uint64_t> sum(0);
+  std::atomic<size_t> count(0);
+  reader.forEach(policy, [&](Slice s, ValueLength index) {
+    if (s.get("id").getUInt() != index) {
+      return false;
+    }
+    sum += index;
+    ++count;
+    return true;
+  });
+  ASSERT_EQ(n, count.load());
+  ASSERT_EQ(uint64_t(n) * (n - 1) / 2, sum.load());
+
+  // stop early
+  count = 0;
+  reader.forEach(policy, [&](Slice, ValueLength index) {
+    ++count;
+    return index < 10;
+  });
+  ASSERT_LT(count.load(), n);
+
+  // sequential without a second chunk
+  count = 0;
+  reader.forEach(ParallelPolicy(&pool, n), [&](Slice, ValueLength) {
+    ++count;
+    return true;
+  });
+  ASSERT_EQ(n, count.load());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
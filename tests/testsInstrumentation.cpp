@@ -0,0 +1,229 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tests-common.h"
+
+static std::vector<std::pair<Instrumentation::Counter, uint64_t>> traced;
+
+static void traceHook(Instrumentation::Counter counter, uint64_t amount) {
+  traced.emplace_back(counter, amount);
+}
+
+TEST(InstrumentationTest, CounterNames) {
+  for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+    std::string name =
+        Instrumentation::counterName(static_cast<Instrumentation::Counter>(i));
+    ASSERT_NE("unknown", name);
+  }
+  ASSERT_EQ(std::string("unknown"),
+            Instrumentation::counterName(Instrumentation::NumCounters));
+}
+
+TEST(InstrumentationTest, SnapshotDifference) {
+  Instrumentation::Snapshot a;
+  Instrumentation::Snapshot b;
+  for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+    a.values[i] = 10 + i;
+    b.values[i] = i;
+  }
+  Instrumentation::Snapshot d = a - b;
+  for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+    ASSERT_EQ(10UL, d[static_cast<Instrumentation::Counter>(i)]);
+  }
+}
+
+TEST(InstrumentationTest, BuilderCounters) {
+  Instrumentation::resetThread();
+
+  Builder b;
+  b.openObject();
+  b.add("z", Value(1));
+  b.add("a", Value(2));
+  b.add("m", Value(ValueType::Array, true));
+  b.add(Value(1));
+  b.add(Value("foo"));
+  b.close();
+  b.add("x", Value(ValueType::Array));
+  b.add(Value(1));
+  b.add(Value(2));
+  b.close();
+  b.close();
+
+  Instrumentation::Snapshot s = Instrumentation::threadSnapshot();
+  if (!Instrumentation::enabled()) {
+    for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+      ASSERT_EQ(0UL, s[static_cast<Instrumentation::Counter>(i)]);
+    }
+    return;
+  }
+
+  ASSERT_EQ(1UL, s[Instrumentation::CompactArrays]);
+  ASSERT_EQ(1UL, s[Instrumentation::IndexedArrays]);
+  ASSERT_EQ(0UL, s[Instrumentation::CompactObjects]);
+  ASSERT_EQ(1UL, s[Instrumentation::IndexedObjects]);
+  ASSERT_EQ(1UL, s[Instrumentation::ObjectIndexSorts]);
+  ASSERT_EQ(4UL, s[Instrumentation::ObjectIndexSortedMembers]);
+  ASSERT_EQ(3UL, s[Instrumentation::BuilderCloseMemmoves]);
+  ASSERT_TRUE(s[Instrumentation::BuilderCloseBytesMoved] > 0);
+
+  Instrumentation::resetThread();
+  s = Instrumentation::threadSnapshot();
+  for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+    ASSERT_EQ(0UL, s[static_cast<Instrumentation::Counter>(i)]);
+  }
+}
+
+TEST(InstrumentationTest, BufferCounters) {
+  Instrumentation::resetThread();
+
+  Buffer<uint8_t> buffer;
+  std::string const data(1000, 'x');
+  for (int i = 0; i < 10; ++i) {
+    buffer.append(data);
+  }
+
+  Instrumentation::Snapshot s = Instrumentation::threadSnapshot();
+  if (Instrumentation::enabled()) {
+    ASSERT_TRUE(s[Instrumentation::BufferReallocations] > 0);
+    ASSERT_TRUE(s[Instrumentation::BufferBytesCopied] > 0);
+    ASSERT_TRUE(s[Instrumentation::BufferBytesCopied] < 100000);
+  } else {
+    ASSERT_EQ(0UL, s[Instrumentation::BufferReallocations]);
+  }
+}
+
+TEST(InstrumentationTest, KeySearches) {
+  Builder b;
+  b.openObject();
+  for (int i = 0; i < 10; ++i) {
+    b.add("key" + std::to_string(i), Value(i));
+  }
+  b.close();
+  Builder c;
+  c.openObject(true);
+  c.add("a", Value(1));
+  c.close();
+
+  Instrumentation::resetThread();
+  ASSERT_EQ(5UL, b.slice().get("key5").getUInt());
+  ASSERT_TRUE(b.slice().get("foo").isNone());
+  ASSERT_EQ(1UL, c.slice().get("a").getUInt());
+
+  Instrumentation::Snapshot s = Instrumentation::threadSnapshot();
+  ASSERT_EQ(Instrumentation::enabled() ? 2UL : 0UL,
+            s[Instrumentation::BinaryKeySearches]);
+  ASSERT_EQ(Instrumentation::enabled() ? 1UL : 0UL,
+            s[Instrumentation::LinearKeySearches]);
+}
+
+TEST(InstrumentationTest, ParserCalls) {
+  Instrumentation::resetThread();
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("{ \"a\" : \"some longer string value\", \"b\" : 1 }");
+  ASSERT_TRUE(b->slice().isObject());
+
+  Instrumentation::Snapshot s = Instrumentation::threadSnapshot();
+  uint64_t const calls =
+      s[Instrumentation::ParserSimdCalls] + s[Instrumentation::ParserScalarCalls];
+  if (Instrumentation::enabled()) {
+    ASSERT_TRUE(calls > 0);
+  } else {
+    ASSERT_EQ(0UL, calls);
+  }
+}
+
+TEST(InstrumentationTest, GlobalSnapshot) {
+  Instrumentation::reset();
+
+  std::thread t([]() {
+    Builder b;
+    b.openArray();
+    b.add(Value(1));
+    b.add(Value("foo"));
+    b.close();
+  });
+  t.join();
+
+  Builder b;
+  b.openArray();
+  b.add(Value(1));
+  b.add(Value("foo"));
+  b.close();
+
+  Instrumentation::Snapshot local = Instrumentation::threadSnapshot();
+  Instrumentation::Snapshot global = Instrumentation::globalSnapshot();
+  if (Instrumentation::enabled()) {
+    ASSERT_EQ(1UL, local[Instrumentation::IndexedArrays]);
+    ASSERT_EQ(2UL, global[Instrumentation::IndexedArrays]);
+  } else {
+    ASSERT_EQ(0UL, global[Instrumentation::IndexedArrays]);
+  }
+}
+
+TEST(InstrumentationTest, TraceHook) {
+  traced.clear();
+  Instrumentation::resetThread();
+  Instrumentation::setTraceHook(&traceHook);
+
+  Builder b;
+  b.openArray(true);
+  b.add(Value(1));
+  b.close();
+
+  Instrumentation::setTraceHook(nullptr);
+  Instrumentation::Snapshot s = Instrumentation::threadSnapshot();
+  b.clear();
+  b.openArray(true);
+  b.add(Value(1));
+  b.close();
+
+  if (Instrumentation::enabled()) {
+    // the hook saw exactly the events counted
+    Instrumentation::Snapshot fromHook;
+    for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+      fromHook.values[i] = 0;
+    }
+    for (auto const& it : traced) {
+      fromHook.values[it.first] += it.second;
+    }
+    for (uint32_t i = 0; i < Instrumentation::NumCounters; ++i) {
+      ASSERT_EQ(s.values[i], fromHook.values[i]);
+    }
+    ASSERT_EQ(1UL, fromHook[Instrumentation::CompactArrays]);
+  } else {
+    ASSERT_TRUE(traced.empty());
+  }
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
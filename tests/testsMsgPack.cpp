@@ -0,0 +1,275 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+
+#include "tests-common.h"
+
+static std::string fromHex(char const* hex) {
+  std::string result;
+  while (*hex != '\0' && *(hex + 1) != '\0') {
+    if (*hex == ' ') {
+      ++hex;
+      continue;
+    }
+    result.push_back(static_cast<char>(std::stoi(std::string(hex, 2), nullptr, 16)));
+    hex += 2;
+  }
+  return result;
+}
+
+static std::string roundTrip(std::string const& json) {
+  Options options;
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  std::string msgpack = MsgPackDumper::toString(b->slice(), &options);
+  std::shared_ptr<Builder> b2 = MsgPackParser::fromMsgPack(msgpack, &options);
+  return b2->slice().toJson();
+}
+
+TEST(MsgPackTest, CreateWithoutOptions) {
+  ASSERT_VELOCYPACK_EXCEPTION(new MsgPackParser(nullptr),
+                              Exception::InternalError);
+
+  std::string result;
+  StringSink sink(&result);
+  ASSERT_VELOCYPACK_EXCEPTION(new MsgPackDumper(&sink, nullptr),
+                              Exception::InternalError);
+  ASSERT_VELOCYPACK_EXCEPTION(new MsgPackDumper(nullptr),
+                              Exception::InternalError);
+}
+
+TEST(MsgPackTest, DumpScalars) {
+  Builder b;
+  b.openArray();
+  b.add(Value(ValueType::Null));
+  b.add(Value(false));
+  b.add(Value(true));
+  b.add(Value(5));
+  b.add(Value(-5));
+  b.add(Value(-33));
+  b.add(Value(200));
+  b.add(Value(-200));
+  b.add(Value(70000));
+  b.add(Value(uint64_t(0xffffffffffffULL)));
+  b.add(Value(int64_t(-5000000000LL)));
+  b.add(Value(1.5));
+  b.add(Value("abc"));
+  b.close();
+
+  std::string expected = fromHex(
+      "9d c0 c2 c3 05 fb d0 df cc c8 d1 ff 38 ce 00 01 11 70"
+      "cf 00 00 ff ff ff ff ff ff d3 ff ff ff fe d5 fa 0e 00"
+      "cb 3f f8 00 00 00 00 00 00 a3 61 62 63");
+  ASSERT_EQ(expected, MsgPackDumper::toString(b.slice()));
+}
+
+TEST(MsgPackTest, ParseScalars) {
+  std::string data = fromHex(
+      "9e c0 c2 c3 05 fb d0 df cc c8 d1 ff 38 ce 00 01 11 70"
+      "cf ff ff ff ff ff ff ff ff d3 ff ff ff fe d5 fa 0e 00"
+      "ca 3f c0 00 00 cb 3f f8 00 00 00 00 00 00 a3 61 62 63");
+  std::shared_ptr<Builder> b = MsgPackParser::fromMsgPack(data);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.isArray());
+  ASSERT_EQ(14UL, s.length());
+  ASSERT_TRUE(s.at(0).isNull());
+  ASSERT_FALSE(s.at(1).getBool());
+  ASSERT_TRUE(s.at(2).getBool());
+  ASSERT_EQ(5, s.at(3).getInt());
+  ASSERT_EQ(-5, s.at(4).getInt());
+  ASSERT_EQ(-33, s.at(5).getInt());
+  ASSERT_EQ(200UL, s.at(6).getUInt());
+  ASSERT_EQ(-200, s.at(7).getInt());
+  ASSERT_EQ(70000UL, s.at(8).getUInt());
+  ASSERT_EQ(UINT64_MAX, s.at(9).getUInt());
+  ASSERT_EQ(-5000000000LL, s.at(10).getInt());
+  ASSERT_EQ(1.5, s.at(11).getDouble());
+  ASSERT_EQ(1.5, s.at(12).getDouble());
+  ASSERT_EQ("abc", s.at(13).copyString());
+}
+
+TEST(MsgPackTest, RoundTripJson) {
+  std::vector<std::string> values = {
+      "null", "true", "false", "0", "-1", "127", "128", "-32", "-33",
+      "255", "256", "65535", "65536", "-129", "-32769", "4294967296",
+      "-2147483649", "18446744073709551615", "-9223372036854775808",
+      "1.25", "-1.0e100", "\"\"", "\"foo\"", "[]", "{}", "[1,2,3]",
+      "{\"a\":1,\"b\":[true,{\"c\":\"d\"}]}"};
+
+  for (auto const& value : values) {
+    Options options;
+    std::shared_ptr<Builder> b = Parser::fromJson(value, &options);
+    ASSERT_EQ(b->slice().toJson(), roundTrip(value));
+  }
+}
+
+TEST(MsgPackTest, RoundTripLengths) {
+  for (size_t length : {0, 15, 16, 31, 32, 255, 256, 65535, 65536}) {
+    Builder b;
+    b.openObject();
+    b.add("string", Value(std::string(length, 'x')));
+    b.add("array", Value(ValueType::Array));
+    for (size_t i = 0; i < length; ++i) {
+      b.add(Value(i));
+    }
+    b.close();
+    b.add("object", Value(ValueType::Object));
+    for (size_t i = 0; i < (std::min)(length, size_t(300)); ++i) {
+      b.add(std::to_string(i), Value(i));
+    }
+    b.close();
+    b.close();
+
+    std::string data = MsgPackDumper::toString(b.slice());
+    std::shared_ptr<Builder> b2 = MsgPackParser::fromMsgPack(data);
+    ASSERT_EQ(b.slice().toJson(), b2->slice().toJson());
+  }
+}
+
+TEST(MsgPackTest, Binary) {
+  std::string payload("\x00\x01\x02\xff", 4);
+  Builder b;
+  b.add(ValuePair(payload.data(), payload.size(), ValueType::Binary));
+
+  std::string data = MsgPackDumper::toString(b.slice());
+  ASSERT_EQ(fromHex("c4 04 00 01 02 ff"), data);
+
+  std::shared_ptr<Builder> b2 = MsgPackParser::fromMsgPack(data);
+  Slice s = b2->slice();
+  ASSERT_TRUE(s.isBinary());
+  std::vector<uint8_t> binary = s.copyBinary();
+  ASSERT_EQ(payload, std::string(binary.begin(), binary.end()));
+}
+
+TEST(MsgPackTest, UTCDate) {
+  for (int64_t value : {int64_t(0), int64_t(1000), int64_t(1500),
+                        int64_t(1483228800000LL), int64_t(-1),
+                        int64_t(-86400000), int64_t(17179869184000LL),
+                        int64_t(17179869184123LL)}) {
+    Builder b;
+    b.add(Value(value, ValueType::UTCDate));
+
+    std::string data = MsgPackDumper::toString(b.slice());
+    std::shared_ptr<Builder> b2 = MsgPackParser::fromMsgPack(data);
+    Slice s = b2->slice();
+    ASSERT_TRUE(s.isUTCDate());
+    ASSERT_EQ(value, s.getUTCDate());
+  }
+
+  // timestamp 32
+  Builder b;
+  b.add(Value(int64_t(1000), ValueType::UTCDate));
+  ASSERT_EQ(fromHex("d6 ff 00 00 00 01"), MsgPackDumper::toString(b.slice()));
+}
+
+TEST(MsgPackTest, Extension) {
+  // fixext 2 with type 5, and ext 8 with 3 bytes of type -3
+  std::string data = fromHex("92 d5 05 aa bb c7 03 fd 01 02 03");
+  std::shared_ptr<Builder> b = MsgPackParser::fromMsgPack(data);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.at(0).isCustom());
+  ASSERT_EQ(0xf4, s.at(0).head());
+  ASSERT_EQ(5UL, s.at(0).byteSize());
+  ASSERT_EQ(0x05, s.at(0).start()[2]);
+  ASSERT_TRUE(s.at(1).isCustom());
+  ASSERT_EQ(6UL, s.at(1).byteSize());
+
+  ASSERT_EQ(data, MsgPackDumper::toString(s));
+}
+
+TEST(MsgPackTest, IntegerKeys) {
+  std::string data = fromHex("82 01 a1 61 d0 f0 c3");
+  std::shared_ptr<Builder> b = MsgPackParser::fromMsgPack(data);
+  ASSERT_EQ(std::string("{\"-16\":true,\"1\":\"a\"}"), b->slice().toJson());
+
+  // array as key
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("81 90 c0")),
+                              Exception::ParseError);
+}
+
+TEST(MsgPackTest, InvalidInput) {
+  // truncated
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("92 01")),
+                              Exception::ParseError);
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("a3 61 62")),
+                              Exception::ParseError);
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("cd 01")),
+                              Exception::ParseError);
+  // never used
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("c1")),
+                              Exception::ParseError);
+  // trailing data
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackParser::fromMsgPack(fromHex("01 02")),
+                              Exception::ParseError);
+  // invalid UTF-8
+  Options options;
+  options.validateUtf8Strings = true;
+  ASSERT_VELOCYPACK_EXCEPTION(
+      MsgPackParser::fromMsgPack(fromHex("a1 ff"), &options),
+      Exception::InvalidUtf8Sequence);
+}
+
+TEST(MsgPackTest, ParseMulti) {
+  std::string data = fromHex("01 a1 61 90");
+  MsgPackParser parser;
+  ASSERT_EQ(3UL, parser.parse(data, true));
+}
+
+TEST(MsgPackTest, UnsupportedTypes) {
+  Builder b;
+  b.add(Value(ValueType::MinKey));
+
+  Options options;
+  options.unsupportedTypeBehavior = Options::FailOnUnsupportedType;
+  ASSERT_VELOCYPACK_EXCEPTION(MsgPackDumper::toString(b.slice(), &options),
+                              Exception::NoJsonEquivalent);
+
+  options.unsupportedTypeBehavior = Options::NullifyUnsupportedType;
+  ASSERT_EQ(fromHex("c0"), MsgPackDumper::toString(b.slice(), &options));
+
+  options.unsupportedTypeBehavior = Options::ConvertUnsupportedType;
+  std::shared_ptr<Builder> b2 = MsgPackParser::fromMsgPack(
+      MsgPackDumper::toString(b.slice(), &options));
+  ASSERT_EQ("(non-representable type min-key)", b2->slice().copyString());
+}
+
+TEST(MsgPackTest, ExistingBuilder) {
+  Options options;
+  options.clearBuilderBeforeParse = false;
+  Builder b;
+  b.openArray();
+  MsgPackParser parser(b, &options);
+  parser.parse(fromHex("01"));
+  parser.parse(fromHex("a1 61"));
+  b.close();
+  ASSERT_EQ(std::string("[1,\"a\"]"), b.slice().toJson());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
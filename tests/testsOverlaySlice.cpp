@@ -0,0 +1,246 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <vector>
+
+#include "tests-common.h"
+
+static void checkAgainstMerge(std::string const& base, std::string const& patch,
+                              bool mergeValues, bool nullMeansRemove) {
+  std::shared_ptr<Builder> b = Parser::fromJson(base);
+  std::shared_ptr<Builder> p = Parser::fromJson(patch);
+  Builder expected =
+      Collection::merge(b->slice(), p->slice(), mergeValues, nullMeansRemove);
+
+  OverlaySlice overlay(b->slice(), p->slice(), mergeValues, nullMeansRemove);
+  ASSERT_EQ(expected.slice().toJson(), overlay.toJson());
+  ASSERT_EQ(expected.slice().length(), overlay.length());
+
+  Builder materialized = overlay.materialize();
+  ASSERT_EQ(expected.slice().toJson(), materialized.slice().toJson());
+
+  for (ObjectIterator it(expected.slice()); it.valid(); it.next()) {
+    OverlaySlice value = overlay.get(it.key().copyString());
+    ASSERT_FALSE(value.isNone());
+    ASSERT_EQ(it.value().toJson(), value.toJson());
+  }
+}
+
+TEST(OverlaySliceTest, NonObjects) {
+  Builder obj;
+  obj.openObject();
+  obj.close();
+  Builder arr;
+  arr.openArray();
+  arr.close();
+
+  ASSERT_VELOCYPACK_EXCEPTION(OverlaySlice(obj.slice(), arr.slice()),
+                              Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(OverlaySlice(arr.slice(), obj.slice()),
+                              Exception::InvalidValueType);
+}
+
+TEST(OverlaySliceTest, PlainValue) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1,2,3]");
+  OverlaySlice value(b->slice());
+
+  ASSERT_FALSE(value.isOverlay());
+  ASSERT_FALSE(value.isObject());
+  ASSERT_EQ(ValueType::Array, value.type());
+  ASSERT_EQ(3UL, value.length());
+  ASSERT_EQ("[1,2,3]", value.toJson());
+  ASSERT_EQ(b->slice().start(), value.slice().start());
+}
+
+TEST(OverlaySliceTest, Get) {
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("{\"a\":1,\"b\":{\"x\":1,\"y\":2},\"c\":\"foo\"}");
+  std::shared_ptr<Builder> p =
+      Parser::fromJson("{\"a\":2,\"b\":{\"y\":3,\"z\":4},\"d\":null}");
+  OverlaySlice overlay(b->slice(), p->slice());
+
+  ASSERT_TRUE(overlay.isOverlay());
+  ASSERT_TRUE(overlay.isObject());
+  ASSERT_EQ(ValueType::Object, overlay.type());
+  ASSERT_VELOCYPACK_EXCEPTION(overlay.slice(), Exception::InvalidValueType);
+
+  ASSERT_EQ(2UL, overlay.get("a").slice().getUInt());
+  ASSERT_EQ("foo", overlay.get("c").slice().copyString());
+  ASSERT_TRUE(overlay.get("d").slice().isNull());
+  ASSERT_TRUE(overlay.get("e").isNone());
+  ASSERT_FALSE(overlay.hasKey("e"));
+  ASSERT_TRUE(overlay.hasKey("d"));
+
+  OverlaySlice nested = overlay.get("b");
+  ASSERT_TRUE(nested.isOverlay());
+  ASSERT_EQ(1UL, nested.get("x").slice().getUInt());
+  ASSERT_EQ(3UL, nested.get("y").slice().getUInt());
+  ASSERT_EQ(4UL, nested.get("z").slice().getUInt());
+  ASSERT_EQ(3UL, nested.length());
+
+  ASSERT_EQ(3UL, overlay.get(std::vector<std::string>({"b", "y"}))
+                     .slice()
+                     .getUInt());
+  ASSERT_TRUE(overlay.get(std::vector<std::string>({"b", "q"})).isNone());
+  ASSERT_TRUE(overlay.get(std::vector<std::string>({"a", "q"})).isNone());
+  ASSERT_VELOCYPACK_EXCEPTION(overlay.get(std::vector<std::string>()),
+                              Exception::InvalidAttributePath);
+}
+
+TEST(OverlaySliceTest, GetNullMeansRemove) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"a\":1,\"b\":{\"x\":1}}");
+  std::shared_ptr<Builder> p =
+      Parser::fromJson("{\"a\":null,\"b\":{\"x\":null},\"c\":null}");
+  OverlaySlice overlay(b->slice(), p->slice(), true, true);
+
+  ASSERT_TRUE(overlay.get("a").isNone());
+  ASSERT_TRUE(overlay.get("c").isNone());
+  ASSERT_TRUE(overlay.get("b").isOverlay());
+  ASSERT_TRUE(overlay.get("b").get("x").isNone());
+  ASSERT_EQ(0UL, overlay.get("b").length());
+  ASSERT_EQ(1UL, overlay.length());
+  ASSERT_EQ("{\"b\":{}}", overlay.toJson());
+}
+
+TEST(OverlaySliceTest, GetWithoutMergeValues) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"b\":{\"x\":1,\"y\":2}}");
+  std::shared_ptr<Builder> p = Parser::fromJson("{\"b\":{\"y\":3}}");
+  OverlaySlice overlay(b->slice(), p->slice(), false, false);
+
+  OverlaySlice nested = overlay.get("b");
+  ASSERT_FALSE(nested.isOverlay());
+  ASSERT_TRUE(nested.get("x").isNone());
+  ASSERT_EQ("{\"y\":3}", nested.toJson());
+}
+
+TEST(OverlaySliceTest, Iterator) {
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("{\"d\":4,\"a\":1,\"c\":{\"x\":1}}");
+  std::shared_ptr<Builder> p =
+      Parser::fromJson("{\"e\":5,\"b\":2,\"c\":{\"y\":2},\"d\":null}");
+  OverlaySlice overlay(b->slice(), p->slice(), true, true);
+
+  std::vector<std::string> keys;
+  for (OverlayIterator it(overlay); it.valid(); it.next()) {
+    keys.emplace_back(it.key().copyString());
+    if (keys.back() == "c") {
+      ASSERT_TRUE(it.value().isOverlay());
+    } else {
+      ASSERT_FALSE(it.value().isOverlay());
+    }
+  }
+  ASSERT_EQ(std::vector<std::string>({"a", "b", "c", "e"}), keys);
+
+  OverlayIterator it(overlay);
+  while (it.valid()) {
+    it.next();
+  }
+  ASSERT_VELOCYPACK_EXCEPTION(it.next(), Exception::IndexOutOfBounds);
+  ASSERT_VELOCYPACK_EXCEPTION(it.key(), Exception::IndexOutOfBounds);
+  ASSERT_VELOCYPACK_EXCEPTION(it.value(), Exception::IndexOutOfBounds);
+}
+
+TEST(OverlaySliceTest, IteratorPlainObject) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"b\":2,\"a\":1}");
+  OverlaySlice value(b->slice());
+
+  std::vector<std::string> keys;
+  for (OverlayIterator it(value); it.valid(); it.next()) {
+    keys.emplace_back(it.key().copyString());
+  }
+  ASSERT_EQ(std::vector<std::string>({"a", "b"}), keys);
+}
+
+TEST(OverlaySliceTest, MatchesMerge) {
+  std::vector<std::pair<std::string, std::string>> const cases = {
+      {"{}", "{}"},
+      {"{\"a\":1}", "{}"},
+      {"{}", "{\"a\":null}"},
+      {"{\"a\":1,\"b\":2}", "{\"b\":3,\"c\":null}"},
+      {"{\"a\":{\"b\":{\"c\":1,\"d\":2}},\"e\":[1,2]}",
+       "{\"a\":{\"b\":{\"c\":null,\"f\":{\"g\":null}}},\"e\":{\"x\":1}}"},
+      {"{\"a\":{\"x\":1},\"b\":{\"y\":2}}", "{\"a\":5,\"b\":{\"y\":null}}"},
+      {"{\"z\":\"z\",\"y\":\"y\",\"x\":\"x\"}",
+       "{\"w\":\"w\",\"y\":null,\"zz\":{\"a\":null}}"},
+  };
+
+  for (auto const& c : cases) {
+    for (bool mergeValues : {true, false}) {
+      for (bool nullMeansRemove : {true, false}) {
+        checkAgainstMerge(c.first, c.second, mergeValues, nullMeansRemove);
+      }
+    }
+  }
+}
+
+TEST(OverlaySliceTest, UnsortedAndCompactObjects) {
+  Options options;
+  options.buildUnindexedObjects = true;
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("{\"c\":{\"q\":1},\"a\":1,\"b\":2}", &options);
+  std::shared_ptr<Builder> p =
+      Parser::fromJson("{\"c\":{\"p\":0},\"b\":null,\"d\":4}", &options);
+  ASSERT_EQ(0x14, b->slice().head());
+
+  OverlaySlice overlay(b->slice(), p->slice(), true, true);
+  ASSERT_EQ("{\"a\":1,\"c\":{\"p\":0,\"q\":1},\"d\":4}", overlay.toJson());
+  ASSERT_EQ(1UL, overlay.get("a").slice().getUInt());
+  ASSERT_TRUE(overlay.get("b").isNone());
+}
+
+TEST(OverlaySliceTest, PrettyPrint) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"a\":1,\"b\":{\"x\":1}}");
+  std::shared_ptr<Builder> p = Parser::fromJson("{\"b\":{\"y\":2}}");
+  OverlaySlice overlay(b->slice(), p->slice());
+
+  Options options;
+  options.prettyPrint = true;
+  Builder expected = Collection::merge(b->slice(), p->slice(), true, false);
+  ASSERT_EQ(expected.slice().toJson(&options), overlay.toJson(&options));
+}
+
+TEST(OverlaySliceTest, MaterializeIntoBuilder) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"a\":1,\"b\":{\"x\":1}}");
+  std::shared_ptr<Builder> p = Parser::fromJson("{\"b\":{\"y\":2}}");
+  OverlaySlice overlay(b->slice(), p->slice());
+
+  Builder builder;
+  builder.openArray();
+  overlay.materialize(builder);
+  overlay.get("b").materialize(builder);
+  overlay.get("a").materialize(builder);
+  builder.close();
+
+  ASSERT_EQ("[{\"a\":1,\"b\":{\"x\":1,\"y\":2}},{\"x\":1,\"y\":2},1]",
+            builder.slice().toJson());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
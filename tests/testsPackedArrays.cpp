@@ -0,0 +1,378 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "tests-common.h"
+
+TEST(PackedArraysTest, Format) {
+  Builder b;
+  int32_t const values[] = {1, -2, 3};
+  b.addPacked(values, 3);
+
+  uint8_t const expected[] = {0xe0, 0x03, 0x01, 0x00, 0x00, 0x00, 0xfe,
+                              0xff, 0xff, 0xff, 0x03, 0x00, 0x00, 0x00};
+  Slice s = b.slice();
+  ASSERT_EQ(sizeof(expected), s.byteSize());
+  ASSERT_EQ(0, memcmp(expected, s.start(), sizeof(expected)));
+  ASSERT_TRUE(isValid(s));
+  ASSERT_TRUE(s.isArray());
+  ASSERT_TRUE(s.isPackedArray());
+  ASSERT_EQ(3UL, s.length());
+  ASSERT_EQ("[1,-2,3]", s.toJson());
+}
+
+TEST(PackedArraysTest, BuildDoubles) {
+  Options options;
+  options.buildPackedArrays = true;
+  std::string json("[");
+  for (int i = 0; i < 100; ++i) {
+    if (i > 0) {
+      json.push_back(',');
+    }
+    json.append(std::to_string(i) + ".25");
+  }
+  json.push_back(']');
+
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  Slice s = b->slice();
+  ASSERT_EQ(0xe3, s.head());
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(100UL, s.length());
+
+  PackedSpan<double> span = s.getPacked<double>();
+  ASSERT_EQ(100UL, span.size());
+  ASSERT_EQ(0.25, span[0]);
+  ASSERT_EQ(99.25, span.at(99));
+  ASSERT_VELOCYPACK_EXCEPTION(span.at(100), Exception::IndexOutOfBounds);
+
+  PackedAggregate<double> agg = span.aggregate();
+  ASSERT_EQ(100UL, agg.count);
+  ASSERT_EQ(4975.0, agg.sum);
+  ASSERT_EQ(0.25, agg.min);
+  ASSERT_EQ(99.25, agg.max);
+
+  std::shared_ptr<Builder> plain = Parser::fromJson(json);
+  ASSERT_EQ(plain->slice().toJson(), s.toJson());
+  ASSERT_LT(s.byteSize(), plain->slice().byteSize());
+  ASSERT_EQ(plain->slice().normalizedHash(), s.normalizedHash());
+  ASSERT_EQ(0, Collection::compare(plain->slice(), s));
+}
+
+TEST(PackedArraysTest, IntegerWidths) {
+  Options options;
+  options.buildPackedArrays = true;
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("[10000000,-20000000,30000000,-40000000,50000000]", &options);
+  ASSERT_EQ(0xe0, b->slice().head());
+  ASSERT_TRUE(isValid(b->slice()));
+  ASSERT_EQ(-40000000, b->slice().getPacked<int32_t>().min());
+  ASSERT_EQ(30000000, b->slice().getPacked<int32_t>().sum());
+
+  b = Parser::fromJson(
+      "[100000000000000000,-200000000000000000,300000000000000000,"
+      "-400000000000000000,500000000000000000]", &options);
+  ASSERT_EQ(0xe1, b->slice().head());
+  ASSERT_TRUE(isValid(b->slice()));
+  ASSERT_EQ(-400000000000000000LL, b->slice().getPacked<int64_t>().min());
+  ASSERT_EQ(500000000000000000LL, b->slice().getPacked<int64_t>().max());
+
+  b = Parser::fromJson(
+      "[18446744073709551615,10000000000000000000,12000000000000000000]", &options);
+  ASSERT_EQ(0xe2, b->slice().head());
+  ASSERT_TRUE(isValid(b->slice()));
+  ASSERT_EQ(UINT64_MAX, b->slice().getPacked<uint64_t>().max());
+  ASSERT_EQ(10000000000000000000ULL, b->slice().getPacked<uint64_t>().min());
+  ASSERT_EQ(
+      "[18446744073709551615,10000000000000000000,12000000000000000000]",
+      b->slice().toJson());
+}
+
+TEST(PackedArraysTest, NotEligible) {
+  Options options;
+  options.buildPackedArrays = true;
+  char const* documents[] = {
+      "[1.5,2.5,3]",
+      "[1,2,3,4,5,6,7,8]",
+      "[1.5,2.5,\"foo\"]",
+      "[18446744073709551615,-100000000000000000,100000000000000000]",
+      "[[1.5,2.5],[3.5,4.5]]"};
+  for (auto const& json : documents) {
+    std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+    ASSERT_FALSE(b->slice().isPackedArray());
+    ASSERT_TRUE(isValid(b->slice()));
+    ASSERT_EQ(Parser::fromJson(json)->slice().toJson(), b->slice().toJson());
+  }
+
+  // nested Arrays are packed on their own
+  std::shared_ptr<Builder> b = Parser::fromJson("[[1.5,2.5],[3.5,4.5]]", &options);
+  ASSERT_TRUE(b->slice().at(0).isPackedArray());
+  ASSERT_TRUE(b->slice().at(1).isPackedArray());
+}
+
+TEST(PackedArraysTest, AddPacked) {
+  int64_t const ints[] = {-1, 2, -3};
+  uint64_t const uints[] = {1, UINT64_MAX};
+  double const doubles[] = {1.5, -2.5};
+
+  Builder b;
+  b.openObject();
+  b.add(Value("ints"));
+  b.addPacked(ints, 3);
+  b.add(Value("uints"));
+  b.addPacked(uints, 2);
+  b.add(Value("doubles"));
+  b.addPacked(doubles, 2);
+  b.add(Value("empty"));
+  b.addPacked(doubles, 0);
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(0xe1, s.get("ints").head());
+  ASSERT_EQ(0xe2, s.get("uints").head());
+  ASSERT_EQ(0xe3, s.get("doubles").head());
+  ASSERT_EQ(0UL, s.get("empty").length());
+  ASSERT_EQ(-2, s.get("ints").getPacked<int64_t>().sum());
+  ASSERT_EQ(-2.5, s.get("doubles").getPacked<double>().min());
+  ASSERT_EQ(0UL, s.get("empty").getPacked<double>().count());
+  ASSERT_EQ(
+      "{\"doubles\":[1.5,-2.5],\"empty\":[],\"ints\":[-1,2,-3],"
+      "\"uints\":[1,18446744073709551615]}",
+      s.toJson());
+
+  Builder a;
+  a.openObject();
+  ASSERT_VELOCYPACK_EXCEPTION(a.addPacked(ints, 3),
+                              Exception::BuilderKeyMustBeString);
+}
+
+TEST(PackedArraysTest, Access) {
+  std::vector<int32_t> values;
+  for (int32_t i = 0; i < 37; ++i) {
+    values.push_back(i * 1000 - 5000);
+  }
+  Builder b;
+  b.addPacked(values.data(), values.size());
+  Slice s = b.slice();
+
+  ASSERT_VELOCYPACK_EXCEPTION(s.getPacked<double>(), Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(s.at(0), Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(Slice(s.start() + 1).getPacked<int32_t>(),
+                              Exception::InvalidValueType);
+
+  uint8_t buffer[9];
+  Slice member = s.packedAt(3, buffer);
+  ASSERT_TRUE(member.isInt());
+  ASSERT_EQ(-2000, member.getInt());
+  ASSERT_VELOCYPACK_EXCEPTION(s.packedAt(37, buffer), Exception::IndexOutOfBounds);
+
+  std::vector<int32_t> decoded(values.size());
+  s.getPacked<int32_t>().copyTo(decoded.data());
+  ASSERT_EQ(values, decoded);
+
+  size_t i = 0;
+  for (int32_t v : s.getPacked<int32_t>()) {
+    ASSERT_EQ(values[i++], v);
+  }
+  ASSERT_EQ(values.size(), i);
+
+  i = 0;
+  for (auto const& it : ArrayIterator(s)) {
+    ASSERT_EQ(values[i++], it.getNumber<int32_t>());
+  }
+  ASSERT_EQ(values.size(), i);
+
+  ArrayIterator it(s);
+  it.forward(10);
+  ASSERT_EQ(values[10], it.value().getInt());
+  it.reset();
+  ASSERT_EQ(values[0], it.value().getInt());
+
+  ValueLength visited = 0;
+  Collection::visit(s, [&visited](VisitPath const& path, Slice const& value) {
+    if (path.size() == 1) {
+      EXPECT_EQ(static_cast<int64_t>(path.back().index) * 1000 - 5000,
+                value.getInt());
+      ++visited;
+    }
+    return Collection::Continue;
+  });
+  ASSERT_EQ(values.size(), visited);
+
+  ASSERT_EQ(values.size(), Collection::filter(s, [](Slice const& v, ValueLength) {
+    return v.isInteger();
+  }).slice().length());
+  ASSERT_VELOCYPACK_EXCEPTION(Collection::sort(s), Exception::InvalidValueType);
+  ASSERT_VELOCYPACK_EXCEPTION(
+      Collection::find(s, [](Slice const&, ValueLength) { return true; }),
+      Exception::InvalidValueType);
+
+  Builder copy;
+  copy.add(s);
+  ASSERT_TRUE(copy.slice().equals(s));
+}
+
+TEST(PackedArraysTest, MembersCompareToRegularValues) {
+  int32_t const i32[] = {1, 2, 3, 4, -1000, 100000};
+  int64_t const i64[] = {-6, 7, 1LL << 40};
+  uint64_t const u64[] = {0, 255, UINT64_MAX};
+  double const doubles[] = {1.5, -2.5};
+
+  Builder b;
+  b.openArray();
+  b.addPacked(i32, 6);
+  b.addPacked(i64, 3);
+  b.addPacked(u64, 3);
+  b.addPacked(doubles, 2);
+  b.close();
+  Slice s = b.slice();
+
+  auto number = [](Value const& value) {
+    Builder v;
+    v.add(value);
+    return v;
+  };
+  ASSERT_TRUE(Collection::contains(s.at(0), number(Value(3)).slice()));
+  ASSERT_EQ(2UL, Collection::indexOf(s.at(0), number(Value(3)).slice()));
+  ASSERT_EQ(4UL, Collection::indexOf(s.at(0), number(Value(-1000)).slice()));
+  ASSERT_EQ(5UL, Collection::indexOf(s.at(0), number(Value(100000)).slice()));
+  ASSERT_FALSE(Collection::contains(s.at(0), number(Value(5)).slice()));
+  ASSERT_EQ(0UL, Collection::indexOf(s.at(1), number(Value(-6)).slice()));
+  ASSERT_EQ(2UL, Collection::indexOf(s.at(1), number(Value(int64_t(1) << 40)).slice()));
+  ASSERT_EQ(0UL, Collection::indexOf(s.at(2), number(Value(uint64_t(0))).slice()));
+  ASSERT_EQ(1UL, Collection::indexOf(s.at(2), number(Value(uint64_t(255))).slice()));
+  ASSERT_EQ(2UL, Collection::indexOf(s.at(2), number(Value(UINT64_MAX)).slice()));
+  ASSERT_EQ(1UL, Collection::indexOf(s.at(3), number(Value(-2.5)).slice()));
+
+  for (auto const& packed : ArrayIterator(s)) {
+    for (auto const& member : ArrayIterator(packed)) {
+      ASSERT_TRUE(isValid(member));
+    }
+  }
+  ASSERT_EQ(
+      "[[1,2,3,4,-1000,100000],[-6,7,1099511627776],"
+      "[0,255,18446744073709551615],[1.5,-2.5]]",
+      s.toJson());
+}
+
+TEST(PackedArraysTest, Aggregates) {
+  for (size_t n = 1; n < 40; ++n) {
+    std::vector<int32_t> i32;
+    std::vector<int64_t> i64;
+    std::vector<uint64_t> u64;
+    std::vector<double> dbl;
+    for (size_t i = 0; i < n; ++i) {
+      int64_t const v = static_cast<int64_t>((i * 7919) % 101) - 50;
+      i32.push_back(static_cast<int32_t>(v * 40000000));
+      i64.push_back(v * 100000000000LL);
+      u64.push_back(static_cast<uint64_t>(v + 50) * 100000000000000000ULL);
+      dbl.push_back(static_cast<double>(v) / 4);
+    }
+
+    Builder b;
+    b.openArray();
+    b.addPacked(i32.data(), n);
+    b.addPacked(i64.data(), n);
+    b.addPacked(u64.data(), n);
+    b.addPacked(dbl.data(), n);
+    b.close();
+    Slice s = b.slice();
+    ASSERT_TRUE(isValid(s));
+
+    PackedAggregate<int32_t> a32 = s.at(0).getPacked<int32_t>().aggregate();
+    ASSERT_EQ(n, a32.count);
+    ASSERT_EQ(std::accumulate(i32.begin(), i32.end(), int64_t(0)), a32.sum);
+    ASSERT_EQ(*std::min_element(i32.begin(), i32.end()), a32.min);
+    ASSERT_EQ(*std::max_element(i32.begin(), i32.end()), a32.max);
+
+    PackedAggregate<int64_t> a64 = s.at(1).getPacked<int64_t>().aggregate();
+    ASSERT_EQ(n, a64.count);
+    ASSERT_EQ(std::accumulate(i64.begin(), i64.end(), int64_t(0)), a64.sum);
+    ASSERT_EQ(*std::min_element(i64.begin(), i64.end()), a64.min);
+    ASSERT_EQ(*std::max_element(i64.begin(), i64.end()), a64.max);
+
+    PackedAggregate<uint64_t> au = s.at(2).getPacked<uint64_t>().aggregate();
+    ASSERT_EQ(n, au.count);
+    ASSERT_EQ(std::accumulate(u64.begin(), u64.end(), uint64_t(0)), au.sum);
+    ASSERT_EQ(*std::min_element(u64.begin(), u64.end()), au.min);
+    ASSERT_EQ(*std::max_element(u64.begin(), u64.end()), au.max);
+
+    PackedAggregate<double> ad = s.at(3).getPacked<double>().aggregate();
+    ASSERT_EQ(n, ad.count);
+    // quarters are summed exactly in any order
+    ASSERT_EQ(std::accumulate(dbl.begin(), dbl.end(), 0.0), ad.sum);
+    ASSERT_EQ(*std::min_element(dbl.begin(), dbl.end()), ad.min);
+    ASSERT_EQ(*std::max_element(dbl.begin(), dbl.end()), ad.max);
+  }
+}
+
+TEST(PackedArraysTest, AggregateNaN) {
+  double const nan = std::numeric_limits<double>::quiet_NaN();
+  double const values[] = {nan, 1.0, nan, -3.0, 2.0, nan, nan};
+  Builder b;
+  b.addPacked(values, 7);
+  PackedAggregate<double> agg = b.slice().getPacked<double>().aggregate();
+  ASSERT_EQ(3UL, agg.count);
+  ASSERT_EQ(0.0, agg.sum);
+  ASSERT_EQ(-3.0, agg.min);
+  ASSERT_EQ(2.0, agg.max);
+
+  double const nans[] = {nan, nan, nan};
+  Builder c;
+  c.addPacked(nans, 3);
+  agg = c.slice().getPacked<double>().aggregate();
+  ASSERT_EQ(0UL, agg.count);
+  ASSERT_EQ(0.0, agg.sum);
+  ASSERT_EQ(0.0, agg.min);
+  ASSERT_EQ(0.0, agg.max);
+}
+
+TEST(PackedArraysTest, Validator) {
+  Validator validator;
+  std::string value("\xe0\x02\x01\x00\x00\x00\x02\x00\x00\x00", 10);
+  ASSERT_TRUE(validator.validate(value.c_str(), value.size()));
+
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), 9),
+                              Exception::ValidatorInvalidLength);
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), 1),
+                              Exception::ValidatorInvalidLength);
+
+  std::string big("\xe3\xff\xff\xff\x0f", 5);
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(big.c_str(), big.size()),
+                              Exception::ValidatorInvalidLength);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,361 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "tests-common.h"
+
+TEST(ShapedArraysTest, Format) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4}]", &options);
+  Slice s = b->slice();
+
+  uint8_t const expected[] = {0x15, 0x13, 0x02, 0x06, 0x41, 0x61, 0x41,
+                              0x62, 0x16, 0x05, 0x06, 0x31, 0x32, 0x16,
+                              0x05, 0x0b, 0x33, 0x34, 0x02};
+  ASSERT_EQ(sizeof(expected), s.byteSize());
+  ASSERT_EQ(0, memcmp(expected, s.start(), sizeof(expected)));
+  ASSERT_TRUE(isValid(s));
+}
+
+TEST(ShapedArraysTest, Access) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::string const json(
+      "[{\"name\":\"alpha\",\"value\":1,\"tags\":[1,2]},"
+      "{\"value\":2,\"name\":\"beta\",\"tags\":[]},"
+      "{\"tags\":{\"x\":true},\"name\":\"gamma\",\"value\":3}]");
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  Slice s = b->slice();
+  ASSERT_EQ(0x15, s.head());
+  ASSERT_TRUE(isValid(s));
+  ASSERT_TRUE(s.isArray());
+  ASSERT_EQ(3UL, s.length());
+
+  Slice shape = s.getShape();
+  ASSERT_EQ(3UL, shape.length());
+  ASSERT_EQ("name", shape.at(0).copyString());
+  ASSERT_EQ("tags", shape.at(1).copyString());
+  ASSERT_EQ("value", shape.at(2).copyString());
+
+  char const* names[] = {"alpha", "beta", "gamma"};
+  for (ValueLength i = 0; i < 3; ++i) {
+    Slice row = s.at(i);
+    ASSERT_EQ(0x16, row.head());
+    ASSERT_TRUE(row.isObject());
+    ASSERT_EQ(ValueType::Object, row.type());
+    ASSERT_EQ(3UL, row.length());
+    ASSERT_EQ(names[i], row.get("name").copyString());
+    ASSERT_EQ(i + 1, row.get("value").getUInt());
+    ASSERT_TRUE(row.get("foo").isNone());
+    ASSERT_TRUE(row.hasKey("tags"));
+    ASSERT_EQ("name", row.keyAt(0).copyString());
+    ASSERT_EQ("value", row.keyAt(2).copyString());
+    ASSERT_EQ(names[i], row.valueAt(0).copyString());
+    ASSERT_EQ(i + 1, row.valueAt(2).getUInt());
+    ASSERT_VELOCYPACK_EXCEPTION(row.keyAt(3), Exception::IndexOutOfBounds);
+    ASSERT_VELOCYPACK_EXCEPTION(row.valueAt(3), Exception::IndexOutOfBounds);
+
+    std::vector<std::string> keys;
+    for (auto const& it : ObjectIterator(row)) {
+      keys.emplace_back(it.key.copyString());
+      ASSERT_EQ(row.get(keys.back()).start(), it.value.start());
+    }
+    ASSERT_EQ(std::vector<std::string>({"name", "tags", "value"}), keys);
+  }
+
+  ValueLength n = 0;
+  for (auto const& row : ArrayIterator(s)) {
+    ASSERT_EQ(s.at(n).start(), row.start());
+    ++n;
+  }
+  ASSERT_EQ(3UL, n);
+
+  std::shared_ptr<Builder> plain = Parser::fromJson(json);
+  ASSERT_EQ(plain->slice().toJson(), s.toJson());
+  ASSERT_LT(s.byteSize(), plain->slice().byteSize());
+  ASSERT_EQ(plain->slice().normalizedHash(), s.normalizedHash());
+}
+
+TEST(ShapedArraysTest, ColumnScan) {
+  Options options;
+  options.buildShapedArrays = true;
+  Builder b(&options);
+  b.openArray();
+  for (uint64_t i = 0; i < 100; ++i) {
+    b.openObject();
+    b.add("id", Value(i));
+    b.add("score", Value(i * 2));
+    b.close();
+  }
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_EQ(0x15, s.head());
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(100UL, s.length());
+
+  ValueLength column = 0;
+  for (auto const& name : ArrayIterator(s.getShape())) {
+    if (name.isEqualString("score")) {
+      break;
+    }
+    ++column;
+  }
+  uint64_t sum = 0;
+  for (auto const& row : ArrayIterator(s)) {
+    sum += row.valueAt(column).getUInt();
+  }
+  ASSERT_EQ(9900UL, sum);
+}
+
+TEST(ShapedArraysTest, NotEligible) {
+  Options options;
+  options.buildShapedArrays = true;
+  char const* documents[] = {
+      "[{\"a\":1,\"b\":2},{\"a\":3,\"c\":4}]",
+      "[{\"a\":1,\"b\":2},{\"a\":3}]",
+      "[{\"a\":1,\"b\":2},[1,2]]",
+      "[{},{}]",
+      "[{\"a\":1,\"b\":2}]",
+      "[1,2,3]"};
+  for (auto const& json : documents) {
+    std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+    ASSERT_NE(0x15, b->slice().head());
+    ASSERT_TRUE(isValid(b->slice()));
+    ASSERT_EQ(Parser::fromJson(json)->slice().toJson(), b->slice().toJson());
+  }
+}
+
+TEST(ShapedArraysTest, Nested) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::string const json(
+      "{\"rows\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4},{\"x\":5,\"y\":6}],"
+      "\"more\":[{\"list\":[{\"p\":1,\"q\":2},{\"p\":3,\"q\":4}],\"k\":1},"
+      "{\"list\":[],\"k\":2}]}");
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(0x15, s.get("rows").head());
+  ASSERT_EQ(0x15, s.get("more").head());
+  ASSERT_EQ(0x15, s.get("more").at(0).get("list").head());
+  ASSERT_EQ(4UL, s.get("more").at(0).get("list").at(1).get("q").getUInt());
+  ASSERT_EQ(Parser::fromJson(json)->slice().toJson(), s.toJson());
+}
+
+static std::vector<std::string> visitAll(Slice s) {
+  std::vector<std::string> visited;
+  Collection::visit(s, [&visited](VisitPath const& path, Slice const& value) {
+    visited.push_back(path.toString() + " => " + value.toJson());
+    return Collection::Continue;
+  });
+  return visited;
+}
+
+TEST(ShapedArraysTest, Visit) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b =
+      Parser::fromJson("[{\"a\":1,\"b\":\"x\"},{\"a\":2,\"b\":\"y\"}]", &options);
+  ASSERT_EQ(0x15, b->slice().head());
+  std::vector<std::string> visited = visitAll(b->slice());
+  ASSERT_EQ(7UL, visited.size());
+  ASSERT_EQ("[0].a => 1", visited[2]);
+  ASSERT_EQ("[0].b => \"x\"", visited[3]);
+  ASSERT_EQ("[1].b => \"y\"", visited[6]);
+
+  std::string const json(
+      "{\"rows\":[{\"x\":1,\"y\":2},{\"x\":3,\"y\":4},{\"x\":5,\"y\":6}],"
+      "\"more\":[{\"list\":[{\"p\":1,\"q\":2},{\"p\":3,\"q\":4}],\"k\":1},"
+      "{\"list\":[],\"k\":2}]}");
+  b = Parser::fromJson(json, &options);
+  ASSERT_EQ(0x15, b->slice().get("more").at(0).get("list").head());
+  // rows store their members in attribute name order
+  std::vector<std::string> expected = visitAll(Parser::fromJson(json)->slice());
+  visited = visitAll(b->slice());
+  std::sort(expected.begin(), expected.end());
+  std::sort(visited.begin(), visited.end());
+  ASSERT_EQ(expected, visited);
+}
+
+TEST(ShapedArraysTest, CopyRow) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":\"foo\"},{\"a\":3,\"b\":\"bar\"}]", &options);
+  Slice row = b->slice().at(1);
+  ASSERT_EQ(0x16, row.head());
+
+  Builder copy;
+  copy.add(row);
+  Slice s = copy.slice();
+  ASSERT_TRUE(s.isObject());
+  ASSERT_NE(0x16, s.head());
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ("{\"a\":3,\"b\":\"bar\"}", s.toJson());
+
+  Builder outer;
+  outer.openObject();
+  outer.add("row", row);
+  outer.close();
+  ASSERT_TRUE(isValid(outer.slice()));
+  ASSERT_EQ("bar", outer.slice().get("row").get("b").copyString());
+}
+
+TEST(ShapedArraysTest, ContainerCopiesOfRow) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":\"foo\"},{\"a\":3,\"b\":\"bar\"}]", &options);
+  Slice row = b->slice().at(1);
+  ASSERT_FALSE(row.isSelfContained());
+  ASSERT_TRUE(b->slice().isSelfContained());
+  std::string const expected("{\"a\":3,\"b\":\"bar\"}");
+
+  SliceContainer container(row);
+  ASSERT_NE(0x16, container.slice().head());
+  ASSERT_TRUE(isValid(container.slice()));
+  ASSERT_EQ(expected, container.slice().toJson());
+
+  SharedSlice shared(row);
+  ASSERT_NE(0x16, shared.slice().head());
+  ASSERT_TRUE(isValid(shared.slice()));
+  ASSERT_EQ(expected, shared.slice().toJson());
+
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder streaming(&sink);
+  streaming.openArray();
+  streaming.add(row);
+  streaming.close();
+  streaming.flush();
+  Slice streamed(reinterpret_cast<uint8_t const*>(out.data()));
+  ASSERT_EQ(out.size(), streamed.byteSize());
+  ASSERT_TRUE(isValid(streamed));
+  ASSERT_EQ("[" + expected + "]", streamed.toJson());
+}
+
+TEST(ShapedArraysTest, SetOperations) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":\"xx\"},{\"a\":2,\"b\":\"yy\"},{\"a\":1,\"b\":\"xx\"}]",
+      &options);
+  Slice s = b->slice();
+  ASSERT_EQ(0x15, s.head());
+
+  Builder distinct = Collection::distinct(s);
+  ASSERT_TRUE(isValid(distinct.slice()));
+  ASSERT_EQ("[{\"a\":1,\"b\":\"xx\"},{\"a\":2,\"b\":\"yy\"}]",
+            distinct.slice().toJson());
+
+  std::shared_ptr<Builder> other = Parser::fromJson(
+      "[{\"a\":2,\"b\":\"yy\"},{\"a\":3,\"b\":\"zz\"},{\"a\":2,\"b\":\"yy\"}]",
+      &options);
+  ASSERT_EQ(0x15, other->slice().head());
+
+  Builder intersect = Collection::intersect(s, other->slice());
+  ASSERT_EQ("[{\"a\":2,\"b\":\"yy\"}]", intersect.slice().toJson());
+
+  Builder unionOf = Collection::unionOf(s, other->slice());
+  ASSERT_EQ(
+      "[{\"a\":1,\"b\":\"xx\"},{\"a\":2,\"b\":\"yy\"},{\"a\":3,\"b\":\"zz\"}]",
+      unionOf.slice().toJson());
+
+  Builder difference = Collection::difference(s, other->slice());
+  ASSERT_EQ("[{\"a\":1,\"b\":\"xx\"}]", difference.slice().toJson());
+
+  Builder groups = Collection::groupBy(s, "b");
+  ASSERT_TRUE(isValid(groups.slice()));
+  ASSERT_EQ(
+      "[[\"xx\",[{\"a\":1,\"b\":\"xx\"},{\"a\":1,\"b\":\"xx\"}]],"
+      "[\"yy\",[{\"a\":2,\"b\":\"yy\"}]]]",
+      groups.slice().toJson());
+}
+
+TEST(ShapedArraysTest, ValidatorRejectsRowOutsideShapedArray) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4}]", &options);
+  Slice row = b->slice().at(0);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(row.start(), row.byteSize()),
+                              Exception::ValidatorInvalidType);
+}
+
+TEST(ShapedArraysTest, ValidatorRejectsUnsortedShape) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4}]", &options);
+  std::string data(b->slice().startAs<char>(), b->slice().byteSize());
+  // swap the attribute names in the shape
+  std::swap(data[5], data[7]);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(data.data(), data.size()),
+                              Exception::ValidatorInvalidKeyOrder);
+}
+
+TEST(ShapedArraysTest, ValidatorRejectsWrongDistance) {
+  Options options;
+  options.buildShapedArrays = true;
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"a\":1,\"b\":2},{\"a\":3,\"b\":4}]", &options);
+  std::string data(b->slice().startAs<char>(), b->slice().byteSize());
+  // distance of the second row
+  data[15] = 0x06;
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(data.data(), data.size()),
+                              Exception::ValidatorInvalidLength);
+}
+
+TEST(ShapedArraysTest, StringReferences) {
+  Options options;
+  options.buildShapedArrays = true;
+  options.dedupeStrings = true;
+  std::string const json(
+      "[{\"a\":\"foobar\",\"b\":2},{\"a\":\"foobar\",\"b\":4},"
+      "{\"a\":\"foobar\",\"b\":6}]");
+  std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(Parser::fromJson(json)->slice().toJson(), s.toJson());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,196 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tests-common.h"
+
+TEST(SharedSliceTest, Default) {
+  SharedSlice s;
+  ASSERT_TRUE(s.isNone());
+  ASSERT_TRUE(s.slice().isNone());
+  ASSERT_EQ(0UL, s.useCount());
+  ASSERT_EQ(1UL, s.byteSize());
+
+  SharedSlice copy(s);
+  ASSERT_TRUE(copy.isNone());
+  ASSERT_EQ(0UL, copy.useCount());
+}
+
+TEST(SharedSliceTest, FromSlice) {
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"foo\":\"bar\",\"baz\":[1,2,3]}");
+  SharedSlice s(b->slice());
+  ASSERT_NE(b->slice().start(), s.start());
+  ASSERT_EQ(b->slice().byteSize(), s.byteSize());
+  ASSERT_TRUE(b->slice().equals(s.slice()));
+  ASSERT_EQ(1UL, s.useCount());
+
+  SharedSlice raw(b->slice().start(), b->slice().byteSize());
+  ASSERT_TRUE(b->slice().equals(raw.slice()));
+}
+
+TEST(SharedSliceTest, CopyAndMove) {
+  Builder b;
+  b.add(Value("the quick brown fox jumps over the lazy dog"));
+  SharedSlice s(b.slice());
+
+  SharedSlice copy(s);
+  ASSERT_EQ(s.start(), copy.start());
+  ASSERT_EQ(2UL, s.useCount());
+
+  SharedSlice assigned;
+  assigned = copy;
+  ASSERT_EQ(3UL, s.useCount());
+  assigned = assigned;
+  ASSERT_EQ(3UL, s.useCount());
+
+  SharedSlice moved(std::move(copy));
+  ASSERT_TRUE(copy.isNone());
+  ASSERT_EQ(0UL, copy.useCount());
+  ASSERT_EQ(s.start(), moved.start());
+  ASSERT_EQ(3UL, s.useCount());
+
+  moved = SharedSlice();
+  ASSERT_EQ(2UL, s.useCount());
+  assigned = SharedSlice();
+  ASSERT_EQ(1UL, s.useCount());
+  ASSERT_EQ("the quick brown fox jumps over the lazy dog", s.slice().copyString());
+}
+
+TEST(SharedSliceTest, FromBuilderAdoptsBytes) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 1000; ++i) {
+    b.add(Value(i));
+  }
+  b.close();
+  uint8_t const* start = b.slice().start();
+  ValueLength size = b.size();
+
+  SharedSlice s(std::move(b));
+  ASSERT_EQ(start, s.start());
+  ASSERT_EQ(size, s.byteSize());
+  ASSERT_EQ(1000UL, s.slice().length());
+  ASSERT_EQ(1UL, s.useCount());
+}
+
+TEST(SharedSliceTest, FromSmallBuilder) {
+  Builder b;
+  b.add(Value(42));
+  SharedSlice s(std::move(b));
+  ASSERT_EQ(42UL, s.slice().getUInt());
+}
+
+TEST(SharedSliceTest, FromBuilderSharedBuffer) {
+  auto buffer = std::make_shared<Buffer<uint8_t>>();
+  Builder b(buffer);
+  b.add(Value("foobar"));
+  SharedSlice s(std::move(b));
+  // the buffer is still used by others, so the bytes are copied
+  ASSERT_NE(buffer->data(), s.start());
+  ASSERT_EQ("foobar", s.slice().copyString());
+  ASSERT_EQ("foobar", Slice(buffer->data()).copyString());
+
+  Buffer<uint8_t> local;
+  Builder b2(local);
+  b2.add(Value("baz"));
+  SharedSlice s2(std::move(b2));
+  ASSERT_NE(local.data(), s2.start());
+  ASSERT_EQ("baz", s2.slice().copyString());
+}
+
+TEST(SharedSliceTest, FromBuilderEmptyOrOpen) {
+  Builder empty;
+  SharedSlice s(std::move(empty));
+  ASSERT_TRUE(s.isNone());
+
+  Builder open;
+  open.openArray();
+  ASSERT_VELOCYPACK_EXCEPTION(SharedSlice(std::move(open)),
+                              Exception::BuilderNotSealed);
+}
+
+TEST(SharedSliceTest, SubSlicesKeepParentAlive) {
+  SharedSlice value;
+  SharedSlice member;
+  SharedSlice missing;
+  {
+    std::shared_ptr<Builder> b = Parser::fromJson("{\"foo\":{\"bar\":[1,\"qux\"]},\"a\":1}");
+    SharedSlice s(b->slice());
+    value = s.get("foo");
+    member = value.get(std::string("bar")).at(1);
+    missing = s.get("nope");
+    ASSERT_EQ(4UL, s.useCount());
+  }
+  ASSERT_EQ(3UL, value.useCount());
+  ASSERT_TRUE(value.slice().isObject());
+  ASSERT_EQ("qux", member.slice().copyString());
+  ASSERT_TRUE(missing.isNone());
+
+  SharedSlice key = value.keyAt(0);
+  ASSERT_EQ("bar", key.slice().copyString());
+  ASSERT_TRUE(value.valueAt(0).slice().isArray());
+}
+
+TEST(SharedSliceTest, LocalRefCount) {
+  Builder b;
+  b.add(Value("foo"));
+  LocalSharedSlice s(b.slice());
+  {
+    LocalSharedSlice copy(s);
+    ASSERT_EQ(2UL, s.useCount());
+  }
+  ASSERT_EQ(1UL, s.useCount());
+  ASSERT_EQ("foo", s.slice().copyString());
+}
+
+TEST(SharedSliceTest, ConcurrentCopies) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1,2,3,4,5]");
+  SharedSlice s(b->slice());
+
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < 4; ++t) {
+    threads.emplace_back([s]() {
+      for (size_t i = 0; i < 10000; ++i) {
+        SharedSlice copy(s);
+        SharedSlice member = copy.at(i % 5);
+        EXPECT_EQ(i % 5 + 1, member.slice().getUInt());
+      }
+    });
+  }
+  for (auto& it : threads) {
+    it.join();
+  }
+  ASSERT_EQ(1UL, s.useCount());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
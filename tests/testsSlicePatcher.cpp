@@ -0,0 +1,177 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdint>
+#include <limits>
+#include <string>
+
+#include "tests-common.h"
+
+static Builder counterDocument() {
+  Builder b;
+  b.openObject();
+  b.add("small", Value(3));                  // SmallInt, 1 byte
+  b.add("int", Value(-1000));                // Int, 3 bytes
+  b.add("uint", Value(uint64_t(70000)));     // UInt, 4 bytes
+  b.add("double", Value(1.5));
+  b.add("flag", Value(true));
+  b.add("nothing", Value(ValueType::Null));
+  b.add("name", Value("abcdef"));
+  b.add("nested", Value(ValueType::Object));
+  b.add("counter", Value(uint64_t(1) << 40));
+  b.close();
+  b.add("list", Value(ValueType::Array));
+  b.add(Value(100));
+  b.add(Value(200));
+  b.close();
+  b.close();
+  return b;
+}
+
+static void checkValid(Builder const& b) {
+  Validator validator;
+  ASSERT_TRUE(validator.validate(b.start(), b.size()));
+}
+
+TEST(SlicePatcherTest, Integers) {
+  Builder b = counterDocument();
+  ValueLength const size = b.size();
+  SlicePatcher patcher(b);
+
+  ASSERT_TRUE(patcher.patch("small", Value(9)));
+  ASSERT_EQ(9, b.slice().get("small").getInt());
+  ASSERT_TRUE(patcher.patch("small", Value(-6)));
+  ASSERT_EQ(-6, b.slice().get("small").getInt());
+  ASSERT_FALSE(patcher.patch("small", Value(10)));
+  ASSERT_FALSE(patcher.patch("small", Value(-7)));
+  ASSERT_EQ(-6, b.slice().get("small").getInt());
+
+  ASSERT_TRUE(patcher.patch("int", Value(-32768)));
+  ASSERT_EQ(-32768, b.slice().get("int").getInt());
+  ASSERT_TRUE(b.slice().get("int").isInt());
+  ASSERT_TRUE(patcher.patch("int", Value(5)));
+  ASSERT_EQ(5, b.slice().get("int").getInt());
+  ASSERT_TRUE(b.slice().get("int").isInt());
+  ASSERT_FALSE(patcher.patch("int", Value(-32769)));
+  ASSERT_FALSE(patcher.patch("int", Value(65536)));
+  ASSERT_TRUE(patcher.patch("int", Value(65535)));
+  ASSERT_EQ(65535UL, b.slice().get("int").getUInt());
+
+  ASSERT_TRUE(patcher.patch("uint", Value(uint64_t(0xffffff))));
+  ASSERT_EQ(0xffffffUL, b.slice().get("uint").getUInt());
+  ASSERT_TRUE(b.slice().get("uint").isUInt());
+  ASSERT_TRUE(patcher.patch("uint", Value(-1)));
+  ASSERT_EQ(-1, b.slice().get("uint").getInt());
+
+  std::vector<std::string> path{"nested", "counter"};
+  for (uint64_t i = 0; i < 1000; ++i) {
+    ASSERT_TRUE(patcher.patch(path, Value(i * 1000003)));
+  }
+  ASSERT_EQ(999UL * 1000003, b.slice().get(path).getUInt());
+
+  // integers fit into the 9 bytes of a double, too
+  ASSERT_TRUE(patcher.patch("double", Value(std::numeric_limits<uint64_t>::max())));
+  ASSERT_EQ(std::numeric_limits<uint64_t>::max(), b.slice().get("double").getUInt());
+  ASSERT_TRUE(patcher.patch("double", Value(std::numeric_limits<int64_t>::min())));
+  ASSERT_EQ(std::numeric_limits<int64_t>::min(), b.slice().get("double").getInt());
+
+  ASSERT_EQ(size, b.size());
+  checkValid(b);
+}
+
+TEST(SlicePatcherTest, OtherTypes) {
+  Builder b = counterDocument();
+  SlicePatcher patcher(b);
+
+  ASSERT_TRUE(patcher.patch("double", Value(-2.25)));
+  ASSERT_EQ(-2.25, b.slice().get("double").getDouble());
+  ASSERT_FALSE(patcher.patch("small", Value(2.0)));
+
+  ASSERT_TRUE(patcher.patch("flag", Value(false)));
+  ASSERT_FALSE(b.slice().get("flag").getBool());
+  ASSERT_TRUE(patcher.patch("flag", Value(ValueType::Null)));
+  ASSERT_TRUE(b.slice().get("flag").isNull());
+  ASSERT_TRUE(patcher.patch("nothing", Value(true)));
+  ASSERT_TRUE(b.slice().get("nothing").getBool());
+
+  ASSERT_TRUE(patcher.patch("name", Value("ghijkl")));
+  ASSERT_EQ("ghijkl", b.slice().get("name").copyString());
+  ASSERT_FALSE(patcher.patch("name", Value("abc")));
+  ASSERT_FALSE(patcher.patch("name", Value("abcdefg")));
+  ASSERT_EQ("ghijkl", b.slice().get("name").copyString());
+
+  ASSERT_FALSE(patcher.patch("missing", Value(1)));
+  checkValid(b);
+}
+
+TEST(SlicePatcherTest, SliceTargets) {
+  Builder b = counterDocument();
+  SlicePatcher patcher(b);
+
+  Slice list = b.slice().get("list");
+  ASSERT_TRUE(patcher.patch(list.at(1), Value(300)));
+  ASSERT_EQ(300, list.at(1).getInt());
+
+  Builder other;
+  other.add(Value(-100));
+  ASSERT_TRUE(patcher.patch(list.at(0), other.slice()));
+  ASSERT_EQ(-100, list.at(0).getInt());
+
+  Builder str;
+  str.add(Value("fedcba"));
+  ASSERT_TRUE(patcher.patch(b.slice().get("name"), str.slice()));
+  ASSERT_EQ("fedcba", b.slice().get("name").copyString());
+
+  ASSERT_VELOCYPACK_EXCEPTION(patcher.patch(other.slice(), Value(1)),
+                              Exception::IndexOutOfBounds);
+  checkValid(b);
+}
+
+TEST(SlicePatcherTest, EqualSizeArray) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[1000,2000,3000]");
+  ASSERT_EQ(0x02, b->slice().head());
+  SlicePatcher patcher(*b);
+  ASSERT_TRUE(patcher.patch(b->slice().at(2), Value(-4000)));
+  ASSERT_EQ("[1000,2000,-4000]", b->slice().toJson());
+  checkValid(*b);
+}
+
+TEST(SlicePatcherTest, RawData) {
+  Builder b = counterDocument();
+  std::string data(reinterpret_cast<char const*>(b.start()), b.size());
+  SlicePatcher patcher(reinterpret_cast<uint8_t*>(&data[0]), data.size());
+  ASSERT_TRUE(patcher.patch("small", Value(1)));
+  ASSERT_EQ(1, patcher.slice().get("small").getInt());
+  ASSERT_EQ(3, b.slice().get("small").getInt());
+
+  ASSERT_VELOCYPACK_EXCEPTION(SlicePatcher(nullptr, 0), Exception::InternalError);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+#include "tests-common.h"
+
+static void checkValid(std::string const& data) {
+  Validator validator;
+  ASSERT_TRUE(validator.validate(data.data(), data.size()));
+  ASSERT_EQ(data.size(), Slice(reinterpret_cast<uint8_t const*>(data.data())).byteSize());
+}
+
+static void checkJson(std::string const& data, std::string const& json) {
+  checkValid(data);
+  Slice s(reinterpret_cast<uint8_t const*>(data.data()));
+  ASSERT_EQ(json, s.toJson());
+}
+
+TEST(StreamingBuilderTest, Scalar) {
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder b(&sink);
+  b.add(Value(42));
+  ASSERT_TRUE(b.isClosed());
+  b.flush();
+  checkJson(out, "42");
+
+  ASSERT_VELOCYPACK_EXCEPTION(b.add(Value(1)), Exception::BuilderNeedOpenCompound);
+  ASSERT_VELOCYPACK_EXCEPTION(b.openArray(), Exception::BuilderNeedOpenCompound);
+}
+
+TEST(StreamingBuilderTest, EmptyCompounds) {
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder b(&sink);
+  b.openObject();
+  b.openArray("a");
+  b.close();
+  b.openObject("b");
+  b.close();
+  b.close();
+  b.flush();
+  checkJson(out, "{\"a\":[],\"b\":{}}");
+  Slice s(reinterpret_cast<uint8_t const*>(out.data()));
+  ASSERT_EQ(0x14, s.head());
+  ASSERT_EQ(0x01, s.get("a").head());
+  ASSERT_EQ(0x0a, s.get("b").head());
+}
+
+TEST(StreamingBuilderTest, CompactInChunk) {
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder b(&sink);
+  b.openArray();
+  b.add(Value(1));
+  b.add(Value("foo"));
+  b.openObject();
+  b.add("a", Value(true));
+  b.add(std::string("b"), Value(ValueType::Null));
+  b.add(Value("c"));
+  b.add(Value(2.5));
+  b.close();
+  b.add(Value(ValueType::Array));
+  b.close();
+  b.close();
+  ASSERT_TRUE(b.isClosed());
+  ASSERT_TRUE(out.empty());
+  b.flush();
+
+  checkJson(out, "[1,\"foo\",{\"a\":true,\"b\":null,\"c\":2.5},[]]");
+
+  // same bytes as a Builder producing compact values
+  Options options;
+  options.buildUnindexedArrays = true;
+  options.buildUnindexedObjects = true;
+  Builder expected(&options);
+  expected.openArray();
+  expected.add(Value(1));
+  expected.add(Value("foo"));
+  expected.openObject();
+  expected.add("a", Value(true));
+  expected.add("b", Value(ValueType::Null));
+  expected.add("c", Value(2.5));
+  expected.close();
+  expected.openArray();
+  expected.close();
+  expected.close();
+  ASSERT_EQ(expected.slice().byteSize(), out.size());
+  ASSERT_EQ(0, memcmp(expected.slice().start(), out.data(), out.size()));
+}
+
+TEST(StreamingBuilderTest, LongKeysAndSlices) {
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder b(&sink);
+  std::string key(300, 'k');
+  std::shared_ptr<Builder> sub = Parser::fromJson("{\"x\":[1,2,{\"y\":\"z\"}]}");
+  b.openObject();
+  b.add(key, Value("v"));
+  b.add("sub", sub->slice());
+  b.add(Value("raw"));
+  b.add(Slice(sub->slice()));
+  b.close();
+  b.flush();
+  checkValid(out);
+  Slice s(reinterpret_cast<uint8_t const*>(out.data()));
+  ASSERT_EQ("v", s.get(key).copyString());
+  ASSERT_TRUE(s.get("sub").equals(sub->slice()));
+  ASSERT_TRUE(s.get("raw").equals(sub->slice()));
+}
+
+TEST(StreamingBuilderTest, Errors) {
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder b(&sink);
+  ASSERT_VELOCYPACK_EXCEPTION(b.close(), Exception::BuilderNeedOpenCompound);
+  ASSERT_VELOCYPACK_EXCEPTION(b.add("a", Value(1)), Exception::BuilderNeedOpenObject);
+  b.openObject();
+  ASSERT_VELOCYPACK_EXCEPTION(b.add(Value(1)), Exception::BuilderKeyMustBeString);
+  ASSERT_VELOCYPACK_EXCEPTION(b.openArray(), Exception::BuilderKeyMustBeString);
+  b.add(Value("a"));
+  ASSERT_VELOCYPACK_EXCEPTION(b.add("b", Value(1)), Exception::BuilderKeyAlreadyWritten);
+  ASSERT_VELOCYPACK_EXCEPTION(b.close(), Exception::BuilderNeedSubvalue);
+  b.openArray();
+  ASSERT_VELOCYPACK_EXCEPTION(b.add("b", Value(1)), Exception::BuilderNeedOpenObject);
+  b.close();
+  b.close();
+  ASSERT_TRUE(b.isClosed());
+}
+
+static void buildRows(StreamingBuilder& b, size_t n) {
+  b.openArray();
+  for (size_t i = 0; i < n; ++i) {
+    b.openObject();
+    b.add("id", Value(i));
+    b.add("name", Value("row" + std::to_string(i)));
+    b.openArray("tags");
+    for (size_t j = 0; j < i % 4; ++j) {
+      b.add(Value(j));
+    }
+    b.close();
+    b.close();
+  }
+  b.close();
+  b.flush();
+}
+
+static void checkRows(Slice s, size_t n) {
+  ASSERT_TRUE(s.isArray());
+  ASSERT_EQ(n, s.length());
+  size_t i = 0;
+  for (auto const& row : ArrayIterator(s)) {
+    ASSERT_EQ(i, row.get("id").getUInt());
+    ASSERT_EQ("row" + std::to_string(i), row.get("name").copyString());
+    ASSERT_EQ(i % 4, row.get("tags").length());
+    ++i;
+  }
+}
+
+TEST(StreamingBuilderTest, ManyRowsSmallChunks) {
+  size_t const n = 20000;
+  for (ValueLength chunkSize : {1, 17, 1000, 1 << 20}) {
+    std::string out;
+    StringSink sink(&out);
+    StreamingBuilder b(&sink, &Options::Defaults, chunkSize);
+    buildRows(b, n);
+    ASSERT_EQ(out.size(), b.size());
+    checkValid(out);
+    checkRows(Slice(reinterpret_cast<uint8_t const*>(out.data())), n);
+  }
+}
+
+TEST(StreamingBuilderTest, BufferAndStreamSinks) {
+  size_t const n = 3000;
+  Buffer<char> buffer;
+  CharBufferSink bufferSink(&buffer);
+  StreamingBuilder b1(&bufferSink, &Options::Defaults, 100);
+  buildRows(b1, n);
+  checkValid(buffer.toString());
+  checkRows(Slice(reinterpret_cast<uint8_t const*>(buffer.data())), n);
+
+  std::ostringstream stream;
+  StringStreamSink streamSink(&stream);
+  StreamingBuilder b2(&streamSink, &Options::Defaults, 100);
+  buildRows(b2, n);
+  std::string out = stream.str();
+  checkValid(out);
+  ASSERT_EQ(buffer.toString(), out);
+}
+
+#ifndef _WIN32
+TEST(StreamingBuilderTest, FdSink) {
+  char name[] = "/tmp/vpack-streaming-XXXXXX";
+  int fd = ::mkstemp(name);
+  ASSERT_TRUE(fd >= 0);
+  size_t const n = 50000;
+  {
+    FdSink sink(fd, 4096);
+    StreamingBuilder b(&sink, &Options::Defaults, 1000);
+    buildRows(b, n);
+    sink.flush();
+  }
+
+  std::string out;
+  ASSERT_TRUE(::lseek(fd, 0, SEEK_SET) == 0);
+  char buf[65536];
+  ssize_t r;
+  while ((r = ::read(fd, buf, sizeof(buf))) > 0) {
+    out.append(buf, static_cast<size_t>(r));
+  }
+  ::close(fd);
+  ::unlink(name);
+
+  checkValid(out);
+  checkRows(Slice(reinterpret_cast<uint8_t const*>(out.data())), n);
+}
+
+TEST(StreamingBuilderTest, FdSinkPipeSmallValue) {
+  int fds[2];
+  ASSERT_EQ(0, ::pipe(fds));
+  {
+    FdSink sink(fds[1]);
+    StreamingBuilder b(&sink);
+    buildRows(b, 10);
+    sink.flush();
+  }
+  ::close(fds[1]);
+  std::string out;
+  char buf[4096];
+  ssize_t r;
+  while ((r = ::read(fds[0], buf, sizeof(buf))) > 0) {
+    out.append(buf, static_cast<size_t>(r));
+  }
+  ::close(fds[0]);
+  checkValid(out);
+  checkRows(Slice(reinterpret_cast<uint8_t const*>(out.data())), 10);
+}
+#endif
+
+struct AppendOnlySink final : public Sink {
+  void push_back(char c) override { out.push_back(c); }
+  void append(std::string const& p) override { out.append(p); }
+  void append(char const* p) override { out.append(p); }
+  void append(char const* p, ValueLength len) override { out.append(p, len); }
+  void reserve(ValueLength) override {}
+  std::string out;
+};
+
+TEST(StreamingBuilderTest, SinkWithoutOverwrite) {
+  AppendOnlySink sink;
+  StreamingBuilder small(&sink);
+  buildRows(small, 10);
+  checkRows(Slice(reinterpret_cast<uint8_t const*>(sink.out.data())), 10);
+
+  AppendOnlySink sink2;
+  StreamingBuilder big(&sink2, &Options::Defaults, 100);
+  ASSERT_VELOCYPACK_EXCEPTION(buildRows(big, 100), Exception::NotImplemented);
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
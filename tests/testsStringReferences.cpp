@@ -0,0 +1,499 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <string>
+
+#include "tests-common.h"
+
+TEST(StringReferencesTest, BuilderArray) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openArray();
+  b.add(Value("foobar"));
+  b.add(Value(std::string("foobar")));
+  b.add(ValuePair("foobar", 6, ValueType::String));
+  b.add(Value("baz"));
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(4UL, s.length());
+  ASSERT_FALSE(s.at(0).isStringReference());
+  ASSERT_TRUE(s.at(1).isStringReference());
+  ASSERT_TRUE(s.at(2).isStringReference());
+  ASSERT_FALSE(s.at(3).isStringReference());
+
+  for (size_t i = 0; i < 3; ++i) {
+    Slice member = s.at(i);
+    ASSERT_TRUE(member.isString());
+    ASSERT_EQ(ValueType::String, member.type());
+    ASSERT_EQ("foobar", member.copyString());
+    ASSERT_EQ(6UL, member.getStringLength());
+    ValueLength length;
+    char const* p = member.getString(length);
+    ASSERT_EQ("foobar", std::string(p, length));
+    ASSERT_TRUE(member.isEqualString("foobar"));
+    ASSERT_EQ(0, member.compareString("foobar"));
+    ASSERT_EQ(s.at(0).normalizedHash(), member.normalizedHash());
+    ASSERT_EQ(s.at(0).start(), member.resolveStringReference().start());
+  }
+  ASSERT_EQ(2UL, s.at(1).byteSize());
+  ASSERT_EQ("[\"foobar\",\"foobar\",\"foobar\",\"baz\"]", s.toJson());
+
+  Builder plain;
+  plain.add(Value(ValueType::Array));
+  plain.add(Value("foobar"));
+  plain.add(Value("foobar"));
+  plain.add(Value("foobar"));
+  plain.add(Value("baz"));
+  plain.close();
+  ASSERT_LT(s.byteSize(), plain.slice().byteSize());
+  ASSERT_EQ(plain.slice().normalizedHash(), s.normalizedHash());
+}
+
+TEST(StringReferencesTest, KeysAreNotReplaced) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openObject();
+  b.add("foobar", Value("foobar"));
+  b.add("qux", Value("foobar"));
+  b.add("foobar2", Value("qux"));
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_FALSE(s.keyAt(0).isStringReference());
+  ASSERT_FALSE(s.keyAt(1).isStringReference());
+  ASSERT_FALSE(s.keyAt(2).isStringReference());
+  ASSERT_FALSE(s.get("foobar").isStringReference());
+  ASSERT_TRUE(s.get("qux").isStringReference());
+  ASSERT_FALSE(s.get("foobar2").isStringReference());
+  ASSERT_EQ("foobar", s.get("qux").copyString());
+  ASSERT_EQ("qux", s.get("foobar2").copyString());
+}
+
+TEST(StringReferencesTest, OnlyShorterReplacements) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openArray();
+  b.add(Value("a"));
+  b.add(Value("a"));
+  b.add(Value(""));
+  b.add(Value(""));
+  b.add(Value("ab"));
+  b.add(Value("ab"));
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_FALSE(s.at(1).isStringReference());
+  ASSERT_FALSE(s.at(3).isStringReference());
+  ASSERT_TRUE(s.at(5).isStringReference());
+  ASSERT_EQ("ab", s.at(5).copyString());
+}
+
+TEST(StringReferencesTest, NestedCompoundValues) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::string const json(
+      "[{\"name\":\"alpha\",\"tags\":[\"red\",\"green\"]},"
+      "{\"name\":\"alpha\",\"tags\":[\"green\",\"blue\"],"
+      "\"sub\":{\"name\":\"alpha\",\"color\":\"blue\"}},\"alpha\"]");
+
+  for (bool unindexed : {false, true}) {
+    options.buildUnindexedArrays = unindexed;
+    options.buildUnindexedObjects = unindexed;
+
+    std::shared_ptr<Builder> b = Parser::fromJson(json, &options);
+    Slice s = b->slice();
+    ASSERT_TRUE(isValid(s));
+
+    options.dedupeStrings = false;
+    std::shared_ptr<Builder> plain = Parser::fromJson(json, &options);
+    options.dedupeStrings = true;
+    ASSERT_EQ(plain->slice().toJson(), s.toJson());
+    ASSERT_LT(s.byteSize(), plain->slice().byteSize());
+    ASSERT_EQ(plain->slice().normalizedHash(), s.normalizedHash());
+
+    ASSERT_FALSE(s.at(0).get("name").isStringReference());
+    ASSERT_TRUE(s.at(1).get("name").isStringReference());
+    ASSERT_TRUE(s.at(1).get("sub").get("name").isStringReference());
+    ASSERT_TRUE(s.at(1).get("tags").at(0).isStringReference());
+    ASSERT_TRUE(s.at(1).get("sub").get("color").isStringReference());
+    ASSERT_TRUE(s.at(2).isStringReference());
+    ASSERT_EQ("alpha", s.at(1).get("sub").get("name").copyString());
+    ASSERT_EQ("blue", s.at(1).get("sub").get("color").copyString());
+  }
+}
+
+TEST(StringReferencesTest, LongStringsAndDistances) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::string const value(300, 'x');
+  Builder b(&options);
+  b.openArray();
+  b.add(Value(value));
+  b.add(Value(value));
+  for (size_t i = 0; i < 500; ++i) {
+    b.add(Value("filler" + std::to_string(i)));
+  }
+  b.add(Value(value));
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_EQ(0xbf, s.at(0).head());
+  ASSERT_EQ(0xd9, s.at(1).head());
+  ASSERT_EQ(0xd9, s.at(502).head());
+  ASSERT_EQ(value, s.at(1).copyString());
+  ASSERT_EQ(value, s.at(502).copyString());
+  ASSERT_EQ("filler499", s.at(501).copyString());
+}
+
+TEST(StringReferencesTest, CopyReference) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openArray();
+  b.add(Value("foobar"));
+  b.add(Value("foobar"));
+  b.close();
+  ASSERT_TRUE(b.slice().at(1).isStringReference());
+
+  Builder copy;
+  copy.add(b.slice().at(1));
+  ASSERT_FALSE(copy.slice().isStringReference());
+  ASSERT_EQ("foobar", copy.slice().copyString());
+
+  Builder copy2(&options);
+  copy2.openArray();
+  copy2.add(b.slice().at(1));
+  copy2.add(b.slice().at(1));
+  copy2.close();
+  ASSERT_TRUE(isValid(copy2.slice()));
+  ASSERT_FALSE(copy2.slice().at(0).isStringReference());
+  ASSERT_TRUE(copy2.slice().at(1).isStringReference());
+}
+
+TEST(StringReferencesTest, SelfContained) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"a\":\"some long status value\","
+      "\"b\":{\"c\":\"some long status value\",\"d\":[\"foobar\",\"foobar\"]}}",
+      &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.isSelfContained());
+  ASSERT_FALSE(s.get("b").isSelfContained());
+  ASSERT_FALSE(s.get("b").get("c").isSelfContained());
+  ASSERT_TRUE(s.get("b").get("d").isSelfContained());
+  ASSERT_TRUE(s.get("b").get("d").at(1).isStringReference());
+  ASSERT_TRUE(s.get("a").isSelfContained());
+}
+
+TEST(StringReferencesTest, CopyCompoundValue) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"a\":\"some long status value\","
+      "\"b\":{\"c\":\"some long status value\",\"d\":[\"foobar\",\"foobar\"]}}",
+      &options);
+  Slice sub = b->slice().get("b");
+  ASSERT_TRUE(sub.get("c").isStringReference());
+
+  std::string const expected(
+      "{\"c\":\"some long status value\",\"d\":[\"foobar\",\"foobar\"]}");
+
+  Builder out;
+  out.add(sub);
+  ASSERT_TRUE(isValid(out.slice()));
+  ASSERT_TRUE(out.slice().isSelfContained());
+  ASSERT_EQ(expected, out.slice().toJson());
+
+  // the copy is deduplicated against the Strings of its new document
+  Builder outer(&options);
+  outer.openArray();
+  outer.add(Value("some long status value"));
+  outer.add(sub);
+  outer.close();
+  ASSERT_TRUE(isValid(outer.slice()));
+  ASSERT_TRUE(outer.slice().at(1).get("c").isStringReference());
+  ASSERT_EQ(expected, outer.slice().at(1).toJson());
+}
+
+TEST(StringReferencesTest, CopyArrayMembers) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[{\"x\":\"some long status value\",\"y\":1},"
+      "{\"x\":\"some long status value\",\"y\":2}]",
+      &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.at(1).get("x").isStringReference());
+
+  Builder out;
+  out.openArray();
+  for (auto const& it : ArrayIterator(s)) {
+    out.add(it);
+  }
+  out.close();
+  ASSERT_TRUE(isValid(out.slice()));
+  ASSERT_EQ(s.toJson(), out.slice().toJson());
+}
+
+TEST(StringReferencesTest, CollectionCopies) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"a\":\"some long status value\","
+      "\"b\":{\"c\":\"some long status value\"},"
+      "\"e\":[{\"x\":\"another long value\"},{\"x\":\"another long value\"},"
+      "{\"x\":\"some long status value\"}]}",
+      &options);
+  Slice s = b->slice();
+  Slice sub = s.get("b");
+  Slice array = s.get("e");
+
+  Builder keep = Collection::keep(s, std::vector<std::string>{"b"});
+  ASSERT_TRUE(isValid(keep.slice()));
+  ASSERT_EQ("{\"b\":{\"c\":\"some long status value\"}}", keep.slice().toJson());
+
+  Builder remove = Collection::remove(s, std::vector<std::string>{"a", "e"});
+  ASSERT_TRUE(isValid(remove.slice()));
+  ASSERT_EQ("{\"b\":{\"c\":\"some long status value\"}}", remove.slice().toJson());
+
+  Builder filter = Collection::filter(
+      array, [](Slice const&, ValueLength index) { return index > 0; });
+  ASSERT_TRUE(isValid(filter.slice()));
+  ASSERT_EQ(
+      "[{\"x\":\"another long value\"},{\"x\":\"some long status value\"}]",
+      filter.slice().toJson());
+
+  std::shared_ptr<Builder> other = Parser::fromJson("{\"d\":1}");
+  Builder merge = Collection::merge(sub, other->slice(), false);
+  ASSERT_TRUE(isValid(merge.slice()));
+  ASSERT_EQ("{\"c\":\"some long status value\",\"d\":1}", merge.slice().toJson());
+
+  Builder sort = Collection::sort(array);
+  ASSERT_TRUE(isValid(sort.slice()));
+  ASSERT_EQ(
+      "[{\"x\":\"another long value\"},{\"x\":\"another long value\"},"
+      "{\"x\":\"some long status value\"}]",
+      sort.slice().toJson());
+
+  std::shared_ptr<Builder> patch = Parser::fromJson("[]");
+  Builder apply = Collection::apply(sub, patch->slice());
+  ASSERT_TRUE(isValid(apply.slice()));
+  ASSERT_EQ("{\"c\":\"some long status value\"}", apply.slice().toJson());
+}
+
+TEST(StringReferencesTest, ContainerCopies) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "{\"a\":\"some long status value\","
+      "\"b\":{\"c\":\"some long status value\"}}",
+      &options);
+  Slice sub = b->slice().get("b");
+  std::string const expected("{\"c\":\"some long status value\"}");
+
+  SliceContainer container(sub);
+  ASSERT_TRUE(isValid(container.slice()));
+  ASSERT_EQ(expected, container.slice().toJson());
+
+  SharedSlice shared(sub);
+  ASSERT_TRUE(isValid(shared.slice()));
+  ASSERT_EQ(expected, shared.slice().toJson());
+
+  SharedSlice reference(b->slice().get("b").get("c"));
+  ASSERT_FALSE(reference.slice().isStringReference());
+  ASSERT_EQ("some long status value", reference.slice().copyString());
+
+  std::string out;
+  StringSink sink(&out);
+  StreamingBuilder streaming(&sink);
+  streaming.openArray();
+  streaming.add(sub);
+  streaming.add(sub.get("c"));
+  streaming.close();
+  streaming.flush();
+  Slice streamed(reinterpret_cast<uint8_t const*>(out.data()));
+  ASSERT_EQ(out.size(), streamed.byteSize());
+  ASSERT_TRUE(isValid(streamed));
+  ASSERT_EQ("[" + expected + ",\"some long status value\"]", streamed.toJson());
+}
+
+TEST(StringReferencesTest, PatchReferencedString) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openObject();
+  b.add("a", Value("pending-review"));
+  b.add("b", Value("pending-review"));
+  b.add("c", Value("something else"));
+  b.close();
+  ASSERT_TRUE(b.slice().get("b").isStringReference());
+
+  SlicePatcher patcher(b);
+  ASSERT_FALSE(patcher.patch("a", Value("accepted-done!")));
+  ASSERT_EQ("pending-review", b.slice().get("a").copyString());
+  ASSERT_EQ("pending-review", b.slice().get("b").copyString());
+
+  // Strings nobody refers to can be patched
+  ASSERT_TRUE(patcher.patch("c", Value("different one!")));
+  ASSERT_EQ("different one!", b.slice().get("c").copyString());
+  ASSERT_EQ("pending-review", b.slice().get("b").copyString());
+  ASSERT_TRUE(isValid(b.slice()));
+
+  // neither can an Array containing a referenced String
+  std::shared_ptr<Builder> nested = Parser::fromJson(
+      "{\"a\":[\"pending-review\"],\"b\":\"pending-review\"}", &options);
+  std::shared_ptr<Builder> other = Parser::fromJson("[\"accepted-done!\"]");
+  SlicePatcher nestedPatcher(*nested);
+  ASSERT_FALSE(nestedPatcher.patch(nested->slice().get("a"), other->slice()));
+  ASSERT_EQ("pending-review", nested->slice().get("b").copyString());
+}
+
+TEST(StringReferencesTest, PatchWithReference) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder source(&options);
+  source.openArray();
+  source.add(Value("foobar"));
+  source.add(Value("foobar"));
+  source.close();
+  Slice reference = source.slice().at(1);
+  ASSERT_TRUE(reference.isStringReference());
+
+  Builder b;
+  b.openArray();
+  b.add(Value("qux123"));
+  b.add(Value(1));
+  b.close();
+
+  SlicePatcher patcher(b);
+  ASSERT_TRUE(patcher.patch(b.slice().at(0), reference));
+  ASSERT_FALSE(b.slice().at(0).isStringReference());
+  ASSERT_EQ("[\"foobar\",1]", b.slice().toJson());
+  ASSERT_TRUE(isValid(b.slice()));
+}
+
+TEST(StringReferencesTest, Distinct) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson(
+      "[\"long string value\",\"long string value\",\"other\","
+      "[\"long string value\"],[\"long string value\"],"
+      "{\"a\":\"long string value\"},{\"a\":\"long string value\"}]",
+      &options);
+  Slice s = b->slice();
+  ASSERT_TRUE(s.at(1).isStringReference());
+  ASSERT_TRUE(s.at(4).at(0).isStringReference());
+
+  Builder distinct = Collection::distinct(s);
+  ASSERT_EQ(
+      "[\"long string value\",\"other\",[\"long string value\"],"
+      "{\"a\":\"long string value\"}]",
+      distinct.slice().toJson());
+  ASSERT_TRUE(isValid(distinct.slice()));
+
+  std::shared_ptr<Builder> plain = Parser::fromJson(
+      "[\"long string value\",[\"long string value\"],\"more\"]");
+  Builder intersect = Collection::intersect(s, plain->slice());
+  ASSERT_EQ("[\"long string value\",[\"long string value\"]]",
+            intersect.slice().toJson());
+  Builder difference = Collection::difference(plain->slice(), s);
+  ASSERT_EQ("[\"more\"]", difference.slice().toJson());
+}
+
+TEST(StringReferencesTest, RemoveLast) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openArray();
+  b.add(Value("foobar"));
+  b.removeLast();
+  b.add(Value(1));
+  b.add(Value("foobar"));
+  b.add(Value("foobar"));
+  b.close();
+
+  Slice s = b.slice();
+  ASSERT_TRUE(isValid(s));
+  ASSERT_FALSE(s.at(1).isStringReference());
+  ASSERT_TRUE(s.at(2).isStringReference());
+  ASSERT_EQ("[1,\"foobar\",\"foobar\"]", s.toJson());
+}
+
+TEST(StringReferencesTest, NoReferencesAcrossDocuments) {
+  Options options;
+  options.dedupeStrings = true;
+
+  Builder b(&options);
+  b.openArray();
+  b.add(Value("foobar"));
+  b.close();
+  ValueLength const first = b.size();
+  b.openArray();
+  b.add(Value("foobar"));
+  b.add(Value("foobar"));
+  b.close();
+
+  Slice second(b.start() + first);
+  ASSERT_TRUE(isValid(second));
+  ASSERT_FALSE(second.at(0).isStringReference());
+  ASSERT_TRUE(second.at(1).isStringReference());
+
+  b.clear();
+  b.openArray();
+  b.add(Value("foobar"));
+  b.close();
+  ASSERT_FALSE(b.slice().at(0).isStringReference());
+}
+
+int main(int argc, char* argv[]) {
+  ::testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
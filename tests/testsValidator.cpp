@@ -34,21 +34,42 @@ TEST(ValidatorTest, NoOptions) {
 }
 
 TEST(ValidatorTest, ReservedValue1) {
-  std::string const value("\x15", 1);
+  std::string const value("\xdd", 1);
 
   Validator validator;
   ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
 }
 
 TEST(ValidatorTest, ReservedValue2) {
-  std::string const value("\x16", 1);
+  std::string const value("\xde", 1);
 
   Validator validator;
   ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
 }
 
 TEST(ValidatorTest, ReservedValue3) {
-  std::string const value("\xd8", 1);
+  std::string const value("\xdc", 1);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
+}
+
+TEST(ValidatorTest, ShapedArrayTruncated) {
+  std::string const value("\x15", 1);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, ShapedArrayMemberNoRow) {
+  std::string const value("\x15\x0e\x02\x04\x41\x61\x0b\x07\x01\x41\x61\x31\x03\x01", 14);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
+}
+
+TEST(ValidatorTest, RowOutsideShapedArray) {
+  std::string const value("\x16\x04\x01\x31", 4);
 
   Validator validator;
   ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
@@ -1193,6 +1214,247 @@ TEST(ValidatorTest, EmptyObjectWithExtra) {
   ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
 }
 
+TEST(ValidatorTest, DeeplyNestedArrays) {
+  // Arrays with 8-byte lengths, each containing the next one
+  size_t const depth = 100000;
+  std::string value;
+  value.reserve(depth * 9 + 1);
+  for (size_t i = depth; i > 0; --i) {
+    uint64_t byteSize = i * 9 + 1;
+    value.push_back('\x05');
+    for (size_t j = 0; j < 8; ++j) {
+      value.push_back(static_cast<char>(byteSize & 0xff));
+      byteSize >>= 8;
+    }
+  }
+  value.push_back('\x01');
+
+  Validator validator;
+  ASSERT_TRUE(validator.validate(value.c_str(), value.size()));
+
+  Options options;
+  options.validatorMaxDepth = depth;
+  Validator validator2(&options);
+  ASSERT_TRUE(validator2.validate(value.c_str(), value.size()));
+
+  options.validatorMaxDepth = depth - 1;
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(value.c_str(), value.size()), Exception::ValidatorNestingTooDeep);
+}
+
+TEST(ValidatorTest, MaxDepth) {
+  Options options;
+  options.validatorMaxDepth = 3;
+  Validator validator(&options);
+
+  std::shared_ptr<Builder> b = Parser::fromJson("[{\"a\":[1]},[]]");
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+
+  b = Parser::fromJson("[{\"a\":[[]]}]");
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+
+  b = Parser::fromJson("[{\"a\":[[1]]}]");
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(b->start(), b->size()), Exception::ValidatorNestingTooDeep);
+
+  b = Parser::fromJson("{\"a\":{\"b\":{\"c\":{\"d\":1}}}}");
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(b->start(), b->size()), Exception::ValidatorNestingTooDeep);
+}
+
+TEST(ValidatorTest, MaxSize) {
+  std::shared_ptr<Builder> b = Parser::fromJson("[\"foobar\",1,2,3]");
+
+  Options options;
+  options.validatorMaxSize = b->size();
+  Validator validator(&options);
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+
+  options.validatorMaxSize = b->size() - 1;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(b->start(), b->size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, ArrayIndexTableOutOfOrder) {
+  std::string const value("\x06\x09\x02\x31\x42\x61\x62\x03\x04", 9);
+
+  Validator validator;
+  ASSERT_TRUE(validator.validate(value.c_str(), value.size()));
+
+  std::string const swapped("\x06\x09\x02\x31\x42\x61\x62\x04\x03", 9);
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(swapped.c_str(), swapped.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, CompactArrayMembersNotFillingArray) {
+  std::string const value("\x13\x06\x18\x18\x18\x02", 6);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, ObjectIndexTableNoPermutation) {
+  std::string const value("\x0b\x0b\x02\x41\x62\x31\x41\x61\x32\x03\x03", 11);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, ObjectKeyOrder) {
+  // index table in data order, which is not sorted by key
+  std::string const unsorted("\x0b\x0b\x02\x41\x62\x31\x41\x61\x32\x03\x06", 11);
+  // index table sorted by key
+  std::string const sorted("\x0b\x0b\x02\x41\x62\x31\x41\x61\x32\x06\x03", 11);
+
+  Validator validator;
+  ASSERT_TRUE(validator.validate(unsorted.c_str(), unsorted.size()));
+  ASSERT_TRUE(validator.validate(sorted.c_str(), sorted.size()));
+
+  Options options;
+  options.validatorCheckKeyOrder = true;
+  Validator validator2(&options);
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(unsorted.c_str(), unsorted.size()), Exception::ValidatorInvalidKeyOrder);
+  ASSERT_TRUE(validator2.validate(sorted.c_str(), sorted.size()));
+
+  // unsorted Object types are not subject to the order check
+  std::string const unsortedType("\x0f\x0b\x02\x41\x62\x31\x41\x61\x32\x03\x06", 11);
+  ASSERT_TRUE(validator2.validate(unsortedType.c_str(), unsortedType.size()));
+}
+
+TEST(ValidatorTest, ObjectKeyOrderBuilder) {
+  Options options;
+  options.validatorCheckKeyOrder = true;
+  options.checkAttributeUniqueness = true;
+  Validator validator(&options);
+
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"z\":1,\"a\":2,\"ab\":3,\"b\":{\"y\":1,\"x\":[1,2,{\"c\":1,\"b\":2}]},\"aa\":4}");
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+}
+
+TEST(ValidatorTest, ObjectDuplicateKeys) {
+  std::string const sorted("\x0b\x0b\x02\x41\x61\x31\x41\x61\x32\x03\x06", 11);
+  std::string const unsorted("\x0f\x0b\x02\x41\x61\x31\x41\x61\x32\x03\x06", 11);
+  std::string const compact("\x14\x09\x41\x61\x31\x41\x61\x32\x02", 9);
+
+  Validator validator;
+  ASSERT_TRUE(validator.validate(sorted.c_str(), sorted.size()));
+  ASSERT_TRUE(validator.validate(unsorted.c_str(), unsorted.size()));
+  ASSERT_TRUE(validator.validate(compact.c_str(), compact.size()));
+
+  Options options;
+  options.checkAttributeUniqueness = true;
+  Validator validator2(&options);
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(sorted.c_str(), sorted.size()), Exception::DuplicateAttributeName);
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(unsorted.c_str(), unsorted.size()), Exception::DuplicateAttributeName);
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(compact.c_str(), compact.size()), Exception::DuplicateAttributeName);
+
+  options.validatorCheckKeyOrder = true;
+  ASSERT_VELOCYPACK_EXCEPTION(validator2.validate(sorted.c_str(), sorted.size()), Exception::DuplicateAttributeName);
+}
+
+TEST(ValidatorTest, ObjectUniqueKeysNested) {
+  Options options;
+  options.checkAttributeUniqueness = true;
+  Validator validator(&options);
+
+  std::shared_ptr<Builder> b = Parser::fromJson("{\"a\":{\"a\":{\"a\":1,\"b\":2},\"b\":[{\"a\":1}]},\"b\":{}}");
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+
+  options.buildUnindexedObjects = true;
+  b = Parser::fromJson("{\"a\":{\"a\":{\"a\":1,\"b\":2},\"b\":[{\"a\":1}]},\"b\":{}}", &options);
+  ASSERT_EQ(0x14, b->slice().head());
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+}
+
+TEST(ValidatorTest, LongStringUtf8) {
+  Options options;
+  options.validateUtf8Strings = true;
+  Validator validator(&options);
+
+  std::string text(300, 'x');
+  text.append("\xc3\xa4\xe2\x82\xac");
+  text.append(77, 'y');
+  Builder b;
+  b.add(Value(text));
+  ASSERT_TRUE(validator.validate(b.start(), b.size()));
+
+  // invalid continuation byte after a long run of ASCII
+  for (size_t pos : {0, 7, 15, 16, 299, 300, 302, 381}) {
+    std::string invalid(text);
+    invalid[pos] = '\x80';
+    Builder b2;
+    b2.add(Value(invalid));
+    ASSERT_VELOCYPACK_EXCEPTION(validator.validate(b2.start(), b2.size()), Exception::InvalidUtf8Sequence);
+  }
+
+  // truncated multi-byte sequence at the very end
+  std::string truncated(64, 'z');
+  truncated.push_back('\xc3');
+  Builder b3;
+  b3.add(Value(truncated));
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(b3.start(), b3.size()), Exception::InvalidUtf8Sequence);
+}
+
+TEST(ValidatorTest, StringReferences) {
+  Options options;
+  options.dedupeStrings = true;
+
+  std::shared_ptr<Builder> b = Parser::fromJson("[\"foobar\",{\"a\":\"foobar\"},\"foobar\"]", &options);
+
+  Validator validator;
+  ASSERT_TRUE(validator.validate(b->start(), b->size()));
+}
+
+TEST(ValidatorTest, StringReferenceAlone) {
+  std::string const value("\xd8\x01", 2);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, StringReferenceTruncated) {
+  std::string const value("\x13\x06\x41\x61\xd9\x02", 6);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, StringReferenceTargetOutOfBounds) {
+  std::string const value("\x13\x05\xd8\x05\x01", 5);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+
+  // a sub part must not reference anything in front of it
+  std::string const value2("\x13\x07\x41\x61\xd8\x02\x02", 7);
+  ASSERT_TRUE(validator.validate(value2.c_str(), value2.size()));
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value2.c_str() + 4, 2), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, StringReferenceTargetNoString) {
+  std::string const value("\x13\x06\x31\xd8\x01\x02", 6);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
+}
+
+TEST(ValidatorTest, StringReferenceTargetReference) {
+  std::string const value("\x13\x09\x41\x61\xd8\x02\xd8\x02\x03", 9);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
+}
+
+TEST(ValidatorTest, StringReferenceTargetTooLong) {
+  // the reference points into the middle of a String
+  std::string const value("\x13\x09\x43\x61\x62\x63\xd8\x03\x02", 9);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidLength);
+}
+
+TEST(ValidatorTest, StringReferenceAsKey) {
+  std::string const value("\x14\x0a\x41\x61\x41\x61\xd8\x04\x31\x02", 10);
+
+  Validator validator;
+  ASSERT_VELOCYPACK_EXCEPTION(validator.validate(value.c_str(), value.size()), Exception::ValidatorInvalidType);
+}
+
 int main(int argc, char* argv[]) {
   ::testing::InitGoogleTest(&argc, argv);
 
@@ -24,34 +24,67 @@
 /// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
-#include <fstream>
-#include <chrono>
-#include <thread>
 
 #include "velocypack/vpack.h"
 
+#ifdef VELOCYPACK_BENCH_RAPIDJSON
 #include "rapidjson/document.h"
-#include "rapidjson/writer.h"
-#include "rapidjson/stringbuffer.h"
+#endif
 
 using namespace arangodb::velocypack;
 
 static void usage(char* argv[]) {
-  std::cout << "Usage: " << argv[0]
-            << " FILENAME.json RUNTIME_IN_SECONDS COPIES TYPE" << std::endl;
-  std::cout << "This program reads the file into a string, makes COPIES copies"
+  std::cout << "Usage: " << argv[0] << " [OPTIONS] [FILENAME.json ...]"
+            << std::endl;
+  std::cout << "Runs a set of workloads over JSON inputs and reports timings."
+            << std::endl;
+  std::cout << "Without filenames, all valid JSON files from tests/jsonSample"
+            << std::endl;
+  std::cout << "are used. Synthetic inputs of typical shapes are added unless"
+            << std::endl;
+  std::cout << "--no-synthetic is given." << std::endl;
+  std::cout << std::endl;
+  std::cout << "Options:" << std::endl;
+  std::cout << "  --runtime SECONDS   measuring time per workload and input "
+               "(default: 1)"
+            << std::endl;
+  std::cout << "  --warmup SECONDS    warmup time per workload and input "
+               "(default: 0.2)"
+            << std::endl;
+  std::cout << "  --copies N          number of copies of each input used in a"
+            << std::endl;
+  std::cout << "                      round-robin fashion. 1 copy means running"
+            << std::endl;
+  std::cout << "                      in cache, more copies make it run out of"
             << std::endl;
-  std::cout << "and then parses the copies in a round-robin fashion to VPack."
+  std::cout << "                      cache (default: 1)" << std::endl;
+  std::cout << "  --workload LIST     comma-separated list of workloads to run"
             << std::endl;
-  std::cout << "1 copy means its running in cache, more copies make it run"
+  std::cout << "                      (default: all)" << std::endl;
+  std::cout << "  --input TEXT        only run inputs whose name contains TEXT"
             << std::endl;
-  std::cout << "out of cache. The target areas are also in a different memory"
+  std::cout << "  --no-synthetic      do not add synthetic inputs" << std::endl;
+  std::cout << "  --format FORMAT     output format, one of 'text', 'json' or "
+               "'csv'"
             << std::endl;
-  std::cout << "area for each copy." << std::endl;
-  std::cout << "TYPE must be either 'vpack' or 'rapidjson'." << std::endl;
+  std::cout << "                      (default: text)" << std::endl;
+  std::cout << "  --output FILENAME   write results to FILENAME instead of "
+               "stdout"
+            << std::endl;
+  std::cout << "  --list              list workloads and inputs, then exit"
+            << std::endl;
+  std::cout << "  --help              show this help" << std::endl;
 }
 
 static std::string tryReadFile(std::string const& filename) {
@@ -59,8 +92,7 @@ static std::string tryReadFile(std::string const& filename) {
   std::ifstream ifs(filename.c_str(), std::ifstream::in);
 
   if (!ifs.is_open()) {
-    std::cerr << "Cannot open input file '" << filename << "'" << std::endl;
-    ::exit(EXIT_FAILURE);
+    throw std::runtime_error("cannot open input file '" + filename + "'");
   }
 
   char buffer[4096];
@@ -73,154 +105,828 @@ static std::string tryReadFile(std::string const& filename) {
   return s;
 }
 
+// reads a file by its path, or from tests/jsonSample in the current
+// directory or one of its parents
 static std::string readFile(std::string filename) {
 #ifdef _WIN32
   std::string const separator("\\");
 #else
   std::string const separator("/");
 #endif
+  {
+    std::ifstream ifs(filename.c_str(), std::ifstream::in);
+    if (ifs.is_open()) {
+      return tryReadFile(filename);
+    }
+  }
   filename = "tests" + separator + "jsonSample" + separator + filename;
 
-  for (size_t i = 0; i < 3; ++i) {
-    try {
+  for (size_t i = 0; i < 4; ++i) {
+    std::ifstream ifs(filename.c_str(), std::ifstream::in);
+    if (ifs.is_open()) {
       return tryReadFile(filename);
-    } catch (...) {
-      filename = ".." + separator + filename;
     }
+    filename = ".." + separator + filename;
   }
-  throw "cannot open input file";
+  throw std::runtime_error("cannot find input file '" + filename + "'");
 }
 
-static void run(std::string& data, int runTime, size_t copies, bool useVPack,
-                bool fullOutput) {
-  Options options;
+// the valid JSON files in tests/jsonSample
+static char const* const corpusFiles[] = {
+    "api-docs.json", "commits.json",     "countries.json",
+    "directory-tree.json", "doubles-small.json", "doubles.json",
+    "file-list.json", "object.json",      "pass1.json",
+    "pass2.json",     "pass3.json",       "random1.json",
+    "random2.json",   "random3.json",     "sample.json",
+    "sampleNoWhite.json", "small.json"};
 
-  std::vector<std::string> inputs;
-  std::vector<Parser*> outputs;
-  inputs.push_back(data);
-  outputs.push_back(new Parser(&options));
+// a lookup done by the 'get' workload: the offset of an Object relative to
+// the start of the input, and the attribute path looked up in it
+struct Lookup {
+  ValueLength offset;
+  std::vector<std::string> path;
+};
 
-  for (size_t i = 1; i < copies; i++) {
-    // Make an explicit copy:
-    data.clear();
-    data.insert(data.begin(), inputs[0].begin(), inputs[0].end());
-    inputs.push_back(data);
-    outputs.push_back(new Parser(&options));
-  }
+struct Input {
+  std::string name;
+  // copies of the input in the formats measured
+  std::vector<std::string> json;
+  std::vector<std::string> msgpack;
+  std::vector<std::string> cbor;
+  std::vector<std::shared_ptr<Builder>> vpack;
+  std::vector<Lookup> lookups;
 
-  size_t count = 0;
-  size_t total = 0;
-  auto start = std::chrono::high_resolution_clock::now();
-  decltype(start) now;
+  Slice slice(size_t copy) const { return vpack[copy]->slice(); }
+};
 
-  try {
-    do {
-      for (int i = 0; i < 2; i++) {
-        if (useVPack) {
-          outputs[count]->clear();
-          outputs[count]->parse(inputs[count]);
-        } else {
-          rapidjson::Document d;
-          d.Parse(inputs[count].c_str());
-        }
-        count++;
-        if (count >= copies) {
-          count = 0;
-        }
-        total++;
+// reusable state for the workloads, so that they measure the library
+// and not the allocation of parsers, builders and buffers
+struct Scratch {
+  explicit Scratch(Options const* options, Options const* strictOptions)
+      : options(options),
+        strictOptions(strictOptions),
+        parser(options),
+        builder(options) {}
+
+  Options const* options;
+  Options const* strictOptions;
+  Parser parser;
+  Builder builder;
+  std::string output;
+};
+
+static void collectLookups(Slice const& root, Slice const& object,
+                           std::vector<std::string>& prefix,
+                           std::vector<Lookup>& lookups) {
+  ObjectIterator it(object, true);
+  while (it.valid() && lookups.size() < 256) {
+    prefix.emplace_back(it.key(true).copyString());
+    lookups.emplace_back(Lookup{
+        static_cast<ValueLength>(object.start() - root.start()), prefix});
+    Slice value = it.value();
+    if (value.isObject() && prefix.size() < 4) {
+      collectLookups(root, value, prefix, lookups);
+    }
+    prefix.pop_back();
+    it.next();
+  }
+}
+
+// looks up the attributes of the root Object, or of the first Objects in
+// the root Array
+static std::vector<Lookup> buildLookups(Slice const& root) {
+  std::vector<Lookup> lookups;
+  std::vector<std::string> prefix;
+  if (root.isObject()) {
+    collectLookups(root, root, prefix, lookups);
+  } else if (root.isArray()) {
+    ArrayIterator it(root);
+    while (it.valid() && it.index() < 64 && lookups.size() < 256) {
+      if (it.value().isObject()) {
+        collectLookups(root, it.value(), prefix, lookups);
       }
-      now = std::chrono::high_resolution_clock::now();
-    } while (std::chrono::duration_cast<std::chrono::duration<int>>(now - start)
-                 .count() < runTime);
-
-    std::chrono::duration<double> totalTime =
-        std::chrono::duration_cast<std::chrono::duration<double>>(now - start);
-
-    if (fullOutput) {
-      std::cout << "Total runtime: " << totalTime.count() << " s" << std::endl;
-      std::cout << "Have parsed " << total << " times with "
-                << (useVPack ? "vpack" : "rapidjson") << " using " << copies
-                << " copies of JSON data, each of size " << inputs[0].size()
-                << "." << std::endl;
-      std::cout << "Parsed " << inputs[0].size() * total << " bytes in total."
-                << std::endl;
+      it.next();
     }
-    std::cout << "This is "
-              << static_cast<double>(inputs[0].size() * total) /
-                     totalTime.count() << " bytes/s"
-              << " or " << total / totalTime.count() << " JSON docs per second."
-              << std::endl;
-  } catch (Exception const& ex) {
-    std::cerr << "An exception occurred while running bench: " << ex.what()
-              << std::endl;
-    ::exit(EXIT_FAILURE);
-  } catch (std::exception const& ex) {
-    std::cerr << "An exception occurred while running bench: " << ex.what()
-              << std::endl;
-    ::exit(EXIT_FAILURE);
-  } catch (...) {
-    std::cerr << "An unknown exception occurred while running bench"
-              << std::endl;
-    ::exit(EXIT_FAILURE);
   }
+  return lookups;
+}
+
+static Input makeInput(std::string const& name, std::string const& json,
+                       size_t copies, Options const* options) {
+  Input input;
+  input.name = name;
+  for (size_t i = 0; i < copies; ++i) {
+    // every copy lives in its own memory area
+    input.json.emplace_back(json.begin(), json.end());
+    std::shared_ptr<Builder> builder = Parser::fromJson(json, options);
+    input.msgpack.emplace_back(
+        MsgPackDumper::toString(builder->slice(), options));
+    input.cbor.emplace_back(CborDumper::toString(builder->slice(), options));
+    input.vpack.emplace_back(std::move(builder));
+  }
+  input.lookups = buildLookups(input.slice(0));
+  return input;
+}
+
+// deterministic pseudo random numbers for the synthetic inputs
+class Random {
+ public:
+  explicit Random(uint64_t seed) : _state(seed) {}
+
+  uint64_t next() {
+    _state ^= _state << 13;
+    _state ^= _state >> 7;
+    _state ^= _state << 17;
+    return _state;
+  }
+
+  uint64_t next(uint64_t limit) { return next() % limit; }
+
+  std::string string(size_t length) {
+    static char const chars[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ";
+    std::string s;
+    s.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+      s.push_back(chars[next(sizeof(chars) - 1)]);
+    }
+    return s;
+  }
+
+ private:
+  uint64_t _state;
+};
+
+static std::string syntheticRecords(Random& random) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 10000; ++i) {
+    b.openObject();
+    b.add("_key", Value(std::to_string(1000000 + i)));
+    b.add("id", Value(static_cast<int64_t>(random.next(1000000000))));
+    b.add("name", Value(random.string(8 + random.next(24))));
+    b.add("score", Value(static_cast<double>(random.next(100000)) / 100.0));
+    b.add("active", Value(random.next(2) == 0));
+    b.add("tags", Value(ValueType::Array));
+    for (size_t j = 0; j < 3; ++j) {
+      b.add(Value(random.string(6)));
+    }
+    b.close();
+    b.add("address", Value(ValueType::Object));
+    b.add("city", Value(random.string(10)));
+    b.add("zip", Value(static_cast<uint64_t>(random.next(100000))));
+    b.close();
+    b.close();
+  }
+  b.close();
+  return b.slice().toJson();
+}
+
+static std::string syntheticWideObject(Random& random) {
+  Builder b;
+  b.openObject();
+  for (size_t i = 0; i < 10000; ++i) {
+    b.add("attribute" + std::to_string(i),
+          Value(static_cast<uint64_t>(random.next(1000000))));
+  }
+  b.close();
+  return b.slice().toJson();
+}
+
+static std::string syntheticDeep(Random& random) {
+  Builder b;
+  size_t const depth = 60;
+  for (size_t i = 0; i < depth; ++i) {
+    if (i == 0) {
+      b.openObject();
+    } else if (i % 2 == 0) {
+      b.add(Value(ValueType::Object));
+    } else {
+      b.add("level" + std::to_string(i), Value(ValueType::Array));
+    }
+    if (i % 2 == 0) {
+      b.add("name", Value(random.string(12)));
+      b.add("value", Value(static_cast<uint64_t>(random.next(1000))));
+    } else {
+      b.add(Value(random.string(12)));
+      b.add(Value(static_cast<uint64_t>(random.next(1000))));
+    }
+  }
+  for (size_t i = 0; i < depth; ++i) {
+    b.close();
+  }
+  return b.slice().toJson();
+}
+
+static std::string syntheticIntegers(Random& random) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 100000; ++i) {
+    // mix of small and large magnitudes
+    uint64_t bits = 1 + random.next(48);
+    int64_t value = static_cast<int64_t>(random.next(uint64_t(1) << bits));
+    b.add(Value(random.next(4) == 0 ? -value : value));
+  }
+  b.close();
+  return b.slice().toJson();
+}
 
-  for (auto& it : outputs) {
-    delete it;
+static std::string syntheticDoubles(Random& random) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 100000; ++i) {
+    b.add(Value(static_cast<double>(random.next()) / 1.0e12));
+  }
+  b.close();
+  return b.slice().toJson();
+}
+
+static std::string syntheticStrings(Random& random) {
+  Builder b;
+  b.openArray();
+  for (size_t i = 0; i < 20000; ++i) {
+    std::string s = random.string(random.next(200));
+    if (random.next(8) == 0) {
+      // some strings need escaping or contain multi-byte characters
+      s.append("\"\\\n\xc3\xa4\xe2\x82\xac");
+    }
+    b.add(Value(s));
   }
+  b.close();
+  return b.slice().toJson();
 }
 
-static void runDefaultBench() {
-  auto runComparison = [](std::string const& filename) {
-    std::string data = std::move(readFile(filename));
+struct Synthetic {
+  char const* name;
+  std::string (*generate)(Random&);
+};
+
+static Synthetic const syntheticInputs[] = {
+    {"synthetic-records", &syntheticRecords},
+    {"synthetic-wide-object", &syntheticWideObject},
+    {"synthetic-deep", &syntheticDeep},
+    {"synthetic-integers", &syntheticIntegers},
+    {"synthetic-doubles", &syntheticDoubles},
+    {"synthetic-strings", &syntheticStrings}};
+
+static uint64_t iterate(Slice const& slice) {
+  uint64_t count = 1;
+  if (slice.isArray()) {
+    ArrayIterator it(slice);
+    while (it.valid()) {
+      count += iterate(it.value());
+      it.next();
+    }
+  } else if (slice.isObject()) {
+    ObjectIterator it(slice, true);
+    while (it.valid()) {
+      count += iterate(it.value());
+      it.next();
+    }
+  }
+  return count;
+}
 
-    std::cout << std::endl;
-    std::cout << "# " << filename << " ";
-    for (size_t i = 0; i < 30 - filename.size(); ++i) {
-      std::cout << "#";
+static uint64_t sumByteSizes(Slice const& slice) {
+  uint64_t total = slice.byteSize();
+  if (slice.isArray()) {
+    ArrayIterator it(slice);
+    while (it.valid()) {
+      total += sumByteSizes(it.value());
+      it.next();
     }
-    std::cout << std::endl;
+  } else if (slice.isObject()) {
+    ObjectIterator it(slice, true);
+    while (it.valid()) {
+      total += sumByteSizes(it.value());
+      it.next();
+    }
+  }
+  return total;
+}
+
+// builds the value again, member by member
+static void rebuild(Builder& builder, Slice const& slice) {
+  if (slice.isArray()) {
+    builder.add(Value(ValueType::Array));
+    ArrayIterator it(slice);
+    while (it.valid()) {
+      rebuild(builder, it.value());
+      it.next();
+    }
+    builder.close();
+  } else if (slice.isObject()) {
+    builder.add(Value(ValueType::Object));
+    ObjectIterator it(slice, true);
+    while (it.valid()) {
+      builder.add(it.key(true));
+      rebuild(builder, it.value());
+      it.next();
+    }
+    builder.close();
+  } else {
+    builder.add(slice);
+  }
+}
+
+static bool always(Input const&) { return true; }
+static bool isArray(Input const& input) { return input.slice(0).isArray(); }
+static bool isObject(Input const& input) { return input.slice(0).isObject(); }
+static bool hasLookups(Input const& input) { return !input.lookups.empty(); }
+
+static ValueLength jsonSize(Input const& input) { return input.json[0].size(); }
+static ValueLength vpackSize(Input const& input) {
+  return input.vpack[0]->size();
+}
+static ValueLength msgpackSize(Input const& input) {
+  return input.msgpack[0].size();
+}
+static ValueLength cborSize(Input const& input) { return input.cbor[0].size(); }
+static ValueLength noSize(Input const&) { return 0; }
+
+static uint64_t runParse(Input const& input, size_t copy, Scratch& scratch) {
+  scratch.parser.clear();
+  return scratch.parser.parse(input.json[copy]);
+}
+
+#ifdef VELOCYPACK_BENCH_RAPIDJSON
+static uint64_t runParseRapidJson(Input const& input, size_t copy, Scratch&) {
+  rapidjson::Document d;
+  d.Parse(input.json[copy].c_str());
+  return d.HasParseError() ? 0 : 1;
+}
+#endif
+
+static uint64_t runDump(Input const& input, size_t copy, Scratch& scratch) {
+  scratch.output.clear();
+  StringSink sink(&scratch.output);
+  Dumper::dump(input.slice(copy), &sink, scratch.options);
+  return scratch.output.size();
+}
+
+static uint64_t runGet(Input const& input, size_t copy, Scratch&) {
+  uint8_t const* start = input.slice(copy).start();
+  uint64_t found = 0;
+  for (auto const& lookup : input.lookups) {
+    found += Slice(start + lookup.offset).get(lookup.path).isNone() ? 0 : 1;
+  }
+  return found;
+}
+
+static uint64_t runIterate(Input const& input, size_t copy, Scratch&) {
+  return iterate(input.slice(copy));
+}
 
-    std::cout << "vpack:        ";
-    run(data, 10, 1, true, false);
+static uint64_t runByteSize(Input const& input, size_t copy, Scratch&) {
+  return sumByteSizes(input.slice(copy));
+}
+
+static uint64_t runValidate(Input const& input, size_t copy,
+                            Scratch& scratch) {
+  Validator validator(scratch.options);
+  return validator.validate(input.vpack[copy]->data(), input.vpack[copy]->size());
+}
+
+static uint64_t runValidateStrict(Input const& input, size_t copy,
+                                  Scratch& scratch) {
+  Validator validator(scratch.strictOptions);
+  return validator.validate(input.vpack[copy]->data(), input.vpack[copy]->size());
+}
+
+static uint64_t runHash(Input const& input, size_t copy, Scratch&) {
+  return input.slice(copy).normalizedHash();
+}
+
+static uint64_t runCollectionFilter(Input const& input, size_t copy,
+                                    Scratch&) {
+  Builder b = Collection::filter(
+      input.slice(copy),
+      [](Slice const&, ValueLength index) { return (index & 1) == 0; });
+  return b.size();
+}
+
+static uint64_t runCollectionMerge(Input const& input, size_t copy, Scratch&) {
+  Builder b =
+      Collection::merge(input.slice(copy), input.slice(copy), true, false);
+  return b.size();
+}
+
+static uint64_t runBuild(Input const& input, size_t copy, Scratch& scratch) {
+  scratch.builder.clear();
+  rebuild(scratch.builder, input.slice(copy));
+  return scratch.builder.size();
+}
+
+static uint64_t runMsgPackParse(Input const& input, size_t copy,
+                                Scratch& scratch) {
+  scratch.builder.clear();
+  MsgPackParser parser(scratch.builder, scratch.options);
+  return parser.parse(input.msgpack[copy]);
+}
+
+static uint64_t runMsgPackDump(Input const& input, size_t copy,
+                               Scratch& scratch) {
+  scratch.output.clear();
+  StringSink sink(&scratch.output);
+  MsgPackDumper dumper(&sink, scratch.options);
+  dumper.dump(input.slice(copy));
+  return scratch.output.size();
+}
+
+static uint64_t runCborParse(Input const& input, size_t copy,
+                             Scratch& scratch) {
+  scratch.builder.clear();
+  CborParser parser(scratch.builder, scratch.options);
+  return parser.parse(input.cbor[copy]);
+}
+
+static uint64_t runCborDump(Input const& input, size_t copy,
+                            Scratch& scratch) {
+  scratch.output.clear();
+  StringSink sink(&scratch.output);
+  CborDumper dumper(&sink, scratch.options);
+  dumper.dump(input.slice(copy));
+  return scratch.output.size();
+}
+
+struct Workload {
+  char const* name;
+  char const* description;
+  bool (*applies)(Input const&);
+  // number of bytes one run processes, used for the throughput
+  ValueLength (*bytes)(Input const&);
+  uint64_t (*run)(Input const&, size_t, Scratch&);
+};
+
+static Workload const workloads[] = {
+    {"parse", "JSON to VPack with Parser", &always, &jsonSize, &runParse},
+#ifdef VELOCYPACK_BENCH_RAPIDJSON
+    {"parse-rapidjson", "JSON to rapidjson::Document", &always, &jsonSize,
+     &runParseRapidJson},
+#endif
+    {"dump", "VPack to JSON with Dumper", &always, &vpackSize, &runDump},
+    {"get", "Slice::get() for attribute paths of the input", &hasLookups,
+     &noSize, &runGet},
+    {"iterate", "recursive ArrayIterator/ObjectIterator walk", &always,
+     &vpackSize, &runIterate},
+    {"byte-size", "Slice::byteSize() of all values", &always, &vpackSize,
+     &runByteSize},
+    {"validate", "Validator with default options", &always, &vpackSize,
+     &runValidate},
+    {"validate-strict",
+     "Validator checking UTF-8, key order and key uniqueness", &always,
+     &vpackSize, &runValidateStrict},
+    {"hash", "Slice::normalizedHash()", &always, &vpackSize, &runHash},
+    {"collection-filter", "Collection::filter() of every other member",
+     &isArray, &vpackSize, &runCollectionFilter},
+    {"collection-merge", "Collection::merge() of the input with itself",
+     &isObject, &vpackSize, &runCollectionMerge},
+    {"build", "Builder construction of the value, member by member", &always,
+     &vpackSize, &runBuild},
+    {"msgpack-parse", "MsgPack to VPack", &always, &msgpackSize,
+     &runMsgPackParse},
+    {"msgpack-dump", "VPack to MsgPack", &always, &vpackSize, &runMsgPackDump},
+    {"cbor-parse", "CBOR to VPack", &always, &cborSize, &runCborParse},
+    {"cbor-dump", "VPack to CBOR", &always, &vpackSize, &runCborDump}};
+
+struct Result {
+  std::string input;
+  std::string workload;
+  ValueLength bytes;
+  uint64_t iterations;
+  double seconds;
+  // nanoseconds per run
+  double mean;
+  double min;
+  double p50;
+  double p90;
+  double p99;
+  double max;
+
+  double runsPerSecond() const { return iterations / seconds; }
+  double bytesPerSecond() const { return bytes * runsPerSecond(); }
+};
 
-    std::cout << "rapidjson:    ";
-    run(data, 10, 1, false, false);
+struct Settings {
+  double runtime = 1.0;
+  double warmup = 0.2;
+  size_t copies = 1;
+};
+
+// keeps the results of the runs alive, so they are not optimized away
+static volatile uint64_t blackhole = 0;
+
+static double percentile(std::vector<double> const& sorted, double p) {
+  size_t rank = static_cast<size_t>(p * sorted.size() / 100.0);
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+static Result measure(Input const& input, Workload const& workload,
+                      Settings const& settings, Scratch& scratch) {
+  typedef std::chrono::steady_clock clock;
+  auto elapsed = [](clock::time_point start) {
+    return std::chrono::duration<double>(clock::now() - start).count();
+  };
+
+  uint64_t sum = 0;
+  size_t copy = 0;
+  auto next = [&copy, &settings]() {
+    size_t current = copy;
+    if (++copy == settings.copies) {
+      copy = 0;
+    }
+    return current;
   };
 
-  runComparison("small.json");
-  runComparison("sample.json");
-  runComparison("sampleNoWhite.json");
-  runComparison("commits.json");
+  // warmup, also used to choose how many runs make up one sample
+  uint64_t warmupRuns = 0;
+  auto start = clock::now();
+  do {
+    sum += workload.run(input, next(), scratch);
+    ++warmupRuns;
+  } while (elapsed(start) < settings.warmup);
+  double perRun = elapsed(start) / warmupRuns;
+
+  // aim for about 1000 samples, each taking at least 10 microseconds
+  double sampleTime = std::max(settings.runtime / 1000.0, 10.0e-6);
+  uint64_t batch =
+      std::max<uint64_t>(1, static_cast<uint64_t>(sampleTime / perRun));
+
+  std::vector<double> samples;
+  uint64_t iterations = 0;
+  double total = 0.0;
+  do {
+    auto batchStart = clock::now();
+    for (uint64_t i = 0; i < batch; ++i) {
+      sum += workload.run(input, next(), scratch);
+    }
+    double batchTime = elapsed(batchStart);
+    samples.push_back(batchTime * 1.0e9 / batch);
+    iterations += batch;
+    total += batchTime;
+  } while (total < settings.runtime || samples.size() < 5);
+  blackhole = blackhole + sum;
+
+  std::sort(samples.begin(), samples.end());
+
+  Result result;
+  result.input = input.name;
+  result.workload = workload.name;
+  result.bytes = workload.bytes(input);
+  result.iterations = iterations;
+  result.seconds = total;
+  result.mean = total * 1.0e9 / iterations;
+  result.min = samples.front();
+  result.p50 = percentile(samples, 50.0);
+  result.p90 = percentile(samples, 90.0);
+  result.p99 = percentile(samples, 99.0);
+  result.max = samples.back();
+  return result;
 }
 
-int main(int argc, char* argv[]) {
-  if (argc == 1) {
-    runDefaultBench();
-    return EXIT_FAILURE;
+static void writeText(std::ostream& out, std::vector<Result> const& results) {
+  out << std::left << std::setw(24) << "input" << std::setw(18) << "workload"
+      << std::right << std::setw(10) << "bytes" << std::setw(12) << "runs"
+      << std::setw(12) << "mean us" << std::setw(12) << "p50 us"
+      << std::setw(12) << "p90 us" << std::setw(12) << "p99 us"
+      << std::setw(12) << "MB/s" << std::endl;
+  out << std::fixed;
+  for (auto const& r : results) {
+    out << std::left << std::setw(24) << r.input << std::setw(18) << r.workload
+        << std::right << std::setw(10) << r.bytes << std::setw(12)
+        << r.iterations << std::setprecision(3) << std::setw(12)
+        << r.mean / 1000.0 << std::setw(12) << r.p50 / 1000.0 << std::setw(12)
+        << r.p90 / 1000.0 << std::setw(12) << r.p99 / 1000.0
+        << std::setprecision(1) << std::setw(12);
+    if (r.bytes > 0) {
+      out << r.bytesPerSecond() / 1.0e6;
+    } else {
+      out << "-";
+    }
+    out << std::endl;
+  }
+}
+
+static void writeCsv(std::ostream& out, std::vector<Result> const& results) {
+  out << "input,workload,bytes,runs,seconds,mean_ns,min_ns,p50_ns,p90_ns,"
+         "p99_ns,max_ns,runs_per_second,bytes_per_second"
+      << std::endl;
+  out << std::setprecision(10);
+  for (auto const& r : results) {
+    out << '"' << r.input << "\",\"" << r.workload << "\"," << r.bytes << ','
+        << r.iterations << ',' << r.seconds << ',' << r.mean << ',' << r.min
+        << ',' << r.p50 << ',' << r.p90 << ',' << r.p99 << ',' << r.max << ','
+        << r.runsPerSecond() << ',' << r.bytesPerSecond() << std::endl;
+  }
+}
+
+static void writeJson(std::ostream& out, std::vector<Result> const& results,
+                      Settings const& settings) {
+  Builder b;
+  b.openObject();
+  b.add("version", Value(Version::BuildVersion.toString()));
+  b.add("settings", Value(ValueType::Object));
+  b.add("runtime", Value(settings.runtime));
+  b.add("warmup", Value(settings.warmup));
+  b.add("copies", Value(settings.copies));
+  b.close();
+  b.add("results", Value(ValueType::Array));
+  for (auto const& r : results) {
+    b.openObject();
+    b.add("input", Value(r.input));
+    b.add("workload", Value(r.workload));
+    b.add("bytes", Value(r.bytes));
+    b.add("runs", Value(r.iterations));
+    b.add("seconds", Value(r.seconds));
+    b.add("meanNs", Value(r.mean));
+    b.add("minNs", Value(r.min));
+    b.add("p50Ns", Value(r.p50));
+    b.add("p90Ns", Value(r.p90));
+    b.add("p99Ns", Value(r.p99));
+    b.add("maxNs", Value(r.max));
+    b.add("runsPerSecond", Value(r.runsPerSecond()));
+    b.add("bytesPerSecond", Value(r.bytesPerSecond()));
+    b.close();
+  }
+  b.close();
+  b.close();
+
+  Options options;
+  options.prettyPrint = true;
+  out << b.slice().toJson(&options) << std::endl;
+}
+
+static std::vector<std::string> splitList(std::string const& value) {
+  std::vector<std::string> result;
+  std::stringstream ss(value);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (!item.empty()) {
+      result.emplace_back(item);
+    }
   }
+  return result;
+}
 
-  if (argc != 5) {
+int main(int argc, char* argv[]) {
+  Settings settings;
+  std::vector<std::string> files;
+  std::vector<std::string> selected;
+  std::string inputFilter;
+  std::string format = "text";
+  std::string outputFile;
+  bool synthetic = true;
+  bool list = false;
+
+  try {
+    for (int i = 1; i < argc; ++i) {
+      std::string const arg(argv[i]);
+      bool const hasValue = (i + 1 < argc);
+      if (arg == "--help" || arg == "-h") {
+        usage(argv);
+        return EXIT_SUCCESS;
+      } else if (arg == "--runtime" && hasValue) {
+        settings.runtime = std::stod(argv[++i]);
+      } else if (arg == "--warmup" && hasValue) {
+        settings.warmup = std::stod(argv[++i]);
+      } else if (arg == "--copies" && hasValue) {
+        settings.copies = std::max<size_t>(1, std::stoul(argv[++i]));
+      } else if (arg == "--workload" && hasValue) {
+        for (auto const& it : splitList(argv[++i])) {
+          selected.emplace_back(it);
+        }
+      } else if (arg == "--input" && hasValue) {
+        inputFilter = argv[++i];
+      } else if (arg == "--no-synthetic") {
+        synthetic = false;
+      } else if (arg == "--format" && hasValue) {
+        format = argv[++i];
+      } else if (arg == "--output" && hasValue) {
+        outputFile = argv[++i];
+      } else if (arg == "--list") {
+        list = true;
+      } else if (arg.compare(0, 2, "--") == 0) {
+        usage(argv);
+        return EXIT_FAILURE;
+      } else {
+        files.emplace_back(arg);
+      }
+    }
+  } catch (std::exception const&) {
     usage(argv);
     return EXIT_FAILURE;
   }
 
-  bool useVPack;
-  if (::strcmp(argv[4], "vpack") == 0) {
-    useVPack = true;
-  } else if (::strcmp(argv[4], "rapidjson") == 0) {
-    useVPack = false;
-  } else {
+  if (format != "text" && format != "json" && format != "csv") {
     usage(argv);
     return EXIT_FAILURE;
   }
 
-  size_t copies = std::stoul(argv[3]);
-  int runTime = std::stoi(argv[2]);
+  std::vector<Workload const*> toRun;
+  for (auto const& w : workloads) {
+    if (selected.empty() ||
+        std::find(selected.begin(), selected.end(), w.name) != selected.end()) {
+      toRun.push_back(&w);
+    }
+  }
+  for (auto const& name : selected) {
+    bool found = false;
+    for (auto const& w : workloads) {
+      found |= (name == w.name);
+    }
+    if (!found) {
+      std::cerr << "Unknown workload '" << name << "'" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (files.empty()) {
+    files.assign(std::begin(corpusFiles), std::end(corpusFiles));
+  }
+  auto matches = [&inputFilter](std::string const& name) {
+    return inputFilter.empty() || name.find(inputFilter) != std::string::npos;
+  };
 
-  // read input file
-  std::string s = std::move(readFile(argv[1]));
+  if (list) {
+    std::cout << "Workloads:" << std::endl;
+    for (auto const& w : workloads) {
+      std::cout << "  " << std::left << std::setw(20) << w.name
+                << w.description << std::endl;
+    }
+    std::cout << "Inputs:" << std::endl;
+    for (auto const& f : files) {
+      std::cout << "  " << f << std::endl;
+    }
+    if (synthetic) {
+      for (auto const& s : syntheticInputs) {
+        std::cout << "  " << s.name << std::endl;
+      }
+    }
+    return EXIT_SUCCESS;
+  }
 
-  run(s, runTime, copies, useVPack, true);
+  Options options;
+  Options strictOptions;
+  strictOptions.validateUtf8Strings = true;
+  strictOptions.validatorCheckKeyOrder = true;
+  strictOptions.checkAttributeUniqueness = true;
+
+  std::vector<Result> results;
+  try {
+    std::vector<Input> inputs;
+    for (auto const& f : files) {
+      if (matches(f)) {
+        inputs.emplace_back(
+            makeInput(f, readFile(f), settings.copies, &options));
+      }
+    }
+    if (synthetic) {
+      Random random(0x5eed);
+      for (auto const& s : syntheticInputs) {
+        if (matches(s.name)) {
+          inputs.emplace_back(makeInput(s.name, s.generate(random),
+                                        settings.copies, &options));
+        }
+      }
+    }
+
+    Scratch scratch(&options, &strictOptions);
+    for (auto const& input : inputs) {
+      for (auto const* w : toRun) {
+        if (!w->applies(input)) {
+          continue;
+        }
+        results.emplace_back(measure(input, *w, settings, scratch));
+      }
+    }
+  } catch (std::exception const& ex) {
+    std::cerr << "An exception occurred while running bench: " << ex.what()
+              << std::endl;
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "An unknown exception occurred while running bench"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream file;
+  if (!outputFile.empty()) {
+    file.open(outputFile.c_str(), std::ofstream::out | std::ofstream::trunc);
+    if (!file.is_open()) {
+      std::cerr << "Cannot open output file '" << outputFile << "'"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& out = outputFile.empty() ? std::cout : file;
+
+  if (format == "json") {
+    writeJson(out, results, settings);
+  } else if (format == "csv") {
+    writeCsv(out, results);
+  } else {
+    writeText(out, results);
+  }
 
   return EXIT_SUCCESS;
 }
@@ -64,6 +64,13 @@ static void usage(char* argv[]) {
   std::cout << " --no-compress   don't compress Object keys" << std::endl;
   std::cout << " --hex           print a hex dump of the generated VPack value"
             << std::endl;
+  std::cout << " --framed        store each JSON value of INFILE as a document of"
+            << std::endl;
+  std::cout << "                 a framed VPack file" << std::endl;
+  std::cout << " --checksums     store checksums of documents in framed files"
+            << std::endl;
+  std::cout << " --no-checksums  don't store checksums in framed files"
+            << std::endl;
 }
 
 static inline bool isOption(char const* arg, char const* expected) {
@@ -103,6 +110,8 @@ int main(int argc, char* argv[]) {
   bool compact = true;
   bool compress = false;
   bool hexDump = false;
+  bool framed = false;
+  bool checksums = true;
 
   int i = 1;
   while (i < argc) {
@@ -120,6 +129,12 @@ int main(int argc, char* argv[]) {
       compress = false;
     } else if (allowFlags && isOption(p, "--hex")) {
       hexDump = true;
+    } else if (allowFlags && isOption(p, "--framed")) {
+      framed = true;
+    } else if (allowFlags && isOption(p, "--checksums")) {
+      checksums = true;
+    } else if (allowFlags && isOption(p, "--no-checksums")) {
+      checksums = false;
     } else if (allowFlags && isOption(p, "--")) {
       allowFlags = false;
     } else if (infileName == nullptr) {
@@ -231,7 +246,7 @@ int main(int argc, char* argv[]) {
 
   Parser parser(&options);
   try {
-    parser.parse(s);
+    parser.parse(s, framed);
   } catch (Exception const& ex) {
     std::cerr << "An exception occurred while parsing infile '" << infile
               << "': " << ex.what() << std::endl;
@@ -243,6 +258,37 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
+  std::shared_ptr<Builder> builder = parser.steal();
+
+  if (framed) {
+    // every top-level value of the input becomes a document
+    ValueLength documents = 0;
+    try {
+      FramedFileWriter writer(outfileName, checksums);
+      uint8_t const* p = builder->start();
+      uint8_t const* end = p + builder->size();
+      while (p < end) {
+        Slice const document(p);
+        writer.append(document);
+        p += document.byteSize();
+      }
+      writer.finish();
+      documents = writer.size();
+    } catch (Exception const& ex) {
+      std::cerr << "Cannot write outfile '" << outfileName
+                << "': " << ex.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+
+    if (!toStdOut) {
+      std::cout << "Successfully converted JSON infile '" << infile << "'"
+                << std::endl;
+      std::cout << "JSON Infile size:    " << s.size() << std::endl;
+      std::cout << "Documents written:   " << documents << std::endl;
+    }
+    return EXIT_SUCCESS;
+  }
+
   std::ofstream ofs(outfileName, std::ofstream::out);
 
   if (!ofs.is_open()) {
@@ -256,7 +302,6 @@ int main(int argc, char* argv[]) {
   }
 
   // write into stream
-  std::shared_ptr<Builder> builder = parser.steal();
   if (hexDump) {
     ofs << HexDump(builder->slice()) << std::endl;
   } else {
@@ -0,0 +1,492 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "velocypack/vpack.h"
+#include "velocypack/velocypack-exception-macros.h"
+
+using namespace arangodb::velocypack;
+
+static void usage(char* argv[]) {
+  std::cout << "Usage: " << argv[0] << " [OPTIONS]" << std::endl;
+  std::cout << "This program generates a pseudo-random document of a"
+            << std::endl;
+  std::cout << "configurable shape and saves it as JSON and/or VPack. The"
+            << std::endl;
+  std::cout << "same options and seed always generate the same document."
+            << std::endl;
+  std::cout << "If neither --json nor --vpack is given, the JSON is printed"
+            << std::endl;
+  std::cout << "to stdout." << std::endl;
+  std::cout << "RANGE values are given as MIN:MAX, lengths are drawn uniformly"
+            << std::endl;
+  std::cout << "from it, or skewed towards MIN with MIN:MAX:exp. WEIGHTS are"
+            << std::endl;
+  std::cout << "colon-separated relative weights." << std::endl;
+  std::cout << "Available options are:" << std::endl;
+  std::cout << " --json FILE                  write the document as JSON to FILE"
+            << std::endl;
+  std::cout << " --vpack FILE                 write the document as VPack to FILE"
+            << std::endl;
+  std::cout << " --compact                    store Array and Object types "
+               "without index tables"
+            << std::endl;
+  std::cout << " --seed N                     seed of the generator (default: 1)"
+            << std::endl;
+  std::cout << " --documents N                generate an Array of N documents "
+               "(default: 1)"
+            << std::endl;
+  std::cout << " --root object|array          type of each document (default: "
+               "object)"
+            << std::endl;
+  std::cout << " --depth N                    maximum nesting depth (default: 3)"
+            << std::endl;
+  std::cout << " --width RANGE                attributes per Object (default: "
+               "4:12)"
+            << std::endl;
+  std::cout << " --array-length RANGE         members per Array (default: 0:8)"
+            << std::endl;
+  std::cout << " --key-length RANGE           length of Object keys (default: "
+               "3:12)"
+            << std::endl;
+  std::cout << " --key-pool N                 draw keys from N distinct names, 0 "
+               "for"
+            << std::endl;
+  std::cout << "                              random keys (default: 64)"
+            << std::endl;
+  std::cout << " --string-length RANGE        length of String values "
+               "(default: 0:32)"
+            << std::endl;
+  std::cout << " --value-mix WEIGHTS          weights of "
+               "object:array:string:number:bool:null"
+            << std::endl;
+  std::cout << "                              members (default: 1:1:4:3:1:1)"
+            << std::endl;
+  std::cout << " --number-mix WEIGHTS         weights of small int:int:double "
+               "numbers"
+            << std::endl;
+  std::cout << "                              (default: 1:1:1)" << std::endl;
+  std::cout << " --homogeneity P              probability that all members of an"
+            << std::endl;
+  std::cout << "                              Array have the same type "
+               "(default: 0.5)"
+            << std::endl;
+  std::cout << " --unicode P                  fraction of multi-byte characters "
+               "in"
+            << std::endl;
+  std::cout << "                              strings and keys (default: 0)"
+            << std::endl;
+  std::cout << " --escapes P                  fraction of characters needing "
+               "JSON escaping"
+            << std::endl;
+  std::cout << "                              in strings and keys (default: 0)"
+            << std::endl;
+}
+
+static inline bool isOption(char const* arg, char const* expected) {
+  return (strcmp(arg, expected) == 0);
+}
+
+// a length range with its distribution
+struct Range {
+  uint64_t min;
+  uint64_t max;
+  bool exponential;
+};
+
+enum ValueKind { KindObject, KindArray, KindString, KindNumber, KindBool, KindNull };
+
+struct Shape {
+  uint64_t documents = 1;
+  bool rootIsArray = false;
+  uint64_t depth = 3;
+  Range width{4, 12, false};
+  Range arrayLength{0, 8, false};
+  Range keyLength{3, 12, false};
+  uint64_t keyPool = 64;
+  Range stringLength{0, 32, false};
+  std::vector<double> valueMix{1, 1, 4, 3, 1, 1};
+  std::vector<double> numberMix{1, 1, 1};
+  double homogeneity = 0.5;
+  double unicode = 0.0;
+  double escapes = 0.0;
+};
+
+static Range parseRange(std::string const& value) {
+  Range range{0, 0, false};
+  size_t const sep = value.find(':');
+  if (sep == std::string::npos) {
+    range.min = range.max = std::stoull(value);
+    return range;
+  }
+  range.min = std::stoull(value.substr(0, sep));
+  std::string rest = value.substr(sep + 1);
+  size_t const sep2 = rest.find(':');
+  if (sep2 != std::string::npos) {
+    if (rest.substr(sep2 + 1) != "exp") {
+      throw std::invalid_argument("invalid distribution");
+    }
+    range.exponential = true;
+    rest = rest.substr(0, sep2);
+  }
+  range.max = std::stoull(rest);
+  if (range.max < range.min) {
+    throw std::invalid_argument("invalid range");
+  }
+  return range;
+}
+
+static std::vector<double> parseWeights(std::string const& value,
+                                        size_t expected) {
+  std::vector<double> weights;
+  size_t start = 0;
+  while (true) {
+    size_t const sep = value.find(':', start);
+    weights.push_back(std::stod(value.substr(start, sep - start)));
+    if (weights.back() < 0.0) {
+      throw std::invalid_argument("negative weight");
+    }
+    if (sep == std::string::npos) {
+      break;
+    }
+    start = sep + 1;
+  }
+  if (weights.size() != expected) {
+    throw std::invalid_argument("wrong number of weights");
+  }
+  return weights;
+}
+
+// generates documents from a seed. only the raw output of the mt19937_64
+// engine is used, which is the same on all platforms, unlike the output of
+// the standard distributions
+class Generator {
+ public:
+  Generator(Shape const& shape, uint64_t seed)
+      : _shape(shape), _random(seed) {
+    for (uint64_t i = 0; i < _shape.keyPool; ++i) {
+      _keys.emplace_back(string(_shape.keyLength));
+    }
+  }
+
+  void document(Builder& builder) {
+    if (_shape.rootIsArray) {
+      array(builder, _shape.depth);
+    } else {
+      object(builder, _shape.depth);
+    }
+  }
+
+ private:
+  uint64_t next(uint64_t limit) { return limit == 0 ? 0 : _random() % limit; }
+
+  double probability() {
+    return static_cast<double>(_random() >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  uint64_t length(Range const& range) {
+    uint64_t const span = range.max - range.min;
+    if (!range.exponential) {
+      return range.min + next(span + 1);
+    }
+    // each additional character has a probability of 3/4
+    uint64_t n = 0;
+    while (n < span && next(4) != 0) {
+      ++n;
+    }
+    return range.min + n;
+  }
+
+  size_t pick(std::vector<double> const& weights) {
+    double total = 0.0;
+    for (double w : weights) {
+      total += w;
+    }
+    double value = probability() * total;
+    for (size_t i = 0; i < weights.size(); ++i) {
+      if (value < weights[i]) {
+        return i;
+      }
+      value -= weights[i];
+    }
+    return weights.size() - 1;
+  }
+
+  std::string string(Range const& range) {
+    static char const chars[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-";
+    static char const* const multiByte[] = {"\xc3\xa4", "\xc3\x9f",
+                                            "\xce\xa9", "\xe2\x82\xac",
+                                            "\xe6\x97\xa5", "\xf0\x9f\x98\x80"};
+    static char const escaped[] = "\"\\\n\t\r\b\f\x01\x1f";
+
+    uint64_t const n = length(range);
+    std::string s;
+    s.reserve(n);
+    for (uint64_t i = 0; i < n; ++i) {
+      double const p = probability();
+      if (p < _shape.unicode) {
+        s.append(multiByte[next(sizeof(multiByte) / sizeof(multiByte[0]))]);
+      } else if (p < _shape.unicode + _shape.escapes) {
+        s.push_back(escaped[next(sizeof(escaped) - 1)]);
+      } else {
+        s.push_back(chars[next(sizeof(chars) - 1)]);
+      }
+    }
+    return s;
+  }
+
+  void value(Builder& builder, ValueKind kind, uint64_t depth) {
+    switch (kind) {
+      case KindObject:
+        object(builder, depth);
+        break;
+      case KindArray:
+        array(builder, depth);
+        break;
+      case KindString:
+        builder.add(Value(string(_shape.stringLength)));
+        break;
+      case KindNumber:
+        number(builder);
+        break;
+      case KindBool:
+        builder.add(Value(next(2) == 0));
+        break;
+      case KindNull:
+        builder.add(Value(ValueType::Null));
+        break;
+    }
+  }
+
+  void number(Builder& builder) {
+    switch (pick(_shape.numberMix)) {
+      case 0:
+        builder.add(Value(static_cast<int64_t>(next(16)) - 6));
+        break;
+      case 1: {
+        // mix of magnitudes, so all integer byte sizes occur
+        uint64_t const bits = 1 + next(62);
+        int64_t const value = static_cast<int64_t>(next(uint64_t(1) << bits));
+        builder.add(Value(next(4) == 0 ? -value : value));
+        break;
+      }
+      default:
+        builder.add(Value((probability() - 0.5) *
+                          static_cast<double>(uint64_t(1) << (1 + next(40)))));
+        break;
+    }
+  }
+
+  ValueKind kind(uint64_t depth) {
+    if (depth <= 1) {
+      // no more compound values
+      std::vector<double> weights(_shape.valueMix);
+      weights[KindObject] = 0.0;
+      weights[KindArray] = 0.0;
+      double total = 0.0;
+      for (double w : weights) {
+        total += w;
+      }
+      if (total == 0.0) {
+        return KindNull;
+      }
+      return static_cast<ValueKind>(pick(weights));
+    }
+    return static_cast<ValueKind>(pick(_shape.valueMix));
+  }
+
+  void object(Builder& builder, uint64_t depth) {
+    builder.add(Value(ValueType::Object));
+    uint64_t const n = length(_shape.width);
+    std::unordered_set<std::string> seen;
+    for (uint64_t i = 0; i < n; ++i) {
+      std::string key = _keys.empty() ? string(_shape.keyLength)
+                                      : _keys[next(_keys.size())];
+      while (!seen.insert(key).second) {
+        key.append("_" + std::to_string(i));
+      }
+      builder.add(Value(key));
+      value(builder, kind(depth), depth - 1);
+    }
+    builder.close();
+  }
+
+  void array(Builder& builder, uint64_t depth) {
+    builder.add(Value(ValueType::Array));
+    uint64_t const n = length(_shape.arrayLength);
+    bool const homogeneous = probability() < _shape.homogeneity;
+    ValueKind const first = kind(depth);
+    for (uint64_t i = 0; i < n; ++i) {
+      value(builder, (homogeneous || i == 0) ? first : kind(depth), depth - 1);
+    }
+    builder.close();
+  }
+
+  Shape const& _shape;
+  std::mt19937_64 _random;
+  std::vector<std::string> _keys;
+};
+
+static bool writeFile(std::string const& filename, char const* data,
+                      size_t size) {
+  std::ofstream ofs(filename, std::ofstream::out | std::ofstream::binary);
+  if (!ofs.is_open()) {
+    std::cerr << "Cannot write outfile '" << filename << "'" << std::endl;
+    return false;
+  }
+  ofs.write(data, size);
+  ofs.close();
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  VELOCYPACK_GLOBAL_EXCEPTION_TRY
+
+  Shape shape;
+  uint64_t seed = 1;
+  char const* jsonFile = nullptr;
+  char const* vpackFile = nullptr;
+  bool compact = false;
+
+  try {
+    int i = 1;
+    while (i < argc) {
+      char const* p = argv[i];
+      char const* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+      if (isOption(p, "--help")) {
+        usage(argv);
+        return EXIT_SUCCESS;
+      } else if (isOption(p, "--compact")) {
+        compact = true;
+        ++i;
+        continue;
+      } else if (value == nullptr) {
+        usage(argv);
+        return EXIT_FAILURE;
+      } else if (isOption(p, "--json")) {
+        jsonFile = value;
+      } else if (isOption(p, "--vpack")) {
+        vpackFile = value;
+      } else if (isOption(p, "--seed")) {
+        seed = std::stoull(value);
+      } else if (isOption(p, "--documents")) {
+        shape.documents = std::stoull(value);
+      } else if (isOption(p, "--root")) {
+        if (isOption(value, "array")) {
+          shape.rootIsArray = true;
+        } else if (isOption(value, "object")) {
+          shape.rootIsArray = false;
+        } else {
+          throw std::invalid_argument("invalid root type");
+        }
+      } else if (isOption(p, "--depth")) {
+        shape.depth = std::stoull(value);
+      } else if (isOption(p, "--width")) {
+        shape.width = parseRange(value);
+      } else if (isOption(p, "--array-length")) {
+        shape.arrayLength = parseRange(value);
+      } else if (isOption(p, "--key-length")) {
+        shape.keyLength = parseRange(value);
+      } else if (isOption(p, "--key-pool")) {
+        shape.keyPool = std::stoull(value);
+      } else if (isOption(p, "--string-length")) {
+        shape.stringLength = parseRange(value);
+      } else if (isOption(p, "--value-mix")) {
+        shape.valueMix = parseWeights(value, 6);
+      } else if (isOption(p, "--number-mix")) {
+        shape.numberMix = parseWeights(value, 3);
+      } else if (isOption(p, "--homogeneity")) {
+        shape.homogeneity = std::stod(value);
+      } else if (isOption(p, "--unicode")) {
+        shape.unicode = std::stod(value);
+      } else if (isOption(p, "--escapes")) {
+        shape.escapes = std::stod(value);
+      } else {
+        usage(argv);
+        return EXIT_FAILURE;
+      }
+      i += 2;
+    }
+  } catch (std::exception const& ex) {
+    std::cerr << "Invalid option value: " << ex.what() << std::endl;
+    usage(argv);
+    return EXIT_FAILURE;
+  }
+
+  if (shape.depth == 0 || shape.documents == 0 ||
+      shape.unicode + shape.escapes > 1.0) {
+    usage(argv);
+    return EXIT_FAILURE;
+  }
+
+  Options options;
+  options.buildUnindexedArrays = compact;
+  options.buildUnindexedObjects = compact;
+
+  Generator generator(shape, seed);
+  Builder builder(&options);
+  if (shape.documents == 1) {
+    generator.document(builder);
+  } else {
+    builder.openArray();
+    for (uint64_t i = 0; i < shape.documents; ++i) {
+      generator.document(builder);
+    }
+    builder.close();
+  }
+
+  std::string json = builder.slice().toJson(&options);
+
+  if (jsonFile == nullptr && vpackFile == nullptr) {
+    std::cout << json << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (jsonFile != nullptr &&
+      !writeFile(jsonFile, json.data(), json.size())) {
+    return EXIT_FAILURE;
+  }
+  if (vpackFile != nullptr &&
+      !writeFile(vpackFile, reinterpret_cast<char const*>(builder.start()),
+                 builder.size())) {
+    return EXIT_FAILURE;
+  }
+
+  std::cout << "Successfully generated document with seed " << seed
+            << std::endl;
+  std::cout << "JSON size:  " << json.size() << std::endl;
+  std::cout << "VPack size: " << builder.size() << std::endl;
+
+  VELOCYPACK_GLOBAL_EXCEPTION_CATCH
+}
@@ -0,0 +1,580 @@
+////////////////////////////////////////////////////////////////////////////////
+/// @brief Library to build up VPack documents.
+///
+/// DISCLAIMER
+///
+/// Copyright 2015 ArangoDB GmbH, Cologne, Germany
+///
+/// Licensed under the Apache License, Version 2.0 (the "License");
+/// you may not use this file except in compliance with the License.
+/// You may obtain a copy of the License at
+///
+///     http://www.apache.org/licenses/LICENSE-2.0
+///
+/// Unless required by applicable law or agreed to in writing, software
+/// distributed under the License is distributed on an "AS IS" BASIS,
+/// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+/// See the License for the specific language governing permissions and
+/// limitations under the License.
+///
+/// Copyright holder is ArangoDB GmbH, Cologne, Germany
+///
+/// @author Max Neunhoeffer
+/// @author Jan Steemann
+/// @author Copyright 2015, ArangoDB GmbH, Cologne, Germany
+////////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "velocypack/vpack.h"
+#include "velocypack/velocypack-exception-macros.h"
+
+using namespace arangodb::velocypack;
+
+static void usage(char* argv[]) {
+  std::cout << "Usage: " << argv[0] << " [OPTIONS] INFILE..." << std::endl;
+  std::cout << "This program reads the binary VPack values from the INFILEs"
+            << std::endl;
+  std::cout << "and reports how their bytes are spent: on headers, index"
+            << std::endl;
+  std::cout << "tables, padding, Object keys, strings, numbers and other"
+            << std::endl;
+  std::cout << "values, per type and per attribute path. It also reports the"
+            << std::endl;
+  std::cout << "sizes the values would have when built with other options."
+            << std::endl;
+  std::cout << "An INFILE may contain several VPack values one after another."
+            << std::endl;
+  std::cout << "Available options are:" << std::endl;
+  std::cout << " --paths N         number of attribute paths to show "
+               "(default: 25)"
+            << std::endl;
+  std::cout << " --no-layouts      don't compute the sizes with other options"
+            << std::endl;
+}
+
+static inline bool isOption(char const* arg, char const* expected) {
+  return (strcmp(arg, expected) == 0);
+}
+
+enum Category {
+  Header,   // type bytes and length fields
+  Index,    // offset tables of Arrays and Objects
+  Padding,  // unused bytes in Arrays and Objects
+  Keys,     // Object keys
+  Strings,  // String payloads
+  Numbers,  // payloads of numbers, dates and SmallInts
+  Other,    // everything else, e.g. Null, Bool and Binary payloads
+  NumCategories
+};
+
+static char const* const categoryNames[NumCategories] = {
+    "header", "index", "padding", "keys", "strings", "numbers", "other"};
+
+struct Breakdown {
+  uint64_t count = 0;
+  uint64_t bytes[NumCategories] = {};
+
+  uint64_t total() const {
+    uint64_t sum = 0;
+    for (auto b : bytes) {
+      sum += b;
+    }
+    return sum;
+  }
+
+  void add(Breakdown const& other) {
+    count += other.count;
+    for (int i = 0; i < NumCategories; ++i) {
+      bytes[i] += other.bytes[i];
+    }
+  }
+};
+
+struct PathStats {
+  uint64_t count = 0;
+  // bytes of the values, including everything they contain
+  uint64_t bytes = 0;
+  // bytes of the keys naming the values
+  uint64_t keyBytes = 0;
+};
+
+struct Profile {
+  uint64_t values = 0;
+  uint64_t bytes = 0;
+  Breakdown total;
+  std::map<std::string, Breakdown> types;
+  std::map<std::string, PathStats> paths;
+  // string keys and how often they occur, to build a translator
+  std::unordered_map<std::string, uint64_t> keys;
+  bool translatedKeys = false;
+};
+
+static std::string keyName(Slice const& key) {
+  if (key.isString()) {
+    return key.copyString();
+  }
+  // key translated with an attribute translator we don't have
+  return "#" + std::to_string(key.getUInt());
+}
+
+static void analyze(Slice const& slice, std::string const& path,
+                    Profile& profile);
+
+// accounts the bytes of an Array or Object that are not spent on members
+static void analyzeCompound(Slice const& slice, std::string const& path,
+                            Breakdown& own, Profile& profile) {
+  uint8_t const head = slice.head();
+  ValueLength const size = slice.byteSize();
+  if (head == 0x01 || head == 0x0a) {
+    own.bytes[Header] += 1;
+    return;
+  }
+  if (slice.isDeltaArray()) {
+    // delta-encoded: byte length and number of members, the blocks and
+    // the offsets of all blocks but the first
+    uint8_t const* p = slice.start() + 1;
+    p += getVariableValueLengthSize(p);
+    p += getVariableValueLengthSize(p);
+    ValueLength const header = static_cast<ValueLength>(p - slice.start());
+    ValueLength const nrBlocks =
+        (slice.length() + DeltaSpan::blockSize - 1) / DeltaSpan::blockSize;
+    ValueLength const index = (nrBlocks > 1 ? (nrBlocks - 1) * 4 : 0);
+    own.bytes[Header] += header;
+    own.bytes[Index] += index;
+    own.bytes[Numbers] += size - header - index;
+    return;
+  }
+  if (slice.isPackedArray()) {
+    // packed: number of members, followed by numbers without type bytes
+    ValueLength const payload = slice.length() * (head == 0xe0 ? 4 : 8);
+    own.bytes[Header] += size - payload;
+    own.bytes[Numbers] += payload;
+    return;
+  }
+
+  ValueLength header = 0;
+  ValueLength index = 0;
+  if (head >= 0x02 && head <= 0x05) {
+    header = 1 + (ValueLength(1) << (head - 0x02));
+  } else if (head >= 0x06 && head <= 0x12) {
+    ValueLength const width = ValueLength(1)
+                              << ((head >= 0x0f ? head - 0x0f
+                                                : (head >= 0x0b ? head - 0x0b
+                                                                : head - 0x06)));
+    // byte length and number of items, which is stored at the end for
+    // 8-byte widths
+    header = 1 + 2 * width;
+    index = slice.length() * width;
+  }
+
+  ValueLength members = 0;
+  if (slice.isArray()) {
+    std::string const memberPath = path + "[*]";
+    ArrayIterator it(slice);
+    while (it.valid()) {
+      Slice value = it.value();
+      members += value.byteSize();
+      PathStats& stats = profile.paths[memberPath];
+      ++stats.count;
+      stats.bytes += value.byteSize();
+      analyze(value, memberPath, profile);
+      it.next();
+    }
+  } else {
+    ObjectIterator it(slice, true);
+    while (it.valid()) {
+      Slice key = it.key(false);
+      Slice value = it.value();
+      members += value.byteSize();
+      if (head != 0x16) {
+        // the names of rows of shaped Arrays are stored in the shape
+        members += key.byteSize();
+        own.bytes[Keys] += key.byteSize();
+      }
+      std::string const name = keyName(key);
+      if (key.isString()) {
+        ++profile.keys[name];
+      } else {
+        profile.translatedKeys = true;
+      }
+      std::string const memberPath = path.empty() ? name : path + "." + name;
+      PathStats& stats = profile.paths[memberPath];
+      ++stats.count;
+      stats.bytes += value.byteSize();
+      stats.keyBytes += key.byteSize();
+      analyze(value, memberPath, profile);
+      it.next();
+    }
+  }
+
+  if (head == 0x15) {
+    // shaped: the attribute names of all rows are stored once
+    ValueLength const shape = slice.getShape().byteSize();
+    own.bytes[Keys] += shape;
+    members += shape;
+  }
+  if (head >= 0x13 && head <= 0x16) {
+    // compact, shaped or row: byte length, number of items or distance to
+    // the shape as variable length values
+    header = size - members;
+  }
+  own.bytes[Header] += header;
+  own.bytes[Index] += index;
+  own.bytes[Padding] += size - members - header - index;
+}
+
+static void analyze(Slice const& slice, std::string const& path,
+                    Profile& profile) {
+  Breakdown own;
+  own.count = 1;
+  ValueLength const size = slice.byteSize();
+
+  switch (slice.type()) {
+    case ValueType::Array:
+    case ValueType::Object:
+      analyzeCompound(slice, path, own, profile);
+      break;
+    case ValueType::String: {
+      ValueLength const header = (slice.head() == 0xbf) ? 9 : 1;
+      own.bytes[Header] += header;
+      own.bytes[Strings] += size - header;
+      break;
+    }
+    case ValueType::SmallInt:
+      own.bytes[Numbers] += size;
+      break;
+    case ValueType::Double:
+    case ValueType::UTCDate:
+    case ValueType::Int:
+    case ValueType::UInt:
+      own.bytes[Header] += 1;
+      own.bytes[Numbers] += size - 1;
+      break;
+    default:
+      if (size > 1) {
+        own.bytes[Header] += 1;
+        own.bytes[Other] += size - 1;
+      } else {
+        own.bytes[Other] += size;
+      }
+      break;
+  }
+
+  profile.types[valueTypeName(slice.type())].add(own);
+  profile.total.add(own);
+}
+
+static void rebuildValue(Builder& builder, Slice const& slice);
+
+static void rebuildMember(Builder& builder, char const* key,
+                          ValueLength keyLength, Slice const& value);
+
+static void rebuildObject(Builder& builder, Slice const& slice) {
+  ObjectIterator it(slice, true);
+  while (it.valid()) {
+    ValueLength length;
+    char const* key = it.key(false).getString(length);
+    rebuildMember(builder, key, length, it.value());
+    it.next();
+  }
+  builder.close();
+}
+
+static void rebuildMember(Builder& builder, char const* key,
+                          ValueLength keyLength, Slice const& value) {
+  if (value.isObject()) {
+    builder.add(key, checkOverflow(keyLength), Value(ValueType::Object));
+    rebuildObject(builder, value);
+  } else if (value.isArray()) {
+    builder.add(key, checkOverflow(keyLength), Value(ValueType::Array));
+    ArrayIterator it(value);
+    while (it.valid()) {
+      rebuildValue(builder, it.value());
+      it.next();
+    }
+    builder.close();
+  } else {
+    builder.add(key, checkOverflow(keyLength), value);
+  }
+}
+
+// builds the value again, with the options of the builder
+static void rebuildValue(Builder& builder, Slice const& slice) {
+  if (slice.isObject()) {
+    builder.add(Value(ValueType::Object));
+    rebuildObject(builder, slice);
+  } else if (slice.isArray()) {
+    builder.add(Value(ValueType::Array));
+    ArrayIterator it(slice);
+    while (it.valid()) {
+      rebuildValue(builder, it.value());
+      it.next();
+    }
+    builder.close();
+  } else {
+    builder.add(slice);
+  }
+}
+
+// a translator for all keys that occur more than once, the most frequent
+// keys get the smallest ids
+static std::unique_ptr<AttributeTranslator> buildTranslator(
+    Profile const& profile) {
+  std::vector<std::pair<std::string, uint64_t>> keys;
+  for (auto const& it : profile.keys) {
+    if (it.second > 1 && it.first.size() >= 2) {
+      keys.emplace_back(it.first, it.second);
+    }
+  }
+  std::sort(keys.begin(), keys.end(),
+            [](std::pair<std::string, uint64_t> const& lhs,
+               std::pair<std::string, uint64_t> const& rhs) {
+              return lhs.second > rhs.second ||
+                     (lhs.second == rhs.second && lhs.first < rhs.first);
+            });
+
+  std::unique_ptr<AttributeTranslator> translator(new AttributeTranslator);
+  uint64_t id = 0;
+  for (auto const& it : keys) {
+    translator->add(it.first, ++id);
+  }
+  translator->seal();
+  return translator;
+}
+
+struct Layout {
+  char const* name;
+  bool compact;
+  bool translate;
+  uint64_t bytes;
+  uint64_t dictionary;
+};
+
+static uint64_t percent(uint64_t part, uint64_t total) {
+  return total == 0 ? 0 : (part * 100 + total / 2) / total;
+}
+
+static void printBreakdownHeader(std::string const& title) {
+  std::cout << std::left << std::setw(24) << title << std::right
+            << std::setw(10) << "count";
+  for (auto name : categoryNames) {
+    std::cout << std::setw(12) << name;
+  }
+  std::cout << std::setw(14) << "total" << std::endl;
+}
+
+static void printBreakdown(std::string const& name, Breakdown const& b) {
+  std::cout << std::left << std::setw(24) << name << std::right
+            << std::setw(10) << b.count;
+  for (auto bytes : b.bytes) {
+    std::cout << std::setw(12) << bytes;
+  }
+  std::cout << std::setw(14) << b.total() << std::endl;
+}
+
+static bool readFile(std::string const& filename, std::string& s) {
+  std::ifstream ifs(filename, std::ifstream::in | std::ifstream::binary);
+
+  if (!ifs.is_open()) {
+    std::cerr << "Cannot read infile '" << filename << "'" << std::endl;
+    return false;
+  }
+
+  char buffer[4096];
+  while (ifs.good()) {
+    ifs.read(&buffer[0], sizeof(buffer));
+    s.append(buffer, checkOverflow(ifs.gcount()));
+  }
+  ifs.close();
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  VELOCYPACK_GLOBAL_EXCEPTION_TRY
+
+  std::vector<std::string> files;
+  size_t maxPaths = 25;
+  bool layouts = true;
+  bool allowFlags = true;
+
+  int i = 1;
+  while (i < argc) {
+    char const* p = argv[i];
+    if (allowFlags && isOption(p, "--help")) {
+      usage(argv);
+      return EXIT_SUCCESS;
+    } else if (allowFlags && isOption(p, "--paths") && i + 1 < argc) {
+      maxPaths = std::stoul(argv[++i]);
+    } else if (allowFlags && isOption(p, "--no-layouts")) {
+      layouts = false;
+    } else if (allowFlags && isOption(p, "--")) {
+      allowFlags = false;
+    } else if (allowFlags && strncmp(p, "--", 2) == 0) {
+      usage(argv);
+      return EXIT_FAILURE;
+    } else {
+      files.emplace_back(p);
+    }
+    ++i;
+  }
+
+  if (files.empty()) {
+    usage(argv);
+    return EXIT_FAILURE;
+  }
+
+  Profile profile;
+  std::vector<std::string> contents;
+  Validator validator;
+
+  for (auto const& file : files) {
+    std::string s;
+    if (!readFile(file, s)) {
+      return EXIT_FAILURE;
+    }
+    size_t offset = 0;
+    while (offset < s.size()) {
+      uint8_t const* p = reinterpret_cast<uint8_t const*>(s.data()) + offset;
+      try {
+        validator.validate(p, s.size() - offset, true);
+      } catch (Exception const& ex) {
+        std::cerr << "Invalid VPack value in infile '" << file
+                  << "' at offset " << offset << ": " << ex.what()
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+      Slice slice(p);
+      analyze(slice, "", profile);
+      ++profile.values;
+      profile.bytes += slice.byteSize();
+      offset += checkOverflow(slice.byteSize());
+    }
+    contents.emplace_back(std::move(s));
+  }
+
+  std::cout << "Values: " << profile.values << ", bytes: " << profile.bytes
+            << std::endl
+            << std::endl;
+
+  // totals per category
+  std::cout << std::left << std::setw(24) << "category" << std::right
+            << std::setw(14) << "bytes" << std::setw(8) << "%" << std::endl;
+  for (int c = 0; c < NumCategories; ++c) {
+    std::cout << std::left << std::setw(24) << categoryNames[c] << std::right
+              << std::setw(14) << profile.total.bytes[c] << std::setw(8)
+              << percent(profile.total.bytes[c], profile.bytes) << std::endl;
+  }
+  std::cout << std::endl;
+
+  // per type, only the bytes of the values themselves, not of their members
+  printBreakdownHeader("type");
+  for (auto const& it : profile.types) {
+    printBreakdown(it.first, it.second);
+  }
+  printBreakdown("total", profile.total);
+  std::cout << std::endl;
+
+  // largest attribute paths
+  std::vector<std::pair<std::string, PathStats>> paths(profile.paths.begin(),
+                                                       profile.paths.end());
+  std::sort(paths.begin(), paths.end(),
+            [](std::pair<std::string, PathStats> const& lhs,
+               std::pair<std::string, PathStats> const& rhs) {
+              uint64_t const l = lhs.second.bytes + lhs.second.keyBytes;
+              uint64_t const r = rhs.second.bytes + rhs.second.keyBytes;
+              return l > r || (l == r && lhs.first < rhs.first);
+            });
+  if (!paths.empty() && maxPaths > 0) {
+    std::cout << std::left << std::setw(40) << "path" << std::right
+              << std::setw(10) << "count" << std::setw(14) << "key bytes"
+              << std::setw(14) << "value bytes" << std::setw(8) << "%"
+              << std::endl;
+    for (size_t n = 0; n < paths.size() && n < maxPaths; ++n) {
+      auto const& stats = paths[n].second;
+      std::cout << std::left << std::setw(40) << paths[n].first << std::right
+                << std::setw(10) << stats.count << std::setw(14)
+                << stats.keyBytes << std::setw(14) << stats.bytes
+                << std::setw(8)
+                << percent(stats.keyBytes + stats.bytes, profile.bytes)
+                << std::endl;
+    }
+    if (paths.size() > maxPaths) {
+      std::cout << "... " << (paths.size() - maxPaths)
+                << " more path(s)" << std::endl;
+    }
+    std::cout << std::endl;
+  }
+
+  if (!layouts) {
+    return EXIT_SUCCESS;
+  }
+  if (profile.translatedKeys) {
+    std::cout << "Sizes with other options cannot be computed, because the "
+                 "values contain translated keys"
+              << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  std::unique_ptr<AttributeTranslator> translator = buildTranslator(profile);
+  Layout all[] = {{"indexed", false, false, 0, 0},
+                  {"compact", true, false, 0, 0},
+                  {"indexed, translated keys", false, true, 0, 0},
+                  {"compact, translated keys", true, true, 0, 0}};
+  uint64_t jsonBytes = 0;
+
+  for (auto& layout : all) {
+    Options options;
+    // sorting Object indexes translates keys with the default translator
+    std::unique_ptr<AttributeTranslatorScope> scope;
+    options.buildUnindexedArrays = layout.compact;
+    options.buildUnindexedObjects = layout.compact;
+    if (layout.translate) {
+      options.attributeTranslator = translator.get();
+      scope.reset(new AttributeTranslatorScope(translator.get()));
+      if (translator->count() > 0) {
+        layout.dictionary = Slice(translator->builder()->data()).byteSize();
+      }
+    }
+    for (auto const& s : contents) {
+      size_t offset = 0;
+      while (offset < s.size()) {
+        Slice slice(reinterpret_cast<uint8_t const*>(s.data()) + offset);
+        Builder builder(&options);
+        rebuildValue(builder, slice);
+        layout.bytes += builder.size();
+        if (&layout == &all[0]) {
+          jsonBytes += slice.toJson().size();
+        }
+        offset += checkOverflow(slice.byteSize());
+      }
+    }
+  }
+
+  std::cout << std::left << std::setw(32) << "layout" << std::right
+            << std::setw(14) << "bytes" << std::setw(14) << "dictionary"
+            << std::setw(8) << "%" << std::endl;
+  std::cout << std::left << std::setw(32) << "as stored" << std::right
+            << std::setw(14) << profile.bytes << std::setw(14) << 0
+            << std::setw(8) << 100 << std::endl;
+  for (auto const& layout : all) {
+    std::cout << std::left << std::setw(32) << layout.name << std::right
+              << std::setw(14) << layout.bytes << std::setw(14)
+              << layout.dictionary << std::setw(8)
+              << percent(layout.bytes, profile.bytes) << std::endl;
+  }
+  std::cout << std::left << std::setw(32) << "JSON" << std::right
+            << std::setw(14) << jsonBytes << std::setw(14) << 0
+            << std::setw(8) << percent(jsonBytes, profile.bytes) << std::endl;
+
+  VELOCYPACK_GLOBAL_EXCEPTION_CATCH
+}
@@ -28,6 +28,11 @@
 #include <string>
 #include <fstream>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #include "velocypack/vpack.h"
 #include "velocypack/velocypack-exception-macros.h"
 
@@ -56,6 +61,46 @@ static void usage(char* argv[]) {
   std::cout << " --print-unsupported       convert non-JSON types into something else" << std::endl;
   std::cout << " --no-print-unsupported    fail when encoutering a non-JSON type" << std::endl;
   std::cout << " --hex                     try to turn hex-encoded input into binary vpack" << std::endl;
+  std::cout << " --parallel                convert large arrays/objects using multiple threads" << std::endl;
+  std::cout << " --framed                  read a framed VPack file and print its documents" << std::endl;
+  std::cout << "                           one after the other" << std::endl;
+  std::cout << " --verify                  check checksums and validate documents of framed files" << std::endl;
+}
+
+static int dumpFramedFile(std::string const& infile, char const* outfileName,
+                          bool toStdOut, Options const& options, bool verify) {
+  std::ofstream ofs(outfileName, std::ofstream::out);
+
+  if (!ofs.is_open()) {
+    std::cerr << "Cannot write outfile '" << outfileName << "'" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ValueLength documents = 0;
+  try {
+    FramedFileReader reader(infile);
+    for (auto it = reader.begin(); it != reader.end(); ++it) {
+      if (verify) {
+        reader.verify(it.index());
+      }
+      ofs << Dumper::toString(*it, &options) << std::endl;
+      ++documents;
+    }
+  } catch (Exception const& ex) {
+    std::cerr << "An exception occurred while processing document "
+              << documents << " of infile '" << infile << "': " << ex.what()
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ofs.close();
+
+  if (!toStdOut) {
+    std::cout << "Successfully converted framed VPack infile '" << infile
+              << "'" << std::endl;
+    std::cout << "Documents converted: " << documents << std::endl;
+  }
+  return EXIT_SUCCESS;
 }
 
 static std::string convertFromHex(std::string const& value) {
@@ -105,6 +150,9 @@ int main(int argc, char* argv[]) {
   bool pretty = true;
   bool printUnsupported = true;
   bool hex = false;
+  bool parallel = false;
+  bool framed = false;
+  bool verify = false;
 
   int i = 1;
   while (i < argc) {
@@ -122,6 +170,12 @@ int main(int argc, char* argv[]) {
       printUnsupported = false;
     } else if (allowFlags && isOption(p, "--hex")) {
       hex = true;
+    } else if (allowFlags && isOption(p, "--parallel")) {
+      parallel = true;
+    } else if (allowFlags && isOption(p, "--framed")) {
+      framed = true;
+    } else if (allowFlags && isOption(p, "--verify")) {
+      verify = true;
     } else if (allowFlags && isOption(p, "--")) {
       allowFlags = false;
     } else if (infileName == nullptr) {
@@ -169,6 +223,15 @@ int main(int argc, char* argv[]) {
   }
 #endif
 
+  Options options;
+  options.prettyPrint = pretty;
+  options.unsupportedTypeBehavior = 
+    (printUnsupported ? Options::ConvertUnsupportedType : Options::FailOnUnsupportedType);
+
+  if (framed) {
+    return dumpFramedFile(infile, outfileName, toStdOut, options, verify);
+  }
+
   std::string s;
   std::ifstream ifs(infile, std::ifstream::in);
 
@@ -192,17 +255,59 @@ int main(int argc, char* argv[]) {
 
   Slice const slice(s.c_str());
 
-  Options options;
-  options.prettyPrint = pretty;
-  options.unsupportedTypeBehavior = 
-    (printUnsupported ? Options::ConvertUnsupportedType : Options::FailOnUnsupportedType);
+#ifndef _WIN32
+  // stream the JSON directly into the output file descriptor instead of
+  // building up the complete result in memory first
+  int fd = STDOUT_FILENO;
+  if (!toStdOut) {
+    fd = ::open(outfileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+      std::cerr << "Cannot write outfile '" << outfileName << "'" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
 
+  ValueLength outputSize = 0;
+  try {
+    FdSink sink(fd);
+    Dumper dumper(&sink, &options);
+    if (parallel) {
+      dumper.dumpParallel(slice);
+    } else {
+      dumper.dump(slice);
+    }
+    sink.flush();
+    outputSize = sink.bytesWritten();
+  } catch (Exception const& ex) {
+    std::cerr << "An exception occurred while processing infile '" << infile
+              << "': " << ex.what() << std::endl;
+    if (!toStdOut) {
+      ::close(fd);
+    }
+    return EXIT_FAILURE;
+  } catch (...) {
+    std::cerr << "An unknown exception occurred while processing infile '"
+              << infile << "'" << std::endl;
+    if (!toStdOut) {
+      ::close(fd);
+    }
+    return EXIT_FAILURE;
+  }
+
+  if (!toStdOut) {
+    ::close(fd);
+  }
+#else
   Buffer<char> buffer(4096);
   CharBufferSink sink(&buffer);
   Dumper dumper(&sink, &options);
 
   try {
-    dumper.dump(slice);
+    if (parallel) {
+      dumper.dumpParallel(slice);
+    } else {
+      dumper.dump(slice);
+    }
   } catch (Exception const& ex) {
     std::cerr << "An exception occurred while processing infile '" << infile
               << "': " << ex.what() << std::endl;
@@ -220,22 +325,20 @@ int main(int argc, char* argv[]) {
     return EXIT_FAILURE;
   }
 
-  // reset stream
-  if (!toStdOut) {
-    ofs.seekp(0);
-  }
-
   // write into stream
   char const* start = buffer.data();
   ofs.write(start, buffer.size());
 
   ofs.close();
 
+  ValueLength const outputSize = buffer.size();
+#endif
+
   if (!toStdOut) {
     std::cout << "Successfully converted JSON infile '" << infile << "'"
               << std::endl;
     std::cout << "VPack Infile size: " << s.size() << std::endl;
-    std::cout << "JSON Outfile size: " << buffer.size() << std::endl;
+    std::cout << "JSON Outfile size: " << outputSize << std::endl;
   }
   
   VELOCYPACK_GLOBAL_EXCEPTION_CATCH